@@ -24,6 +24,7 @@
 #include "Host.h"
 #include "TAlias.h"
 #include "TLuaInterpreter.h"
+#include "TMatchSubject.h"
 
 #include "pre_guard.h"
 #include <QStringList>
@@ -237,9 +238,11 @@ bool AliasUnit::processDataStream(const QString& data)
     QString lua_command_string = "command";
     Lua->set_lua_string(lua_command_string, data);
     bool state = false;
+    // Encoded just once for every alias in the tree:
+    const TMatchSubject subject(data);
     for (auto alias : mAliasRootNodeList) {
         // = data.replace( "\n", "" );
-        if (alias->match(data)) {
+        if (alias->match(subject)) {
             state = true;
         }
     }
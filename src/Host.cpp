@@ -90,10 +90,16 @@ Host::Host(int port, const QString& hostname, const QString& login, const QStrin
 , mpEditorDialog(0)
 , mpMap(new TMap(this))
 , mpNotePad(0)
+, mpReplayBenchmark(0)
 , mPort(port)
 , mPrintCommand(true)
 , mIsCurrentLogFileInHtmlFormat(false)
 , mIsLoggingTimestamps(false)
+, mIsLogCompressed(false)
+, mLogFlushInterval(1)
+, mLogFlushSize(64)
+, mLogRotateSize(0)
+, mLogRotateInterval(0)
 , mResetProfile(false)
 , mRetries(5)
 , mSaveProfileOnExit(false)
@@ -104,6 +110,7 @@ Host::Host(int port, const QString& hostname, const QString& login, const QStrin
 , mUSE_FORCE_LF_AFTER_PROMPT(false)
 , mUSE_IRE_DRIVER_BUGFIX(true)
 , mUSE_UNIX_EOL(false)
+, mUseNetworkThread(false)
 , mWrapAt(100)
 , mWrapIndentCount(0)
 , mBlack(Qt::black)
@@ -613,17 +620,24 @@ void Host::raiseEvent(const TEvent& pE)
         return;
     }
 
-    if (mEventHandlerMap.contains(pE.mArgumentList.at(0))) {
-        QList<TScript*> scriptList = mEventHandlerMap.value(pE.mArgumentList.at(0));
-        for (auto& script : scriptList) {
+    const QString& eventName = pE.mArgumentList.at(0);
+
+    // The lists are only taken by (implicitly shared) value rather than by
+    // reference because a handler may register or unregister handlers for the
+    // same event, they are not actually copied unless that happens:
+    auto itScripts = mEventHandlerMap.constFind(eventName);
+    if (itScripts != mEventHandlerMap.constEnd()) {
+        const QList<TScript*> scriptList = itScripts.value();
+        for (auto script : scriptList) {
             script->callEventHandler(pE);
         }
     }
 
-    if (mAnonymousEventHandlerFunctions.contains(pE.mArgumentList.at(0))) {
-        QStringList functionsList = mAnonymousEventHandlerFunctions.value(pE.mArgumentList.at(0));
-        for (int i = 0, total = functionsList.size(); i < total; ++i) {
-            mLuaInterpreter.callEventHandler(functionsList.at(i), pE);
+    auto itFunctions = mAnonymousEventHandlerFunctions.constFind(eventName);
+    if (itFunctions != mAnonymousEventHandlerFunctions.constEnd()) {
+        const QStringList functionsList = itFunctions.value();
+        for (auto& function : functionsList) {
+            mLuaInterpreter.callEventHandler(function, pE);
         }
     }
 }
@@ -29,6 +29,7 @@
 #include "KeyUnit.h"
 #include "ScriptUnit.h"
 #include "TLuaInterpreter.h"
+#include "TProfiler.h"
 #include "TimerUnit.h"
 #include "TriggerUnit.h"
 #include "ctelnet.h"
@@ -53,6 +54,7 @@ class LuaInterface;
 class TMap;
 class TRoom;
 class TConsole;
+class TReplayBenchmark;
 class dlgNotepad;
 class TMap;
 
@@ -94,6 +96,7 @@ public:
     ActionUnit* getActionUnit() { return &mActionUnit; }
     KeyUnit* getKeyUnit() { return &mKeyUnit; }
     ScriptUnit* getScriptUnit() { return &mScriptUnit; }
+    TProfiler* getProfiler() { return &mProfiler; }
 
     void connectToServer();
     void send(QString cmd, bool wantPrint = true, bool dontExpandAliases = false);
@@ -213,6 +216,8 @@ public:
     dlgTriggerEditor* mpEditorDialog;
     QScopedPointer<TMap> mpMap;
     dlgNotepad* mpNotePad;
+    // Only set while a replay benchmark is being run:
+    TReplayBenchmark* mpReplayBenchmark;
 
     bool mPrintCommand;
 
@@ -229,6 +234,15 @@ public:
     bool mIsNextLogFileInHtmlFormat;
 
     bool mIsLoggingTimestamps;
+    // Only take effect when a log is started:
+    bool mIsLogCompressed;
+    // In seconds:
+    int mLogFlushInterval;
+    // In KiB:
+    int mLogFlushSize;
+    // In MiB and hours, 0 to never start a new log file:
+    int mLogRotateSize;
+    int mLogRotateInterval;
     bool mResetProfile;
     int mScreenHeight;
     int mScreenWidth;
@@ -240,6 +254,8 @@ public:
     bool mUSE_FORCE_LF_AFTER_PROMPT;
     bool mUSE_IRE_DRIVER_BUGFIX;
     bool mUSE_UNIX_EOL;
+    // Read the socket and inflate MCCP data in a separate thread:
+    bool mUseNetworkThread;
     int mWrapAt;
     int mWrapIndentCount;
 
@@ -332,6 +348,7 @@ private:
     AliasUnit mAliasUnit;
     ActionUnit mActionUnit;
     KeyUnit mKeyUnit;
+    TProfiler mProfiler;
 
     QString mBufferIncomingData;
     bool mCodeCompletion;
@@ -35,6 +35,7 @@
 
 #include "pre_guard.h"
 #include <QtEvents>
+#include <QtMath>
 #include <QtUiTools>
 #include <QAction>
 #include <QCheckBox>
@@ -58,6 +59,28 @@
 #include <QTreeWidgetItem>
 #include "post_guard.h"
 
+#include <algorithm>
+
+// Size (in device independent pixels) of the square tiles that the parts of
+// the map that do not change from one paint to the next are cached in:
+static const int scMapTileSize = 256;
+// How many tiles are kept (if the view does not need more) before those away
+// from it are thrown out:
+static const int scMaxMapTiles = 64;
+
+// The compass directions that exits are drawn as straight lines for, with the
+// key that a custom line replacing one is stored under:
+static const struct
+{
+    int direction;
+    const char* customLineKey;
+} scDrawnExitDirections[] = {{DIR_NORTH, "N"}, {DIR_NORTHWEST, "NW"}, {DIR_EAST, "E"}, {DIR_SOUTHEAST, "SE"}, {DIR_SOUTH, "S"}, {DIR_SOUTHWEST, "SW"}, {DIR_WEST, "W"}, {DIR_NORTHEAST, "NE"}};
+
+static quint64 mapTileKey(const int column, const int row)
+{
+    return (static_cast<quint64>(static_cast<quint32>(column)) << 32) | static_cast<quint32>(row);
+}
+
 
 T2DMap::T2DMap(QWidget* parent)
 : QWidget(parent)
@@ -88,6 +111,7 @@ T2DMap::T2DMap(QWidget* parent)
 , mpCurrentLineArrow()
 , mCurrentLineArrow()
 , mShowGrid()
+, mIsMapCacheValid(false)
 {
     mMultiSelectionListWidget.setColumnCount(2);
     mMultiSelectionListWidget.hideColumn(1);
@@ -164,6 +188,8 @@ void T2DMap::init()
 
     mMapperUseAntiAlias = mpHost->mMapperUseAntiAlias;
     mPixMap.clear();
+    // The room symbols are about to be redrawn:
+    mIsMapCacheValid = false;
     QFont f = QFont(QFont("Bitstream Vera Sans Mono", 20, QFont::Normal)); //( QFont("Monospace", 10, QFont::Courier) );
     f.setPointSize(gzoom);
     f.setBold(true);
@@ -567,6 +593,732 @@ void T2DMap::slot_switchArea(QString name)
 }
 
 
+bool T2DMap::MapCacheKey::operator==(const MapCacheKey& other) const
+{
+    return areaId == other.areaId && zLevel == other.zLevel && tx == other.tx && ty == other.ty && roomSize == other.roomSize && exitSize == other.exitSize
+            && devicePixelRatio == other.devicePixelRatio && isGridMode == other.isGridMode && isAntiAliased == other.isAntiAliased && isBubbleMode == other.isBubbleMode
+            && isShowingRoomIds == other.isShowingRoomIds && mapRevision == other.mapRevision && colors == other.colors;
+}
+
+// Throws away the cached tiles if what they were drawn from has changed and
+// then works out, going through the rooms on the level once, where each room
+// draws its exits and where the area exits are - so that neither has to be
+// redone on every paint:
+void T2DMap::updateMapCache(TArea* pArea, const int zLevel, const float tx, const float ty)
+{
+    MapCacheKey key;
+    key.areaId = mAID;
+    key.zLevel = zLevel;
+    key.tx = tx;
+    key.ty = ty;
+    key.roomSize = rSize;
+    key.exitSize = eSize;
+    key.devicePixelRatio = devicePixelRatioF();
+    key.isGridMode = pArea->gridMode;
+    key.isAntiAliased = mMapperUseAntiAlias;
+    key.isBubbleMode = mBubbleMode;
+    key.isShowingRoomIds = mShowRoomID;
+    key.mapRevision = mpMap->getMapDataRevision();
+    key.colors << mpHost->mBgColor_2.rgba() << mpHost->mFgColor_2.rgba() << mpHost->mRed_2.rgba() << mpHost->mGreen_2.rgba() << mpHost->mYellow_2.rgba() << mpHost->mBlue_2.rgba()
+               << mpHost->mMagenta_2.rgba() << mpHost->mCyan_2.rgba() << mpHost->mWhite_2.rgba() << mpHost->mBlack_2.rgba() << mpHost->mLightRed_2.rgba() << mpHost->mLightGreen_2.rgba()
+               << mpHost->mLightYellow_2.rgba() << mpHost->mLightBlue_2.rgba() << mpHost->mLightMagenta_2.rgba() << mpHost->mLightCyan_2.rgba() << mpHost->mLightWhite_2.rgba()
+               << mpHost->mLightBlack_2.rgba();
+    if (mIsMapCacheValid && key == mMapCacheKey) {
+        return;
+    }
+
+    mMapCacheKey = key;
+    mIsMapCacheValid = true;
+    mMapTiles.clear();
+    mScaledPixMap.clear();
+    mCachedExitBounds.clear();
+    mCachedAreaExits.clear();
+    if (pArea->gridMode) {
+        // No exits are drawn in grid mode
+        return;
+    }
+
+    // Enough to take in the exit stubs, area exit arrows, doors and one way
+    // arrows around the rooms at either end of an exit:
+    const float roomExtent = qMax(tx, ty) * (rSize + 1.0);
+    const float pointExtent = 5.0 / eSize * qMax(tx, ty) * rSize + qMax(tx, ty) / 4.0;
+    QListIterator<int> itRoom(pArea->getRoomsOnLevel(zLevel));
+    while (itRoom.hasNext()) {
+        const int id = itRoom.next();
+        TRoom* pR = mpMap->mpRoomDB->getRoom(id);
+        if (!pR) {
+            continue;
+        }
+
+        const QPointF center(pR->x * tx, pR->y * -1 * ty);
+        QRectF bounds(center.x() - roomExtent, center.y() - roomExtent, roomExtent * 2.0, roomExtent * 2.0);
+        QList<int> exitList;
+        QList<int> oneWayExits;
+        getDrawnExits(pR, exitList, oneWayExits);
+        for (int exitId : exitList) {
+            TRoom* pE = mpMap->mpRoomDB->getRoom(exitId);
+            if (!pE) {
+                continue;
+            }
+            if (pE->getArea() != mAID) {
+                // Drawn as a short arrow out of the room, the point half way
+                // along it is where it can be clicked on:
+                for (int direction = DIR_NORTH; direction <= DIR_SOUTHWEST; ++direction) {
+                    if (pR->getExit(direction) == exitId) {
+                        const QVector3D uDirection = mpMap->unitVectors.value(direction);
+                        mCachedAreaExits.insert(exitId, QPointF(center.x() + uDirection.x() * tx / 2, center.y() + uDirection.y() * ty / 2));
+                        break;
+                    }
+                }
+            } else {
+                bounds |= QRectF(pE->x * tx - pointExtent, pE->y * -1 * ty - pointExtent, pointExtent * 2.0, pointExtent * 2.0);
+            }
+        }
+
+        QMapIterator<QString, QList<QPointF>> itCustomLine(pR->customLines);
+        while (itCustomLine.hasNext()) {
+            itCustomLine.next();
+            for (const QPointF& point : itCustomLine.value()) {
+                bounds |= QRectF(point.x() * tx - pointExtent, point.y() * -1 * ty - pointExtent, pointExtent * 2.0, pointExtent * 2.0);
+            }
+        }
+
+        mCachedExitBounds.append(qMakePair(id, bounds));
+    }
+}
+
+// Returns the given tile of the cached map, drawing it first if needed:
+QPixmap T2DMap::getMapTile(TArea* pArea, const int zLevel, const float tx, const float ty, const int column, const int row)
+{
+    QPixmap& tile = mMapTiles[mapTileKey(column, row)];
+    if (!tile.isNull()) {
+        return tile;
+    }
+
+    const qreal ratio = devicePixelRatioF();
+    tile = QPixmap(qCeil(scMapTileSize * ratio), qCeil(scMapTileSize * ratio));
+    tile.setDevicePixelRatio(ratio);
+    tile.fill(mpHost->mBgColor_2);
+
+    QPainter p(&tile);
+    p.setFont(font());
+    if (mMapperUseAntiAlias) {
+        p.setRenderHint(QPainter::Antialiasing);
+    } else {
+        p.setRenderHint(QPainter::NonCosmeticDefaultPen);
+    }
+    p.translate(-column * scMapTileSize, -row * scMapTileSize);
+    const QRectF tileRect(column * scMapTileSize, row * scMapTileSize, scMapTileSize, scMapTileSize);
+
+    float wegBreite = 1 / eSize * tx * rSize;
+    QPen pen = p.pen();
+    pen.setColor(mpHost->mFgColor_2);
+    pen.setWidthF(wegBreite);
+    p.setPen(pen);
+
+    paintMapLabels(p, zLevel, tx, ty, tileRect, false);
+
+    if (!pArea->gridMode) {
+        for (const auto& exitBounds : mCachedExitBounds) {
+            if (!exitBounds.second.intersects(tileRect)) {
+                continue;
+            }
+            TRoom* pR = mpMap->mpRoomDB->getRoom(exitBounds.first);
+            if (pR) {
+                p.setPen(pen);
+                paintRoomExits(p, pR, tx, ty, wegBreite);
+            }
+        }
+    }
+
+    // The rooms that are (about) in the tile, in the same order for all the
+    // tiles so that any that overlap look the same on both sides of an edge:
+    const int margin = qCeil(rSize) + 1;
+    QList<int> roomIds = pArea->getRoomsInRect(qFloor(tileRect.left() / tx) - margin,
+                                               qCeil(tileRect.right() / tx) + margin,
+                                               qFloor(-tileRect.bottom() / ty) - margin,
+                                               qCeil(-tileRect.top() / ty) + margin,
+                                               zLevel);
+    std::sort(roomIds.begin(), roomIds.end());
+    for (int id : roomIds) {
+        TRoom* pR = mpMap->mpRoomDB->getRoom(id);
+        if (pR && pR->z == zLevel) {
+            paintRoom(p, pR, tx, ty, pArea->gridMode);
+        }
+    }
+
+    paintMapLabels(p, zLevel, tx, ty, tileRect, true);
+    return tile;
+}
+
+// The rooms that the room's exits in the eight compass directions lead to,
+// leaving out those that are drawn as custom lines, and which of them do not
+// have an exit straight back:
+void T2DMap::getDrawnExits(TRoom* pR, QList<int>& exitList, QList<int>& oneWayExits)
+{
+    const int id = pR->getId();
+    for (const auto& drawnExit : scDrawnExitDirections) {
+        const int exitId = pR->getExit(drawnExit.direction);
+        if (exitId <= 0 || pR->customLines.contains(QLatin1String(drawnExit.customLineKey))) {
+            continue;
+        }
+        exitList.append(exitId);
+        TRoom* pER = mpMap->mpRoomDB->getRoom(exitId);
+        if (pER && pER->getExit(mpMap->reverseDirections.value(drawnExit.direction)) != id) {
+            oneWayExits.append(exitId);
+        }
+    }
+}
+
+void T2DMap::paintMapLabels(QPainter& p, const int zLevel, const float tx, const float ty, const QRectF& clipRect, const bool isShowingOnTop)
+{
+    if (!mpMap->mapLabels.contains(mAID)) {
+        return;
+    }
+
+    QMapIterator<int, TMapLabel> it(mpMap->mapLabels.value(mAID));
+    while (it.hasNext()) {
+        it.next();
+        const TMapLabel& label = it.value();
+        if (label.pos.z() != zLevel || label.showOnTop != isShowingOnTop) {
+            continue;
+        }
+
+        QPointF lpos(label.pos.x() * tx, label.pos.y() * ty * -1);
+        int _lw = abs(label.size.width()) * tx;
+        int _lh = abs(label.size.height()) * ty;
+        if (label.noScaling) {
+            if (!QRectF(lpos, label.pix.size()).intersects(clipRect)) {
+                continue;
+            }
+            p.drawPixmap(lpos, label.pix);
+        } else {
+            if (!QRectF(lpos, QSizeF(_lw, _lh)).intersects(clipRect)) {
+                continue;
+            }
+            p.drawPixmap(lpos, label.pix.scaled(_lw, _lh));
+        }
+    }
+}
+
+// Draws the custom lines, exit stubs, exits (with the arrows for one way and
+// area exits) and doors of a room:
+void T2DMap::paintRoomExits(QPainter& p, TRoom* pR, const float tx, const float ty, const float wegBreite)
+{
+    float rx = pR->x * tx;
+    float ry = pR->y * -1 * ty;
+    int rz = pR->z;
+
+    QList<int> exitList;
+    QList<int> oneWayExits;
+    getDrawnExits(pR, exitList, oneWayExits);
+
+    QMapIterator<QString, QList<QPointF>> itk(pR->customLines);
+    while (itk.hasNext()) {
+        itk.next();
+        paintCustomLine(p, pR, itk.key(), tx, ty, wegBreite, false);
+    }
+
+    // draw exit stubs
+    for (int direction : pR->exitStubs) {
+        QVector3D uDirection = mpMap->unitVectors.value(direction);
+        p.drawLine(rx + rSize * (int)uDirection.x() / 2, ry + rSize * (int)uDirection.y(), rx + (int)uDirection.x() * (rSize * 3 / 4 * tx), ry + uDirection.y() * (rSize * 3 / 4 * ty));
+    }
+
+    QPen pen;
+    QPen __pen;
+    for (int& k : exitList) {
+        int rID = k;
+        if (rID <= 0) {
+            continue;
+        }
+
+        bool areaExit;
+
+        TRoom* pE = mpMap->mpRoomDB->getRoom(rID);
+        if (!pE) {
+            continue;
+        }
+
+        if (pE->getArea() != mAID) {
+            areaExit = true;
+        } else {
+            areaExit = false;
+        }
+        float ex = pE->x * tx;
+        float ey = pE->y * ty * -1;
+        int ez = pE->z;
+
+        QVector3D p1(ex, ey, ez);
+        QVector3D p2(rx, ry, rz);
+        QLine _line;
+        if (!areaExit) {
+            // one way exit or 2 way exit?
+            if (!oneWayExits.contains(rID)) {
+                p.drawLine((int)p1.x(), (int)p1.y(), (int)p2.x(), (int)p2.y());
+            } else {
+                // one way exit draw arrow
+
+                QLineF l0 = QLineF(p2.x(), p2.y(), p1.x(), p1.y());
+                QLineF k0 = l0;
+                k0.setLength((l0.length() - wegBreite * 5) * 0.5);
+                qreal dx = k0.dx();
+                qreal dy = k0.dy();
+                QPen _tp = p.pen();
+                QPen _tp2 = _tp;
+                _tp2.setStyle(Qt::DotLine);
+                p.setPen(_tp2);
+                p.drawLine(l0);
+                p.setPen(_tp);
+                l0.setLength(wegBreite * 5);
+                QPointF _p1 = l0.p2();
+                QPointF _p2 = l0.p1();
+                QLineF l1 = QLineF(l0);
+                qreal w1 = l1.angle() - 90.0;
+                QLineF l2;
+                l2.setP1(_p2);
+                l2.setAngle(w1);
+                l2.setLength(wegBreite * 2);
+                QPointF _p3 = l2.p2();
+                l2.setAngle(l2.angle() + 180.0);
+                QPointF _p4 = l2.p2();
+                QPolygonF _poly;
+                _poly.append(_p1);
+                _poly.append(_p3);
+                _poly.append(_p4);
+
+                QBrush brush = p.brush();
+                brush.setColor(QColor(255, 100, 100));
+                brush.setStyle(Qt::SolidPattern);
+                QPen arrowPen = p.pen();
+                arrowPen.setCosmetic(mMapperUseAntiAlias);
+                arrowPen.setStyle(Qt::SolidLine);
+                p.setPen(arrowPen);
+                p.setBrush(brush);
+                p.drawPolygon(_poly.translated(dx, dy));
+            }
+
+        } else {
+            __pen = p.pen();
+            pen = p.pen();
+            pen.setWidthF(wegBreite);
+            pen.setCosmetic(mMapperUseAntiAlias);
+            pen.setColor(getColor(k));
+            p.setPen(pen);
+            if (pR->getSouth() == rID) {
+                _line = QLine(p2.x(), p2.y() + ty, p2.x(), p2.y());
+            } else if (pR->getNorth() == rID) {
+                _line = QLine(p2.x(), p2.y() - ty, p2.x(), p2.y());
+            } else if (pR->getWest() == rID) {
+                _line = QLine(p2.x() - tx, p2.y(), p2.x(), p2.y());
+            } else if (pR->getEast() == rID) {
+                _line = QLine(p2.x() + tx, p2.y(), p2.x(), p2.y());
+            } else if (pR->getNorthwest() == rID) {
+                _line = QLine(p2.x() - tx, p2.y() - ty, p2.x(), p2.y());
+            } else if (pR->getNortheast() == rID) {
+                _line = QLine(p2.x() + tx, p2.y() - ty, p2.x(), p2.y());
+            } else if (pR->getSoutheast() == rID) {
+                _line = QLine(p2.x() + tx, p2.y() + ty, p2.x(), p2.y());
+            } else if (pR->getSouthwest() == rID) {
+                _line = QLine(p2.x() - tx, p2.y() + ty, p2.x(), p2.y());
+            }
+            p.drawLine(_line);
+            QLineF l0 = QLineF(_line);
+            l0.setLength(wegBreite * 5);
+            QPointF _p1 = l0.p1();
+            QPointF _p2 = l0.p2();
+            QLineF l1 = QLineF(l0);
+            qreal w1 = l1.angle() - 90.0;
+            QLineF l2;
+            l2.setP1(_p2);
+            l2.setAngle(w1);
+            l2.setLength(wegBreite * 2);
+            QPointF _p3 = l2.p2();
+            l2.setAngle(l2.angle() + 180.0);
+            QPointF _p4 = l2.p2();
+            QPolygonF _poly;
+            _poly.append(_p1);
+            _poly.append(_p3);
+            _poly.append(_p4);
+            QBrush brush = p.brush();
+            brush.setColor(getColor(k));
+            brush.setStyle(Qt::SolidPattern);
+            QPen arrowPen = p.pen();
+            arrowPen.setCosmetic(mMapperUseAntiAlias);
+            p.setPen(arrowPen);
+            p.setBrush(brush);
+            p.drawPolygon(_poly);
+            p.setPen(__pen);
+        }
+        // doors
+        if (pR->doors.size() > 0) {
+            int doorStatus = 0;
+            if (pR->getSouth() == rID && pR->doors.contains("s")) {
+                doorStatus = pR->doors["s"];
+            } else if (pR->getNorth() == rID && pR->doors.contains("n")) {
+                doorStatus = pR->doors["n"];
+            } else if (pR->getSouthwest() == rID && pR->doors.contains("sw")) {
+                doorStatus = pR->doors["sw"];
+            } else if (pR->getSoutheast() == rID && pR->doors.contains("se")) {
+                doorStatus = pR->doors["se"];
+            } else if (pR->getNortheast() == rID && pR->doors.contains("ne")) {
+                doorStatus = pR->doors["ne"];
+            } else if (pR->getNorthwest() == rID && pR->doors.contains("nw")) {
+                doorStatus = pR->doors["nw"];
+            } else if (pR->getWest() == rID && pR->doors.contains("w")) {
+                doorStatus = pR->doors["w"];
+            } else if (pR->getEast() == rID && pR->doors.contains("e")) {
+                doorStatus = pR->doors["e"];
+            }
+            if (doorStatus > 0) {
+                QLineF k0;
+                QRectF rect;
+                rect.setWidth(0.25 * tx);
+                rect.setHeight(0.25 * ty);
+                if (areaExit) {
+                    k0 = QLineF(_line);
+                } else {
+                    k0 = QLineF(p2.x(), p2.y(), p1.x(), p1.y());
+                }
+                k0.setLength((k0.length()) * 0.5);
+                rect.moveCenter(k0.p2());
+                QPen arrowPen = p.pen();
+                QPen _tp = p.pen();
+                arrowPen.setCosmetic(mMapperUseAntiAlias);
+                arrowPen.setStyle(Qt::SolidLine);
+                if (doorStatus == 1) { //open door
+                    arrowPen.setColor(QColor(10, 155, 10));
+                } else if (doorStatus == 2) { //closed door
+                    arrowPen.setColor(QColor(155, 155, 10));
+                } else { //locked door
+                    arrowPen.setColor(QColor(155, 10, 10));
+                }
+                QBrush brush;
+                QBrush oldBrush;
+                p.setPen(arrowPen);
+                p.setBrush(brush);
+                p.drawRect(rect);
+                p.setBrush(oldBrush);
+                p.setPen(_tp);
+            }
+        }
+    } // End of for( exitList )
+}
+
+// Draws one custom line of a room, the one selected for editing is drawn in
+// orange with its points marked:
+void T2DMap::paintCustomLine(QPainter& p, TRoom* pR, const QString& exit, const float tx, const float ty, const float wegBreite, const bool isSelected)
+{
+    QPen oldPen = p.pen();
+    QBrush oldBrush = p.brush();
+    QColor _color;
+    const QList<int> lineColor = pR->customLinesColor.value(exit);
+    if (isSelected) {
+        _color = QColor(255, 155, 55);
+    } else if (lineColor.size() == 3) {
+        _color = QColor(lineColor.at(0), lineColor.at(1), lineColor.at(2));
+    } else {
+        _color = QColor(Qt::red);
+    }
+    bool _arrow = pR->customLinesArrow.value(exit);
+    QString _style = pR->customLinesStyle.value(exit);
+    QPointF _cstartP;
+    float ex = pR->x * tx;
+    float ey = pR->y * ty * -1;
+    if (exit == "N") {
+        _cstartP = QPoint(ex, ey - ty / 2);
+    } else if (exit == "NW") {
+        _cstartP = QPoint(ex - tx / 2, ey - ty / 2);
+    } else if (exit == "NE") {
+        _cstartP = QPoint(ex + tx / 2, ey - ty / 2);
+    } else if (exit == "S") {
+        _cstartP = QPoint(ex, ey + ty / 2);
+    } else if (exit == "SW") {
+        _cstartP = QPoint(ex - tx / 2, ey + ty / 2);
+    } else if (exit == "SE") {
+        _cstartP = QPoint(ex + tx / 2, ey + ty / 2);
+    } else if (exit == "W") {
+        _cstartP = QPoint(ex - tx / 2, ey);
+    } else if (exit == "E") {
+        _cstartP = QPoint(ex + tx / 2, ey);
+    } else {
+        _cstartP = QPointF(ex, ey);
+    }
+    QPointF ursprung = QPointF(ex, ey);
+    QPen customLinePen = p.pen();
+    customLinePen.setCosmetic(mMapperUseAntiAlias);
+    customLinePen.setColor(_color);
+    customLinePen.setCapStyle(Qt::RoundCap);
+    customLinePen.setJoinStyle(Qt::RoundJoin);
+
+    if (_style == "solid line") {
+        customLinePen.setStyle(Qt::SolidLine);
+    } else if (_style == "dot line") {
+        customLinePen.setStyle(Qt::DotLine);
+    } else if (_style == "dash line") {
+        customLinePen.setStyle(Qt::DashLine);
+    } else if (_style == "dash dot line") {
+        customLinePen.setStyle(Qt::DashDotLine);
+    } else {
+        customLinePen.setStyle(Qt::DashDotDotLine);
+    }
+
+    QList<QPointF> _pL = pR->customLines.value(exit);
+    if (_pL.size() > 0) {
+        p.setPen(customLinePen);
+        p.drawLine(ursprung, _cstartP);
+    }
+    for (int pk = 0; pk < _pL.size(); pk++) {
+        QPointF _cendP;
+        _cendP.setX(_pL[pk].x() * tx);
+        _cendP.setY(_pL[pk].y() * ty * -1);
+        p.drawLine(_cstartP, _cendP);
+
+        if (isSelected) {
+            QPen _savedPen = p.pen();
+            QPen _pen;
+            QBrush _brush = p.brush();
+            if (pk == mCustomLineSelectedPoint) {
+                _pen = QPen(QColor(255, 255, 55), _savedPen.width(), Qt::SolidLine, Qt::FlatCap, _savedPen.joinStyle()); // Draw the selected point in yellow not orange.
+            } else {
+                _pen = QPen(_savedPen.color(), _savedPen.width(), Qt::SolidLine, Qt::FlatCap, _savedPen.joinStyle());
+            }
+            p.setBrush(Qt::NoBrush); // Draw hollow circles not default filled ones!
+            p.setPen(_pen);
+            p.drawEllipse(_cendP, tx / 4, tx / 4);
+            p.setPen(_savedPen);
+            p.setBrush(_brush);
+        }
+
+        if (pk == _pL.size() - 1 && _arrow) {
+            QLineF l0 = QLineF(_cendP, _cstartP);
+            l0.setLength(wegBreite * 5);
+            QPointF _p1 = l0.p1();
+            QPointF _p2 = l0.p2();
+            QLineF l1 = QLineF(l0);
+            qreal w1 = l1.angle() - 90.0;
+            QLineF l2;
+            l2.setP1(_p2);
+            l2.setAngle(w1);
+            l2.setLength(wegBreite * 2);
+            QPointF _p3 = l2.p2();
+            l2.setAngle(l2.angle() + 180.0);
+            QPointF _p4 = l2.p2();
+            QPolygonF _poly;
+            _poly.append(_p1);
+            _poly.append(_p3);
+            _poly.append(_p4);
+            QBrush brush = p.brush();
+            brush.setColor(_color);
+            brush.setStyle(Qt::SolidPattern);
+            QPen arrowPen = p.pen();
+            arrowPen.setCosmetic(mMapperUseAntiAlias);
+            arrowPen.setStyle(Qt::SolidLine);
+            p.setPen(arrowPen);
+            p.setBrush(brush);
+            p.drawPolygon(_poly);
+        }
+        _cstartP = _cendP;
+    }
+    p.setPen(oldPen);
+    p.setBrush(oldBrush);
+}
+
+// Draws a room as it is when it is not selected or highlighted:
+void T2DMap::paintRoom(QPainter& p, TRoom* pR, const float tx, const float ty, const bool isGridMode)
+{
+    float rx = pR->x * tx;
+    float ry = pR->y * -1 * ty;
+    QRectF dr;
+    if (isGridMode) {
+        dr = QRectF(rx - tx / 2, ry - ty / 2, tx, ty);
+    } else {
+        dr = QRectF(rx - (tx * rSize) / 2, ry - (ty * rSize) / 2, tx * rSize, ty * rSize);
+    }
+
+    QColor c = getColor(pR->getId());
+    char _ch = pR->c;
+    if (_ch >= 33 /* && _ch < 255 seems that _ch is a signed char so will always be less than 255 */) {
+        int _color;
+        if (c.red() + c.green() + c.blue() > 260) {
+            _color = (7) * 254 + _ch;
+        } else {
+            _color = (6) * 254 + _ch;
+        }
+
+        p.fillRect(dr, c);
+        if (mPixMap.contains(_color)) {
+            // Scaled once for all the rooms using it rather than for each one:
+            QPixmap& pix = mScaledPixMap[_color];
+            if (pix.isNull()) {
+                pix = mPixMap.value(_color).scaled(dr.width(), dr.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            }
+            p.drawPixmap(dr.topLeft(), pix);
+        }
+    } else {
+        if (mBubbleMode) {
+            float _radius = (rSize * tx) / 2;
+            QPointF _center = QPointF(rx, ry);
+            QRadialGradient _gradient(_center, _radius);
+            _gradient.setColorAt(0.85, c);
+            _gradient.setColorAt(0, QColor(255, 255, 255, 255));
+            QPen myPen(Qt::transparent);
+            QPainterPath myPath;
+            p.setBrush(_gradient);
+            p.setPen(myPen);
+            myPath.addEllipse(_center, _radius, _radius);
+            p.drawPath(myPath);
+        } else {
+            p.fillRect(dr, c);
+        }
+    }
+
+    if (mShowRoomID) {
+        QPen __pen = p.pen();
+        QColor lc;
+        if (c.red() + c.green() + c.blue() > 200) {
+            lc = QColor(Qt::black);
+        } else {
+            lc = QColor(Qt::white);
+        }
+        p.setPen(QPen(lc));
+        p.drawText(dr, Qt::AlignHCenter | Qt::AlignVCenter, QString::number(pR->getId()));
+        p.setPen(__pen);
+    }
+
+    paintRoomMarkers(p, pR, rx, ry, tx, ty, c);
+}
+
+// Draws the marks for the up, down, in and out exits (and stubs) of the room
+// centered on rx, ry:
+void T2DMap::paintRoomMarkers(QPainter& p, TRoom* pR, const float rx, const float ry, const float tx, const float ty, const QColor& roomColor)
+{
+    QColor lc;
+    if (roomColor.red() + roomColor.green() + roomColor.blue() > 200) {
+        lc = QColor(Qt::black);
+    } else {
+        lc = QColor(Qt::white);
+    }
+    QPen pen = p.pen();
+    pen.setColor(lc);
+    pen.setWidthF(0); //wegBreite?);
+    pen.setCosmetic(mMapperUseAntiAlias);
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setJoinStyle(Qt::RoundJoin);
+    p.setPen(pen);
+
+    //FIXME: redo exit stubs here since the room will draw over up/down stubs -- its repetitive though
+    for (int k = 0; k < pR->exitStubs.size(); k++) {
+        int direction = pR->exitStubs[k];
+        QVector3D uDirection = mpMap->unitVectors.value(direction);
+        if (direction > 8) {
+            QPolygonF _poly;
+            QPointF _pt;
+            _pt = QPointF(rx, ry + (ty * rSize) * uDirection.z() / 20);
+            _poly.append(_pt);
+            _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) * uDirection.z() / 3.1);
+            _poly.append(_pt);
+            _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) * uDirection.z() / 3.1);
+            _poly.append(_pt);
+            QBrush brush = p.brush();
+            brush.setColor(Qt::black);
+            brush.setStyle(Qt::NoBrush);
+            p.setBrush(brush);
+            p.drawPolygon(_poly);
+        }
+    }
+
+    if (pR->getUp() > 0) {
+        QPolygonF _poly;
+        QPointF _pt;
+        _pt = QPointF(rx, ry + (ty * rSize) / 20);
+        _poly.append(_pt);
+        _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        QBrush brush = p.brush();
+        brush.setColor(Qt::black);
+        brush.setStyle(Qt::SolidPattern);
+        p.setBrush(brush);
+        p.drawPolygon(_poly);
+    }
+
+    if (pR->getDown() > 0) {
+        QPolygonF _poly;
+        QPointF _pt;
+        _pt = QPointF(rx, ry - (ty * rSize) / 20);
+        _poly.append(_pt);
+        _pt = QPointF(rx - (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        _pt = QPointF(rx + (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        QBrush brush = p.brush();
+        brush.setColor(Qt::black);
+        brush.setStyle(Qt::SolidPattern);
+        p.setBrush(brush);
+        p.drawPolygon(_poly);
+    }
+
+    if (pR->getIn() > 0) {
+        QPolygonF _poly;
+        QPointF _pt;
+        _pt = QPointF(rx + (tx * rSize) / 20, ry);
+        _poly.append(_pt);
+        _pt = QPointF(rx - (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        QBrush brush = p.brush();
+        brush.setColor(Qt::black);
+        brush.setStyle(Qt::SolidPattern);
+        p.setBrush(brush);
+        p.drawPolygon(_poly);
+    }
+
+    if (pR->getOut() > 0) {
+        QPolygonF _poly;
+        QPointF _pt;
+        _pt = QPointF(rx - (tx * rSize) / 20, ry);
+        _poly.append(_pt);
+        _pt = QPointF(rx + (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
+        _poly.append(_pt);
+        QBrush brush = p.brush();
+        brush.setColor(Qt::black);
+        brush.setStyle(Qt::SolidPattern);
+        p.setBrush(brush);
+        p.drawPolygon(_poly);
+    }
+}
+
+// Double size yellow hollow target, used to show the destination of a custom
+// exit line being drawn or edited and the center of a multiple room selection:
+void T2DMap::paintTarget(QPainter& p, const float rx, const float ry, const float tx)
+{
+    QPen savePen = p.pen();
+    QBrush saveBrush = p.brush();
+    float _radius = tx * 1.2;
+    float _diagonal = tx * 1.2;
+    QPointF _center = QPointF(rx, ry);
+
+    QPen myPen(QColor(255, 255, 50, 192)); // Quarter opaque yellow pen
+    myPen.setWidth(tx * 0.1);
+    QPainterPath myPath;
+    p.setPen(myPen);
+    p.setBrush(Qt::NoBrush);
+    myPath.addEllipse(_center, _radius, _radius);
+    myPath.addEllipse(_center, _radius / 2.0, _radius / 2.0);
+    myPath.moveTo(rx - _diagonal, ry - _diagonal);
+    myPath.lineTo(rx + _diagonal, ry + _diagonal);
+    myPath.moveTo(rx + _diagonal, ry - _diagonal);
+    myPath.lineTo(rx - _diagonal, ry + _diagonal);
+    p.drawPath(myPath);
+    p.setPen(savePen);
+    p.setBrush(saveBrush);
+}
+
 void T2DMap::paintEvent(QPaintEvent* e)
 {
     if (!mpMap) {
@@ -606,8 +1358,6 @@ void T2DMap::paintEvent(QPaintEvent* e)
 
 
     int px, py;
-    QList<int> exitList;
-    QList<int> oneWayExits;
     TRoom* pPlayerRoom = mpMap->mpRoomDB->getRoom(mpMap->mRoomIdHash.value(mpHost->getName()));
     if (!pPlayerRoom) {
         p.drawText(_w / 2, _h / 2, "No map or no valid position.");
@@ -674,6 +1424,33 @@ void T2DMap::paintEvent(QPaintEvent* e)
 
     p.fillRect(0, 0, width(), height(), mpHost->mBgColor_2);
 
+    // The rooms, exits and labels come from the cached tiles, _rx and _ry
+    // being whole numbers they line up with the pixels of the widget:
+    updateMapCache(pArea, zEbene, tx, ty);
+    const int firstColumn = qFloor(-_rx / static_cast<float>(scMapTileSize));
+    const int lastColumn = qFloor((_w - 1 - _rx) / scMapTileSize);
+    const int firstRow = qFloor(-_ry / static_cast<float>(scMapTileSize));
+    const int lastRow = qFloor((_h - 1 - _ry) / scMapTileSize);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            p.drawPixmap(column * scMapTileSize + _rx, row * scMapTileSize + _ry, getMapTile(pArea, zEbene, tx, ty, column, row));
+        }
+    }
+    // Keep the ones around the view for panning, but not an ever growing
+    // number of them:
+    if (mMapTiles.size() > qMax(scMaxMapTiles, (lastColumn - firstColumn + 1) * (lastRow - firstRow + 1) * 2)) {
+        QMutableHashIterator<quint64, QPixmap> itTile(mMapTiles);
+        while (itTile.hasNext()) {
+            itTile.next();
+            const int column = static_cast<qint32>(itTile.key() >> 32);
+            const int row = static_cast<qint32>(itTile.key() & 0xFFFFFFFF);
+            if (column < firstColumn - 1 || column > lastColumn + 1 || row < firstRow - 1 || row > lastRow + 1) {
+                itTile.remove();
+            }
+        }
+    }
+
+    // Everything from here on is drawn on every paint:
     QPen pen;
 
     pen = p.pen();
@@ -686,45 +1463,27 @@ void T2DMap::paintEvent(QPaintEvent* e)
     }
     p.setPen(pen);
 
+    // The labels need their current on screen size for mouse clicks:
     if (mpMap->mapLabels.contains(mAID)) {
-        QMapIterator<int, TMapLabel> it(mpMap->mapLabels[mAID]);
+        QMutableMapIterator<int, TMapLabel> it(mpMap->mapLabels[mAID]);
         while (it.hasNext()) {
             it.next();
-            if (it.value().pos.z() != mOz) {
-                continue;
-            }
-            if (it.value().text.length() < 1) {
-                mpMap->mapLabels[mAID][it.key()].text = "no text";
-            }
-            QPointF lpos;
-            int _lx = it.value().pos.x() * tx + _rx;
-            int _ly = it.value().pos.y() * ty * -1 + _ry;
-
-            lpos.setX(_lx);
-            lpos.setY(_ly);
-            int _lw = abs(it.value().size.width()) * tx;
-            int _lh = abs(it.value().size.height()) * ty;
-            if (!((0 < _lx || 0 < _lx + _lw) && (_w > _lx || _w > _lx + _lw))) {
+            TMapLabel& label = it.value();
+            if (label.pos.z() != mOz) {
                 continue;
             }
-            if (!((0 < _ly || 0 < _ly + _lh) && (_h > _ly || _h > _ly + _lh))) {
-                continue;
+            if (label.text.length() < 1) {
+                label.text = "no text";
             }
-            QRectF _drawRect = QRect(it.value().pos.x() * tx + _rx, it.value().pos.y() * ty * -1 + _ry, _lw, _lh);
-            if (!it.value().showOnTop) {
-                if (!it.value().noScaling) {
-                    p.drawPixmap(lpos, it.value().pix.scaled(_drawRect.size().toSize()));
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setWidth(_drawRect.width());
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setHeight(_drawRect.height());
-                } else {
-                    p.drawPixmap(lpos, it.value().pix);
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setWidth(it.value().pix.width());
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setHeight(it.value().pix.height());
-                }
+            if (!label.noScaling) {
+                label.clickSize.setWidth(static_cast<int>(abs(label.size.width()) * tx));
+                label.clickSize.setHeight(static_cast<int>(abs(label.size.height()) * ty));
+            } else {
+                label.clickSize.setWidth(label.pix.width());
+                label.clickSize.setHeight(label.pix.height());
             }
-
-            if (it.value().hilite) {
-                _drawRect.setSize(it.value().clickSize);
+            if (label.hilite) {
+                QRectF _drawRect = QRectF(QPointF(static_cast<int>(label.pos.x() * tx + _rx), static_cast<int>(label.pos.y() * ty * -1 + _ry)), label.clickSize);
                 p.fillRect(_drawRect, QColor(255, 155, 55, 190));
             }
         }
@@ -777,541 +1536,34 @@ void T2DMap::paintEvent(QPaintEvent* e)
                         }
                     }
                 }
-            }
-        }
-        QSetIterator<int> itRoom2(pArea->getAreaRooms());
-        while (itRoom2.hasNext()) {
-            int _id = itRoom2.next();
-            TRoom* pR = mpMap->mpRoomDB->getRoom(_id);
-            if (!pR) {
-                continue;
-            }
-            float rx = pR->x * tx + _rx;
-            float ry = pR->y * -1 * ty + _ry;
-            int rz = pR->z;
-
-            if (rz != zEbene) {
-                continue;
-            }
-
-            if (pR->customLines.size() == 0) {
-                if (rx < 0 || ry < 0 || rx > _w || ry > _h) {
-                    continue;
-                }
-            } else {
-                float miny = pR->min_y * -1 * ty + (float)_ry;
-                float maxy = pR->max_y * -1 * ty + (float)_ry;
-                float minx = pR->min_x * tx + (float)_rx;
-                float maxx = pR->max_x * tx + (float)_rx;
-
-                if (!((minx > 0.0 || maxx > 0.0) && ((float)_w > minx || (float)_w > maxx))) {
-                    continue;
-                }
-                if (!((miny > 0.0 || maxy > 0.0) && ((float)_h > miny || (float)_h > maxy))) {
-                    continue;
-                }
-            }
-
-            pR->rendered = true;
-
-            exitList.clear();
-            oneWayExits.clear();
-            if (pR->customLines.size() > 0) {
-                if (!pR->customLines.contains("N")) {
-                    exitList.push_back(pR->getNorth());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNorth());
-                    if (pER) {
-                        if (pER->getSouth() != _id) {
-                            oneWayExits.push_back(pR->getNorth());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("NW")) {
-                    exitList.push_back(pR->getNorthwest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNorthwest());
-                    if (pER) {
-                        if (pER->getSoutheast() != _id) {
-                            oneWayExits.push_back(pR->getNorthwest());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("E")) {
-                    exitList.push_back(pR->getEast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getEast());
-                    if (pER) {
-                        if (pER->getWest() != _id) {
-                            oneWayExits.push_back(pR->getEast());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("SE")) {
-                    exitList.push_back(pR->getSoutheast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSoutheast());
-                    if (pER) {
-                        if (pER->getNorthwest() != _id) {
-                            oneWayExits.push_back(pR->getSoutheast());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("S")) {
-                    exitList.push_back(pR->getSouth());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSouth());
-                    if (pER) {
-                        if (pER->getNorth() != _id) {
-                            oneWayExits.push_back(pR->getSouth());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("SW")) {
-                    exitList.push_back(pR->getSouthwest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSouthwest());
-                    if (pER) {
-                        if (pER->getNortheast() != _id) {
-                            oneWayExits.push_back(pR->getSouthwest());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("W")) {
-                    exitList.push_back(pR->getWest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getWest());
-                    if (pER) {
-                        if (pER->getEast() != _id) {
-                            oneWayExits.push_back(pR->getWest());
-                        }
-                    }
-                }
-                if (!pR->customLines.contains("NE")) {
-                    exitList.push_back(pR->getNortheast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNortheast());
-                    if (pER) {
-                        if (pER->getSouthwest() != _id) {
-                            oneWayExits.push_back(pR->getNortheast());
-                        }
-                    }
-                }
-            } else {
-                if (pR->getNorth() > 0) {
-                    exitList.push_back(pR->getNorth());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNorth());
-                    if (pER) {
-                        if (pER->getSouth() != _id) {
-                            oneWayExits.push_back(pR->getNorth());
-                        }
-                    }
-                }
-                if (pR->getNorthwest() > 0) {
-                    exitList.push_back(pR->getNorthwest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNorthwest());
-                    if (pER) {
-                        if (pER->getSoutheast() != _id) {
-                            oneWayExits.push_back(pR->getNorthwest());
-                        }
-                    }
-                }
-                if (pR->getEast() > 0) {
-                    exitList.push_back(pR->getEast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getEast());
-                    if (pER) {
-                        if (pER->getWest() != _id) {
-                            oneWayExits.push_back(pR->getEast());
-                        }
-                    }
-                }
-                if (pR->getSoutheast() > 0) {
-                    exitList.push_back(pR->getSoutheast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSoutheast());
-                    if (pER) {
-                        if (pER->getNorthwest() != _id) {
-                            oneWayExits.push_back(pR->getSoutheast());
-                        }
-                    }
-                }
-                if (pR->getSouth() > 0) {
-                    exitList.push_back(pR->getSouth());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSouth());
-                    if (pER) {
-                        if (pER->getNorth() != _id) {
-                            oneWayExits.push_back(pR->getSouth());
-                        }
-                    }
-                }
-                if (pR->getSouthwest() > 0) {
-                    exitList.push_back(pR->getSouthwest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getSouthwest());
-                    if (pER) {
-                        if (pER->getNortheast() != _id) {
-                            oneWayExits.push_back(pR->getSouthwest());
-                        }
-                    }
-                }
-                if (pR->getWest() > 0) {
-                    exitList.push_back(pR->getWest());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getWest());
-                    if (pER) {
-                        if (pER->getEast() != _id) {
-                            oneWayExits.push_back(pR->getWest());
-                        }
-                    }
-                }
-                if (pR->getNortheast() > 0) {
-                    exitList.push_back(pR->getNortheast());
-                    TRoom* pER = mpMap->mpRoomDB->getRoom(pR->getNortheast());
-                    if (pER) {
-                        if (pER->getSouthwest() != _id) {
-                            oneWayExits.push_back(pR->getNortheast());
-                        }
-                    }
-                }
-            }
-
-            if (pR->customLines.size() > 0) {
-                QPen oldPen = p.pen();
-                QMapIterator<QString, QList<QPointF>> itk(pR->customLines);
-                while (itk.hasNext()) {
-                    itk.next();
-                    QColor _color;
-                    if (_id == mCustomLineSelectedRoom && itk.key() == mCustomLineSelectedExit) {
-                        _color.setRed(255);
-                        _color.setGreen(155);
-                        _color.setBlue(55);
-                    } else if (pR->customLinesColor[itk.key()].size() == 3) {
-                        _color.setRed(pR->customLinesColor[itk.key()][0]);
-                        _color.setGreen(pR->customLinesColor[itk.key()][1]);
-                        _color.setBlue(pR->customLinesColor[itk.key()][2]);
-                    } else {
-                        _color = QColor(Qt::red);
-                    }
-                    bool _arrow = pR->customLinesArrow[itk.key()];
-                    QString _style = pR->customLinesStyle[itk.key()];
-                    QPointF _cstartP;
-                    float ex = pR->x * tx + _rx;
-                    float ey = pR->y * ty * -1 + _ry;
-                    if (itk.key() == "N") {
-                        _cstartP = QPoint(ex, ey - ty / 2);
-                    } else if (itk.key() == "NW") {
-                        _cstartP = QPoint(ex - tx / 2, ey - ty / 2);
-                    } else if (itk.key() == "NE") {
-                        _cstartP = QPoint(ex + tx / 2, ey - ty / 2);
-                    } else if (itk.key() == "S") {
-                        _cstartP = QPoint(ex, ey + ty / 2);
-                    } else if (itk.key() == "SW") {
-                        _cstartP = QPoint(ex - tx / 2, ey + ty / 2);
-                    } else if (itk.key() == "SE") {
-                        _cstartP = QPoint(ex + tx / 2, ey + ty / 2);
-                    } else if (itk.key() == "W") {
-                        _cstartP = QPoint(ex - tx / 2, ey);
-                    } else if (itk.key() == "E") {
-                        _cstartP = QPoint(ex + tx / 2, ey);
-                    } else {
-                        _cstartP = QPointF(ex, ey);
-                    }
-                    QPointF ursprung = QPointF(ex, ey);
-                    QPen customLinePen = p.pen();
-                    customLinePen.setCosmetic(mMapperUseAntiAlias);
-                    customLinePen.setColor(_color);
-                    customLinePen.setCapStyle(Qt::RoundCap);
-                    customLinePen.setJoinStyle(Qt::RoundJoin);
-
-                    if (_style == "solid line") {
-                        customLinePen.setStyle(Qt::SolidLine);
-                    } else if (_style == "dot line") {
-                        customLinePen.setStyle(Qt::DotLine);
-                    } else if (_style == "dash line") {
-                        customLinePen.setStyle(Qt::DashLine);
-                    } else if (_style == "dash dot line") {
-                        customLinePen.setStyle(Qt::DashDotLine);
-                    } else {
-                        customLinePen.setStyle(Qt::DashDotDotLine);
-                    }
-
-                    QList<QPointF> _pL = itk.value();
-                    if (_pL.size() > 0) {
-                        p.setPen(customLinePen);
-                        p.drawLine(ursprung, _cstartP);
-                    }
-                    for (int pk = 0; pk < _pL.size(); pk++) {
-                        QPointF _cendP;
-                        _cendP.setX(_pL[pk].x() * tx + _rx);
-                        _cendP.setY(_pL[pk].y() * ty * -1 + _ry);
-                        p.drawLine(_cstartP, _cendP);
-
-                        if (_id == mCustomLineSelectedRoom && itk.key() == mCustomLineSelectedExit) {
-                            QPen _savedPen = p.pen();
-                            QPen _pen;
-                            QBrush _brush = p.brush();
-                            if (pk == mCustomLineSelectedPoint) {
-                                _pen = QPen(QColor(255, 255, 55), _savedPen.width(), Qt::SolidLine, Qt::FlatCap, _savedPen.joinStyle()); // Draw the selected point in yellow not orange.
-                            } else {
-                                _pen = QPen(_savedPen.color(), _savedPen.width(), Qt::SolidLine, Qt::FlatCap, _savedPen.joinStyle());
-                            }
-                            p.setBrush(Qt::NoBrush); // Draw hollow circles not default filled ones!
-                            p.setPen(_pen);
-                            p.drawEllipse(_cendP, mTX / 4, mTX / 4);
-                            p.setPen(_savedPen);
-                            p.setBrush(_brush);
-                        }
 
-                        if (pk == _pL.size() - 1 && _arrow) {
-                            QLineF l0 = QLineF(_cendP, _cstartP);
-                            l0.setLength(wegBreite * 5);
-                            QPointF _p1 = l0.p1();
-                            QPointF _p2 = l0.p2();
-                            QLineF l1 = QLineF(l0);
-                            qreal w1 = l1.angle() - 90.0;
-                            QLineF l2;
-                            l2.setP1(_p2);
-                            l2.setAngle(w1);
-                            l2.setLength(wegBreite * 2);
-                            QPointF _p3 = l2.p2();
-                            l2.setAngle(l2.angle() + 180.0);
-                            QPointF _p4 = l2.p2();
-                            QPolygonF _poly;
-                            _poly.append(_p1);
-                            _poly.append(_p3);
-                            _poly.append(_p4);
-                            QBrush brush = p.brush();
-                            brush.setColor(_color);
-                            brush.setStyle(Qt::SolidPattern);
-                            QPen arrowPen = p.pen();
-                            arrowPen.setCosmetic(mMapperUseAntiAlias);
-                            arrowPen.setStyle(Qt::SolidLine);
-                            p.setPen(arrowPen);
-                            p.setBrush(brush);
-                            p.drawPolygon(_poly);
-                        }
-                        _cstartP = _cendP;
-                    }
+                // The custom line being edited is drawn over the cached one:
+                if (pSR->getArea() == mAID && pSR->z == zEbene && pSR->customLines.contains(mCustomLineSelectedExit)) {
+                    p.save();
+                    p.translate(_rx, _ry);
+                    paintCustomLine(p, pSR, mCustomLineSelectedExit, tx, ty, wegBreite, true);
+                    p.restore();
                 }
-                p.setPen(oldPen);
             }
+        }
 
-            // N/U:             int e = pR->z;
+        // Indicate destination for custom exit line drawing - double size
+        // target yellow hollow circle
+        TRoom* pTR = mpMap->mpRoomDB->getRoom(customLineDestinationTarget);
+        if (pTR && pTR->getArea() == mAID && pTR->z == zEbene) {
+            paintTarget(p, pTR->x * tx + _rx, pTR->y * -1 * ty + _ry, tx);
+        }
 
-            // draw exit stubs
-            QMap<int, QVector3D> unitVectors = mpMap->unitVectors;
-            for (int direction : pR->exitStubs) {
-                QVector3D uDirection = unitVectors[direction];
-                p.drawLine(rx + rSize * (int)uDirection.x() / 2, ry + rSize * (int)uDirection.y(), rx + (int)uDirection.x() * (rSize * 3 / 4 * tx), ry + uDirection.y() * (rSize * 3 / 4 * ty));
+        // Only the area exits in view can be clicked on:
+        QMapIterator<int, QPointF> itAreaExit(mCachedAreaExits);
+        while (itAreaExit.hasNext()) {
+            itAreaExit.next();
+            QPoint _p = (itAreaExit.value() + QPointF(_rx, _ry)).toPoint();
+            if (_p.x() >= 0 && _p.y() >= 0 && _p.x() <= _w && _p.y() <= _h) {
+                mAreaExitList.insert(itAreaExit.key(), _p);
             }
-
-            QPen __pen;
-            for (int& k : exitList) {
-                int rID = k;
-                if (rID <= 0) {
-                    continue;
-                }
-
-                bool areaExit;
-
-                TRoom* pE = mpMap->mpRoomDB->getRoom(rID);
-                if (!pE) {
-                    continue;
-                }
-
-                if (pE->getArea() != mAID) {
-                    areaExit = true;
-                } else {
-                    areaExit = false;
-                }
-                float ex = pE->x * tx + _rx;
-                float ey = pE->y * ty * -1 + _ry;
-                int ez = pE->z;
-
-                QVector3D p1(ex, ey, ez);
-                QVector3D p2(rx, ry, rz);
-                QLine _line;
-                if (!areaExit) {
-                    // one way exit or 2 way exit?
-                    if (!oneWayExits.contains(rID)) {
-                        p.drawLine((int)p1.x(), (int)p1.y(), (int)p2.x(), (int)p2.y());
-                    } else {
-                        // one way exit draw arrow
-
-                        QLineF l0 = QLineF(p2.x(), p2.y(), p1.x(), p1.y());
-                        QLineF k0 = l0;
-                        k0.setLength((l0.length() - wegBreite * 5) * 0.5);
-                        qreal dx = k0.dx();
-                        qreal dy = k0.dy();
-                        QPen _tp = p.pen();
-                        QPen _tp2 = _tp;
-                        _tp2.setStyle(Qt::DotLine);
-                        p.setPen(_tp2);
-                        p.drawLine(l0);
-                        p.setPen(_tp);
-                        l0.setLength(wegBreite * 5);
-                        QPointF _p1 = l0.p2();
-                        QPointF _p2 = l0.p1();
-                        QLineF l1 = QLineF(l0);
-                        qreal w1 = l1.angle() - 90.0;
-                        QLineF l2;
-                        l2.setP1(_p2);
-                        l2.setAngle(w1);
-                        l2.setLength(wegBreite * 2);
-                        QPointF _p3 = l2.p2();
-                        l2.setAngle(l2.angle() + 180.0);
-                        QPointF _p4 = l2.p2();
-                        QPolygonF _poly;
-                        _poly.append(_p1);
-                        _poly.append(_p3);
-                        _poly.append(_p4);
-
-                        QBrush brush = p.brush();
-                        brush.setColor(QColor(255, 100, 100));
-                        brush.setStyle(Qt::SolidPattern);
-                        QPen arrowPen = p.pen();
-                        arrowPen.setCosmetic(mMapperUseAntiAlias);
-                        arrowPen.setStyle(Qt::SolidLine);
-                        p.setPen(arrowPen);
-                        p.setBrush(brush);
-                        p.drawPolygon(_poly.translated(dx, dy));
-                    }
-
-                } else {
-                    __pen = p.pen();
-                    QPoint _p;
-                    pen = p.pen();
-                    pen.setWidthF(wegBreite);
-                    pen.setCosmetic(mMapperUseAntiAlias);
-                    pen.setColor(getColor(k));
-                    p.setPen(pen);
-                    if (pR->getSouth() == rID) {
-                        _line = QLine(p2.x(), p2.y() + ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x(), p2.y() + ty / 2);
-                    } else if (pR->getNorth() == rID) {
-                        _line = QLine(p2.x(), p2.y() - ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x(), p2.y() - ty / 2);
-                    } else if (pR->getWest() == rID) {
-                        _line = QLine(p2.x() - tx, p2.y(), p2.x(), p2.y());
-                        _p = QPoint(p2.x() - tx / 2, p2.y());
-                    } else if (pR->getEast() == rID) {
-                        _line = QLine(p2.x() + tx, p2.y(), p2.x(), p2.y());
-                        _p = QPoint(p2.x() + tx / 2, p2.y());
-                    } else if (pR->getNorthwest() == rID) {
-                        _line = QLine(p2.x() - tx, p2.y() - ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x() - tx / 2, p2.y() - ty / 2);
-                    } else if (pR->getNortheast() == rID) {
-                        _line = QLine(p2.x() + tx, p2.y() - ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x() + tx / 2, p2.y() - ty / 2);
-                    } else if (pR->getSoutheast() == rID) {
-                        _line = QLine(p2.x() + tx, p2.y() + ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x() + tx / 2, p2.y() + ty / 2);
-                    } else if (pR->getSouthwest() == rID) {
-                        _line = QLine(p2.x() - tx, p2.y() + ty, p2.x(), p2.y());
-                        _p = QPoint(p2.x() - tx / 2, p2.y() + ty / 2);
-                    }
-                    p.drawLine(_line);
-                    mAreaExitList[k] = _p;
-                    QLineF l0 = QLineF(_line);
-                    l0.setLength(wegBreite * 5);
-                    QPointF _p1 = l0.p1();
-                    QPointF _p2 = l0.p2();
-                    QLineF l1 = QLineF(l0);
-                    qreal w1 = l1.angle() - 90.0;
-                    QLineF l2;
-                    l2.setP1(_p2);
-                    l2.setAngle(w1);
-                    l2.setLength(wegBreite * 2);
-                    QPointF _p3 = l2.p2();
-                    l2.setAngle(l2.angle() + 180.0);
-                    QPointF _p4 = l2.p2();
-                    QPolygonF _poly;
-                    _poly.append(_p1);
-                    _poly.append(_p3);
-                    _poly.append(_p4);
-                    QBrush brush = p.brush();
-                    brush.setColor(getColor(k));
-                    brush.setStyle(Qt::SolidPattern);
-                    QPen arrowPen = p.pen();
-                    arrowPen.setCosmetic(mMapperUseAntiAlias);
-                    p.setPen(arrowPen);
-                    p.setBrush(brush);
-                    p.drawPolygon(_poly);
-                    p.setPen(__pen);
-                }
-                // doors
-                if (pR->doors.size() > 0) {
-                    int doorStatus = 0;
-                    if (pR->getSouth() == rID && pR->doors.contains("s")) {
-                        doorStatus = pR->doors["s"];
-                    } else if (pR->getNorth() == rID && pR->doors.contains("n")) {
-                        doorStatus = pR->doors["n"];
-                    } else if (pR->getSouthwest() == rID && pR->doors.contains("sw")) {
-                        doorStatus = pR->doors["sw"];
-                    } else if (pR->getSoutheast() == rID && pR->doors.contains("se")) {
-                        doorStatus = pR->doors["se"];
-                    } else if (pR->getNortheast() == rID && pR->doors.contains("ne")) {
-                        doorStatus = pR->doors["ne"];
-                    } else if (pR->getNorthwest() == rID && pR->doors.contains("nw")) {
-                        doorStatus = pR->doors["nw"];
-                    } else if (pR->getWest() == rID && pR->doors.contains("w")) {
-                        doorStatus = pR->doors["w"];
-                    } else if (pR->getEast() == rID && pR->doors.contains("e")) {
-                        doorStatus = pR->doors["e"];
-                    }
-                    if (doorStatus > 0) {
-                        QLineF k0;
-                        QRectF rect;
-                        rect.setWidth(0.25 * mTX);
-                        rect.setHeight(0.25 * mTY);
-                        if (areaExit) {
-                            k0 = QLineF(_line);
-                        } else {
-                            k0 = QLineF(p2.x(), p2.y(), p1.x(), p1.y());
-                        }
-                        k0.setLength((k0.length()) * 0.5);
-                        rect.moveCenter(k0.p2());
-                        QPen arrowPen = p.pen();
-                        QPen _tp = p.pen();
-                        arrowPen.setCosmetic(mMapperUseAntiAlias);
-                        arrowPen.setStyle(Qt::SolidLine);
-                        if (doorStatus == 1) { //open door
-                            arrowPen.setColor(QColor(10, 155, 10));
-                        } else if (doorStatus == 2) { //closed door
-                            arrowPen.setColor(QColor(155, 155, 10));
-                        } else { //locked door
-                            arrowPen.setColor(QColor(155, 10, 10));
-                        }
-                        QBrush brush;
-                        QBrush oldBrush;
-                        p.setPen(arrowPen);
-                        p.setBrush(brush);
-                        p.drawRect(rect);
-                        p.setBrush(oldBrush);
-                        p.setPen(_tp);
-                    }
-                }
-            } // End of for( exitList )
-
-            // Indicate destination for custom exit line drawing - double size
-            // target yellow hollow circle
-            // Similar code is now also used to indicate center target of
-            // multiple selected rooms but that must be done after all the rooms
-            // have been drawn otherwise later drawn rooms will overwrite the
-            // mark, especially on areas in gridmode.
-            if (customLineDestinationTarget > 0 && customLineDestinationTarget == _id) {
-                QPen savePen = p.pen();
-                QBrush saveBrush = p.brush();
-                float _radius = tx * 1.2;
-                float _diagonal = tx * 1.2;
-                QPointF _center = QPointF(rx, ry);
-
-                QPen myPen(QColor(255, 255, 50, 192)); // Quarter opaque yellow pen
-                myPen.setWidth(tx * 0.1);
-                QPainterPath myPath;
-                p.setPen(myPen);
-                p.setBrush(Qt::NoBrush);
-                myPath.addEllipse(_center, _radius, _radius);
-                myPath.addEllipse(_center, _radius / 2.0, _radius / 2.0);
-                myPath.moveTo(rx - _diagonal, ry - _diagonal);
-                myPath.lineTo(rx + _diagonal, ry + _diagonal);
-                myPath.moveTo(rx + _diagonal, ry - _diagonal);
-                myPath.lineTo(rx - _diagonal, ry + _diagonal);
-                p.drawPath(myPath);
-                p.setPen(savePen);
-                p.setBrush(saveBrush);
-            }
-        } // End of for( area Rooms )
-    }     // End of NOT area gridmode
+        }
+    }
 
     // Draw label sizing or group selection box
     if (mSizeLabel) {
@@ -1320,7 +1572,9 @@ void T2DMap::paintEvent(QPaintEvent* e)
         p.fillRect(mMultiRect, QColor(190, 190, 190, 60));
     }
 
-    QSetIterator<int> itRoom(pArea->getAreaRooms());
+    // Only the rooms that are (about) in view - the checks below then settle
+    // exactly which ones are:
+    QListIterator<int> itRoom(pArea->getRoomsInRect(qFloor(-_rx / tx), qCeil((_w - _rx) / tx), qFloor((_ry - _h) / ty), qCeil(_ry / ty), zEbene));
     while (itRoom.hasNext()) {
         int currentAreaRoom = itRoom.next();
         TRoom* pR = mpMap->mpRoomDB->getRoom(currentAreaRoom);
@@ -1338,7 +1592,6 @@ void T2DMap::paintEvent(QPaintEvent* e)
             continue;
         }
 
-        pR->rendered = false;
         QRectF dr;
         if (pArea->gridMode) {
             dr = QRectF(rx - tx / 2, ry - ty / 2, tx, ty);
@@ -1346,80 +1599,11 @@ void T2DMap::paintEvent(QPaintEvent* e)
             dr = QRectF(rx - (tx * rSize) / 2, ry - (ty * rSize) / 2, tx * rSize, ty * rSize);
         }
 
-        QColor c;
-        int env = pR->environment;
-        if (mpMap->envColors.contains(env)) {
-            env = mpMap->envColors[env];
-        } else {
-            if (!mpMap->customEnvColors.contains(env)) {
-                env = 1;
-            }
-        }
-        switch (env) {
-        case 1:
-            c = mpHost->mRed_2;
-            break;
-
-        case 2:
-            c = mpHost->mGreen_2;
-            break;
-        case 3:
-            c = mpHost->mYellow_2;
-            break;
-
-        case 4:
-            c = mpHost->mBlue_2;
-            break;
-
-        case 5:
-            c = mpHost->mMagenta_2;
-            break;
-        case 6:
-            c = mpHost->mCyan_2;
-            break;
-        case 7:
-            c = mpHost->mWhite_2;
-            break;
-        case 8:
-            c = mpHost->mBlack_2;
-            break;
-
-        case 9:
-            c = mpHost->mLightRed_2;
-            break;
-
-        case 10:
-            c = mpHost->mLightGreen_2;
-            break;
-        case 11:
-            c = mpHost->mLightYellow_2;
-            break;
-
-        case 12:
-            c = mpHost->mLightBlue_2;
-            break;
-
-        case 13:
-            c = mpHost->mLightMagenta_2;
-            break;
-        case 14:
-            c = mpHost->mLightCyan_2;
-            break;
-        case 15:
-            c = mpHost->mLightWhite_2;
-            break;
-        case 16:
-            c = mpHost->mLightBlack_2;
-            break;
-        default: //user defined room color
-            if (mpMap->customEnvColors.contains(env)) {
-                c = mpMap->customEnvColors[env];
-            }
-        }
         if (((mPick || __Pick) && mPHighlight.x() >= dr.x() - (tx * rSize) && mPHighlight.x() <= dr.x() + (tx * rSize) && mPHighlight.y() >= dr.y() - (ty * rSize)
              && mPHighlight.y() <= dr.y() + (ty * rSize))
             || mMultiSelectionSet.contains(currentAreaRoom)) {
             p.fillRect(dr, QColor(255, 155, 55));
+            paintRoomMarkers(p, pR, rx, ry, tx, ty, getColor(currentAreaRoom));
             mPick = false;
             if (mStartSpeedWalk) {
                 mStartSpeedWalk = false;
@@ -1451,39 +1635,6 @@ void T2DMap::paintEvent(QPaintEvent* e)
                 }
             }
         } else {
-            char _ch = pR->c;
-            if (_ch >= 33 /* && _ch < 255 seems that _ch is a signed char so will always be less than 255 */) {
-                int _color = (265 - 257) * 254 + _ch; //(mpMap->rooms[pArea->rooms[i]]->environment - 257 ) * 254 + _ch;
-
-                if (c.red() + c.green() + c.blue() > 260) {
-                    _color = (7) * 254 + _ch;
-                } else {
-                    _color = (6) * 254 + _ch;
-                }
-
-                p.fillRect(dr, c);
-                if (mPixMap.contains(_color)) {
-                    QPixmap pix = mPixMap[_color].scaled(dr.width(), dr.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                    p.drawPixmap(dr.topLeft(), pix);
-                }
-            } else {
-                if (mBubbleMode) {
-                    float _radius = (rSize * tx) / 2;
-                    QPointF _center = QPointF(rx, ry);
-                    QRadialGradient _gradient(_center, _radius);
-                    _gradient.setColorAt(0.85, c);
-                    _gradient.setColorAt(0, QColor(255, 255, 255, 255));
-                    QPen myPen(Qt::transparent);
-                    QPainterPath myPath;
-                    p.setBrush(_gradient);
-                    p.setPen(myPen);
-                    myPath.addEllipse(_center, _radius, _radius);
-                    p.drawPath(myPath);
-                } else {
-                    p.fillRect(dr, c);
-                }
-            }
-
             if (pR->highlight) {
                 float _radius = (pR->highlightRadius * tx) / 2;
                 QPointF _center = QPointF(rx, ry);
@@ -1498,19 +1649,6 @@ void T2DMap::paintEvent(QPaintEvent* e)
                 p.drawPath(myPath);
             }
 
-            if (mShowRoomID) {
-                QPen __pen = p.pen();
-                QColor lc;
-                if (c.red() + c.green() + c.blue() > 200) {
-                    lc = QColor(Qt::black);
-                } else {
-                    lc = QColor(Qt::white);
-                }
-                p.setPen(QPen(lc));
-                p.drawText(dr, Qt::AlignHCenter | Qt::AlignVCenter, QString::number(currentAreaRoom));
-                p.setPen(__pen);
-            }
-
             if (mShiftMode && currentAreaRoom == mpMap->mRoomIdHash.value(mpHost->getName())) {
                 float _radius = (1.2 * tx) / 2;
                 QPointF _center = QPointF(rx, ry);
@@ -1528,218 +1666,45 @@ void T2DMap::paintEvent(QPaintEvent* e)
                 p.drawPath(myPath);
             }
         }
-
-        QColor lc;
-        if (c.red() + c.green() + c.blue() > 200) {
-            lc = QColor(Qt::black);
-        } else {
-            lc = QColor(Qt::white);
-        }
-        pen = p.pen();
-        pen.setColor(lc);
-        pen.setWidthF(0); //wegBreite?);
-        pen.setCosmetic(mMapperUseAntiAlias);
-        pen.setCapStyle(Qt::RoundCap);
-        pen.setJoinStyle(Qt::RoundJoin);
-        p.setPen(pen);
-
-        //FIXME: redo exit stubs here since the room will draw over up/down stubs -- its repetitive though
-        QMap<int, QVector3D> unitVectors = mpMap->unitVectors;
-        for (int k = 0; k < pR->exitStubs.size(); k++) {
-            int direction = pR->exitStubs[k];
-            QVector3D uDirection = unitVectors[direction];
-            if (direction > 8) {
-                float rx = pR->x * tx + _rx;
-                float ry = pR->y * -1 * ty + _ry;
-                QPolygonF _poly;
-                QPointF _pt;
-                _pt = QPointF(rx, ry + (ty * rSize) * uDirection.z() / 20);
-                _poly.append(_pt);
-                _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) * uDirection.z() / 3.1);
-                _poly.append(_pt);
-                _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) * uDirection.z() / 3.1);
-                _poly.append(_pt);
-                QBrush brush = p.brush();
-                brush.setColor(Qt::black);
-                brush.setStyle(Qt::NoBrush);
-                p.setBrush(brush);
-                p.drawPolygon(_poly);
-            }
-        }
-
-        if (pR->getUp() > 0) {
-            QPolygonF _poly;
-            QPointF _pt;
-            _pt = QPointF(rx, ry + (ty * rSize) / 20);
-            _poly.append(_pt);
-            _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            QBrush brush = p.brush();
-            brush.setColor(Qt::black);
-            brush.setStyle(Qt::SolidPattern);
-            p.setBrush(brush);
-            p.drawPolygon(_poly);
-        }
-
-        if (pR->getDown() > 0) {
-            QPolygonF _poly;
-            QPointF _pt;
-            _pt = QPointF(rx, ry - (ty * rSize) / 20);
-            _poly.append(_pt);
-            _pt = QPointF(rx - (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            _pt = QPointF(rx + (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            QBrush brush = p.brush();
-            brush.setColor(Qt::black);
-            brush.setStyle(Qt::SolidPattern);
-            p.setBrush(brush);
-            p.drawPolygon(_poly);
-        }
-
-        if (pR->getIn() > 0) {
-            QPolygonF _poly;
-            QPointF _pt;
-            _pt = QPointF(rx + (tx * rSize) / 20, ry);
-            _poly.append(_pt);
-            _pt = QPointF(rx - (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            _pt = QPointF(rx - (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            QBrush brush = p.brush();
-            brush.setColor(Qt::black);
-            brush.setStyle(Qt::SolidPattern);
-            p.setBrush(brush);
-            p.drawPolygon(_poly);
-        }
-
-        if (pR->getOut() > 0) {
-            QPolygonF _poly;
-            QPointF _pt;
-            _pt = QPointF(rx - (tx * rSize) / 20, ry);
-            _poly.append(_pt);
-            _pt = QPointF(rx + (tx * rSize) / 3.1, ry - (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            _pt = QPointF(rx + (tx * rSize) / 3.1, ry + (ty * rSize) / 3.1);
-            _poly.append(_pt);
-            QBrush brush = p.brush();
-            brush.setColor(Qt::black);
-            brush.setStyle(Qt::SolidPattern);
-            p.setBrush(brush);
-            p.drawPolygon(_poly);
-        }
-
-        if (pArea->gridMode) {
-            QMapIterator<int, QPoint> it(mAreaExitList);
-            while (it.hasNext()) {
-                it.next();
-                QPoint P = it.value();
-                int rx = P.x();
-                int ry = P.y();
-
-                QRectF dr = QRectF(rx - tx / 2, ry - ty / 2, tx, ty);
-                if (((mPick || __Pick) && mPHighlight.x() >= dr.x() - tx / 2 && mPHighlight.x() <= dr.x() + tx / 2 && mPHighlight.y() >= dr.y() - ty / 2 && mPHighlight.y() <= dr.y() + ty / 2)
-                    || mMultiSelectionSet.contains(currentAreaRoom)) {
-                    p.fillRect(dr, QColor(50, 255, 50));
-                    mPick = false;
-                    mTarget = it.key();
-                    if (mpMap->mpRoomDB->getRoom(mTarget)) {
-                        mpMap->mTargetID = mTarget;
-                        if (mpMap->findPath(mpMap->mRoomIdHash.value(mpHost->getName()), mpMap->mTargetID)) {
-                            mpHost->startSpeedWalk();
-                        } else {
-                            QString msg = "Mapper: Cannot find a path to this room using known exits.\n";
-                            mpHost->mpConsole->printSystemMessage(msg);
-                        }
-                    }
-                }
-            }
-        } else {
-            QMapIterator<int, QPoint> it(mAreaExitList);
-            while (it.hasNext()) {
-                it.next();
-                QPoint P = it.value();
-                int rx = P.x();
-                int ry = P.y();
-
-                QRectF dr = QRectF(rx, ry, tx * rSize, ty * rSize); //rx-(tx*rSize)/2,ry-(ty*rSize)/2,tx*rSize,ty*rSize);
-                if (((mPick || __Pick) && mPHighlight.x() >= dr.x() - tx / 3 && mPHighlight.x() <= dr.x() + tx / 3 && mPHighlight.y() >= dr.y() - ty / 3 && mPHighlight.y() <= dr.y() + ty / 3)
-                    && mStartSpeedWalk) {
-                    mStartSpeedWalk = false;
-                    float _radius = (0.8 * tx) / 2;
-                    QPointF _center = QPointF(rx, ry);
-                    QRadialGradient _gradient(_center, _radius);
-                    _gradient.setColorAt(0.95, QColor(255, 0, 0, 150));
-                    _gradient.setColorAt(0.80, QColor(150, 100, 100, 150));
-                    _gradient.setColorAt(0.799, QColor(150, 100, 100, 100));
-                    _gradient.setColorAt(0.7, QColor(255, 0, 0, 200));
-                    _gradient.setColorAt(0, QColor(255, 255, 255, 255));
-                    QPen myPen(Qt::transparent);
-                    QPainterPath myPath;
-                    p.setBrush(_gradient);
-                    p.setPen(myPen);
-                    myPath.addEllipse(_center, _radius, _radius);
-                    p.drawPath(myPath);
-
-                    mPick = false;
-                    mTarget = it.key();
-                    if (mpMap->mpRoomDB->getRoom(mTarget)) {
-                        mpMap->mTargetID = mTarget;
-                        if (mpMap->findPath(mpMap->mRoomIdHash.value(mpHost->getName()), mpMap->mTargetID)) {
-                            mpMap->mpHost->startSpeedWalk();
-                        } else {
-                            QString msg = "Mapper: Cannot find a path to this room using known exits.\n";
-                            mpHost->mpConsole->printSystemMessage(msg);
-                        }
-                    }
-                }
-            }
-        }
     }
 
-    if (mpMap->mapLabels.contains(mAID)) {
-        QMapIterator<int, TMapLabel> it(mpMap->mapLabels[mAID]);
-        while (it.hasNext()) {
-            it.next();
-            if (it.value().pos.z() != mOz) {
-                continue;
-            }
-            if (it.value().text.length() < 1) {
-                mpMap->mapLabels[mAID][it.key()].text = "no text";
-            }
-            QPointF lpos;
-            int _lx = it.value().pos.x() * tx + _rx;
-            int _ly = it.value().pos.y() * ty * -1 + _ry;
+    QMapIterator<int, QPoint> itAreaExit(mAreaExitList);
+    while (itAreaExit.hasNext()) {
+        itAreaExit.next();
+        QPoint P = itAreaExit.value();
+        int rx = P.x();
+        int ry = P.y();
 
-            lpos.setX(_lx);
-            lpos.setY(_ly);
-            int _lw = abs(it.value().size.width()) * tx;
-            int _lh = abs(it.value().size.height()) * ty;
+        QRectF dr = QRectF(rx, ry, tx * rSize, ty * rSize); //rx-(tx*rSize)/2,ry-(ty*rSize)/2,tx*rSize,ty*rSize);
+        if (((mPick || __Pick) && mPHighlight.x() >= dr.x() - tx / 3 && mPHighlight.x() <= dr.x() + tx / 3 && mPHighlight.y() >= dr.y() - ty / 3 && mPHighlight.y() <= dr.y() + ty / 3)
+            && mStartSpeedWalk) {
+            mStartSpeedWalk = false;
+            float _radius = (0.8 * tx) / 2;
+            QPointF _center = QPointF(rx, ry);
+            QRadialGradient _gradient(_center, _radius);
+            _gradient.setColorAt(0.95, QColor(255, 0, 0, 150));
+            _gradient.setColorAt(0.80, QColor(150, 100, 100, 150));
+            _gradient.setColorAt(0.799, QColor(150, 100, 100, 100));
+            _gradient.setColorAt(0.7, QColor(255, 0, 0, 200));
+            _gradient.setColorAt(0, QColor(255, 255, 255, 255));
+            QPen myPen(Qt::transparent);
+            QPainterPath myPath;
+            p.setBrush(_gradient);
+            p.setPen(myPen);
+            myPath.addEllipse(_center, _radius, _radius);
+            p.drawPath(myPath);
 
-            if (!((0 < _lx || 0 < _lx + _lw) && (_w > _lx || _w > _lx + _lw))) {
-                continue;
-            }
-            if (!((0 < _ly || 0 < _ly + _lh) && (_h > _ly || _h > _ly + _lh))) {
-                continue;
-            }
-            QRectF _drawRect = QRect(it.value().pos.x() * tx + _rx, it.value().pos.y() * ty * -1 + _ry, _lw, _lh);
-            if (it.value().showOnTop) {
-                if (!it.value().noScaling) {
-                    p.drawPixmap(lpos, it.value().pix.scaled(_drawRect.size().toSize()));
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setWidth(_drawRect.width());
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setHeight(_drawRect.height());
+            mPick = false;
+            mTarget = itAreaExit.key();
+            if (mpMap->mpRoomDB->getRoom(mTarget)) {
+                mpMap->mTargetID = mTarget;
+                if (mpMap->findPath(mpMap->mRoomIdHash.value(mpHost->getName()), mpMap->mTargetID)) {
+                    mpMap->mpHost->startSpeedWalk();
                 } else {
-                    p.drawPixmap(lpos, it.value().pix);
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setWidth(it.value().pix.width());
-                    mpMap->mapLabels[mAID][it.key()].clickSize.setHeight(it.value().pix.height());
+                    QString msg = "Mapper: Cannot find a path to this room using known exits.\n";
+                    mpHost->mpConsole->printSystemMessage(msg);
                 }
             }
-            if (it.value().hilite) {
-                _drawRect.setSize(it.value().clickSize);
-                p.fillRect(_drawRect, QColor(255, 155, 55, 190));
-            }
         }
     }
 
@@ -1749,28 +1714,7 @@ void T2DMap::paintEvent(QPaintEvent* e)
     if (mMultiSelectionHighlightRoomId > 0 && mMultiSelectionSet.size() > 1) {
         TRoom* pR_multiSelectionHighlight = mpMap->mpRoomDB->getRoom(mMultiSelectionHighlightRoomId);
         if (pR_multiSelectionHighlight) {
-            float r_mSx = pR_multiSelectionHighlight->x * tx + _rx;
-            float r_mSy = pR_multiSelectionHighlight->y * -1 * ty + _ry;
-            QPen savePen = p.pen();
-            QBrush saveBrush = p.brush();
-            float _radius = tx * 1.2;
-            float _diagonal = tx * 1.2;
-            QPointF _center = QPointF(r_mSx, r_mSy);
-
-            QPen myPen(QColor(255, 255, 50, 192)); // Quarter opaque yellow pen
-            myPen.setWidth(tx * 0.1);
-            QPainterPath myPath;
-            p.setPen(myPen);
-            p.setBrush(Qt::NoBrush);
-            myPath.addEllipse(_center, _radius, _radius);
-            myPath.addEllipse(_center, _radius / 2.0, _radius / 2.0);
-            myPath.moveTo(r_mSx - _diagonal, r_mSy - _diagonal);
-            myPath.lineTo(r_mSx + _diagonal, r_mSy + _diagonal);
-            myPath.moveTo(r_mSx + _diagonal, r_mSy - _diagonal);
-            myPath.lineTo(r_mSx - _diagonal, r_mSy + _diagonal);
-            p.drawPath(myPath);
-            p.setPen(savePen);
-            p.setBrush(saveBrush);
+            paintTarget(p, pR_multiSelectionHighlight->x * tx + _rx, pR_multiSelectionHighlight->y * -1 * ty + _ry, tx);
         }
     }
 
@@ -2071,6 +2015,7 @@ void T2DMap::createLabel(QRectF labelRect)
         labelID = mpMap->createMapLabelID(mAID);
         mpMap->mapLabels[mAID].insert(labelID, label);
     }
+    mpMap->setMapDataChanged();
     update();
 }
 
@@ -2155,6 +2100,7 @@ void T2DMap::mousePressEvent(QMouseEvent* event)
                 // might be useful to have a snap to grid type option
                 pR->customLines[mCustomLinesRoomExit].push_back(QPointF(mx, my));
                 pR->calcRoomDimensions();
+                mpMap->setMapDataChanged();
                 repaint();
                 return;
             }
@@ -2772,6 +2718,7 @@ void T2DMap::slot_customLineProperties()
 
                 pR->customLinesArrow[exit] = mpCurrentLineArrow->checkState();
                 mCurrentLineArrow = mpCurrentLineArrow->checkState();
+                mpMap->setMapDataChanged();
             }
         }
         repaint();
@@ -2793,6 +2740,7 @@ void T2DMap::slot_customLineAddPoint()
         segment.setLength(segment.length() / 2.0);
         pR->customLines[mCustomLineSelectedExit].insert(mCustomLineSelectedPoint, segment.p2());
         mCustomLineSelectedPoint++;
+        mpMap->setMapDataChanged();
         repaint();
     } else if (mCustomLineSelectedPoint == 0) {
         // The first user manipulable point IS zero - line is drawn to it from a
@@ -2825,6 +2773,7 @@ void T2DMap::slot_customLineAddPoint()
         segment.setLength(segment.length() / 2.0);
         pR->customLines[mCustomLineSelectedExit].insert(mCustomLineSelectedPoint, segment.p2());
         mCustomLineSelectedPoint++;
+        mpMap->setMapDataChanged();
         repaint();
     }
 }
@@ -2840,12 +2789,14 @@ void T2DMap::slot_customLineRemovePoint()
     if (mCustomLineSelectedPoint > 0) {
         pR->customLines[mCustomLineSelectedExit].removeAt(mCustomLineSelectedPoint);
         mCustomLineSelectedPoint--;
+        mpMap->setMapDataChanged();
         repaint();
     } else if (mCustomLineSelectedPoint == 0 && pR->customLines.value(mCustomLineSelectedExit).count() > 1) {
         // The first user manipulable point IS zero - line is drawn to it from a
         // point around room symbol dependent on the exit direction.  We can only
         // allow it's deletion if there is at least another one left.
         pR->customLines[mCustomLineSelectedExit].removeAt(mCustomLineSelectedPoint);
+        mpMap->setMapDataChanged();
         repaint();
     }
 }
@@ -2860,6 +2811,7 @@ void T2DMap::slot_undoCustomLineLastPoint()
                 pR->customLines[mCustomLinesRoomExit].pop_back();
             }
             pR->calcRoomDimensions();
+            mpMap->setMapDataChanged();
         }
         repaint();
     }
@@ -2893,6 +2845,7 @@ void T2DMap::slot_deleteCustomExitLine()
             pR->customLinesColor.remove(mCustomLineSelectedExit);
             pR->customLinesStyle.remove(mCustomLineSelectedExit);
             pR->customLines.remove(mCustomLineSelectedExit);
+            mpMap->setMapDataChanged();
             mCustomLineSelectedRoom = 0;
             mCustomLineSelectedExit = "";
             mCustomLineSelectedPoint = -1;
@@ -2929,6 +2882,7 @@ void T2DMap::slot_deleteLabel()
         for (int& i : deleteList) {
             mpMap->mapLabels[mAID].remove(i);
         }
+        mpMap->setMapDataChanged();
     }
     update();
 }
@@ -3057,9 +3011,7 @@ void T2DMap::slot_movePosition()
                 continue;
             }
 
-            pR->x += dx;
-            pR->y += dy;
-            pR->z += dz;
+            mpMap->setRoomCoordinates(pR->getId(), pR->x + dx, pR->y + dy, pR->z + dz);
         }
     }
     repaint();
@@ -3235,6 +3187,7 @@ void T2DMap::slot_setCharacter()
                 pR->c = newLetter.at(0).toLatin1();
             }
         }
+        mpMap->setMapDataChanged();
     }
 }
 
@@ -3264,6 +3217,7 @@ void T2DMap::slot_defineNewColor()
     auto color = QColorDialog::getColor(mpHost->mRed, this);
     if (color.isValid()) {
         mpMap->customEnvColors[mpMap->customEnvColors.size() + 257 + 16] = color;
+        mpMap->setMapDataChanged();
         slot_changeColor();
     }
     repaint();
@@ -3333,6 +3287,7 @@ void T2DMap::slot_changeColor()
                 pR->environment = mChosenRoomColor;
             }
         }
+        mpMap->setMapDataChanged();
 
         update();
     }
@@ -3378,10 +3333,7 @@ void T2DMap::slot_spread()
             continue;
         }
 
-        pMovingR->x *= spread;
-        pMovingR->y *= spread;
-        pMovingR->x += dx;
-        pMovingR->y += dy;
+        mpMap->setRoomCoordinates(pMovingR->getId(), pMovingR->x * spread + dx, pMovingR->y * spread + dy, pMovingR->z);
         QMapIterator<QString, QList<QPointF>> itCustomLine(pMovingR->customLines);
         QMap<QString, QList<QPointF>> newCustomLinePointsMap;
         while (itCustomLine.hasNext()) {
@@ -3440,10 +3392,7 @@ void T2DMap::slot_shrink()
         if (!pMovingR) {
             continue;
         }
-        pMovingR->x /= spread;
-        pMovingR->y /= spread;
-        pMovingR->x += dx;
-        pMovingR->y += dy;
+        mpMap->setRoomCoordinates(pMovingR->getId(), pMovingR->x / spread + dx, pMovingR->y / spread + dy, pMovingR->z);
         QMapIterator<QString, QList<QPointF>> itCustomLine(pMovingR->customLines);
         QMap<QString, QList<QPointF>> newCustomLinePointsMap;
         while (itCustomLine.hasNext()) {
@@ -3492,7 +3441,7 @@ void T2DMap::slot_lockRoom()
         TRoom* pR = mpMap->mpRoomDB->getRoom(itSelectedRoom.next());
         if (pR) {
             pR->isLocked = true;
-            mpMap->mMapGraphNeedsUpdate = true;
+            mpMap->setRoomNeedsGraphUpdate(pR->getId());
         }
     }
 }
@@ -3509,7 +3458,7 @@ void T2DMap::slot_unlockRoom()
         TRoom* pR = mpMap->mpRoomDB->getRoom(itSelectedRoom.next());
         if (pR) {
             pR->isLocked = false;
-            mpMap->mMapGraphNeedsUpdate = true;
+            mpMap->setRoomNeedsGraphUpdate(pR->getId());
         }
     }
 }
@@ -3641,7 +3590,6 @@ void T2DMap::slot_setRoomWeight()
 
             pR->setWeight(newWeight);
         }
-        mpMap->mMapGraphNeedsUpdate = true;
         repaint();
     }
 }
@@ -3748,6 +3696,7 @@ void T2DMap::mouseMoveEvent(QMouseEvent* event)
                     QPointF pc = QPointF(mx, my);
                     pR->customLines[mCustomLineSelectedExit][mCustomLineSelectedPoint] = pc;
                     pR->calcRoomDimensions();
+                    mpMap->setMapDataChanged();
                     repaint();
                     return;
                 }
@@ -3776,6 +3725,7 @@ void T2DMap::mouseMoveEvent(QMouseEvent* event)
                 my = yspan / 2 - my;
                 QVector3D p = QVector3D(mx, my, mOz);
                 mpMap->mapLabels[mAID][it.key()].pos = p;
+                mpMap->setMapDataChanged();
             }
         }
         update();
@@ -3948,9 +3898,8 @@ void T2DMap::mouseMoveEvent(QMouseEvent* event)
         while (itRoom.hasNext()) {
             pR = mpMap->mpRoomDB->getRoom(itRoom.next());
             if (pR) {
-                pR->x += dx;
-                pR->y += dy;
-                pR->z = mOz; // allow groups to be moved to a different z-level with the map editor
+                // allow groups to be moved to a different z-level with the map editor:
+                mpMap->setRoomCoordinates(pR->getId(), pR->x + dx, pR->y + dy, mOz);
 
                 QMapIterator<QString, QList<QPointF>> itk(pR->customLines);
                 QMap<QString, QList<QPointF>> newMap;
@@ -4442,6 +4391,7 @@ void T2DMap::slot_setCustomLine2()
     //    qDebug("   LINE STYLE: %s", qPrintable(mCurrentLineStyle) );
     pR->customLinesArrow[exit] = mCurrentLineArrow;
     //    qDebug("   ARROW: %s", mCurrentLineArrow ? "Yes" : "No");
+    mpMap->setMapDataChanged();
 
     mHelpMsg = tr("Left-click to add point, right-click to undo/change/finish...");
     // This message was previously being put up AFTER first click to set first segment was made....
@@ -4479,6 +4429,7 @@ void T2DMap::slot_setCustomLine2B(QTreeWidgetItem* special_exit, int column)
     //    qDebug("   LINE STYLE: %s", qPrintable(mCurrentLineStyle) );
     pR->customLinesArrow[exit] = mCurrentLineArrow;
     //    qDebug("   ARROW: %s", mCurrentLineArrow ? "Yes" : "No");
+    mpMap->setMapDataChanged();
     mHelpMsg = tr("Left-click to add point, right-click to undo/change/finish...");
     // This message was previously being put up AFTER first click to set first segment was made....
     update();
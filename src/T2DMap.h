@@ -25,19 +25,25 @@
 
 #include "pre_guard.h"
 #include <QColor>
+#include <QHash>
+#include <QPair>
 #include <QPixmap>
 #include <QPointer>
 #include <QString>
 #include <QTreeWidget>
+#include <QVector>
 #include <QWidget>
 #include "post_guard.h"
 
 class Host;
+class TArea;
 class TMap;
+class TRoom;
 
 class QCheckBox;
 class QComboBox;
 class QListWidgetItem;
+class QPainter;
 class QPushButton;
 class QTreeWidgetItem;
 
@@ -198,8 +204,44 @@ public slots:
     void slot_cancelCustomLineDialog();
 
 private:
+    // What the cached map tiles were drawn for, they are all thrown away when
+    // any of it changes:
+    struct MapCacheKey
+    {
+        bool operator==(const MapCacheKey& other) const;
+
+        int areaId;
+        int zLevel;
+        float tx;
+        float ty;
+        double roomSize;
+        double exitSize;
+        qreal devicePixelRatio;
+        bool isGridMode;
+        bool isAntiAliased;
+        bool isBubbleMode;
+        bool isShowingRoomIds;
+        quint64 mapRevision;
+        QVector<QRgb> colors;
+    };
+
     void resizeMultiSelectionWidget();
 
+    // The map is painted in two layers: the rooms, exits and labels - which
+    // only change with the map data, the zoom or the mapper settings - are
+    // drawn, in map pixels (the map's 0,0 at 0,0), into tiles that are kept
+    // between paints; the player marker, room highlights and selections are
+    // then drawn over those on every paint:
+    void updateMapCache(TArea* pArea, int zLevel, float tx, float ty);
+    QPixmap getMapTile(TArea* pArea, int zLevel, float tx, float ty, int column, int row);
+    void getDrawnExits(TRoom* pR, QList<int>& exitList, QList<int>& oneWayExits);
+    void paintMapLabels(QPainter& painter, int zLevel, float tx, float ty, const QRectF& clipRect, bool isShowingOnTop);
+    void paintRoomExits(QPainter& painter, TRoom* pR, float tx, float ty, float wegBreite);
+    void paintCustomLine(QPainter& painter, TRoom* pR, const QString& exit, float tx, float ty, float wegBreite, bool isSelected);
+    void paintRoom(QPainter& painter, TRoom* pR, float tx, float ty, bool isGridMode);
+    void paintRoomMarkers(QPainter& painter, TRoom* pR, float rx, float ry, float tx, float ty, const QColor& roomColor);
+    void paintTarget(QPainter& painter, float rx, float ry, float tx);
+
     bool mDialogLock;
 
     // When more than zero rooms are selected this
@@ -223,6 +265,20 @@ private:
     // room listing/selection widget, and by what,
     // as we now show room names (if present) as well.
     bool mIsSelectionUsingNames;
+
+    MapCacheKey mMapCacheKey;
+    bool mIsMapCacheValid;
+    // key = tile column and row packed together, value = tile:
+    QHash<quint64, QPixmap> mMapTiles;
+    // Where (in map pixels) each room on the cached level draws its exits and
+    // custom lines, so that a tile need only draw those of the rooms that
+    // reach into it:
+    QVector<QPair<int, QRectF>> mCachedExitBounds;
+    // key = room that an area exit leads to, value = where (in map pixels) it
+    // is drawn from:
+    QMap<int, QPointF> mCachedAreaExits;
+    // key = index into mPixMap, value = it scaled to the current room size:
+    QHash<int, QPixmap> mScaledPixMap;
 };
 
 #endif // MUDLET_T2DMAP_H
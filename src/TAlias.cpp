@@ -25,6 +25,7 @@
 
 #include "Host.h"
 #include "TDebug.h"
+#include "TMatchSubject.h"
 #include "mudlet.h"
 
 
@@ -68,7 +69,7 @@ void TAlias::setName(const QString& name)
     mpHost->getAliasUnit()->mLookupTable.insertMulti(name, this);
 }
 
-bool TAlias::match(const QString& toMatch)
+bool TAlias::match(const TMatchSubject& toMatch)
 {
     if (!isActive()) {
         if (isFolder()) {
@@ -88,21 +89,21 @@ bool TAlias::match(const QString& toMatch)
     bool matchCondition = false;
     //bool ret = false;
     //bool conditionMet = false;
-    QSharedPointer<pcre> re = mpRegex;
-    if (re == NULL) {
+    const TRegex re = mRegex;
+    if (!re) {
         return false; //regex compile error
     }
 
-    //const char *error;
-    char* subject = (char*)malloc(strlen(toMatch.toLocal8Bit().data()) + 1);
-    strcpy(subject, toMatch.toLocal8Bit().data());
+    TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Alias, mID, mName, TProfiler::Matching);
+
+    const char* subject = toMatch.data();
     unsigned char* name_table;
     //int erroffset;
     //int find_all;
     int namecount;
     int name_entry_size;
 
-    int subject_length = strlen(subject);
+    int subject_length = toMatch.length();
     int rc, i;
     std::list<std::string> captureList;
     std::list<int> posList;
@@ -110,7 +111,7 @@ bool TAlias::match(const QString& toMatch)
 
     //cout <<" LINE="<<subject<<endl;
     if (mRegexCode.size() > 0) {
-        rc = pcre_exec(re.data(), 0, subject, subject_length, 0, 0, ovector, 100);
+        rc = re.exec(subject, subject_length, 0, PCRE_NO_UTF8_CHECK, ovector, 100);
     } else {
         goto MUD_ERROR;
     }
@@ -135,9 +136,10 @@ bool TAlias::match(const QString& toMatch)
     }
 
     matchCondition = true; // alias has matched
+    profileScope.setHit();
 
     for (i = 0; i < rc; i++) {
-        char* substring_start = subject + ovector[2 * i];
+        const char* substring_start = subject + ovector[2 * i];
         int substring_length = ovector[2 * i + 1] - ovector[2 * i];
 
         std::string match;
@@ -148,21 +150,21 @@ bool TAlias::match(const QString& toMatch)
         }
         match.append(substring_start, substring_length);
         captureList.push_back(match);
-        posList.push_back(ovector[2 * i]);
+        posList.push_back(toMatch.textPosition(ovector[2 * i]));
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::darkCyan), QColor(Qt::black)) << "Alias: capture group #" << (i + 1) << " = " >> 0;
             TDebug(QColor(Qt::darkMagenta), QColor(Qt::black)) << "<" << match.c_str() << ">\n" >> 0;
         }
     }
-    pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMECOUNT, &namecount);
+    re.fullInfo(PCRE_INFO_NAMECOUNT, &namecount);
 
     if (namecount <= 0) {
         //cout << "no named substrings detected" << endl;
     } else {
         unsigned char* tabptr;
-        pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMETABLE, &name_table);
+        re.fullInfo(PCRE_INFO_NAMETABLE, &name_table);
 
-        pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMEENTRYSIZE, &name_entry_size);
+        re.fullInfo(PCRE_INFO_NAMEENTRYSIZE, &name_entry_size);
 
         tabptr = name_table;
         for (i = 0; i < namecount; i++) {
@@ -182,13 +184,13 @@ bool TAlias::match(const QString& toMatch)
             options = PCRE_NOTEMPTY | PCRE_ANCHORED;
         }
 
-        rc = pcre_exec(re.data(), NULL, subject, subject_length, start_offset, options, ovector, 30);
+        rc = re.exec(subject, subject_length, start_offset, options | PCRE_NO_UTF8_CHECK, ovector, 30);
 
         if (rc == PCRE_ERROR_NOMATCH) {
             if (options == 0) {
                 break;
             }
-            ovector[1] = start_offset + 1;
+            ovector[1] = toMatch.nextCharacterOffset(start_offset);
             continue;
         }
 
@@ -200,7 +202,7 @@ bool TAlias::match(const QString& toMatch)
             qDebug() << "CRITICAL ERROR: SHOULD NOT HAPPEN->pcre_info() got wrong num of cap groups ovector only has room for %d captured substrings\n";
         }
         for (i = 0; i < rc; i++) {
-            char* substring_start = subject + ovector[2 * i];
+            const char* substring_start = subject + ovector[2 * i];
             int substring_length = ovector[2 * i + 1] - ovector[2 * i];
             std::string match;
             if (substring_length < 1) {
@@ -210,7 +212,7 @@ bool TAlias::match(const QString& toMatch)
             }
             match.append(substring_start, substring_length);
             captureList.push_back(match);
-            posList.push_back(ovector[2 * i]);
+            posList.push_back(toMatch.textPosition(ovector[2 * i]));
             if (mudlet::debugMode) {
                 TDebug(QColor(Qt::darkCyan), QColor(Qt::black)) << "capture group #" << (i + 1) << " = " >> 0;
                 TDebug(QColor(Qt::darkMagenta), QColor(Qt::black)) << "<" << match.c_str() << ">\n" >> 0;
@@ -233,15 +235,9 @@ MUD_ERROR:
         }
     }
 
-    free(subject);
     return matchCondition;
 }
 
-static void pcre_deleter(pcre* pointer)
-{
-    pcre_free(pointer);
-}
-
 void TAlias::setRegexCode(const QString& code)
 {
     mRegexCode = code;
@@ -251,12 +247,12 @@ void TAlias::setRegexCode(const QString& code)
 void TAlias::compileRegex()
 {
     const char* error;
-    const QByteArray& local8Bit = mRegexCode.toLocal8Bit();
+    const QByteArray& utf8 = mRegexCode.toUtf8();
     int erroffset;
 
-    QSharedPointer<pcre> re(pcre_compile(local8Bit.constData(), 0, &error, &erroffset, NULL), pcre_deleter);
+    TRegex re = TRegex::compile(utf8, PCRE_UTF8, &error, &erroffset);
 
-    if (re == NULL) {
+    if (!re) {
         mOK_init = false;
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::white), QColor(Qt::red)) << "REGEX ERROR: failed to compile, reason:\n" << error << "\n" >> 0;
@@ -267,7 +263,7 @@ void TAlias::compileRegex()
         mOK_init = true;
     }
 
-    mpRegex = re;
+    mRegex = re;
 }
 
 bool TAlias::registerAlias()
@@ -335,6 +331,7 @@ bool TAlias::compileScript()
 
 void TAlias::execute()
 {
+    TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Alias, mID, mName, TProfiler::Executing);
     if (mCommand.size() > 0) {
         mpHost->send(mCommand);
     }
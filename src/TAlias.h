@@ -23,6 +23,7 @@
  ***************************************************************************/
 
 
+#include "TRegex.h"
 #include "Tree.h"
 
 #include "pre_guard.h"
@@ -34,6 +35,7 @@
 #include <pcre.h>
 
 class Host;
+class TMatchSubject;
 
 
 class TAlias : public Tree<TAlias>
@@ -60,14 +62,14 @@ public:
     void setCommand(const QString& command) { mCommand = command; }
     QString getCommand() { return mCommand; }
 
-    bool match(const QString& toMatch);
+    bool match(const TMatchSubject& toMatch);
     bool registerAlias();
 
     TAlias() {}
     QString mName;
     QString mCommand;
     QString mRegexCode;
-    QSharedPointer<pcre> mpRegex;
+    TRegex mRegex;
     QString mScript;
     QPointer<Host> mpHost;
     bool mNeedsToBeCompiled;
@@ -43,6 +43,11 @@
 // FIXME: Modify mapper "painter" code to use "exits" rather than deriving the
 // same information each time it is run ???
 
+// Size (in map units) of the square cells of the spatial index - big enough
+// that a range query over a typical view only looks in a few cells, small
+// enough that looking for one position does not have many rooms to check:
+static const int scSpatialIndexCellSize = 8;
+
 TArea::TArea(TMap * map , TRoomDB * pRDB )
 : min_x(0)
 , min_y(0)
@@ -56,6 +61,7 @@ TArea::TArea(TMap * map , TRoomDB * pRDB )
 , mpRoomDB( pRDB )
 , mIsDirty( false )
 , mpMap( map )
+, mIsSpatialIndexValid(false)
 {
 }
 
@@ -78,39 +84,21 @@ int TArea::getAreaID()
     }
 }
 
-QMap<int, QMap<int, QMultiMap<int, int>>> TArea::koordinatenSystem()
+QList<int> TArea::getRoomsByPosition(int x, int y, int z)
 {
-    QMap<int, QMap<int, QMultiMap<int, int>>> kS;
-    QList<TRoom*> roomList = mpRoomDB->getRoomPtrList();
-    for (auto room : roomList) {
-        int id = room->getId();
-        int x = room->x;
-        int y = room->y;
-        int z = room->z;
-        QMap<int, QMultiMap<int, int>> _y;
-        QMultiMap<int, int> _z;
-        if (!kS.contains(x)) {
-            kS[x] = _y;
-        }
-        if (!kS[x].contains(y)) {
-            kS[x][y] = _z;
-        }
-        kS[x][y].insertMulti(z, id);
+    if (!mIsSpatialIndexValid) {
+        buildSpatialIndex();
     }
-    //qDebug()<< "kS="<<kS;
-    return kS;
-}
 
-QList<int> TArea::getRoomsByPosition(int x, int y, int z)
-{
     QList<int> dL;
-    QSetIterator<int> itAreaRoom(rooms);
-    while (itAreaRoom.hasNext()) {
-        int roomId = itAreaRoom.next();
-        TRoom* pR = mpRoomDB->getRoom(roomId);
-        if (pR) {
-            if (pR->x == x && pR->y == y && pR->z == z) {
-                dL.push_back(roomId);
+    auto itLevel = mSpatialIndex.constFind(z);
+    if (itLevel != mSpatialIndex.constEnd()) {
+        auto itCell = itLevel.value().constFind(cellKey(cellOf(x), cellOf(y)));
+        if (itCell != itLevel.value().constEnd()) {
+            for (const auto& entry : itCell.value()) {
+                if (entry.x == x && entry.y == y) {
+                    dL.push_back(entry.id);
+                }
             }
         }
     }
@@ -122,32 +110,86 @@ QList<int> TArea::getRoomsByPosition(int x, int y, int z)
     return dL;
 }
 
+QList<int> TArea::getRoomsInRect(int xMin, int xMax, int yMin, int yMax, int z)
+{
+    if (!mIsSpatialIndexValid) {
+        buildSpatialIndex();
+    }
+
+    QList<int> results;
+    auto itLevel = mSpatialIndex.constFind(z);
+    if (itLevel == mSpatialIndex.constEnd() || xMin > xMax || yMin > yMax) {
+        return results;
+    }
+
+    const QHash<quint64, QVector<IndexedRoom>>& cells = itLevel.value();
+    auto collect = [&](const QVector<IndexedRoom>& cell) {
+        for (const auto& entry : cell) {
+            if (entry.x >= xMin && entry.x <= xMax && entry.y >= yMin && entry.y <= yMax) {
+                results.append(entry.id);
+            }
+        }
+    };
+
+    const int cellXMin = cellOf(xMin);
+    const int cellXMax = cellOf(xMax);
+    const int cellYMin = cellOf(yMin);
+    const int cellYMax = cellOf(yMax);
+    // When zoomed out so far that the bounds cover more cells than are in use
+    // it is quicker to look at each of those instead:
+    if ((static_cast<qint64>(cellXMax) - cellXMin + 1) * (static_cast<qint64>(cellYMax) - cellYMin + 1) > cells.size()) {
+        for (auto itCell = cells.constBegin(); itCell != cells.constEnd(); ++itCell) {
+            collect(itCell.value());
+        }
+        return results;
+    }
+
+    for (int cellX = cellXMin; cellX <= cellXMax; ++cellX) {
+        for (int cellY = cellYMin; cellY <= cellYMax; ++cellY) {
+            auto itCell = cells.constFind(cellKey(cellX, cellY));
+            if (itCell != cells.constEnd()) {
+                collect(itCell.value());
+            }
+        }
+    }
+    return results;
+}
+
+QList<int> TArea::getRoomsOnLevel(int z)
+{
+    if (!mIsSpatialIndexValid) {
+        buildSpatialIndex();
+    }
+
+    QList<int> results;
+    auto itLevel = mSpatialIndex.constFind(z);
+    if (itLevel != mSpatialIndex.constEnd()) {
+        for (const auto& cell : itLevel.value()) {
+            for (const auto& entry : cell) {
+                results.append(entry.id);
+            }
+        }
+    }
+    return results;
+}
+
+// Returns the rooms that are at the same coordinates as another room in this
+// area:
 QList<int> TArea::getCollisionNodes()
 {
+    if (!mIsSpatialIndexValid) {
+        buildSpatialIndex();
+    }
+
     QList<int> problems;
-    QMap<int, QMap<int, QMultiMap<int, int>>> kS = koordinatenSystem();
-    QMapIterator<int, QMap<int, QMultiMap<int, int>>> it(kS);
-    while (it.hasNext()) {
-        it.next();
-        QMap<int, QMultiMap<int, int>> x_val = it.value();
-        QMapIterator<int, QMultiMap<int, int>> it2(x_val);
-        while (it2.hasNext()) {
-            it2.next();
-            QMultiMap<int, int> y_val = it2.value();
-            QMapIterator<int, int> it3(y_val);
-            QList<int> z_coordinates;
-            while (it3.hasNext()) {
-                it3.next();
-                int z = it3.key();
-                int node = it3.value();
-
-                if (!z_coordinates.contains(node)) {
-                    z_coordinates.append(node);
-                } else {
-                    if (!problems.contains(node)) {
-                        auto it4 = y_val.find(z);
-                        problems.append(it4.value());
-                        //qDebug()<<"problem node="<<node;
+    for (const auto& level : mSpatialIndex) {
+        for (const auto& cell : level) {
+            // Rooms can only collide with others in the same cell:
+            for (int i = 0, total = cell.size(); i < total; ++i) {
+                for (int j = 0; j < total; ++j) {
+                    if (i != j && cell.at(i).x == cell.at(j).x && cell.at(i).y == cell.at(j).y) {
+                        problems.append(cell.at(i).id);
+                        break;
                     }
                 }
             }
@@ -156,6 +198,104 @@ QList<int> TArea::getCollisionNodes()
     return problems;
 }
 
+void TArea::updateRoomPosition(int id)
+{
+    if (!mIsSpatialIndexValid || !rooms.contains(id)) {
+        return;
+    }
+
+    removeFromSpatialIndex(id);
+    TRoom* pR = mpRoomDB->getRoom(id);
+    if (pR) {
+        addToSpatialIndex(id, pR->x, pR->y, pR->z);
+    }
+}
+
+void TArea::invalidateSpatialIndex()
+{
+    mIsSpatialIndexValid = false;
+    mSpatialIndex.clear();
+    mIndexedPositions.clear();
+}
+
+// Floors rather than truncates so that cells either side of zero are the same
+// size as the others:
+int TArea::cellOf(int coordinate)
+{
+    return coordinate >= 0 ? coordinate / scSpatialIndexCellSize : (coordinate + 1) / scSpatialIndexCellSize - 1;
+}
+
+quint64 TArea::cellKey(int cellX, int cellY)
+{
+    return (static_cast<quint64>(static_cast<quint32>(cellX)) << 32) | static_cast<quint32>(cellY);
+}
+
+void TArea::buildSpatialIndex()
+{
+    mSpatialIndex.clear();
+    mIndexedPositions.clear();
+    mIndexedPositions.reserve(rooms.size());
+    QSetIterator<int> itRoom(rooms);
+    while (itRoom.hasNext()) {
+        int id = itRoom.next();
+        TRoom* pR = mpRoomDB->getRoom(id);
+        if (pR) {
+            addToSpatialIndex(id, pR->x, pR->y, pR->z);
+        }
+    }
+    mIsSpatialIndexValid = true;
+}
+
+void TArea::addToSpatialIndex(int id, int x, int y, int z)
+{
+    IndexedPosition position;
+    position.x = x;
+    position.y = y;
+    position.z = z;
+    mIndexedPositions.insert(id, position);
+
+    IndexedRoom entry;
+    entry.id = id;
+    entry.x = x;
+    entry.y = y;
+    mSpatialIndex[z][cellKey(cellOf(x), cellOf(y))].append(entry);
+}
+
+void TArea::removeFromSpatialIndex(int id)
+{
+    auto itPosition = mIndexedPositions.find(id);
+    if (itPosition == mIndexedPositions.end()) {
+        return;
+    }
+
+    const IndexedPosition position = itPosition.value();
+    mIndexedPositions.erase(itPosition);
+    auto itLevel = mSpatialIndex.find(position.z);
+    if (itLevel == mSpatialIndex.end()) {
+        return;
+    }
+    auto itCell = itLevel.value().find(cellKey(cellOf(position.x), cellOf(position.y)));
+    if (itCell == itLevel.value().end()) {
+        return;
+    }
+
+    QVector<IndexedRoom>& cell = itCell.value();
+    for (int i = 0, total = cell.size(); i < total; ++i) {
+        if (cell.at(i).id == id) {
+            // The order within a cell does not matter:
+            cell[i] = cell.last();
+            cell.removeLast();
+            break;
+        }
+    }
+    if (cell.isEmpty()) {
+        itLevel.value().erase(itCell);
+        if (itLevel.value().isEmpty()) {
+            mSpatialIndex.erase(itLevel);
+        }
+    }
+}
+
 void TArea::determineAreaExitsOfRoom(int id)
 {
     if (!mpRoomDB) {
@@ -369,6 +509,9 @@ void TArea::addRoom(int id)
     if (pR) {
         if (!rooms.contains(id)) {
             rooms.insert(id);
+            if (mIsSpatialIndexValid) {
+                addToSpatialIndex(id, pR->x, pR->y, pR->z);
+            }
         } else {
             qDebug() << "TArea::addRoom(" << id << ") No creation! room already exists";
         }
@@ -510,6 +653,9 @@ void TArea::removeRoom(int room, bool isToDeferAreaRelatedRecalculations)
     }
     rooms.remove(room);
     exits.remove(room);
+    if (mIsSpatialIndexValid) {
+        removeFromSpatialIndex(room);
+    }
     if (isOnExtreme) {
         calcSpan();
     }
@@ -26,9 +26,11 @@
 #include "TMap.h"
 
 #include "pre_guard.h"
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QPair>
+#include <QVector>
 #include <QVector3D>
 #include "post_guard.h"
 
@@ -58,7 +60,15 @@ public:
     void removeRoom(int, bool isToDeferAreaRelatedRecalculations = false);
     QList<int> getCollisionNodes();
     QList<int> getRoomsByPosition(int x, int y, int z);
-    QMap<int, QMap<int, QMultiMap<int, int>>> koordinatenSystem();
+    // From the spatial index, for culling to what can be seen - the rooms on
+    // z-level z that lie within the given bounds (inclusive) or on it at all:
+    QList<int> getRoomsInRect(int xMin, int xMax, int yMin, int yMax, int z);
+    QList<int> getRoomsOnLevel(int z);
+    // To be called when a room of this area has been moved:
+    void updateRoomPosition(int id);
+    // To be called after the rooms set has been changed directly, the index
+    // is then rebuilt the next time that it is needed:
+    void invalidateSpatialIndex();
 
 
     QSet<int> rooms; // rooms of this area
@@ -91,11 +101,39 @@ private:
     TArea() { qFatal("FATAL: illegal default constructor use of TArea()"); };
     // QMap<int, TMapLabel> labelMap;
 
+    struct IndexedRoom
+    {
+        int id;
+        int x;
+        int y;
+    };
+
+    struct IndexedPosition
+    {
+        int x;
+        int y;
+        int z;
+    };
+
+    static int cellOf(int coordinate);
+    static quint64 cellKey(int cellX, int cellY);
+    void buildSpatialIndex();
+    void addToSpatialIndex(int id, int x, int y, int z);
+    void removeFromSpatialIndex(int id);
+
     TMap* mpMap; // Supplied by C'tor and now needed to pass an error message upwards
     QMultiMap<int, QPair<int, int>> exits;
     // rooms that border on this area:
     // key=in_area room id, pair.first=out_of_area room id pair.second=direction
     // Made private as we may change implimentation detail
+
+    // Spatial index, a hash grid of square cells for each z-level:
+    // key=z-level, value=(key=cell, value=the rooms in that cell)
+    QHash<int, QHash<quint64, QVector<IndexedRoom>>> mSpatialIndex;
+    // Where each room was when it was indexed, so that it can be found again
+    // after its coordinates have been changed:
+    QHash<int, IndexedPosition> mIndexedPositions;
+    bool mIsSpatialIndexValid;
 };
 
 // - gezeichnet werden erstmal die areas
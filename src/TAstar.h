@@ -27,7 +27,6 @@
 #ifndef Q_MOC_RUN
 #include "pre_guard.h"
 #include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/astar_search.hpp>
 #include <boost/graph/graphviz.hpp>
 #include <boost/graph/random.hpp>
 #include <boost/random.hpp>
@@ -64,54 +63,4 @@ struct route
     QString specialExitName; // If direction is DIR_OTHER then this is needed
 };
 
-// euclidean distance heuristic
-template <class Graph, class CostType, class LocMap>
-class distance_heuristic : public boost::astar_heuristic<Graph, CostType>
-{
-public:
-    typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
-    distance_heuristic(LocMap l, Vertex goal) : m_location(l), m_goal(goal) {}
-
-    CostType operator()(Vertex u)
-    {
-        if (m_location[m_goal].pR->getArea() != m_location[u].pR->getArea()) {
-            return 1;
-        }
-        CostType dx = m_location[m_goal].pR->x - m_location[u].pR->x;
-        CostType dy = m_location[m_goal].pR->y - m_location[u].pR->y;
-        CostType dz = m_location[m_goal].pR->z - m_location[u].pR->z;
-
-        return std::sqrt(dx * dx + dy * dy + dz * dz);
-    }
-
-private:
-    LocMap m_location;
-    Vertex m_goal;
-};
-
-
-// exception for termination
-struct found_goal
-{
-};
-
-// visitor that terminates when we find the goal
-template <class Vertex>
-class astar_goal_visitor : public boost::default_astar_visitor
-{
-public:
-    astar_goal_visitor(Vertex goal) : m_goal(goal) {}
-
-    template <class Graph>
-    void examine_vertex(Vertex u, Graph& g)
-    {
-        if (u == m_goal) {
-            throw found_goal();
-        }
-    }
-
-private:
-    Vertex m_goal;
-};
-
 #endif // MUDLET_TASTAR_H
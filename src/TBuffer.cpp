@@ -24,8 +24,15 @@
 
 #include "Host.h"
 #include "TConsole.h"
+#include "TLogWriter.h"
 
-#include <queue>
+#include "pre_guard.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include "post_guard.h"
+
+#include <iterator>
+#include <utility>
 
 #include <assert.h>
 
@@ -610,20 +617,19 @@ const QMap<QString, QPair<QString, QVector<QChar>>> TBuffer::csmEncodingTable =
 // clang-format on
 
 TChar::TChar()
+: flags(0)
+, link(0)
+, mFgColor(qRgb(255, 255, 255))
+, mBgColor(qRgb(0, 0, 0))
 {
-    fgR = 255;
-    fgG = 255;
-    fgB = 255;
-    bgR = 0;
-    bgG = 0;
-    bgB = 0;
-    flags = 0;
-    link = 0;
 }
 
-TChar::TChar(int fR, int fG, int fB, int bR, int bG, int bB, bool b, bool i, bool u, bool s, int _link) : fgR(fR), fgG(fG), fgB(fB), bgR(bR), bgG(bG), bgB(bB), link(_link)
+TChar::TChar(int fR, int fG, int fB, int bR, int bG, int bB, bool b, bool i, bool u, bool s, int _link)
+: flags(0)
+, link(_link)
+, mFgColor(qRgb(fR, fG, fB))
+, mBgColor(qRgb(bR, bG, bB))
 {
-    flags = 0;
     if (i) {
         flags |= TCHAR_ITALICS;
     }
@@ -639,71 +645,30 @@ TChar::TChar(int fR, int fG, int fB, int bR, int bG, int bB, bool b, bool i, boo
 }
 
 TChar::TChar(Host* pH)
+: flags(0)
+, link(0)
 {
     if (pH) {
-        fgR = pH->mFgColor.red();
-        fgG = pH->mFgColor.green();
-        fgB = pH->mFgColor.blue();
-        bgR = pH->mBgColor.red();
-        bgG = pH->mBgColor.green();
-        bgB = pH->mBgColor.blue();
+        mFgColor = pH->mFgColor.rgb();
+        mBgColor = pH->mBgColor.rgb();
     } else {
-        fgR = 255;
-        fgG = 255;
-        fgB = 255;
-        bgR = 0;
-        bgG = 0;
-        bgB = 0;
-    }
-    flags = 0;
-    link = 0;
-}
-
-bool TChar::operator==(const TChar& c)
-{
-    if (fgR != c.fgR) {
-        return false;
-    }
-    if (fgG != c.fgG) {
-        return false;
-    }
-    if (fgB != c.fgB) {
-        return false;
-    }
-    if (bgR != c.bgR) {
-        return false;
-    }
-    if (bgG != c.bgG) {
-        return false;
-    }
-    if (bgB != c.bgB) {
-        return false;
-    }
-    if (flags != c.flags) {
-        return false;
-    }
-    if (link != c.link) {
-        return false;
+        mFgColor = qRgb(255, 255, 255);
+        mBgColor = qRgb(0, 0, 0);
     }
-    return true;
 }
 
 TChar::TChar(const TChar& copy)
+: flags(copy.flags & ~(TCHAR_INVERSE)) //for some reason we always clear the inverse, is this a bug?
+, link(copy.link)
+, mFgColor(copy.mFgColor)
+, mBgColor(copy.mBgColor)
 {
-    fgR = copy.fgR;
-    fgG = copy.fgG;
-    fgB = copy.fgB;
-    bgR = copy.bgR;
-    bgG = copy.bgG;
-    bgB = copy.bgB;
-    flags = copy.flags;
-    link = copy.link;
-    flags &= ~(TCHAR_INVERSE); //for some reason we always clear the inverse, is this a bug?
 }
 
 
 TBuffer::TBuffer(Host* pH)
-: mLinkID(0)
+: mLineOffset(0)
+, mLinkID(0)
 , mLinesLimit(10000)
 , mBatchDeleteSize(1000)
 , mUntriggered(0)
@@ -902,8 +867,8 @@ QPoint TBuffer::getEndPos()
     int y = 0;
     if (!buffer.empty()) {
         y = buffer.size() - 1;
-        if (!buffer.at(y).empty()) {
-            x = buffer.at(y).size() - 1;
+        if (!buffer[y].format.empty()) {
+            x = buffer[y].format.size() - 1;
         }
     }
     QPoint P_end(x, y);
@@ -919,6 +884,46 @@ int TBuffer::getLastLineNumber()
     }
 }
 
+// The time of day, in milliseconds since the epoch, so that a line shows when
+// it came in even if the computer has been asleep since:
+qint64 TBuffer::currentTimeStamp()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+// In milliseconds since it was started (the first time this is used), from a
+// clock that only ever goes up - though not while the computer is asleep - so
+// that scripts can time things without the time of day being changed under
+// them:
+qint64 TBuffer::currentSteadyTimeStamp()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer.elapsed();
+}
+
+void TBuffer::setCurrentTimeStamp(TBufferLine& line)
+{
+    line.timeStamp = currentTimeStamp();
+    line.steadyTimeStamp = currentSteadyTimeStamp();
+}
+
+// Only done when a time stamp is shown, logged or asked for by a script - and
+// in the same form that they used to be kept in:
+QString TBuffer::timeStampToString(const qint64 timeStamp)
+{
+    if (timeStamp == cTimeStampContinued) {
+        return QStringLiteral("-------------");
+    }
+    if (timeStamp < 0) {
+        return QString();
+    }
+    return QDateTime::fromMSecsSinceEpoch(timeStamp).toString(QStringLiteral("hh:mm:ss.zzz   "));
+}
+
 void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command, QStringList& hint, TChar format)
 {
     mLinkID++;
@@ -931,12 +936,12 @@ void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command,
         append(text,
                0,
                text.length(),
-               format.fgR,
-               format.fgG,
-               format.fgB,
-               format.bgR,
-               format.bgG,
-               format.bgB,
+               format.fgR(),
+               format.fgG(),
+               format.fgB(),
+               format.bgR(),
+               format.bgG(),
+               format.bgB(),
                format.flags & TCHAR_BOLD,
                format.flags & TCHAR_ITALICS,
                format.flags & TCHAR_UNDERLINE,
@@ -946,12 +951,12 @@ void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command,
         appendLine(text,
                    0,
                    text.length(),
-                   format.fgR,
-                   format.fgG,
-                   format.fgB,
-                   format.bgR,
-                   format.bgG,
-                   format.bgB,
+                   format.fgR(),
+                   format.fgG(),
+                   format.fgB(),
+                   format.bgR(),
+                   format.bgG(),
+                   format.bgB(),
                    format.flags & TCHAR_BOLD,
                    format.flags & TCHAR_ITALICS,
                    format.flags & TCHAR_UNDERLINE,
@@ -980,7 +985,7 @@ void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command,
 //    int last = buffer.size()-1;
 //    if( last < 0 )
 //    {
-//        std::deque<TChar> newLine;
+//        std::vector<TChar> newLine;
 //        TChar c(fgColorR,fgColorG,fgColorB,bgColorR,bgColorG,bgColorB,bold,italics,underline);
 //        newLine.push_back( c );
 //        buffer.push_back( newLine );
@@ -999,7 +1004,7 @@ void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command,
 //    {
 //        if( text.at(i) == '\n' )
 //        {
-//            std::deque<TChar> newLine;
+//            std::vector<TChar> newLine;
 //            buffer.push_back( newLine );
 //            lineBuffer.push_back( QString() );
 //            QString time = "-------------";
@@ -1023,7 +1028,7 @@ void TBuffer::addLink(bool trigMode, const QString& text, QStringList& command,
 //                    QString tmp = lineBuffer.back().mid(0,i+1);
 //                    QString lineRest = lineBuffer.back().mid(i+1);
 //                    lineBuffer.back() = tmp;
-//                    std::deque<TChar> newLine;
+//                    std::vector<TChar> newLine;
 
 //                    int k = lineRest.size();
 //                    if( k > 0 )
@@ -1179,7 +1184,7 @@ void TBuffer::translateToPlainText(std::string& incoming, const bool isFromServe
     speedTP = 0;
     int numCodes = 0;
     speedSequencer = 0;
-    mUntriggered = lineBuffer.size() - 1;
+    mUntriggered = static_cast<int>(buffer.size()) - 1;
     size_t localBufferLength = localBuffer.length();
     size_t localBufferPosition = 0;
     if (!localBufferLength) {
@@ -2174,56 +2179,44 @@ void TBuffer::translateToPlainText(std::string& incoming, const bool isFromServe
     COMMIT_LINE:
         if ((ch == '\n') || (ch == '\xff') || (ch == '\r')) {
             // MUD Zeilen werden immer am Zeilenanfang geschrieben
-            if (lineBuffer.back().size() > 0) {
-                if (mMudLine.size() > 0) {
-                    lineBuffer << mMudLine;
-                } else {
-                    if (ch == '\r') {
-                        ++localBufferPosition;
-                        continue; //empty timer posting
-                    }
-                    lineBuffer << QString();
-                }
-                buffer.push_back(mMudBuffer);
-                dirty << true;
-                timeBuffer << (QTime::currentTime()).toString("hh:mm:ss.zzz") + "   ";
-                if (ch == '\xff') {
-                    promptBuffer.append(true);
-                } else {
-                    promptBuffer.append(false);
+            if (buffer.back().text.size() > 0) {
+                if (mMudLine.size() == 0 && ch == '\r') {
+                    ++localBufferPosition;
+                    continue; //empty timer posting
                 }
+                TBufferLine newLine;
+                setCurrentTimeStamp(newLine);
+                newLine.format = mMudBuffer;
+                newLine.text = mMudLine;
+                newLine.isPrompt = (ch == '\xff');
+                buffer.push_back(std::move(newLine));
             } else {
                 if (mMudLine.size() > 0) {
-                    lineBuffer.back().append(mMudLine);
+                    buffer.back().text.append(mMudLine);
                 } else {
                     if (ch == '\r') {
                         ++localBufferPosition;
                         continue; //empty timer posting
                     }
-                    lineBuffer.back().append(QString());
+                    buffer.back().text.append(QString());
                 }
-                buffer.back() = mMudBuffer;
-                dirty.back() = true;
-                timeBuffer.back() = QTime::currentTime().toString("hh:mm:ss.zzz") + "   ";
+                buffer.back().format = mMudBuffer;
+                buffer.back().isDirty = true;
+                setCurrentTimeStamp(buffer.back());
                 if (ch == '\xff') {
-                    promptBuffer.back() = true;
+                    buffer.back().isPrompt = true;
                 } else {
-                    promptBuffer.back() = false;
+                    buffer.back().isPrompt = false;
                 }
             }
 
             mMudLine.clear();
             mMudBuffer.clear();
-            int line = lineBuffer.size() - 1;
+            int line = static_cast<int>(buffer.size()) - 1;
             mpHost->mpConsole->runTriggers(line);
-            wrap(lineBuffer.size() - 1);
+            wrap(line);
             ++localBufferPosition;
-            std::deque<TChar> newLine;
-            buffer.push_back(newLine);
-            lineBuffer.push_back(QString());
-            timeBuffer.push_back("   ");
-            promptBuffer << false;
-            dirty << true;
+            buffer.push_back(TBufferLine());
             if (static_cast<int>(buffer.size()) > mLinesLimit) {
                 shrinkBuffer();
             }
@@ -2531,20 +2524,18 @@ void TBuffer::append(const QString& text,
     }
     int last = buffer.size() - 1;
     if (last < 0) {
-        std::deque<TChar> newLine;
+        std::vector<TChar> newLine;
         TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout);
         if (mEchoText) {
             c.flags |= TCHAR_ECHO;
         }
         newLine.push_back(c);
-        buffer.push_back(newLine);
-        lineBuffer.push_back(QString());
-        timeBuffer << QTime::currentTime().toString(QStringLiteral("hh:mm:ss.zzz   "));
-        promptBuffer << false;
-        dirty << true;
+        buffer.push_back(TBufferLine());
+        setCurrentTimeStamp(buffer.back());
+        buffer.back().format.swap(newLine);
         last = 0;
     }
-    bool firstChar = (lineBuffer.back().size() == 0);
+    bool firstChar = (buffer.back().text.size() == 0);
     int length = text.size();
     if (length < 1) {
         return;
@@ -2556,12 +2547,7 @@ void TBuffer::append(const QString& text,
     for (int i = sub_start; i < length; i++) { //FIXME <=substart+sub_end muss nachsehen, ob wirklich noch teilbereiche gebraucht werden
         if (text.at(i) == '\n') {
             log(size() - 1, size() - 1);
-            std::deque<TChar> newLine;
-            buffer.push_back(newLine);
-            lineBuffer.push_back(QString());
-            timeBuffer << QStringLiteral("-------------");
-            promptBuffer << false;
-            dirty << true;
+            buffer.push_back(TBufferLine(cTimeStampContinued, cTimeStampContinued));
             mLastLine++;
             newLines++;
             firstChar = true;
@@ -2571,32 +2557,18 @@ void TBuffer::append(const QString& text,
         // FIXME: (I18n) Need to measure painted line width and compare that
         // to "unit" character width (whatever we work THAT out to be)
         // multiplied by mWrap:
-        if (lineBuffer.back().size() >= mWrapAt) {
-            for (int i = lineBuffer.back().size() - 1; i >= 0; i--) {
-                if (lineBreaks.indexOf(lineBuffer.back().at(i)) > -1) {
-                    QString tmp = lineBuffer.back().mid(0, i + 1);
-                    QString lineRest = lineBuffer.back().mid(i + 1);
-                    lineBuffer.back() = tmp;
-                    std::deque<TChar> newLine;
-
-                    int k = lineRest.size();
-                    if (k > 0) {
-                        while (k > 0) {
-                            newLine.push_front(buffer.back().back());
-                            buffer.back().pop_back();
-                            k--;
-                        }
-                    }
-
-                    buffer.push_back(newLine);
-                    if (lineRest.size() > 0) {
-                        lineBuffer.append(lineRest);
-                    } else {
-                        lineBuffer.append(QString());
-                    }
-                    timeBuffer << QStringLiteral("-------------");
-                    promptBuffer << false;
-                    dirty << true;
+        if (buffer.back().text.size() >= mWrapAt) {
+            for (int i = buffer.back().text.size() - 1; i >= 0; i--) {
+                if (lineBreaks.indexOf(buffer.back().text.at(i)) > -1) {
+                    TBufferLine newLine(cTimeStampContinued, cTimeStampContinued);
+                    newLine.text = buffer.back().text.mid(i + 1);
+                    buffer.back().text.truncate(i + 1);
+                    // Move the formatting for the rest of the line across in one go:
+                    const int k = newLine.text.size();
+                    newLine.format.assign(buffer.back().format.end() - k, buffer.back().format.end());
+                    buffer.back().format.resize(buffer.back().format.size() - k);
+
+                    buffer.push_back(std::move(newLine));
                     mLastLine++;
                     newLines++;
                     log(size() - 2, size() - 2);
@@ -2607,14 +2579,14 @@ void TBuffer::append(const QString& text,
                 }
             }
         }
-        lineBuffer.back().append(text.at(i));
+        buffer.back().text.append(text.at(i));
         TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout, linkID);
         if (mEchoText) {
             c.flags |= TCHAR_ECHO;
         }
-        buffer.back().push_back(c);
+        buffer.back().format.push_back(c);
         if (firstChar) {
-            timeBuffer.back() = QTime::currentTime().toString(QStringLiteral("hh:mm:ss.zzz   "));
+            setCurrentTimeStamp(buffer.back());
             firstChar = false;
         }
     }
@@ -2643,20 +2615,18 @@ void TBuffer::appendLine(const QString& text,
     }
     int last = buffer.size() - 1;
     if (last < 0) {
-        std::deque<TChar> newLine;
+        std::vector<TChar> newLine;
         TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout);
         if (mEchoText) {
             c.flags |= TCHAR_ECHO;
         }
         newLine.push_back(c);
-        buffer.push_back(newLine);
-        lineBuffer.push_back(QString());
-        timeBuffer << (QTime::currentTime()).toString("hh:mm:ss.zzz") + "   ";
-        promptBuffer << false;
-        dirty << true;
+        buffer.push_back(TBufferLine());
+        setCurrentTimeStamp(buffer.back());
+        buffer.back().format.swap(newLine);
         last = 0;
     }
-    bool firstChar = (lineBuffer.back().size() == 0);
+    bool firstChar = (buffer.back().text.size() == 0);
     int length = text.size();
     if (length < 1) {
         return;
@@ -2666,14 +2636,14 @@ void TBuffer::appendLine(const QString& text,
     }
 
     for (int i = sub_start; i <= (sub_start + sub_end); i++) {
-        lineBuffer.back().append(text.at(i));
+        buffer.back().text.append(text.at(i));
         TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout, linkID);
         if (mEchoText) {
             c.flags |= TCHAR_ECHO;
         }
-        buffer.back().push_back(c);
+        buffer.back().format.push_back(c);
         if (firstChar) {
-            timeBuffer.back() = (QTime::currentTime()).toString("hh:mm:ss.zzz") + "   ";
+            setCurrentTimeStamp(buffer.back());
         }
     }
 }
@@ -2691,31 +2661,24 @@ QPoint TBuffer::insert(QPoint& where, const QString& text, int fgColorR, int fgC
     if (y >= static_cast<int>(buffer.size())) {
         return P;
     }
+    mSearchIndex.linesChanged(y, *this);
 
 
     for (auto character : text) {
         if (character == QChar('\n')) {
-            std::deque<TChar> newLine;
-            TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout);
-            newLine.push_back(c);
-            buffer.push_back(newLine);
-            promptBuffer.insert(y, false);
-            const QString nothing = "";
-            lineBuffer.insert(y, nothing);
-            timeBuffer << "-->"; //this is intentional -> faster
-            dirty.insert(y, true);
+            buffer.insert(buffer.begin() + y, TBufferLine());
             mLastLine++;
             newLines++;
             x = 0;
             y++;
             continue;
         }
-        lineBuffer[y].insert(x, character);
+        buffer[y].text.insert(x, character);
         TChar c(fgColorR, fgColorG, fgColorB, bgColorR, bgColorG, bgColorB, bold, italics, underline, strikeout);
-        auto it = buffer[y].begin();
-        buffer[y].insert(it + x, c);
+        auto it = buffer[y].format.begin();
+        buffer[y].format.insert(it + x, c);
     }
-    dirty[y] = true;
+    buffer[y].isDirty = true;
     P.setX(x);
     P.setY(y);
     return P;
@@ -2733,26 +2696,23 @@ bool TBuffer::insertInLine(QPoint& P, const QString& text, TChar& format)
         if (x < 0) {
             return false;
         }
-        if (x >= static_cast<int>(buffer[y].size())) {
+        mSearchIndex.linesChanged(y, *this);
+        if (x >= static_cast<int>(buffer[y].format.size())) {
             TChar c;
-            expandLine(y, x - buffer[y].size(), c);
-        }
-        for (int i = 0; i < text.size(); i++) {
-            lineBuffer[y].insert(x + i, text.at(i));
-            TChar c = format;
-            auto it = buffer[y].begin();
-            buffer[y].insert(it + x + i, c);
+            expandLine(y, x - buffer[y].format.size(), c);
         }
+        buffer[y].text.insert(x, text);
+        buffer[y].format.insert(buffer[y].format.begin() + x, text.size(), TChar(format));
     } else {
         appendLine(text,
                    0,
                    text.size(),
-                   format.fgR,
-                   format.fgG,
-                   format.fgB,
-                   format.bgR,
-                   format.bgG,
-                   format.bgB,
+                   format.fgR(),
+                   format.fgG(),
+                   format.fgB(),
+                   format.bgR(),
+                   format.bgG(),
+                   format.bgB(),
                    format.flags & TCHAR_BOLD,
                    format.flags & TCHAR_ITALICS,
                    format.flags & TCHAR_UNDERLINE,
@@ -2771,24 +2731,24 @@ TBuffer TBuffer::copy(QPoint& P1, QPoint& P2)
         return slice;
     }
 
-    if ((x < 0) || (x >= static_cast<int>(buffer[y].size())) || (P2.x() < 0) || (P2.x() > static_cast<int>(buffer[y].size()))) {
+    if ((x < 0) || (x >= static_cast<int>(buffer[y].format.size())) || (P2.x() < 0) || (P2.x() > static_cast<int>(buffer[y].format.size()))) {
         x = 0;
     }
     for (; x < P2.x(); x++) {
-        QString s(lineBuffer[y][x]);
+        QString s(buffer[y].text[x]);
         slice.append(s,
                      0,
                      1,
-                     buffer[y][x].fgR,
-                     buffer[y][x].fgG,
-                     buffer[y][x].fgB,
-                     buffer[y][x].bgR,
-                     buffer[y][x].bgG,
-                     buffer[y][x].bgB,
-                     (buffer[y][x].flags & TCHAR_BOLD),
-                     (buffer[y][x].flags & TCHAR_ITALICS),
-                     (buffer[y][x].flags & TCHAR_UNDERLINE),
-                     (buffer[y][x].flags & TCHAR_STRIKEOUT));
+                     buffer[y].format[x].fgR(),
+                     buffer[y].format[x].fgG(),
+                     buffer[y].format[x].fgB(),
+                     buffer[y].format[x].bgR(),
+                     buffer[y].format[x].bgG(),
+                     buffer[y].format[x].bgB(),
+                     (buffer[y].format[x].flags & TCHAR_BOLD),
+                     (buffer[y].format[x].flags & TCHAR_ITALICS),
+                     (buffer[y].format[x].flags & TCHAR_UNDERLINE),
+                     (buffer[y].format[x].flags & TCHAR_STRIKEOUT));
     }
     return slice;
 }
@@ -2817,32 +2777,32 @@ void TBuffer::paste(QPoint& P, TBuffer chunk)
     if (y == -1) {
         needAppend = true;
     } else {
-        if (x < 0 || x >= static_cast<int>(buffer[y].size())) {
+        if (x < 0 || x >= static_cast<int>(buffer[y].format.size())) {
             return;
         }
     }
-    for (int cx = 0; cx < static_cast<int>(chunk.buffer[0].size()); cx++) {
+    for (int cx = 0; cx < static_cast<int>(chunk.buffer[0].format.size()); cx++) {
         QPoint P_current(cx, y);
         if ((y < getLastLineNumber()) && (!needAppend)) {
-            TChar& format = chunk.buffer[0][cx];
-            QString s = QString(chunk.lineBuffer[0][cx]);
+            TChar& format = chunk.buffer[0].format[cx];
+            QString s = QString(chunk.buffer[0].text[cx]);
             insertInLine(P_current, s, format);
         } else {
             hasAppended = true;
-            QString s(chunk.lineBuffer[0][cx]);
+            QString s(chunk.buffer[0].text[cx]);
             append(s,
                    0,
                    1,
-                   chunk.buffer[0][cx].fgR,
-                   chunk.buffer[0][cx].fgG,
-                   chunk.buffer[0][cx].fgB,
-                   chunk.buffer[0][cx].bgR,
-                   chunk.buffer[0][cx].bgG,
-                   chunk.buffer[0][cx].bgB,
-                   (chunk.buffer[0][cx].flags & TCHAR_BOLD),
-                   (chunk.buffer[0][cx].flags & TCHAR_ITALICS),
-                   (chunk.buffer[0][cx].flags & TCHAR_UNDERLINE),
-                   (chunk.buffer[0][cx].flags & TCHAR_STRIKEOUT));
+                   chunk.buffer[0].format[cx].fgR(),
+                   chunk.buffer[0].format[cx].fgG(),
+                   chunk.buffer[0].format[cx].fgB(),
+                   chunk.buffer[0].format[cx].bgR(),
+                   chunk.buffer[0].format[cx].bgG(),
+                   chunk.buffer[0].format[cx].bgB(),
+                   (chunk.buffer[0].format[cx].flags & TCHAR_BOLD),
+                   (chunk.buffer[0].format[cx].flags & TCHAR_ITALICS),
+                   (chunk.buffer[0].format[cx].flags & TCHAR_UNDERLINE),
+                   (chunk.buffer[0].format[cx].flags & TCHAR_STRIKEOUT));
         }
     }
     if (hasAppended) {
@@ -2859,21 +2819,21 @@ void TBuffer::appendBuffer(const TBuffer& chunk)
     if (chunk.buffer.size() < 1) {
         return;
     }
-    for (int cx = 0; cx < static_cast<int>(chunk.buffer[0].size()); cx++) {
-        QString s(chunk.lineBuffer[0][cx]);
+    for (int cx = 0; cx < static_cast<int>(chunk.buffer[0].format.size()); cx++) {
+        QString s(chunk.buffer[0].text[cx]);
         append(s,
                0,
                1,
-               chunk.buffer[0][cx].fgR,
-               chunk.buffer[0][cx].fgG,
-               chunk.buffer[0][cx].fgB,
-               chunk.buffer[0][cx].bgR,
-               chunk.buffer[0][cx].bgG,
-               chunk.buffer[0][cx].bgB,
-               (chunk.buffer[0][cx].flags & TCHAR_BOLD),
-               (chunk.buffer[0][cx].flags & TCHAR_ITALICS),
-               (chunk.buffer[0][cx].flags & TCHAR_UNDERLINE),
-               (chunk.buffer[0][cx].flags & TCHAR_STRIKEOUT));
+               chunk.buffer[0].format[cx].fgR(),
+               chunk.buffer[0].format[cx].fgG(),
+               chunk.buffer[0].format[cx].fgB(),
+               chunk.buffer[0].format[cx].bgR(),
+               chunk.buffer[0].format[cx].bgG(),
+               chunk.buffer[0].format[cx].bgB(),
+               (chunk.buffer[0].format[cx].flags & TCHAR_BOLD),
+               (chunk.buffer[0].format[cx].flags & TCHAR_ITALICS),
+               (chunk.buffer[0].format[cx].flags & TCHAR_UNDERLINE),
+               (chunk.buffer[0].format[cx].flags & TCHAR_STRIKEOUT));
     }
     QString lf = "\n";
     append(lf, 0, 1, 0, 0, 0, 0, 0, 0, false, false, false, false);
@@ -2882,15 +2842,15 @@ void TBuffer::appendBuffer(const TBuffer& chunk)
 int TBuffer::calcWrapPos(int line, int begin, int end)
 {
     const QString lineBreaks = ",.- \n";
-    if (lineBuffer.size() < line) {
+    if (static_cast<int>(buffer.size()) < line) {
         return 0;
     }
-    int lineSize = static_cast<int>(lineBuffer[line].size()) - 1;
+    int lineSize = static_cast<int>(buffer[line].text.size()) - 1;
     if (lineSize < end) {
         end = lineSize;
     }
     for (int i = end; i >= begin; i--) {
-        if (lineBreaks.indexOf(lineBuffer[line].at(i)) > -1) {
+        if (lineBreaks.indexOf(buffer[line].text.at(i)) > -1) {
             return i;
         }
     }
@@ -2900,13 +2860,13 @@ int TBuffer::calcWrapPos(int line, int begin, int end)
 inline int TBuffer::skipSpacesAtBeginOfLine(int i, int i2)
 {
     int offset = 0;
-    int i_end = lineBuffer[i].size();
+    int i_end = buffer[i].text.size();
     QChar space = ' ';
     while (i2 < i_end) {
-        if (buffer[i][i2].flags & TCHAR_ECHO) {
+        if (buffer[i].format[i2].flags & TCHAR_ECHO) {
             break;
         }
-        if (lineBuffer[i][i2] == space) {
+        if (buffer[i].text[i2] == space) {
             offset++;
         } else {
             break;
@@ -2921,18 +2881,17 @@ inline int TBuffer::wrap(int startLine)
     if (static_cast<int>(buffer.size()) < startLine || startLine < 0) {
         return 0;
     }
-    std::queue<std::deque<TChar>> queue;
-    QStringList tempList;
-    QStringList timeList;
-    QList<bool> promptList;
+    mSearchIndex.linesChanged(startLine, *this);
+    std::vector<TBufferLine> wrappedLines;
     int lineCount = 0;
     for (int i = startLine; i < static_cast<int>(buffer.size()); i++) {
-        bool isPrompt = promptBuffer[i];
-        std::deque<TChar> newLine;
+        bool isPrompt = buffer[i].isPrompt;
+        std::vector<TChar> newLine;
         QString lineText = "";
-        QString time = timeBuffer[i];
+        qint64 timeStamp = buffer[i].timeStamp;
+        qint64 steadyTimeStamp = buffer[i].steadyTimeStamp;
         int indent = 0;
-        if (static_cast<int>(buffer[i].size()) >= mWrapAt) {
+        if (static_cast<int>(buffer[i].format.size()) >= mWrapAt) {
             for (int i3 = 0; i3 < mWrapIndent; i3++) {
                 TChar pSpace;
                 newLine.push_back(pSpace);
@@ -2942,14 +2901,11 @@ inline int TBuffer::wrap(int startLine)
         }
         int lastSpace = 0;
         int wrapPos = 0;
-        int length = buffer[i].size();
+        int length = buffer[i].format.size();
         if (length == 0) {
-            tempList.append(QString());
-            std::deque<TChar> emptyLine;
-            queue.push(emptyLine);
-            timeList.append(time);
+            wrappedLines.push_back(TBufferLine());
         }
-        for (int i2 = 0; i2 < static_cast<int>(buffer[i].size());) {
+        for (int i2 = 0; i2 < static_cast<int>(buffer[i].format.size());) {
             if (length - i2 > mWrapAt - indent) {
                 wrapPos = calcWrapPos(i, i2, i2 + mWrapAt - indent);
                 lastSpace = qMax(0, wrapPos);
@@ -2963,28 +2919,25 @@ inline int TBuffer::wrap(int startLine)
                         break;
                     }
                 }
-                if (i2 >= static_cast<int>(buffer[i].size())) {
+                if (i2 >= static_cast<int>(buffer[i].format.size())) {
                     break;
                 }
-                if (lineBuffer[i].at(i2) == '\n') {
+                if (buffer[i].text.at(i2) == '\n') {
                     i2++;
                     break;
                 }
-                newLine.push_back(buffer[i][i2]);
-                lineText.append(lineBuffer[i].at(i2));
+                newLine.push_back(buffer[i].format[i2]);
+                lineText.append(buffer[i].text.at(i2));
                 i2++;
             }
             if (newLine.size() == 0) {
-                tempList.append(QString());
-                std::deque<TChar> emptyLine;
-                queue.push(emptyLine);
-                timeList.append(QString());
-                promptList.append(false);
+                wrappedLines.push_back(TBufferLine());
             } else {
-                queue.push(newLine);
-                tempList.append(lineText);
-                timeList.append(time);
-                promptList.append(isPrompt);
+                TBufferLine wrappedLine(timeStamp, steadyTimeStamp);
+                wrappedLine.format.swap(newLine);
+                wrappedLine.text = lineText;
+                wrappedLine.isPrompt = isPrompt;
+                wrappedLines.push_back(std::move(wrappedLine));
             }
             newLine.clear();
             lineText = "";
@@ -2993,35 +2946,16 @@ inline int TBuffer::wrap(int startLine)
         }
         lineCount++;
     }
-    for (int i = 0; i < lineCount; i++) {
-        buffer.pop_back();
-        lineBuffer.pop_back();
-        timeBuffer.pop_back();
-        promptBuffer.pop_back();
-        dirty.pop_back();
-    }
+    buffer.erase(buffer.end() - lineCount, buffer.end());
 
     newLines -= lineCount;
-    newLines += queue.size();
-    int insertedLines = queue.size() - 1;
-    while (!queue.empty()) {
-        buffer.push_back(queue.front());
-        queue.pop();
-    }
-    for (int i = 0; i < tempList.size(); i++) {
-        if (tempList[i].size() < 1) {
-            lineBuffer.append(QString());
-            timeBuffer.append(QString());
-            promptBuffer.push_back(false);
-        } else {
-            lineBuffer.append(tempList[i]);
-            timeBuffer.append(timeList[i]);
-            promptBuffer.push_back(promptList[i]);
-        }
-        dirty.push_back(true);
+    newLines += wrappedLines.size();
+    int insertedLines = wrappedLines.size() - 1;
+    for (auto& wrappedLine : wrappedLines) {
+        buffer.push_back(std::move(wrappedLine));
     }
 
-    log(startLine, startLine + tempList.size());
+    log(startLine, startLine + static_cast<int>(wrappedLines.size()));
     return insertedLines > 0 ? insertedLines : 0;
 }
 
@@ -3029,7 +2963,7 @@ void TBuffer::log(int from, int to)
 {
     TBuffer* pB = &mpHost->mpConsole->buffer;
     if (pB == this) {
-        if (mpHost->mpConsole->mLogToLogFile) {
+        if (mpHost->mpConsole->mLogToLogFile && mpHost->mpConsole->mpLogWriter) {
             if (from >= size() || from < 0) {
                 return;
             }
@@ -3039,22 +2973,19 @@ void TBuffer::log(int from, int to)
             if (to < 0) {
                 return;
             }
+            // Only copies of the lines are handed over, the writer thread
+            // does everything else:
             for (int i = from; i <= to; i++) {
-                QString toLog;
+                TLogLine line;
+                if (mpHost->mIsLoggingTimestamps) {
+                    line.timeStamp = buffer[i].timeStamp;
+                }
+                line.text = buffer[i].text;
                 if (mpHost->mIsCurrentLogFileInHtmlFormat) {
-                    QPoint P1 = QPoint(0, i);
-                    QPoint P2 = QPoint(buffer[i].size(), i);
-                    toLog = bufferToHtml(P1, P2, mpHost->mIsLoggingTimestamps);
-                } else {
-                    if (mpHost->mIsLoggingTimestamps && !timeBuffer[i].isEmpty()) {
-                        toLog = timeBuffer[i].left(13);
-                    }
-                    toLog.append(lineBuffer[i]);
-                    toLog.append("\n");
+                    line.format = buffer[i].format;
                 }
-                mpHost->mpConsole->mLogStream << toLog;
+                mpHost->mpConsole->mpLogWriter->addLine(std::move(line));
             }
-            mpHost->mpConsole->mLogStream.flush();
         }
     }
 }
@@ -3068,19 +2999,22 @@ int TBuffer::wrapLine(int startLine, int screenWidth, int indentSize, TChar& for
     if (static_cast<int>(buffer.size()) <= startLine) {
         return 0;
     }
-    std::queue<std::deque<TChar>> queue;
-    QStringList tempList;
+    mSearchIndex.linesChanged(startLine, *this);
+    const qint64 timeStamp = buffer[startLine].timeStamp;
+    const qint64 steadyTimeStamp = buffer[startLine].steadyTimeStamp;
+    const bool isPrompt = buffer[startLine].isPrompt;
+    std::vector<TBufferLine> wrappedLines;
     int lineCount = 0;
 
     for (int i = startLine; i < static_cast<int>(buffer.size()); i++) {
         if (i > startLine) {
             break; //only wrap one line of text
         }
-        std::deque<TChar> newLine;
+        std::vector<TChar> newLine;
         QString lineText;
 
         int indent = 0;
-        if (static_cast<int>(buffer[i].size()) >= screenWidth) {
+        if (static_cast<int>(buffer[i].format.size()) >= screenWidth) {
             for (int i3 = 0; i3 < indentSize; i3++) {
                 TChar pSpace = format;
                 newLine.push_back(pSpace);
@@ -3090,9 +3024,9 @@ int TBuffer::wrapLine(int startLine, int screenWidth, int indentSize, TChar& for
         }
         int lastSpace = -1;
         int wrapPos = -1;
-        int length = static_cast<int>(buffer[i].size());
+        int length = static_cast<int>(buffer[i].format.size());
 
-        for (int i2 = 0; i2 < static_cast<int>(buffer[i].size());) {
+        for (int i2 = 0; i2 < static_cast<int>(buffer[i].format.size());) {
             if (length - i2 > screenWidth - indent) {
                 wrapPos = calcWrapPos(i, i2, i2 + screenWidth - indent);
                 lastSpace = qMax(-1, wrapPos);
@@ -3106,30 +3040,23 @@ int TBuffer::wrapLine(int startLine, int screenWidth, int indentSize, TChar& for
                         break;
                     }
                 }
-                if (i2 >= static_cast<int>(buffer[i].size())) {
+                if (i2 >= static_cast<int>(buffer[i].format.size())) {
                     break;
                 }
-                if (lineBuffer[i][i2] == QChar('\n')) {
+                if (buffer[i].text[i2] == QChar('\n')) {
                     i2++;
-
-                    if (newLine.size() == 0) {
-                        tempList.append(QString());
-                        std::deque<TChar> emptyLine;
-                        queue.push(emptyLine);
-                    } else {
-                        queue.push(newLine);
-                        tempList.append(lineText);
-                    }
                     goto OPT_OUT_CLEAN;
                 }
-                newLine.push_back(buffer[i][i2]);
-                lineText.append(lineBuffer[i].at(i2));
+                newLine.push_back(buffer[i].format[i2]);
+                lineText.append(buffer[i].text.at(i2));
                 i2++;
             }
-            queue.push(newLine);
-            tempList.append(lineText);
 
         OPT_OUT_CLEAN:
+            wrappedLines.push_back(TBufferLine(timeStamp, steadyTimeStamp));
+            wrappedLines.back().format.swap(newLine);
+            wrappedLines.back().text = lineText;
+            wrappedLines.back().isPrompt = isPrompt;
             newLine.clear();
             lineText.clear();
             indent = 0;
@@ -3142,29 +3069,10 @@ int TBuffer::wrapLine(int startLine, int screenWidth, int indentSize, TChar& for
         return 0;
     }
 
+    int insertedLines = static_cast<int>(wrappedLines.size()) - 1;
     buffer.erase(buffer.begin() + startLine);
-    lineBuffer.removeAt(startLine);
-    QString time = timeBuffer.at(startLine);
-    timeBuffer.removeAt(startLine);
-    bool isPrompt = promptBuffer.at(startLine);
-    promptBuffer.removeAt(startLine);
-    dirty.removeAt(startLine);
-
-    int insertedLines = queue.size() - 1;
-    int i = 0;
-    while (!queue.empty()) {
-        buffer.insert(buffer.begin() + startLine + i, queue.front());
-        queue.pop();
-        i++;
-    }
-
-    for (int i = 0; i < tempList.size(); i++) {
-        lineBuffer.insert(startLine + i, tempList[i]);
-        timeBuffer.insert(startLine + i, time);
-        promptBuffer.insert(startLine + i, isPrompt);
-        dirty.insert(startLine + i, true);
-    }
-    log(startLine, startLine + tempList.size() - 1);
+    buffer.insert(buffer.begin() + startLine, std::make_move_iterator(wrappedLines.begin()), std::make_move_iterator(wrappedLines.end()));
+    log(startLine, startLine + static_cast<int>(wrappedLines.size()) - 1);
     return insertedLines > 0 ? insertedLines : 0;
 }
 
@@ -3180,9 +3088,9 @@ bool TBuffer::moveCursor(QPoint& where)
         return false;
     }
 
-    if (static_cast<int>(buffer[y].size()) - 1 > x) {
+    if (static_cast<int>(buffer[y].format.size()) - 1 > x) {
         TChar c;
-        expandLine(y, x - buffer[y].size() - 1, c);
+        expandLine(y, x - buffer[y].format.size() - 1, c);
     }
     return true;
 }
@@ -3192,16 +3100,16 @@ QString badLineError = QString("ERROR: invalid line number");
 
 QString& TBuffer::line(int n)
 {
-    if ((n >= lineBuffer.size()) || (n < 0)) {
+    if ((n >= static_cast<int>(buffer.size())) || (n < 0)) {
         return badLineError;
     }
-    return lineBuffer[n];
+    return buffer[n].text;
 }
 
 
 int TBuffer::find(int line, const QString& what, int pos = 0)
 {
-    if (lineBuffer[line].size() >= pos) {
+    if (buffer[line].text.size() >= pos) {
         return -1;
     }
     if (pos < 0) {
@@ -3210,7 +3118,7 @@ int TBuffer::find(int line, const QString& what, int pos = 0)
     if ((line >= static_cast<int>(buffer.size())) || (line < 0)) {
         return -1;
     }
-    return lineBuffer[line].indexOf(what, pos);
+    return buffer[line].text.indexOf(what, pos);
 }
 
 
@@ -3219,7 +3127,7 @@ QStringList TBuffer::split(int line, const QString& splitter)
     if ((line >= static_cast<int>(buffer.size())) || (line < 0)) {
         return QStringList();
     }
-    return lineBuffer[line].split(splitter);
+    return buffer[line].text.split(splitter);
 }
 
 
@@ -3228,16 +3136,17 @@ QStringList TBuffer::split(int line, QRegExp splitter)
     if ((line >= static_cast<int>(buffer.size())) || (line < 0)) {
         return QStringList();
     }
-    return lineBuffer[line].split(splitter);
+    return buffer[line].text.split(splitter);
 }
 
 
 void TBuffer::expandLine(int y, int count, TChar& pC)
 {
-    int size = buffer[y].size() - 1;
+    mSearchIndex.linesChanged(y, *this);
+    int size = buffer[y].format.size() - 1;
     for (int i = size; i < size + count; i++) {
-        buffer[y].push_back(pC);
-        lineBuffer[y].append(" ");
+        buffer[y].format.push_back(pC);
+        buffer[y].text.append(" ");
     }
 }
 
@@ -3250,7 +3159,7 @@ bool TBuffer::replaceInLine(QPoint& P_begin, QPoint& P_end, const QString& with,
     if ((y1 >= static_cast<int>(buffer.size())) || (y2 >= static_cast<int>(buffer.size()))) {
         return false;
     }
-    if ((x2 > static_cast<int>(buffer[y2].size())) || (x1 > static_cast<int>(buffer[y1].size()))) {
+    if ((x2 > static_cast<int>(buffer[y2].format.size())) || (x1 > static_cast<int>(buffer[y1].format.size()))) {
         return false;
     }
     if (x1 < 0 || x2 < 0) {
@@ -3269,20 +3178,21 @@ bool TBuffer::replaceInLine(QPoint& P_begin, QPoint& P_end, const QString& with,
         xb = x2;
         xe = x1;
     }
+    mSearchIndex.linesChanged(yb, *this);
 
     for (int y = yb; y <= ye; y++) {
         int x = 0;
         if (y == yb) {
             x = xb;
         }
-        int x_end = buffer[y].size() - 1;
+        int x_end = buffer[y].format.size() - 1;
         if (y == ye) {
             x_end = xe;
         }
-        lineBuffer[y].remove(x, x_end - x);
-        auto it1 = buffer[y].begin() + x;
-        auto it2 = buffer[y].begin() + x_end;
-        buffer[y].erase(it1, it2);
+        buffer[y].text.remove(x, x_end - x);
+        auto it1 = buffer[y].format.begin() + x;
+        auto it2 = buffer[y].format.begin() + x_end;
+        buffer[y].format.erase(it1, it2);
     }
 
     // insert replacement
@@ -3296,11 +3206,12 @@ bool TBuffer::replace(int line, const QString& what, const QString& with)
     if ((line >= static_cast<int>(buffer.size())) || (line < 0)) {
         return false;
     }
-    lineBuffer[line].replace(what, with);
+    mSearchIndex.linesChanged(line, *this);
+    buffer[line].text.replace(what, with);
 
     // fix size of the corresponding format buffer
 
-    int delta = lineBuffer[line].size() - static_cast<int>(buffer[line].size());
+    int delta = buffer[line].text.size() - static_cast<int>(buffer[line].format.size());
 
     if (delta > 0) {
         for (int i = 0; i < delta; i++) {
@@ -3309,11 +3220,11 @@ bool TBuffer::replace(int line, const QString& what, const QString& with)
             // this is a very often used function and this standard
             // behaviour is acceptable. If the user wants special colors
             // he can apply format changes
-            buffer[line].push_back(c);
+            buffer[line].format.push_back(c);
         }
     } else if (delta < 0) {
         for (int i = 0; i < delta; i++) {
-            buffer[line].pop_back();
+            buffer[line].format.pop_back();
         }
     }
     return true;
@@ -3321,17 +3232,12 @@ bool TBuffer::replace(int line, const QString& what, const QString& with)
 
 void TBuffer::clear()
 {
-    while (buffer.size() > 0) {
-        if (!deleteLines(0, 0)) {
-            break;
-        }
-    }
-    std::deque<TChar> newLine;
-    buffer.push_back(newLine);
-    lineBuffer << QString();
-    timeBuffer << QString();
-    promptBuffer.push_back(false);
-    dirty.push_back(true);
+    mSearchIndex.clear();
+    buffer.clear();
+    // Start counting again, as scripts expect a cleared window to begin at
+    // line 0:
+    mLineOffset = 0;
+    buffer.push_back(TBufferLine());
 }
 
 bool TBuffer::deleteLine(int y)
@@ -3339,30 +3245,23 @@ bool TBuffer::deleteLine(int y)
     return deleteLines(y, y);
 }
 
+// Dropping lines from the front of a std::deque only destroys them, nothing
+// else has to move:
 void TBuffer::shrinkBuffer()
 {
-    for (int i = 0; i < mBatchDeleteSize; i++) {
-        lineBuffer.pop_front();
-        promptBuffer.pop_front();
-        timeBuffer.pop_front();
-        dirty.pop_front();
-        buffer.pop_front();
-        mCursorY--;
-    }
+    const int count = qMin(mBatchDeleteSize, static_cast<int>(buffer.size()));
+    mSearchIndex.removeFirstLines(count, *this);
+    buffer.erase(buffer.begin(), buffer.begin() + count);
+    mLineOffset += count;
+    mCursorY -= count;
 }
 
 bool TBuffer::deleteLines(int from, int to)
 {
     if ((from >= 0) && (from < static_cast<int>(buffer.size())) && (from <= to) && (to >= 0) && (to < static_cast<int>(buffer.size()))) {
-        int delta = to - from + 1;
-
-        for (int i = from; i < from + delta; i++) {
-            lineBuffer.removeAt(i);
-            timeBuffer.removeAt(i);
-            promptBuffer.removeAt(i);
-            dirty.removeAt(i);
-        }
-
+        mSearchIndex.linesChanged(from, *this);
+        // Only moves whichever of the lines before or after the deleted ones
+        // are fewer, so removing a line near the end (gagging) is cheap:
         buffer.erase(buffer.begin() + from, buffer.begin() + to + 1);
         return true;
     } else {
@@ -3378,7 +3277,7 @@ bool TBuffer::applyFormat(QPoint& P_begin, QPoint& P_end, TChar& format)
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3388,14 +3287,14 @@ bool TBuffer::applyFormat(QPoint& P_begin, QPoint& P_end, TChar& format)
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
                     }
                 }
 
-                buffer[y][x] = format;
+                buffer[y].format[x] = format;
                 x++;
             }
         }
@@ -3413,7 +3312,7 @@ bool TBuffer::applyLink(QPoint& P_begin, QPoint& P_end, const QString& linkText,
     int y2 = P_end.y();
     bool incLinkID = false;
     int linkID = 0;
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3423,7 +3322,7 @@ bool TBuffer::applyLink(QPoint& P_begin, QPoint& P_end, const QString& linkText,
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
@@ -3439,7 +3338,7 @@ bool TBuffer::applyLink(QPoint& P_begin, QPoint& P_end, const QString& linkText,
                     mLinkStore[mLinkID] = linkFunction;
                     mHintStore[mLinkID] = linkHint;
                 }
-                buffer[y][x].link = linkID;
+                buffer[y].format[x].link = linkID;
                 x++;
             }
         }
@@ -3456,7 +3355,7 @@ bool TBuffer::applyBold(QPoint& P_begin, QPoint& P_end, bool bold)
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3466,16 +3365,16 @@ bool TBuffer::applyBold(QPoint& P_begin, QPoint& P_end, bool bold)
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
                     }
                 }
                 if (bold) {
-                    buffer[y][x].flags |= TCHAR_BOLD;
+                    buffer[y].format[x].flags |= TCHAR_BOLD;
                 } else {
-                    buffer[y][x].flags &= ~(TCHAR_BOLD);
+                    buffer[y].format[x].flags &= ~(TCHAR_BOLD);
                 }
                 x++;
             }
@@ -3493,7 +3392,7 @@ bool TBuffer::applyItalics(QPoint& P_begin, QPoint& P_end, bool bold)
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3503,16 +3402,16 @@ bool TBuffer::applyItalics(QPoint& P_begin, QPoint& P_end, bool bold)
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
                     }
                 }
                 if (bold) {
-                    buffer[y][x].flags |= TCHAR_ITALICS;
+                    buffer[y].format[x].flags |= TCHAR_ITALICS;
                 } else {
-                    buffer[y][x].flags &= ~(TCHAR_ITALICS);
+                    buffer[y].format[x].flags &= ~(TCHAR_ITALICS);
                 }
                 x++;
             }
@@ -3530,7 +3429,7 @@ bool TBuffer::applyUnderline(QPoint& P_begin, QPoint& P_end, bool bold)
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3540,7 +3439,7 @@ bool TBuffer::applyUnderline(QPoint& P_begin, QPoint& P_end, bool bold)
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
@@ -3548,9 +3447,9 @@ bool TBuffer::applyUnderline(QPoint& P_begin, QPoint& P_end, bool bold)
                 }
 
                 if (bold) {
-                    buffer[y][x].flags |= TCHAR_UNDERLINE;
+                    buffer[y].format[x].flags |= TCHAR_UNDERLINE;
                 } else {
-                    buffer[y][x].flags &= ~(TCHAR_UNDERLINE);
+                    buffer[y].format[x].flags &= ~(TCHAR_UNDERLINE);
                 }
                 x++;
             }
@@ -3568,7 +3467,7 @@ bool TBuffer::applyStrikeOut(QPoint& P_begin, QPoint& P_end, bool strikeout)
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3578,7 +3477,7 @@ bool TBuffer::applyStrikeOut(QPoint& P_begin, QPoint& P_end, bool strikeout)
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
@@ -3586,9 +3485,9 @@ bool TBuffer::applyStrikeOut(QPoint& P_begin, QPoint& P_end, bool strikeout)
                 }
 
                 if (strikeout) {
-                    buffer[y][x].flags |= TCHAR_STRIKEOUT;
+                    buffer[y].format[x].flags |= TCHAR_STRIKEOUT;
                 } else {
-                    buffer[y][x].flags &= ~(TCHAR_STRIKEOUT);
+                    buffer[y].format[x].flags &= ~(TCHAR_STRIKEOUT);
                 }
                 x++;
             }
@@ -3606,7 +3505,7 @@ bool TBuffer::applyFgColor(QPoint& P_begin, QPoint& P_end, int fgColorR, int fgC
     int y1 = P_begin.y();
     int y2 = P_end.y();
 
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
 
@@ -3616,16 +3515,14 @@ bool TBuffer::applyFgColor(QPoint& P_begin, QPoint& P_end, int fgColorR, int fgC
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
                     }
                 }
 
-                buffer[y][x].fgR = fgColorR;
-                buffer[y][x].fgG = fgColorG;
-                buffer[y][x].fgB = fgColorB;
+                buffer[y].format[x].setForeground(fgColorR, fgColorG, fgColorB);
                 x++;
             }
         }
@@ -3641,7 +3538,7 @@ bool TBuffer::applyBgColor(QPoint& P_begin, QPoint& P_end, int bgColorR, int bgC
     int x2 = P_end.x();
     int y1 = P_begin.y();
     int y2 = P_end.y();
-    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].size())))
+    if ((x1 >= 0) && ((y2 < static_cast<int>(buffer.size())) && (y2 >= 0)) && ((x2 > x1) || (y2 > y1)) && (x1 < static_cast<int>(buffer[y1].format.size())))
     // even if the end selection is out of bounds we still apply the format until the end of the line to simplify and ultimately speed up user scripting (no need to calc end of line)
     // && ( x2 < static_cast<int>(buffer[y2].size()) ) )
     {
@@ -3650,16 +3547,14 @@ bool TBuffer::applyBgColor(QPoint& P_begin, QPoint& P_end, int bgColorR, int bgC
             if (y == y1) {
                 x = x1;
             }
-            while (x < static_cast<int>(buffer[y].size())) {
+            while (x < static_cast<int>(buffer[y].format.size())) {
                 if (y >= y2) {
                     if (x >= x2) {
                         return true;
                     }
                 }
 
-                (buffer[y][x]).bgR = bgColorR;
-                (buffer[y][x]).bgG = bgColorG;
-                (buffer[y][x]).bgB = bgColorB;
+                (buffer[y].format[x]).setBackground(bgColorR, bgColorG, bgColorB);
                 x++;
             }
         }
@@ -3683,17 +3578,24 @@ QString TBuffer::bufferToHtml(QPoint P1, QPoint P2, bool allowedTimestamps, int
 {
     int y = P1.y();
     int x = P1.x();
-    QString s;
     if (y < 0 || y >= static_cast<int>(buffer.size())) {
-        return s;
+        return QString();
     }
 
-    if ((x < 0) || (x >= static_cast<int>(buffer[y].size())) || (P2.x() >= static_cast<int>(buffer[y].size()))) {
+    if ((x < 0) || (x >= static_cast<int>(buffer[y].format.size())) || (P2.x() >= static_cast<int>(buffer[y].format.size()))) {
         x = 0;
     }
     if (P2.x() < 0) {
-        P2.setX(buffer[y].size());
+        P2.setX(buffer[y].format.size());
     }
+    return lineToHtml(buffer[y].text, buffer[y].format, allowedTimestamps ? timeStampToString(buffer[y].timeStamp) : QString(), x, P2.x(), spacePadding);
+}
+
+// Does the work for bufferToHtml() on a line that may have been copied out of
+// the buffer, so that the log writer can do it in its own thread:
+QString TBuffer::lineToHtml(const QString& text, const std::vector<TChar>& format, const QString& timestamp, int x, const int to, const int spacePadding)
+{
+    QString s;
 
     bool bold = false;
     bool italics = false;
@@ -3713,12 +3615,12 @@ QString TBuffer::bufferToHtml(QPoint P1, QPoint P2, bool allowedTimestamps, int
     QString fontStyle;
     QString textDecoration;
     bool firstSpan = true;
-    if (allowedTimestamps && !timeBuffer[y].isEmpty()) {
+    if (!timestamp.isEmpty()) {
         firstSpan = false;
         // formatting according to TTextEdit.cpp: if( i2 < timeOffset )
         s.append(R"(<span style="color: rgb(200,150,0); background: rgb(22,22,22); )");
         s.append(R"(font-weight: normal; font-style: normal; text-decoration: normal">)");
-        s.append(timeBuffer[y].left(13));
+        s.append(timestamp.left(13));
     }
     if (spacePadding > 0) {
         // used for "copy HTML", first line of selection
@@ -3731,35 +3633,35 @@ QString TBuffer::bufferToHtml(QPoint P1, QPoint P2, bool allowedTimestamps, int
         s.append(QString(spacePadding, QLatin1Char(' ')));
         // Pad out with spaces to the right so a partial first line lines up
     }
-    for (; x < P2.x(); x++) {
-        if (x >= static_cast<int>(buffer[y].size())) {
+    for (; x < to; x++) {
+        if (x >= static_cast<int>(format.size())) {
             break;
         }
-        if (firstSpan || buffer[y][x].fgR != fgR || buffer[y][x].fgG != fgG || buffer[y][x].fgB != fgB || buffer[y][x].bgR != bgR || buffer[y][x].bgG != bgG || buffer[y][x].bgB != bgB
-            || bool(buffer[y][x].flags & TCHAR_BOLD) != bold
-            || bool(buffer[y][x].flags & TCHAR_UNDERLINE) != underline
-            || bool(buffer[y][x].flags & TCHAR_ITALICS) != italics
-            || bool(buffer[y][x].flags & TCHAR_STRIKEOUT) != strikeout
-            //            || bool( buffer[y][x].flags & TCHAR_OVERLINE ) != overline
-            //            || bool( buffer[y][x].flags & TCHAR_INVERSE ) != inverse
+        if (firstSpan || format[x].fgR() != fgR || format[x].fgG() != fgG || format[x].fgB() != fgB || format[x].bgR() != bgR || format[x].bgG() != bgG || format[x].bgB() != bgB
+            || bool(format[x].flags & TCHAR_BOLD) != bold
+            || bool(format[x].flags & TCHAR_UNDERLINE) != underline
+            || bool(format[x].flags & TCHAR_ITALICS) != italics
+            || bool(format[x].flags & TCHAR_STRIKEOUT) != strikeout
+            //            || bool( format[x].flags & TCHAR_OVERLINE ) != overline
+            //            || bool( format[x].flags & TCHAR_INVERSE ) != inverse
             ) { // Can leave this on a separate line until line above uncommented.
             if (firstSpan) {
                 firstSpan = false; // The first span won't need to close the previous one
             } else {
                 s += "</span>";
             }
-            fgR = buffer[y][x].fgR;
-            fgG = buffer[y][x].fgG;
-            fgB = buffer[y][x].fgB;
-            bgR = buffer[y][x].bgR;
-            bgG = buffer[y][x].bgG;
-            bgB = buffer[y][x].bgB;
-            bold = buffer[y][x].flags & TCHAR_BOLD;
-            italics = buffer[y][x].flags & TCHAR_ITALICS;
-            underline = buffer[y][x].flags & TCHAR_UNDERLINE;
-            strikeout = buffer[y][x].flags & TCHAR_STRIKEOUT;
-            //            overline = buffer[y][x].flags & TCHAR_OVERLINE;
-            //            inverse = buffer[y][x].flags & TCHAR_INVERSE;
+            fgR = format[x].fgR();
+            fgG = format[x].fgG();
+            fgB = format[x].fgB();
+            bgR = format[x].bgR();
+            bgG = format[x].bgG();
+            bgB = format[x].bgB();
+            bold = format[x].flags & TCHAR_BOLD;
+            italics = format[x].flags & TCHAR_ITALICS;
+            underline = format[x].flags & TCHAR_UNDERLINE;
+            strikeout = format[x].flags & TCHAR_STRIKEOUT;
+            //            overline = format[x].flags & TCHAR_OVERLINE;
+            //            inverse = format[x].flags & TCHAR_INVERSE;
             if (bold) {
                 fontWeight = "bold";
             } else {
@@ -3802,12 +3704,12 @@ QString TBuffer::bufferToHtml(QPoint P1, QPoint P2, bool allowedTimestamps, int
             //            }
             s += " font-weight: " + fontWeight + "; font-style: " + fontStyle + "; text-decoration: " + textDecoration + R"(">)";
         }
-        if (lineBuffer[y][x] == '<') {
+        if (text[x] == '<') {
             s.append("&lt;");
-        } else if (lineBuffer[y][x] == '>') {
+        } else if (text[x] == '>') {
             s.append("&gt;");
         } else {
-            s.append(lineBuffer[y][x]);
+            s.append(text[x]);
         }
     }
     if (s.size() > 0) {
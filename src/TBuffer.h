@@ -23,6 +23,8 @@
  ***************************************************************************/
 
 
+#include "TBufferSearchIndex.h"
+
 #include "pre_guard.h"
 #include <QApplication>
 #include <QChar>
@@ -38,6 +40,7 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #define TCHAR_ITALICS 1
 #define TCHAR_BOLD 2
@@ -64,6 +67,10 @@
 class Host;
 
 
+// The formatting of one character in the buffer. There is one of these for
+// every character in the scrollback so it is kept small (12 bytes): the colors
+// are held as packed 32-bit RGB values and the flags in a byte, the link
+// indexes being recycled well before they could overflow 16 bits.
 class TChar
 {
 public:
@@ -71,22 +78,55 @@ public:
     TChar(int, int, int, int, int, int, bool, bool, bool, bool, int _link = 0);
     TChar(Host*);
     TChar(const TChar& copy);
-    bool operator==(const TChar& c);
+    bool operator==(const TChar& c) const { return mFgColor == c.mFgColor && mBgColor == c.mBgColor && flags == c.flags && link == c.link; }
+
+    int fgR() const { return qRed(mFgColor); }
+    int fgG() const { return qGreen(mFgColor); }
+    int fgB() const { return qBlue(mFgColor); }
+    int bgR() const { return qRed(mBgColor); }
+    int bgG() const { return qGreen(mBgColor); }
+    int bgB() const { return qBlue(mBgColor); }
+    QRgb foreground() const { return mFgColor; }
+    QRgb background() const { return mBgColor; }
+    void setForeground(int r, int g, int b) { mFgColor = qRgb(r, g, b); }
+    void setBackground(int r, int g, int b) { mBgColor = qRgb(r, g, b); }
+    void setForeground(const QColor& color) { mFgColor = color.rgb(); }
+    void setBackground(const QColor& color) { mBgColor = color.rgb(); }
 
+    quint8 flags;
+    quint16 link;
 
-    int fgR;
-    int fgG;
-    int fgB;
-    int bgR;
-    int bgG;
-    int bgB;
-    unsigned flags;
-    int link;
+private:
+    QRgb mFgColor;
+    QRgb mBgColor;
 };
 
 const QChar cLF = QChar('\n');
 const QChar cSPACE = QChar(' ');
 
+// Stand-ins for a line's time stamp, for lines that do not have one of their
+// own - the second is for the rest of a line that append(...) had to split:
+const qint64 cTimeStampNone = -1;
+const qint64 cTimeStampContinued = -2;
+
+// One line of a TBuffer - the text and the format for each character of it,
+// along with what is only needed once per line - kept together so that adding,
+// dropping or deleting a line is one operation on one container:
+struct TBufferLine
+{
+    TBufferLine() : timeStamp(cTimeStampNone), steadyTimeStamp(cTimeStampNone), isPrompt(false), isDirty(true) {}
+    TBufferLine(qint64 stamp, qint64 steadyStamp) : timeStamp(stamp), steadyTimeStamp(steadyStamp), isPrompt(false), isDirty(true) {}
+
+    std::vector<TChar> format;
+    QString text;
+    // From TBuffer::currentTimeStamp(), only made into text when it is shown:
+    qint64 timeStamp;
+    // From TBuffer::currentSteadyTimeStamp(), for scripts to time things by:
+    qint64 steadyTimeStamp;
+    bool isPrompt;
+    bool isDirty;
+};
+
 struct TMxpElement
 {
     QString name;
@@ -114,6 +154,11 @@ public:
     int skipSpacesAtBeginOfLine(int i, int i2);
     void addLink(bool, const QString& text, QStringList& command, QStringList& hint, TChar format);
     QString bufferToHtml(QPoint P1, QPoint P2, bool allowedTimestamps, int spacePadding = 0);
+    static QString lineToHtml(const QString& text, const std::vector<TChar>& format, const QString& timestamp, int from, int to, int spacePadding = 0);
+    static qint64 currentTimeStamp();
+    static qint64 currentSteadyTimeStamp();
+    static void setCurrentTimeStamp(TBufferLine& line);
+    static QString timeStampToString(qint64 timeStamp);
     int size() { return static_cast<int>(buffer.size()); }
     QString& line(int n);
     int find(int line, const QString& what, int pos);
@@ -154,12 +199,18 @@ public:
     static const QString& getComputerEncoding(const QString& encoding);
 
 
-    std::deque<TChar> bufferLine;
-    std::deque<std::deque<TChar>> buffer;
-    QStringList timeBuffer;
-    QStringList lineBuffer;
-    QList<bool> promptBuffer;
-    QList<bool> dirty;
+    // Each line's format is held contiguously, a std::deque costs at least a
+    // 512 byte block per line however short it is; the lines themselves are in
+    // a std::deque so that old ones can be dropped from the top without moving
+    // the rest:
+    std::vector<TChar> bufferLine;
+    std::deque<TBufferLine> buffer;
+    // The number of lines that have been dropped from the top of the buffer,
+    // line numbers given to (and taken from) scripts include this so that they
+    // still refer to the same line after older ones have gone:
+    int mLineOffset;
+    // Only enabled for the main console:
+    TBufferSearchIndex mSearchIndex;
     QMap<int, QStringList> mLinkStore;
     QMap<int, QStringList> mHintStore;
     int mLinkID;
@@ -309,7 +360,7 @@ private:
     int mBgColorG;
     int mBgColorB;
     QString mMudLine;
-    std::deque<TChar> mMudBuffer;
+    std::vector<TChar> mMudBuffer;
     int mCode[1024]; //FIXME: potential overflow bug
     // Used to hold the incomplete bytes (1-3) that could be left at the end of
     // a packet:
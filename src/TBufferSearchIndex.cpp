@@ -0,0 +1,319 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TBufferSearchIndex.h"
+
+
+#include "TBuffer.h"
+
+#include "pre_guard.h"
+#include <QDebug>
+#include <QRegularExpression>
+#include "post_guard.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+TBufferSearchIndex::TBufferSearchIndex()
+: mIsEnabled(false)
+, mIndexedLines(0)
+, mFirstChangedLine(-1)
+{
+}
+
+void TBufferSearchIndex::setEnabled(const bool enabled)
+{
+    mIsEnabled = enabled;
+    if (!enabled) {
+        clear();
+    }
+}
+
+void TBufferSearchIndex::clear()
+{
+    mLinesByTrigram.clear();
+    mIndexedLines = 0;
+    // As the buffer's line offset may be about to start again:
+    mFirstChangedLine = 0;
+}
+
+qint64 TBufferSearchIndex::takeFirstChangedLine()
+{
+    const qint64 firstChangedLine = mFirstChangedLine;
+    mFirstChangedLine = -1;
+    return firstChangedLine;
+}
+
+// Should never happen, but rather than reading past the end of the buffer if
+// it has been changed without the index being told, start again:
+bool TBufferSearchIndex::isInStep(const TBuffer& buffer)
+{
+    if (mIndexedLines > static_cast<int>(buffer.buffer.size())) {
+        qWarning() << "TBufferSearchIndex::isInStep(...) WARNING - the buffer has fewer lines than have been indexed, rebuilding the index!";
+        clear();
+        return false;
+    }
+    return true;
+}
+
+quint64 TBufferSearchIndex::trigramAt(const QString& text, int position)
+{
+    return (static_cast<quint64>(text.at(position).unicode()) << 32) | (static_cast<quint64>(text.at(position + 1).unicode()) << 16) | text.at(position + 2).unicode();
+}
+
+void TBufferSearchIndex::appendVarint(QByteArray& data, quint32 value)
+{
+    while (value >= 0x80) {
+        data.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(static_cast<char>(value));
+}
+
+quint32 TBufferSearchIndex::readVarint(const QByteArray& data, int& position)
+{
+    quint32 value = 0;
+    int shift = 0;
+    quint8 byte;
+    do {
+        byte = static_cast<quint8>(data.at(position++));
+        value |= static_cast<quint32>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+void TBufferSearchIndex::decode(const Postings& postings, std::vector<quint32>& lines)
+{
+    lines.clear();
+    lines.reserve(postings.count);
+    int position = postings.start;
+    // The first entry's difference is from one that has gone:
+    readVarint(postings.data, position);
+    quint32 serial = postings.first;
+    lines.push_back(serial);
+    while (position < postings.data.size()) {
+        serial += readVarint(postings.data, position);
+        lines.push_back(serial);
+    }
+}
+
+void TBufferSearchIndex::addLine(const QString& text, const quint32 serial)
+{
+    const QString foldedText = text.toCaseFolded();
+    for (int i = 0, total = foldedText.size() - 2; i < total; ++i) {
+        Postings& postings = mLinesByTrigram[trigramAt(foldedText, i)];
+        if (!postings.count) {
+            postings.data.clear();
+            postings.start = 0;
+            postings.first = serial;
+            appendVarint(postings.data, 0);
+        } else if (postings.last == serial) {
+            continue; // Already got this run of three earlier in the line
+        } else {
+            appendVarint(postings.data, serial - postings.last);
+        }
+        postings.last = serial;
+        ++postings.count;
+    }
+}
+
+// Lines are only taken out from the end that they are at, so each run of
+// three in them is the last (or first) entry in its list - unless it has
+// already been taken out for an earlier appearance in the same line:
+void TBufferSearchIndex::removeLastLine(const QString& text, const quint32 serial)
+{
+    const QString foldedText = text.toCaseFolded();
+    for (int i = 0, total = foldedText.size() - 2; i < total; ++i) {
+        auto itPostings = mLinesByTrigram.find(trigramAt(foldedText, i));
+        if (itPostings == mLinesByTrigram.end() || itPostings.value().last != serial) {
+            continue;
+        }
+        Postings& postings = itPostings.value();
+        if (postings.count == 1) {
+            mLinesByTrigram.erase(itPostings);
+            continue;
+        }
+        // Step back over the bytes with the "more to come" bit set that come
+        // before the final byte of the last number:
+        int position = postings.data.size() - 1;
+        while (position > postings.start && (static_cast<quint8>(postings.data.at(position - 1)) & 0x80)) {
+            --position;
+        }
+        const int end = position;
+        postings.last -= readVarint(postings.data, position);
+        postings.data.truncate(end);
+        --postings.count;
+    }
+}
+
+void TBufferSearchIndex::removeFirstLine(const QString& text, const quint32 serial)
+{
+    const QString foldedText = text.toCaseFolded();
+    for (int i = 0, total = foldedText.size() - 2; i < total; ++i) {
+        auto itPostings = mLinesByTrigram.find(trigramAt(foldedText, i));
+        if (itPostings == mLinesByTrigram.end() || itPostings.value().first != serial) {
+            continue;
+        }
+        Postings& postings = itPostings.value();
+        if (postings.count == 1) {
+            mLinesByTrigram.erase(itPostings);
+            continue;
+        }
+        readVarint(postings.data, postings.start);
+        int position = postings.start;
+        postings.first += readVarint(postings.data, position);
+        --postings.count;
+        // Only move the rest down once there is enough space to be had:
+        if (postings.start > 64 && postings.start > postings.data.size() / 2) {
+            postings.data.remove(0, postings.start);
+            postings.start = 0;
+        }
+    }
+}
+
+void TBufferSearchIndex::update(const TBuffer& buffer)
+{
+    if (!mIsEnabled) {
+        return;
+    }
+
+    isInStep(buffer);
+    for (int total = static_cast<int>(buffer.buffer.size()) - 1; mIndexedLines < total; ++mIndexedLines) {
+        addLine(buffer.buffer[mIndexedLines].text, static_cast<quint32>(buffer.mLineOffset + mIndexedLines));
+    }
+}
+
+void TBufferSearchIndex::linesChanged(int from, const TBuffer& buffer)
+{
+    from = qMax(0, from);
+    // Kept track of even when there is no index, as searches use it:
+    const qint64 serial = buffer.mLineOffset + from;
+    if (mFirstChangedLine < 0 || serial < mFirstChangedLine) {
+        mFirstChangedLine = serial;
+    }
+    if (!mIsEnabled) {
+        return;
+    }
+
+    if (!isInStep(buffer)) {
+        return;
+    }
+    while (mIndexedLines > from) {
+        --mIndexedLines;
+        removeLastLine(buffer.buffer[mIndexedLines].text, static_cast<quint32>(buffer.mLineOffset + mIndexedLines));
+    }
+}
+
+void TBufferSearchIndex::removeFirstLines(const int count, const TBuffer& buffer)
+{
+    if (!mIsEnabled) {
+        return;
+    }
+
+    isInStep(buffer);
+    const int indexedCount = qMin(count, mIndexedLines);
+    for (int i = 0; i < indexedCount; ++i) {
+        removeFirstLine(buffer.buffer[i].text, static_cast<quint32>(buffer.mLineOffset + i));
+    }
+    mIndexedLines -= indexedCount;
+}
+
+void TBufferSearchIndex::findInLine(const QString& text, const qint64 line, const QString& what, const Qt::CaseSensitivity cs, QVector<TBufferSearchHit>& hits)
+{
+    for (int position = text.indexOf(what, 0, cs); position >= 0; position = text.indexOf(what, position + what.size(), cs)) {
+        hits.append(TBufferSearchHit(line, position, what.size()));
+    }
+}
+
+// Returns every match in the buffer from the given line on, in order:
+QVector<TBufferSearchHit> TBufferSearchIndex::findAll(const TBuffer& buffer, const QString& what, const bool isRegex, const bool isCaseSensitive, const int fromLine)
+{
+    const std::deque<TBufferLine>& lines = buffer.buffer;
+    const qint64 firstLine = buffer.mLineOffset;
+    QVector<TBufferSearchHit> hits;
+    if (what.isEmpty()) {
+        return hits;
+    }
+
+    if (isRegex) {
+        QRegularExpression regex(what, isCaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        if (!regex.isValid()) {
+            return hits;
+        }
+        regex.optimize();
+        for (int i = qMax(0, fromLine), total = static_cast<int>(lines.size()); i < total; ++i) {
+            QRegularExpressionMatchIterator itMatch = regex.globalMatch(lines[i].text);
+            while (itMatch.hasNext()) {
+                QRegularExpressionMatch match = itMatch.next();
+                if (match.capturedLength() > 0) {
+                    hits.append(TBufferSearchHit(firstLine + i, match.capturedStart(), match.capturedLength()));
+                }
+            }
+        }
+        return hits;
+    }
+
+    const Qt::CaseSensitivity cs = isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const QString foldedWhat = what.toCaseFolded();
+    update(buffer);
+    int unindexedFrom = mIndexedLines;
+    if (!mIsEnabled || foldedWhat.size() < 3 || fromLine >= mIndexedLines) {
+        unindexedFrom = qMax(0, fromLine);
+    } else {
+        // Start with the least used run of three and then only keep the lines
+        // that have all the others as well:
+        QVector<const Postings*> postingsList;
+        for (int i = 0, total = foldedWhat.size() - 2; i < total; ++i) {
+            auto itPostings = mLinesByTrigram.constFind(trigramAt(foldedWhat, i));
+            if (itPostings == mLinesByTrigram.constEnd()) {
+                postingsList.clear();
+                break;
+            }
+            postingsList.append(&itPostings.value());
+        }
+        if (!postingsList.isEmpty()) {
+            std::sort(postingsList.begin(), postingsList.end(), [](const Postings* a, const Postings* b) { return a->count < b->count; });
+            std::vector<quint32> candidates;
+            std::vector<quint32> others;
+            std::vector<quint32> remaining;
+            decode(*postingsList.first(), candidates);
+            for (int i = 1, total = postingsList.size(); i < total && !candidates.empty(); ++i) {
+                decode(*postingsList.at(i), others);
+                remaining.clear();
+                std::set_intersection(candidates.begin(), candidates.end(), others.begin(), others.end(), std::back_inserter(remaining));
+                candidates.swap(remaining);
+            }
+            // The runs of three being present does not mean that they are in
+            // the right order, so each line has to be checked:
+            for (quint32 serial : candidates) {
+                const qint64 line = static_cast<qint64>(serial) - firstLine;
+                if (line >= fromLine && line < mIndexedLines) {
+                    findInLine(lines[static_cast<size_t>(line)].text, firstLine + line, what, cs, hits);
+                }
+            }
+        }
+    }
+
+    for (int i = unindexedFrom, total = static_cast<int>(lines.size()); i < total; ++i) {
+        findInLine(lines[i].text, firstLine + i, what, cs, hits);
+    }
+    return hits;
+}
@@ -0,0 +1,118 @@
+#ifndef MUDLET_TBUFFERSEARCHINDEX_H
+#define MUDLET_TBUFFERSEARCHINDEX_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "post_guard.h"
+
+#include <vector>
+
+class TBuffer;
+
+
+// Where a search of the buffer found something; the line includes the buffer's
+// line offset, so that it still refers to the same line after older ones have
+// been dropped from the top of the buffer:
+struct TBufferSearchHit
+{
+    TBufferSearchHit() : line(0), position(0), length(0) {}
+    TBufferSearchHit(qint64 l, int p, int len) : line(l), position(p), length(len) {}
+
+    bool operator<(const TBufferSearchHit& other) const { return line < other.line || (line == other.line && position < other.position); }
+    bool operator==(const TBufferSearchHit& other) const { return line == other.line && position == other.position && length == other.length; }
+
+    qint64 line;
+    int position;
+    int length;
+};
+
+
+// An inverted index of the text in a TBuffer, for the console's search box:
+// each line is indexed by every run of three (case folded) characters in it,
+// so a search only has to look at the lines that have all of the runs of
+// three that are in what is being looked for. The lines are indexed as they
+// are completed - the last line is always left out as it is still being added
+// to - and the buffer tells the index before it changes, moves or drops a line
+// so that what was indexed for it can be taken out again while the text is
+// still the same. Regular expressions and searches for fewer than three
+// characters can not use the index and go through every line.
+class TBufferSearchIndex
+{
+public:
+    TBufferSearchIndex();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mIsEnabled; }
+
+    void clear();
+    void update(const TBuffer& buffer);
+    // To be called BEFORE the change, and for the first line affected:
+    void linesChanged(int from, const TBuffer& buffer);
+    // To be called BEFORE the lines are dropped and the offset is moved on:
+    void removeFirstLines(int count, const TBuffer& buffer);
+
+    QVector<TBufferSearchHit> findAll(const TBuffer& buffer, const QString& what, bool isRegex, bool isCaseSensitive, int fromLine = 0);
+    // The first line (including the buffer's line offset, as for hits) that
+    // has been changed or moved since the last time this was called, or -1
+    // if none has, so that hits kept from before can be checked; lines that
+    // are dropped from the top do not count:
+    qint64 takeFirstChangedLine();
+
+private:
+    // The lines that have a run of three, held as the difference from the
+    // entry before as variable length (LEB128) numbers so that the list for a
+    // common run of three takes little more than a byte per line. Lines are
+    // only ever added at the end and removed from either end:
+    struct Postings
+    {
+        Postings() : start(0), count(0), first(0), last(0) {}
+
+        QByteArray data;
+        int start;
+        int count;
+        quint32 first;
+        quint32 last;
+    };
+
+    static quint64 trigramAt(const QString& text, int position);
+    static void appendVarint(QByteArray& data, quint32 value);
+    static quint32 readVarint(const QByteArray& data, int& position);
+    static void decode(const Postings& postings, std::vector<quint32>& lines);
+    static void findInLine(const QString& text, qint64 line, const QString& what, Qt::CaseSensitivity cs, QVector<TBufferSearchHit>& hits);
+
+    bool isInStep(const TBuffer& buffer);
+    void addLine(const QString& text, quint32 serial);
+    void removeLastLine(const QString& text, quint32 serial);
+    void removeFirstLine(const QString& text, quint32 serial);
+
+    bool mIsEnabled;
+    // Lines [0, mIndexedLines) of the buffer are in the index:
+    int mIndexedLines;
+    qint64 mFirstChangedLine;
+    // key = three case folded characters:
+    QHash<quint64, Postings> mLinesByTrigram;
+};
+
+#endif // MUDLET_TBUFFERSEARCHINDEX_H
@@ -29,7 +29,9 @@
 #include "TDebug.h"
 #include "TEvent.h"
 #include "TLabel.h"
+#include "TLogWriter.h"
 #include "TMap.h"
+#include "TReplayBenchmark.h"
 #include "TRoomDB.h"
 #include "TSplitter.h"
 #include "TTextEdit.h"
@@ -41,13 +43,17 @@
 #include <QDateTime>
 #include <QDir>
 #include <QLineEdit>
+#include <QMenu>
 #include <QMessageBox>
 #include <QScrollBar>
 #include <QShortcut>
+#include <QThread>
 #include <QToolButton>
 #include <QVBoxLayout>
 #include "post_guard.h"
 
+#include <algorithm>
+
 #include <assert.h>
 
 
@@ -72,6 +78,8 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
 , mIsDebugConsole(isDebugConsole)
 , mLogFileName(QString(""))
 , mLogToLogFile(false)
+, mpLogThread(nullptr)
+, mpLogWriter(nullptr)
 , mMainFrameBottomHeight(0)
 , mMainFrameLeftWidth(0)
 , mMainFrameRightWidth(0)
@@ -98,10 +106,16 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
 , networkLatency(new QLineEdit)
 , mUserAgreedToCloseConsole(false)
 , mpBufferSearchBox(new QLineEdit)
+, mpBufferSearchOptions(new QToolButton)
 , mpBufferSearchUp(new QToolButton)
 , mpBufferSearchDown(new QToolButton)
-, mCurrentSearchResult(0)
+, mpActionSearchCaseSensitive(nullptr)
+, mpActionSearchRegex(nullptr)
+, mCurrentSearchHit(-1, 0, 0)
 , mSearchQuery("")
+, mSearchIsRegex(false)
+, mSearchIsCaseSensitive(false)
+, mSearchedToLine(-1)
 {
     auto ps = new QShortcut(this);
     ps->setKey(Qt::CTRL + Qt::Key_W);
@@ -113,12 +127,8 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
         // which has it's own title and icon set.
         mWrapAt = 50;
         mIsSubConsole = false;
-        mStandardFormat.bgR = mBgColor.red();
-        mStandardFormat.bgG = mBgColor.green();
-        mStandardFormat.bgB = mBgColor.blue();
-        mStandardFormat.fgR = mFgColor.red();
-        mStandardFormat.fgG = mFgColor.green();
-        mStandardFormat.fgB = mFgColor.blue();
+        mStandardFormat.setBackground(mBgColor);
+        mStandardFormat.setForeground(mFgColor);
         mStandardFormat.flags &= ~(TCHAR_BOLD);
         mStandardFormat.flags &= ~(TCHAR_ITALICS);
         mStandardFormat.flags &= ~(TCHAR_UNDERLINE);
@@ -134,6 +144,7 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
             mMainFrameRightWidth = 0;
         } else {
             mIsSubConsole = false;
+            buffer.mSearchIndex.setEnabled(true);
             mMainFrameTopHeight = mpHost->mBorderTopHeight;
             mMainFrameBottomHeight = mpHost->mBorderBottomHeight;
             mMainFrameLeftWidth = mpHost->mBorderLeftWidth;
@@ -141,12 +152,8 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
             mCommandBgColor = mpHost->mCommandBgColor;
             mCommandFgColor = mpHost->mCommandFgColor;
         }
-        mStandardFormat.bgR = mpHost->mBgColor.red();
-        mStandardFormat.bgG = mpHost->mBgColor.green();
-        mStandardFormat.bgB = mpHost->mBgColor.blue();
-        mStandardFormat.fgR = mpHost->mFgColor.red();
-        mStandardFormat.fgG = mpHost->mFgColor.green();
-        mStandardFormat.fgB = mpHost->mFgColor.blue();
+        mStandardFormat.setBackground(mpHost->mBgColor);
+        mStandardFormat.setForeground(mpHost->mFgColor);
         mStandardFormat.flags &= ~(TCHAR_BOLD);
         mStandardFormat.flags &= ~(TCHAR_ITALICS);
         mStandardFormat.flags &= ~(TCHAR_UNDERLINE);
@@ -158,12 +165,8 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
     } else {
         profile_name = "debug console";
     }
-    mFormatSystemMessage.bgR = mBgColor.red();
-    mFormatSystemMessage.bgG = mBgColor.green();
-    mFormatSystemMessage.bgB = mBgColor.blue();
-    mFormatSystemMessage.fgR = 255;
-    mFormatSystemMessage.fgG = 0;
-    mFormatSystemMessage.fgB = 0;
+    mFormatSystemMessage.setBackground(mBgColor);
+    mFormatSystemMessage.setForeground(255, 0, 0);
     setAttribute(Qt::WA_DeleteOnClose);
     setAttribute(Qt::WA_OpaquePaintEvent); //was disabled
     mWaitingForHighColorCode = false;
@@ -457,6 +460,25 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
     mpBufferSearchBox->setPalette(__pal);
     mpBufferSearchBox->setToolTip(tr("<html><head/><body><p>Search buffer.</p></body></html>"));
     connect(mpBufferSearchBox, SIGNAL(returnPressed()), this, SLOT(slot_searchBufferUp()));
+    connect(mpBufferSearchBox, SIGNAL(textChanged(const QString&)), this, SLOT(slot_searchBufferChanged()));
+
+
+    auto searchOptionsMenu = new QMenu(this);
+    mpActionSearchCaseSensitive = searchOptionsMenu->addAction(tr("Case sensitive"));
+    mpActionSearchCaseSensitive->setCheckable(true);
+    mpActionSearchCaseSensitive->setChecked(true);
+    connect(mpActionSearchCaseSensitive, SIGNAL(toggled(bool)), this, SLOT(slot_searchBufferChanged()));
+    mpActionSearchRegex = searchOptionsMenu->addAction(tr("Regular expression"));
+    mpActionSearchRegex->setCheckable(true);
+    connect(mpActionSearchRegex, SIGNAL(toggled(bool)), this, SLOT(slot_searchBufferChanged()));
+    mpBufferSearchOptions->setMinimumSize(QSize(30, 30));
+    mpBufferSearchOptions->setMaximumSize(QSize(30, 30));
+    mpBufferSearchOptions->setSizePolicy(sizePolicy5);
+    mpBufferSearchOptions->setToolTip(tr("<html><head/><body><p>Search options.</p></body></html>"));
+    mpBufferSearchOptions->setFocusPolicy(Qt::NoFocus);
+    mpBufferSearchOptions->setIcon(QIcon(QStringLiteral(":/icons/configure.png")));
+    mpBufferSearchOptions->setMenu(searchOptionsMenu);
+    mpBufferSearchOptions->setPopupMode(QToolButton::InstantPopup);
 
 
     mpBufferSearchUp->setMinimumSize(QSize(30, 30));
@@ -479,13 +501,14 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
     layoutLayer2->addWidget(mpCommandLine);
     layoutLayer2->addWidget(buttonMainLayer);
     layoutButtonLayer->addWidget(mpBufferSearchBox, 0, 0, 0, 4);
-    layoutButtonLayer->addWidget(mpBufferSearchUp, 0, 5);
-    layoutButtonLayer->addWidget(mpBufferSearchDown, 0, 6);
-    layoutButtonLayer->addWidget(timeStampButton, 0, 7);
-    layoutButtonLayer->addWidget(replayButton, 0, 8);
-    layoutButtonLayer->addWidget(logButton, 0, 9);
-    layoutButtonLayer->addWidget(emergencyStop, 0, 10);
-    layoutButtonLayer->addWidget(networkLatency, 0, 11);
+    layoutButtonLayer->addWidget(mpBufferSearchOptions, 0, 5);
+    layoutButtonLayer->addWidget(mpBufferSearchUp, 0, 6);
+    layoutButtonLayer->addWidget(mpBufferSearchDown, 0, 7);
+    layoutButtonLayer->addWidget(timeStampButton, 0, 8);
+    layoutButtonLayer->addWidget(replayButton, 0, 9);
+    layoutButtonLayer->addWidget(logButton, 0, 10);
+    layoutButtonLayer->addWidget(emergencyStop, 0, 11);
+    layoutButtonLayer->addWidget(networkLatency, 0, 12);
     layoutLayer2->setContentsMargins(0, 0, 0, 0);
     layout->addWidget(layer);
     networkLatency->setFrame(false);
@@ -569,6 +592,13 @@ TConsole::TConsole(Host* pH, bool isDebugConsole, QWidget* parent)
     }
 }
 
+TConsole::~TConsole()
+{
+    // Finish off the log file, but leave logging to start again next time if
+    // it was set to:
+    stopLogWriter();
+}
+
 Host* TConsole::getHost()
 {
     return mpHost;
@@ -819,43 +849,21 @@ void TConsole::toggleLogging(bool isMessageEnabled)
         file.close();
 
         QString directoryLogFile = QStringLiteral("%1/.config/mudlet/profiles/%2/log").arg(QDir::homePath(), profile_name);
-        mLogFileName = QStringLiteral("%1/%2").arg(directoryLogFile, QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd#hh-mm-ss")));
-        // Revised file name derived from time so that alphabetical filename and
-        // date sort order are the same...
         QDir dirLogFile;
         if (!dirLogFile.exists(directoryLogFile)) {
             dirLogFile.mkpath(directoryLogFile);
         }
 
         mpHost->mIsCurrentLogFileInHtmlFormat = mpHost->mIsNextLogFileInHtmlFormat;
-        if (mpHost->mIsCurrentLogFileInHtmlFormat) {
-            mLogFileName.append(QStringLiteral(".html"));
-        } else {
-            mLogFileName.append(QStringLiteral(".txt"));
-        }
-        mLogFile.setFileName(mLogFileName);
-        mLogFile.open(QIODevice::WriteOnly);
-        mLogStream.setDevice(&mLogFile);
-        if (isMessageEnabled) {
-            QString message = tr("Logging has started. Log file is %1\n").arg(mLogFile.fileName());
-            printSystemMessage(message);
-            // This puts text onto console that is IMMEDIATELY POSTED into log file so
-            // must be done BEFORE logging starts - or actually mLogToLogFile gets set!
-        }
-        mLogToLogFile = true;
-    } else {
-        file.remove();
-        mLogToLogFile = false;
-        if (isMessageEnabled) {
-            QString message = tr("Logging has been stopped. Log file is %1\n").arg(mLogFile.fileName());
-            printSystemMessage(message);
-            // This puts text onto console that is IMMEDIATELY POSTED into log file so
-            // must be done AFTER logging ends - or actually mLogToLogFile gets reset!
-        }
-    }
-
-    if (mLogToLogFile) {
-        if (mpHost->mIsCurrentLogFileInHtmlFormat) {
+        TLogWriter::Settings settings;
+        settings.directory = directoryLogFile;
+        settings.isHtml = mpHost->mIsCurrentLogFileInHtmlFormat;
+        settings.isCompressed = mpHost->mIsLogCompressed;
+        settings.flushInterval = mpHost->mLogFlushInterval * 1000;
+        settings.flushSize = mpHost->mLogFlushSize * 1024;
+        settings.rotateSize = static_cast<qint64>(mpHost->mLogRotateSize) * 1024 * 1024;
+        settings.rotateInterval = static_cast<qint64>(mpHost->mLogRotateInterval) * 60 * 60 * 1000;
+        if (settings.isHtml) {
             QStringList fontsList;                  // List of fonts to become the font-family entry for
                                                     // the master css in the header
             fontsList << this->fontInfo().family(); // Seems to be the best way to get the
@@ -870,39 +878,88 @@ void TConsole::toggleLogging(bool isMessageEnabled)
             fontsList << QStringLiteral("Courier");
             fontsList.removeDuplicates(); // In case the actual one is one of the defaults here
 
-            mLogStream << "<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.01//EN' 'http://www.w3.org/TR/html4/strict.dtd'>\n";
-            mLogStream << "<html>\n";
-            mLogStream << " <head>\n";
-            mLogStream << "  <meta http-equiv='content-type' content='text/html; charset=utf-8'>";
+            // Written at the start of every file, as a new one is started
+            // whenever the log is rotated:
+            QTextStream header(&settings.header);
+            header << "<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.01//EN' 'http://www.w3.org/TR/html4/strict.dtd'>\n";
+            header << "<html>\n";
+            header << " <head>\n";
+            header << "  <meta http-equiv='content-type' content='text/html; charset=utf-8'>";
             // put the charset as early as possible as the parser MUST restart when it
             // switches away from the ASCII default
-            mLogStream << "  <meta name='generator' content='Mudlet MUD Client version: " << APP_VERSION << APP_BUILD << "'>\n";
+            header << "  <meta name='generator' content='Mudlet MUD Client version: " << APP_VERSION << APP_BUILD << "'>\n";
             // Nice to identify what made the file!
-            mLogStream << "  <title>" << tr("Mudlet, log from %1 profile").arg(profile_name) << "</title>\n";
+            header << "  <title>" << tr("Mudlet, log from %1 profile").arg(profile_name) << "</title>\n";
             // Web-page title
-            mLogStream << "  <style type='text/css'>\n";
-            mLogStream << "   <!-- body { font-family: '" << fontsList.join("', '") << "'; font-size: 100%; line-height: 1.125em; white-space: nowrap; color:rgb(255,255,255); background-color:rgb("
-                       << mpHost->mBgColor.red() << "," << mpHost->mBgColor.green() << "," << mpHost->mBgColor.blue() << ");}\n";
-            mLogStream << "        span { white-space: pre; } -->\n";
-            mLogStream << "  </style>\n";
-            mLogStream << "  </head>\n";
-            mLogStream << "  <body><div>";
+            header << "  <style type='text/css'>\n";
+            header << "   <!-- body { font-family: '" << fontsList.join("', '") << "'; font-size: 100%; line-height: 1.125em; white-space: nowrap; color:rgb(255,255,255); background-color:rgb("
+                   << mpHost->mBgColor.red() << "," << mpHost->mBgColor.green() << "," << mpHost->mBgColor.blue() << ");}\n";
+            header << "        span { white-space: pre; } -->\n";
+            header << "  </style>\n";
+            header << "  </head>\n";
+            header << "  <body><div>";
             // <div></div> tags required around outside of the body <span></spans> for
             // strict HTML 4 as we do not use <p></p>s or anything else
-            mLogFile.flush();
+            header.flush();
+            settings.footer = QStringLiteral("</div></body>\n</html>\n");
+        }
+
+        // The first file is opened here so that its name is known straight
+        // away, everything after that is done in the log writer's thread:
+        mpLogWriter = new TLogWriter(settings);
+        bool isOpen = mpLogWriter->start();
+        mLogFileName = mpLogWriter->fileName();
+        mpLogThread = new QThread(this);
+        mpLogWriter->moveToThread(mpLogThread);
+        connect(mpLogThread, SIGNAL(finished()), mpLogWriter, SLOT(deleteLater()));
+        connect(mpLogWriter, SIGNAL(signal_logFileChanged(const QString&)), this, SLOT(slot_logFileChanged(const QString&)));
+        mpLogThread->start();
+        QMetaObject::invokeMethod(mpLogWriter, "slot_startTimer", Qt::QueuedConnection);
+        if (!isOpen) {
+            printSystemMessage(tr("Unable to open log file %1, nothing will be saved in it!\n").arg(mLogFileName));
+        } else if (isMessageEnabled) {
+            QString message = tr("Logging has started. Log file is %1\n").arg(mLogFileName);
+            printSystemMessage(message);
+            // This puts text onto console that is IMMEDIATELY POSTED into log file so
+            // must be done BEFORE logging starts - or actually mLogToLogFile gets set!
         }
+        mLogToLogFile = true;
         logButton->setToolTip(tr("<html><head/><body><p>Stop logging MUD output to log file.</p></body></html>"));
     } else {
-        if (mpHost->mIsCurrentLogFileInHtmlFormat) {
-            mLogStream << "</div></body>\n";
-            mLogStream << "</html>\n";
+        file.remove();
+        mLogToLogFile = false;
+        stopLogWriter();
+        if (isMessageEnabled) {
+            QString message = tr("Logging has been stopped. Log file is %1\n").arg(mLogFileName);
+            printSystemMessage(message);
+            // This puts text onto console that is IMMEDIATELY POSTED into log file so
+            // must be done AFTER logging ends - or actually mLogToLogFile gets reset!
         }
-        mLogFile.flush();
-        mLogFile.close();
         logButton->setToolTip(tr("<html><head/><body><p>Start logging MUD output to log file.</p></body></html>"));
     }
 }
 
+// Waits for the log writer to write out everything that it has been given and
+// close the file, the writer is deleted when its thread finishes:
+void TConsole::stopLogWriter()
+{
+    if (!mpLogThread) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(mpLogWriter, "slot_stop", Qt::BlockingQueuedConnection);
+    mpLogThread->quit();
+    mpLogThread->wait();
+    delete mpLogThread;
+    mpLogThread = nullptr;
+    mpLogWriter = nullptr;
+}
+
+void TConsole::slot_logFileChanged(const QString& fileName)
+{
+    mLogFileName = fileName;
+}
+
 // Converted into a wrapper around a separate toggleLogging() method so that
 // calls to turn logging on/off via the toolbar button - which go via this
 // wrapper - generate messages on the console.  Requests to control logging from
@@ -1035,12 +1092,8 @@ void TConsole::changeColors()
         mCommandFgColor = mpHost->mCommandFgColor;
         mCommandBgColor = mpHost->mCommandBgColor;
         mpCommandLine->setFont(mpHost->mDisplayFont);
-        mFormatCurrent.bgR = mpHost->mBgColor.red();
-        mFormatCurrent.bgG = mpHost->mBgColor.green();
-        mFormatCurrent.bgB = mpHost->mBgColor.blue();
-        mFormatCurrent.fgR = mpHost->mFgColor.red();
-        mFormatCurrent.fgG = mpHost->mFgColor.green();
-        mFormatCurrent.fgB = mpHost->mFgColor.blue();
+        mFormatCurrent.setBackground(mpHost->mBgColor);
+        mFormatCurrent.setForeground(mpHost->mFgColor);
     }
     QPalette palette;
     palette.setColor(QPalette::Button, QColor(Qt::blue));
@@ -1102,7 +1155,12 @@ void TConsole::printOnDisplay(std::string& incomingSocketData, const bool isFrom
 {
     mProcessingTime.restart();
     mTriggerEngineMode = true;
-    buffer.translateToPlainText(incomingSocketData, isFromServer);
+    {
+        TBenchmarkStage benchmarkStage(mpHost->mpReplayBenchmark, TReplayBenchmark::Text);
+        buffer.translateToPlainText(incomingSocketData, isFromServer);
+    }
+    // Index the lines that have been completed while they are to hand:
+    buffer.mSearchIndex.update(buffer);
     mTriggerEngineMode = false;
 
     double processT = mProcessingTime.elapsed();
@@ -1115,9 +1173,13 @@ void TConsole::printOnDisplay(std::string& incomingSocketData, const bool isFrom
 
 void TConsole::runTriggers(int line)
 {
+    TBenchmarkStage benchmarkStage(mpHost->mpReplayBenchmark, TReplayBenchmark::Triggers);
+    if (mpHost->mpReplayBenchmark) {
+        mpHost->mpReplayBenchmark->countLine();
+    }
     mDeletedLines = 0;
     mUserCursor.setY(line);
-    mIsPromptLine = buffer.promptBuffer.at(line);
+    mIsPromptLine = buffer.buffer[line].isPrompt;
     mEngineCursor = line;
     mUserCursor.setX(0);
     mCurrentLine = buffer.line(line);
@@ -1137,6 +1199,7 @@ void TConsole::runTriggers(int line)
 
 void TConsole::finalize()
 {
+    TBenchmarkStage benchmarkStage(mpHost->mpReplayBenchmark, TReplayBenchmark::Display);
     console->showNewLines();
     console2->showNewLines();
 }
@@ -1180,9 +1243,9 @@ void TConsole::scrollDown(int lines)
 {
     console->scrollDown(lines);
     if (console->isTailMode()) {
-        console2->mCursorY = buffer.lineBuffer.size(); //getLastLineNumber();
+        console2->mCursorY = buffer.size(); //getLastLineNumber();
         console2->hide();
-        console->mCursorY = buffer.lineBuffer.size(); //getLastLineNumber();
+        console->mCursorY = buffer.size(); //getLastLineNumber();
         console->mIsTailMode = true;
         console->updateScreenView();
         console->forceUpdate();
@@ -1235,12 +1298,8 @@ void TConsole::hideEvent(QHideEvent* event)
 void TConsole::reset()
 {
     deselect();
-    mFormatCurrent.bgR = mStandardFormat.bgR;
-    mFormatCurrent.bgG = mStandardFormat.bgG;
-    mFormatCurrent.bgB = mStandardFormat.bgB;
-    mFormatCurrent.fgR = mStandardFormat.fgR;
-    mFormatCurrent.fgG = mStandardFormat.fgG;
-    mFormatCurrent.fgB = mStandardFormat.fgB;
+    mFormatCurrent.setBackground(mStandardFormat.bgR(), mStandardFormat.bgG(), mStandardFormat.bgB());
+    mFormatCurrent.setForeground(mStandardFormat.fgR(), mStandardFormat.fgG(), mStandardFormat.fgB());
     mFormatCurrent.flags &= ~(TCHAR_BOLD);
     mFormatCurrent.flags &= ~(TCHAR_ITALICS);
     mFormatCurrent.flags &= ~(TCHAR_UNDERLINE);
@@ -1289,7 +1348,7 @@ void TConsole::insertLink(const QString& text, QStringList& func, QStringList& h
         }
         return;
     } else {
-        if ((buffer.buffer.size() == 0 && buffer.buffer[0].size() == 0) || mUserCursor == buffer.getEndPos()) {
+        if ((buffer.buffer.size() == 0 && buffer.buffer[0].format.size() == 0) || mUserCursor == buffer.getEndPos()) {
             if (customFormat) {
                 buffer.addLink(mTriggerEngineMode, text, func, hint, mFormatCurrent);
             } else {
@@ -1300,12 +1359,12 @@ void TConsole::insertLink(const QString& text, QStringList& func, QStringList& h
             /*buffer.append( text,
                                        0,
                                        text.size(),
-                                       mFormatCurrent.fgR,
-                                       mFormatCurrent.fgG,
-                                       mFormatCurrent.fgB,
-                                       mFormatCurrent.bgR,
-                                       mFormatCurrent.bgG,
-                                       mFormatCurrent.bgB,
+                                       mFormatCurrent.fgR(),
+                                       mFormatCurrent.fgG(),
+                                       mFormatCurrent.fgB(),
+                                       mFormatCurrent.bgR(),
+                                       mFormatCurrent.bgG(),
+                                       mFormatCurrent.bgB(),
                                        mFormatCurrent.bold,
                                        mFormatCurrent.italics,
                                        mFormatCurrent.underline );*/
@@ -1331,10 +1390,10 @@ void TConsole::insertLink(const QString& text, QStringList& func, QStringList& h
                 if (x_adjust != -1) {
                     x_neu = text.size() - x_adjust - 1 > 0 ? text.size() - x_adjust - 1 : 0;
                 }
-                moveCursor(x_neu, y_neu);
+                setUserCursor(x_neu, y_neu);
             } else {
                 console->needUpdate(mUserCursor.y(), mUserCursor.y() + 1);
-                moveCursor(mUserCursor.x() + text.size(), mUserCursor.y());
+                setUserCursor(mUserCursor.x() + text.size(), mUserCursor.y());
             }
         }
     }
@@ -1367,16 +1426,16 @@ void TConsole::insertText(const QString& text, QPoint P)
         }
         return;
     } else {
-        if ((buffer.buffer.size() == 0 && buffer.buffer[0].size() == 0) || mUserCursor == buffer.getEndPos()) {
+        if ((buffer.buffer.size() == 0 && buffer.buffer[0].format.size() == 0) || mUserCursor == buffer.getEndPos()) {
             buffer.append(text,
                           0,
                           text.size(),
-                          mFormatCurrent.fgR,
-                          mFormatCurrent.fgG,
-                          mFormatCurrent.fgB,
-                          mFormatCurrent.bgR,
-                          mFormatCurrent.bgG,
-                          mFormatCurrent.bgB,
+                          mFormatCurrent.fgR(),
+                          mFormatCurrent.fgG(),
+                          mFormatCurrent.fgB(),
+                          mFormatCurrent.bgR(),
+                          mFormatCurrent.bgG(),
+                          mFormatCurrent.bgB(),
                           mFormatCurrent.flags & TCHAR_BOLD,
                           mFormatCurrent.flags & TCHAR_ITALICS,
                           mFormatCurrent.flags & TCHAR_UNDERLINE,
@@ -1445,6 +1504,9 @@ bool TConsole::saveMap(const QString& location)
     if (!dir_map.exists(directory_map)) {
         dir_map.mkpath(directory_map);
     }
+    // Any rooms still to be read from the file the map was loaded from have
+    // to be read in before that file might be written over:
+    mpHost->mpMap->mpRoomDB->loadAllAreas();
     QFile file_map(filename_map);
     if (file_map.open(QIODevice::WriteOnly)) {
         QDataStream out(&file_map);
@@ -1634,9 +1696,11 @@ void TConsole::insertHTML(const QString& text)
     insertText(text);
 }
 
+// Line numbers given to and taken from scripts include the buffer's line
+// offset, so that they stay the same when old lines are dropped from the top:
 int TConsole::getLineNumber()
 {
-    return mUserCursor.y();
+    return buffer.mLineOffset + mUserCursor.y();
 }
 
 int TConsole::getColumnNumber()
@@ -1646,13 +1710,14 @@ int TConsole::getColumnNumber()
 
 int TConsole::getLineCount()
 {
-    return buffer.getLastLineNumber();
+    return buffer.mLineOffset + buffer.getLastLineNumber();
 }
 
 QStringList TConsole::getLines(int from, int to)
 {
     QStringList ret;
     int delta = abs(from - to);
+    from -= buffer.mLineOffset;
     for (int i = 0; i < delta; i++) {
         ret << buffer.line(from + i);
     }
@@ -1715,10 +1780,10 @@ std::list<int> TConsole::_getFgColor()
         return result;
     }
 
-    if (static_cast<int>(buffer.buffer[y].size()) - 1 >= x) {
-        result.push_back(buffer.buffer[y][x].fgR);
-        result.push_back(buffer.buffer[y][x].fgG);
-        result.push_back(buffer.buffer[y][x].fgB);
+    if (static_cast<int>(buffer.buffer[y].format.size()) - 1 >= x) {
+        result.push_back(buffer.buffer[y].format[x].fgR());
+        result.push_back(buffer.buffer[y].format[x].fgG());
+        result.push_back(buffer.buffer[y].format[x].fgB());
     }
     return result;
 }
@@ -1738,10 +1803,10 @@ std::list<int> TConsole::_getBgColor()
         return result;
     }
 
-    if (static_cast<int>(buffer.buffer[y].size()) - 1 >= x) {
-        result.push_back(buffer.buffer[y][x].bgR);
-        result.push_back(buffer.buffer[y][x].bgG);
-        result.push_back(buffer.buffer[y][x].bgB);
+    if (static_cast<int>(buffer.buffer[y].format.size()) - 1 >= x) {
+        result.push_back(buffer.buffer[y].format[x].bgR());
+        result.push_back(buffer.buffer[y].format[x].bgG());
+        result.push_back(buffer.buffer[y].format[x].bgB());
     }
     return result;
 }
@@ -1805,7 +1870,7 @@ void TConsole::_luaWrapLine(int line)
         return;
     }
     TChar ch(mpHost);
-    buffer.wrapLine(line, mWrapAt, mIndentCount, ch);
+    buffer.wrapLine(line - buffer.mLineOffset, mWrapAt, mIndentCount, ch);
 }
 
 bool TConsole::setMiniConsoleFontSize(std::string& buf, int size)
@@ -1853,7 +1918,7 @@ QString TConsole::getCurrentLine(std::string& buf)
 
 int TConsole::getLastLineNumber()
 {
-    return buffer.getLastLineNumber();
+    return buffer.mLineOffset + buffer.getLastLineNumber();
 }
 
 void TConsole::moveCursorEnd()
@@ -1861,10 +1926,16 @@ void TConsole::moveCursorEnd()
     int y = buffer.getLastLineNumber();
     int x = buffer.line(y).size() - 1;
     x = x >= 0 ? x : 0;
-    moveCursor(x, y);
+    setUserCursor(x, y);
 }
 
 bool TConsole::moveCursor(int x, int y)
+{
+    return setUserCursor(x, y - buffer.mLineOffset);
+}
+
+// As moveCursor(...) but y is the index of the line in the buffer:
+bool TConsole::setUserCursor(int x, int y)
 {
     QPoint P(x, y);
     if (buffer.moveCursor(P)) {
@@ -1941,7 +2012,7 @@ bool TConsole::selectSection(int from, int to)
     if (mUserCursor.y() >= static_cast<int>(buffer.buffer.size())) {
         return false;
     }
-    int s = buffer.buffer[mUserCursor.y()].size();
+    int s = buffer.buffer[mUserCursor.y()].format.size();
     if (from > s || from + to > s) {
         return false;
     }
@@ -2005,17 +2076,13 @@ void TConsole::setStrikeOut(bool b)
 
 void TConsole::setFgColor(int r, int g, int b)
 {
-    mFormatCurrent.fgR = r;
-    mFormatCurrent.fgG = g;
-    mFormatCurrent.fgB = b;
+    mFormatCurrent.setForeground(r, g, b);
     buffer.applyFgColor(P_begin, P_end, r, g, b);
 }
 
 void TConsole::setBgColor(int r, int g, int b)
 {
-    mFormatCurrent.bgR = r;
-    mFormatCurrent.bgG = g;
-    mFormatCurrent.bgB = b;
+    mFormatCurrent.setBackground(r, g, b);
     buffer.applyBgColor(P_begin, P_end, r, g, b);
 }
 
@@ -2025,7 +2092,7 @@ void TConsole::printCommand(QString& msg)
         msg.append("\n");
         int lineBeforeNewContent = buffer.getLastLineNumber();
         if (lineBeforeNewContent >= 0) {
-            if (buffer.lineBuffer[lineBeforeNewContent].right(1) != "\n") {
+            if (buffer.buffer[lineBeforeNewContent].text.right(1) != "\n") {
                 msg.prepend("\n");
             }
         }
@@ -2045,25 +2112,21 @@ void TConsole::printCommand(QString& msg)
     } else {
         int lineBeforeNewContent = buffer.size() - 2;
         if (lineBeforeNewContent >= 0) {
-            int promptEnd = buffer.buffer[lineBeforeNewContent].size();
+            int promptEnd = buffer.buffer[lineBeforeNewContent].format.size();
             if (promptEnd < 0) {
                 promptEnd = 0;
             }
-            if (buffer.promptBuffer[lineBeforeNewContent] == true) {
+            if (buffer.buffer[lineBeforeNewContent].isPrompt == true) {
                 QPoint P(promptEnd, lineBeforeNewContent);
                 TChar format;
-                format.fgR = mCommandFgColor.red();
-                format.fgG = mCommandFgColor.green();
-                format.fgB = mCommandFgColor.blue();
-                format.bgR = mCommandBgColor.red();
-                format.bgG = mCommandBgColor.green();
-                format.bgB = mCommandBgColor.blue();
+                format.setForeground(mCommandFgColor);
+                format.setBackground(mCommandBgColor);
                 buffer.insertInLine(P, msg, format);
                 int down = buffer.wrapLine(lineBeforeNewContent, mpHost->mScreenWidth, mpHost->mWrapIndentCount, mFormatCurrent);
 
                 console->needUpdate(lineBeforeNewContent, lineBeforeNewContent + 1 + down);
                 console2->needUpdate(lineBeforeNewContent, lineBeforeNewContent + 1 + down);
-                buffer.promptBuffer[lineBeforeNewContent] = false;
+                buffer.buffer[lineBeforeNewContent].isPrompt = false;
                 return;
             }
         }
@@ -2093,12 +2156,12 @@ void TConsole::echo(const QString& msg)
         buffer.appendLine(msg,
                           0,
                           msg.size() - 1,
-                          mFormatCurrent.fgR,
-                          mFormatCurrent.fgG,
-                          mFormatCurrent.fgB,
-                          mFormatCurrent.bgR,
-                          mFormatCurrent.bgG,
-                          mFormatCurrent.bgB,
+                          mFormatCurrent.fgR(),
+                          mFormatCurrent.fgG(),
+                          mFormatCurrent.fgB(),
+                          mFormatCurrent.bgR(),
+                          mFormatCurrent.bgG(),
+                          mFormatCurrent.bgB(),
                           mFormatCurrent.flags & TCHAR_BOLD,
                           mFormatCurrent.flags & TCHAR_ITALICS,
                           mFormatCurrent.flags & TCHAR_UNDERLINE,
@@ -2114,12 +2177,12 @@ void TConsole::print(const char* txt)
     buffer.append(msg,
                   0,
                   msg.size(),
-                  mFormatCurrent.fgR,
-                  mFormatCurrent.fgG,
-                  mFormatCurrent.fgB,
-                  mFormatCurrent.bgR,
-                  mFormatCurrent.bgG,
-                  mFormatCurrent.bgB,
+                  mFormatCurrent.fgR(),
+                  mFormatCurrent.fgG(),
+                  mFormatCurrent.fgB(),
+                  mFormatCurrent.bgR(),
+                  mFormatCurrent.bgG(),
+                  mFormatCurrent.bgB(),
                   mFormatCurrent.flags & TCHAR_BOLD,
                   mFormatCurrent.flags & TCHAR_ITALICS,
                   mFormatCurrent.flags & TCHAR_UNDERLINE,
@@ -2387,12 +2450,12 @@ void TConsole::print(const QString& msg)
     buffer.append(msg,
                   0,
                   msg.size(),
-                  mFormatCurrent.fgR,
-                  mFormatCurrent.fgG,
-                  mFormatCurrent.fgB,
-                  mFormatCurrent.bgR,
-                  mFormatCurrent.bgG,
-                  mFormatCurrent.bgB,
+                  mFormatCurrent.fgR(),
+                  mFormatCurrent.fgG(),
+                  mFormatCurrent.fgB(),
+                  mFormatCurrent.bgR(),
+                  mFormatCurrent.bgG(),
+                  mFormatCurrent.bgB(),
                   mFormatCurrent.flags & TCHAR_BOLD,
                   mFormatCurrent.flags & TCHAR_ITALICS,
                   mFormatCurrent.flags & TCHAR_UNDERLINE,
@@ -2538,6 +2601,14 @@ void TConsole::showStatistics()
     msg = r3;
     print(msg, QColor(150, 120, 0), Qt::black);
 
+    TProfiler* pProfiler = mpHost->getProfiler();
+    if (pProfiler->isEnabled() || !pProfiler->records(TProfiler::SortByTotalTime, 1).isEmpty()) {
+        script = "setFgColor(190,150,0); setUnderline(true);echo([[\n\nProfiler Report:\n\n]]);setBold(false);setUnderline(false);setFgColor(150,120,0)";
+        mpHost->mLuaInterpreter.compileAndExecuteScript(script);
+        msg = pProfiler->report();
+        print(msg, QColor(150, 120, 0), Qt::black);
+    }
+
     QString footer = QString("\n+--------------------------------------------------------------+\n");
     mpHost->mpConsole->print(footer, QColor(150, 120, 0), Qt::black);
     script = "resetFormat();";
@@ -2546,36 +2617,89 @@ void TConsole::showStatistics()
     mpHost->mpConsole->raise();
 }
 
-void TConsole::slot_searchBufferUp()
+// Brings the hits up to date with whatever has come in (or been dropped off
+// the top) since the last time - only going through the whole buffer again if
+// what is being looked for, or a line that had already been searched, has
+// changed:
+void TConsole::findSearchHits()
+{
+    const QString query = mpBufferSearchBox->text();
+    const bool isRegex = mpActionSearchRegex->isChecked();
+    const bool isCaseSensitive = mpActionSearchCaseSensitive->isChecked();
+    const qint64 firstChangedLine = buffer.mSearchIndex.takeFirstChangedLine();
+    if (mSearchedToLine >= 0 && query == mSearchQuery && isRegex == mSearchIsRegex && isCaseSensitive == mSearchIsCaseSensitive
+        && (firstChangedLine < 0 || firstChangedLine >= mSearchedToLine)) {
+        // Drop the hits on lines that have gone from the top and on the one
+        // that was still being added to:
+        mSearchHits.erase(mSearchHits.begin(), std::lower_bound(mSearchHits.begin(), mSearchHits.end(), TBufferSearchHit(buffer.mLineOffset, -1, 0)));
+        mSearchHits.erase(std::lower_bound(mSearchHits.begin(), mSearchHits.end(), TBufferSearchHit(mSearchedToLine, -1, 0)), mSearchHits.end());
+        const int fromLine = static_cast<int>(qMax(static_cast<qint64>(0), mSearchedToLine - buffer.mLineOffset));
+        mSearchHits += buffer.mSearchIndex.findAll(buffer, query, isRegex, isCaseSensitive, fromLine);
+    } else {
+        mSearchQuery = query;
+        mSearchIsRegex = isRegex;
+        mSearchIsCaseSensitive = isCaseSensitive;
+        mSearchHits = buffer.mSearchIndex.findAll(buffer, query, isRegex, isCaseSensitive);
+    }
+    // The last line may still be added to, so it is searched again next time:
+    mSearchedToLine = buffer.mLineOffset + qMax(0, buffer.size() - 1);
+    console->forceUpdate();
+    console2->forceUpdate();
+}
+
+void TConsole::showSearchHit(const TBufferSearchHit& hit)
+{
+    mCurrentSearchHit = hit;
+    int line = static_cast<int>(hit.line - buffer.mLineOffset);
+    scrollUp(buffer.mCursorY - line - 3);
+    console->forceUpdate();
+    console2->forceUpdate();
+}
+
+// The search hits on the given line of the buffer, for TTextEdit to draw:
+QVector<TBufferSearchHit> TConsole::getSearchHits(const int line) const
 {
-    QString _txt = mpBufferSearchBox->text();
-    if (_txt != mSearchQuery) {
-        mSearchQuery = _txt;
-        mCurrentSearchResult = buffer.lineBuffer.size();
+    QVector<TBufferSearchHit> hits;
+    if (mSearchHits.isEmpty()) {
+        return hits;
     }
-    if (buffer.lineBuffer.size() < 1) {
-        return;
+
+    const qint64 serial = buffer.mLineOffset + line;
+    for (auto itHit = std::lower_bound(mSearchHits.constBegin(), mSearchHits.constEnd(), TBufferSearchHit(serial, -1, 0)); itHit != mSearchHits.constEnd() && itHit->line == serial; ++itHit) {
+        hits.append(*itHit);
     }
-    bool _found = false;
-    for (int i = mCurrentSearchResult - 1; i >= 0; i--) {
-        int begin = -1;
-        do {
-            begin = buffer.lineBuffer[i].indexOf(mSearchQuery, begin + 1);
-            if (begin > -1) {
-                int length = mSearchQuery.size();
-                moveCursor(0, i);
-                selectSection(begin, length);
-                setBgColor(255, 255, 0);
-                setFgColor(0, 0, 0);
-                deselect();
-                reset();
-                _found = true;
-            }
-        } while (begin > -1);
-        if (_found) {
-            scrollUp(buffer.mCursorY - i - 3);
+    return hits;
+}
+
+// Shows what matches as it is typed - but not for fewer than three characters
+// as that could match most of the buffer:
+void TConsole::slot_searchBufferChanged()
+{
+    mCurrentSearchHit = TBufferSearchHit(-1, 0, 0);
+    if (mpBufferSearchBox->text().size() < 3 && !mpActionSearchRegex->isChecked()) {
+        if (!mSearchHits.isEmpty()) {
+            mSearchHits.clear();
             console->forceUpdate();
-            mCurrentSearchResult = i;
+            console2->forceUpdate();
+        }
+        mSearchQuery = mpBufferSearchBox->text();
+        mSearchedToLine = -1;
+        return;
+    }
+    findSearchHits();
+}
+
+void TConsole::slot_searchBufferUp()
+{
+    findSearchHits();
+    if (!mSearchHits.isEmpty()) {
+        if (mCurrentSearchHit.line < 0) {
+            showSearchHit(mSearchHits.last());
+            return;
+        }
+        auto itHit = std::lower_bound(mSearchHits.constBegin(), mSearchHits.constEnd(), mCurrentSearchHit);
+        if (itHit != mSearchHits.constBegin()) {
+            showSearchHit(*(--itHit));
             return;
         }
     }
@@ -2584,37 +2708,11 @@ void TConsole::slot_searchBufferUp()
 
 void TConsole::slot_searchBufferDown()
 {
-    QString _txt = mpBufferSearchBox->text();
-    if (_txt != mSearchQuery) {
-        mSearchQuery = _txt;
-        mCurrentSearchResult = buffer.lineBuffer.size();
-    }
-    if (buffer.lineBuffer.size() < 1) {
-        return;
-    }
-    if (mCurrentSearchResult >= buffer.lineBuffer.size()) {
-        return;
-    }
-    bool _found = false;
-    for (int i = mCurrentSearchResult + 1; i < buffer.lineBuffer.size(); i++) {
-        int begin = -1;
-        do {
-            begin = buffer.lineBuffer[i].indexOf(mSearchQuery, begin + 1);
-            if (begin > -1) {
-                int length = mSearchQuery.size();
-                moveCursor(0, i);
-                selectSection(begin, length);
-                setBgColor(255, 255, 0);
-                setFgColor(0, 0, 0);
-                deselect();
-                reset();
-                _found = true;
-            }
-        } while (begin > -1);
-        if (_found) {
-            scrollUp(buffer.mCursorY - i - 3);
-            console->forceUpdate();
-            mCurrentSearchResult = i;
+    findSearchHits();
+    if (!mSearchHits.isEmpty() && mCurrentSearchHit.line >= 0) {
+        auto itHit = std::upper_bound(mSearchHits.constBegin(), mSearchHits.constEnd(), mCurrentSearchHit);
+        if (itHit != mSearchHits.constEnd()) {
+            showSearchHit(*itHit);
             return;
         }
     }
@@ -37,9 +37,11 @@
 #include <list>
 #include <map>
 
+class QAction;
 class QCloseEvent;
 class QLineEdit;
 class QScrollBar;
+class QThread;
 class QToolButton;
 
 class dlgMapper;
@@ -47,6 +49,7 @@ class Host;
 class TTextEdit;
 class TCommandLine;
 class TLabel;
+class TLogWriter;
 class TSplitter;
 class dlgNotepad;
 
@@ -59,6 +62,7 @@ class TConsole : public QWidget
 
 public:
     TConsole(Host*, bool isDebugConsole, QWidget* parent = 0);
+    ~TConsole();
     void reset();
     void resetMainConsole();
     void echoUserWindow(const QString&);
@@ -108,6 +112,7 @@ public:
 
     void echo(const QString&);
     bool moveCursor(int x, int y);
+    bool setUserCursor(int x, int y);
     int select(const QString&, int numOfMatch = 1);
     void deselect();
     bool selectSection(int, int);
@@ -167,6 +172,10 @@ public:
     QSize getMainWindowSize() const;
 
     void toggleLogging(bool);
+    void stopLogWriter();
+    void findSearchHits();
+    void showSearchHit(const TBufferSearchHit&);
+    QVector<TBufferSearchHit> getSearchHits(int line) const;
 
     QPointer<Host> mpHost;
 
@@ -200,10 +209,11 @@ public:
     bool mIsHighColorMode;
     bool mIsSubConsole;
     std::map<std::string, TLabel*> mLabelMap;
-    QFile mLogFile;
     QString mLogFileName;
-    QTextStream mLogStream;
     bool mLogToLogFile;
+    // Only while logging, the writer lives in the thread:
+    QThread* mpLogThread;
+    TLogWriter* mpLogWriter;
     int mMainFrameBottomHeight;
     int mMainFrameLeftWidth;
     int mMainFrameRightWidth;
@@ -257,11 +267,22 @@ public:
     QToolButton* logButton;
     bool mUserAgreedToCloseConsole;
     QLineEdit* mpBufferSearchBox;
+    QToolButton* mpBufferSearchOptions;
     QToolButton* mpBufferSearchUp;
     QToolButton* mpBufferSearchDown;
-    int mCurrentSearchResult;
-    QList<int> mSearchResults;
+    QAction* mpActionSearchCaseSensitive;
+    QAction* mpActionSearchRegex;
+    // Drawn over the buffer by TTextEdit rather than changing its colors:
+    QVector<TBufferSearchHit> mSearchHits;
+    // The one that was last moved to, line is -1 if there is not one:
+    TBufferSearchHit mCurrentSearchHit;
+    // What the hits are for:
     QString mSearchQuery;
+    bool mSearchIsRegex;
+    bool mSearchIsCaseSensitive;
+    // The first line (with the buffer's line offset) that the hits are not
+    // complete for, -1 if there are none to keep:
+    qint64 mSearchedToLine;
     bool mSaveLayoutRequested;
 
 signals:
@@ -270,9 +291,11 @@ signals:
 public slots:
     void slot_searchBufferUp();
     void slot_searchBufferDown();
+    void slot_searchBufferChanged();
     void slot_toggleReplayRecording();
     void slot_stop_all_triggers(bool);
     void slot_toggleLogging();
+    void slot_logFileChanged(const QString&);
 
     // Used by mudlet class as told by "Profile Preferences"
     // =>"Copy Map" in another profile to inform a list of
@@ -0,0 +1,217 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TLogWriter.h"
+
+
+#include "pre_guard.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QMetaObject>
+#include <QTimer>
+#include "post_guard.h"
+
+
+TLogWriter::TLogWriter(const Settings& settings)
+: QObject()
+, mSettings(settings)
+, mIsNotified(false)
+, mpFlushTimer(nullptr)
+, mIsUnflushed(false)
+, mIsDeflating(false)
+{
+}
+
+TLogWriter::~TLogWriter()
+{
+    closeFile();
+}
+
+bool TLogWriter::start()
+{
+    return openFile();
+}
+
+void TLogWriter::addLine(TLogLine&& line)
+{
+    mLines.push(std::move(line));
+    if (!mIsNotified.exchange(true)) {
+        QMetaObject::invokeMethod(this, "slot_processLines", Qt::QueuedConnection);
+    }
+}
+
+void TLogWriter::slot_startTimer()
+{
+    if (!mpFlushTimer) {
+        mpFlushTimer = new QTimer(this);
+        connect(mpFlushTimer, SIGNAL(timeout()), this, SLOT(slot_flush()));
+    }
+    mpFlushTimer->start(qMax(mSettings.flushInterval, 1));
+}
+
+void TLogWriter::slot_stop()
+{
+    if (mpFlushTimer) {
+        mpFlushTimer->stop();
+    }
+    slot_processLines();
+    closeFile();
+}
+
+void TLogWriter::slot_processLines()
+{
+    // Clear this first, any line that is added after it will then get another
+    // call to this:
+    mIsNotified.store(false);
+
+    TLogLine line;
+    while (mLines.pop(line)) {
+        const QString timeStamp = TBuffer::timeStampToString(line.timeStamp);
+        if (mSettings.isHtml) {
+            mPending.append(TBuffer::lineToHtml(line.text, line.format, timeStamp, 0, static_cast<int>(line.format.size())).toUtf8());
+        } else {
+            mPending.append(timeStamp.left(13).toUtf8());
+            mPending.append(line.text.toUtf8());
+            mPending.append('\n');
+        }
+
+        if (mPending.size() >= mSettings.flushSize) {
+            write(Z_NO_FLUSH);
+            rotateIfDue();
+        }
+    }
+}
+
+void TLogWriter::slot_flush()
+{
+    // Nothing to flush when idle - and a sync flush would still add an empty
+    // block to a compressed file each time:
+    if (!mPending.isEmpty() || mIsUnflushed) {
+        write(Z_SYNC_FLUSH);
+    }
+    rotateIfDue();
+}
+
+bool TLogWriter::openFile()
+{
+    // Time based names, so that alphabetical and date sort order are the
+    // same, with a count added if a file has to be rotated in the same second
+    // as the last one was started:
+    QString suffix = mSettings.isHtml ? QStringLiteral(".html") : QStringLiteral(".txt");
+    if (mSettings.isCompressed) {
+        suffix.append(QStringLiteral(".gz"));
+    }
+    const QString baseName = QStringLiteral("%1/%2").arg(mSettings.directory, QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd#hh-mm-ss")));
+    QString fileName = baseName + suffix;
+    for (int count = 2; QFile::exists(fileName); ++count) {
+        fileName = QStringLiteral("%1_%2%3").arg(baseName, QString::number(count), suffix);
+    }
+
+    mFile.setFileName(fileName);
+    if (!mFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "TLogWriter::openFile() ERROR - unable to open log file:" << fileName << "reason:" << mFile.errorString();
+        return false;
+    }
+
+    if (mSettings.isCompressed) {
+        mZstream.zalloc = Z_NULL;
+        mZstream.zfree = Z_NULL;
+        mZstream.opaque = Z_NULL;
+        // 15 + 16 asks for a gzip rather than a zlib wrapper:
+        mIsDeflating = (deflateInit2(&mZstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+        if (!mIsDeflating) {
+            qWarning() << "TLogWriter::openFile() ERROR - unable to start compression, log file:" << fileName << "will be empty!";
+            mFile.close();
+            return false;
+        }
+    }
+
+    mFileAge.start();
+    mPending.prepend(mSettings.header.toUtf8());
+    write(Z_SYNC_FLUSH);
+    return true;
+}
+
+void TLogWriter::closeFile()
+{
+    if (!mFile.isOpen()) {
+        return;
+    }
+
+    mPending.append(mSettings.footer.toUtf8());
+    write(Z_FINISH);
+    if (mIsDeflating) {
+        deflateEnd(&mZstream);
+        mIsDeflating = false;
+    }
+    mFile.close();
+}
+
+// Sends everything in mPending to the file - through the compressor if
+// there is one; flushMode is one of zlib's Z_NO_FLUSH, Z_SYNC_FLUSH and
+// Z_FINISH and anything but the first also flushes the file:
+void TLogWriter::write(const int flushMode)
+{
+    if (!mFile.isOpen()) {
+        mPending.clear();
+        return;
+    }
+
+    if (!mIsDeflating) {
+        mFile.write(mPending);
+    } else if (!mPending.isEmpty() || flushMode != Z_NO_FLUSH) {
+        mZstream.next_in = reinterpret_cast<Bytef*>(mPending.data());
+        mZstream.avail_in = static_cast<uInt>(mPending.size());
+        if (mDeflateBuffer.size() < 65536) {
+            mDeflateBuffer.resize(65536);
+        }
+        // Keep going while the output fills the buffer, as there might be
+        // more to come:
+        do {
+            mZstream.next_out = reinterpret_cast<Bytef*>(mDeflateBuffer.data());
+            mZstream.avail_out = static_cast<uInt>(mDeflateBuffer.size());
+            if (deflate(&mZstream, flushMode) == Z_STREAM_ERROR) {
+                qWarning() << "TLogWriter::write() ERROR - compression failed, log file:" << mFile.fileName() << "will be incomplete!";
+                break;
+            }
+            mFile.write(mDeflateBuffer.constData(), mDeflateBuffer.size() - mZstream.avail_out);
+        } while (mZstream.avail_out == 0);
+    }
+    if (flushMode == Z_NO_FLUSH) {
+        mIsUnflushed = mIsUnflushed || !mPending.isEmpty();
+    } else {
+        mFile.flush();
+        mIsUnflushed = false;
+    }
+    mPending.clear();
+}
+
+void TLogWriter::rotateIfDue()
+{
+    if (!mFile.isOpen()) {
+        return;
+    }
+
+    if ((mSettings.rotateSize > 0 && mFile.pos() >= mSettings.rotateSize) || (mSettings.rotateInterval > 0 && mFileAge.elapsed() >= mSettings.rotateInterval)) {
+        closeFile();
+        if (openFile()) {
+            emit signal_logFileChanged(mFile.fileName());
+        }
+    }
+}
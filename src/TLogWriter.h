@@ -0,0 +1,139 @@
+#ifndef MUDLET_TLOGWRITER_H
+#define MUDLET_TLOGWRITER_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TBuffer.h"
+#include "TSpscQueue.h"
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include "post_guard.h"
+
+#include <zlib.h>
+
+#include <atomic>
+#include <vector>
+
+class QTimer;
+
+
+// A copy of one line of the main console, taken when it is logged so that the
+// log writer never has to look at the buffer itself:
+struct TLogLine
+{
+    TLogLine() : timeStamp(cTimeStampNone) {}
+
+    // Only set if time stamps are being logged, and formatted by the writer:
+    qint64 timeStamp;
+    QString text;
+    // Only filled in for HTML logs:
+    std::vector<TChar> format;
+};
+
+
+// Lives in its own thread and writes the main console log for a TConsole,
+// so that converting lines (to HTML), compressing them and writing them to
+// disk does not hold up the main thread. Lines are collected and written
+// together once there are enough of them, or when the flush timer goes off,
+// and the file can be replaced by a new one once it gets too big or too old.
+class TLogWriter : public QObject
+{
+    Q_OBJECT
+
+    Q_DISABLE_COPY(TLogWriter)
+
+public:
+    struct Settings
+    {
+        Settings()
+        : isHtml(false)
+        , isCompressed(false)
+        , flushInterval(1000)
+        , flushSize(65536)
+        , rotateSize(0)
+        , rotateInterval(0)
+        {}
+
+        QString directory;
+        bool isHtml;
+        // gzip, with a ".gz" added to the file name:
+        bool isCompressed;
+        // Written at the start and end of every file:
+        QString header;
+        QString footer;
+        // In milliseconds:
+        int flushInterval;
+        // In bytes, of text not yet written:
+        int flushSize;
+        // In bytes of file and milliseconds, 0 for never:
+        qint64 rotateSize;
+        qint64 rotateInterval;
+    };
+
+    explicit TLogWriter(const Settings& settings);
+    ~TLogWriter();
+
+    // Main thread only - start() opens the first file and should be called
+    // before the writer is moved to its thread:
+    bool start();
+    QString fileName() const { return mFile.fileName(); }
+    void addLine(TLogLine&& line);
+
+public slots:
+    // Invoked by TConsole through queued (or, to stop, blocking) calls:
+    void slot_startTimer();
+    void slot_stop();
+
+signals:
+    void signal_logFileChanged(const QString& fileName);
+
+private slots:
+    void slot_processLines();
+    void slot_flush();
+
+private:
+    bool openFile();
+    void closeFile();
+    void write(int flushMode);
+    void rotateIfDue();
+
+    Settings mSettings;
+    TSpscQueue<TLogLine> mLines;
+    std::atomic<bool> mIsNotified;
+
+    QFile mFile;
+    QElapsedTimer mFileAge;
+    // Created in the writer's thread:
+    QTimer* mpFlushTimer;
+    QByteArray mPending;
+    // Whether anything has gone to the file since it was last flushed:
+    bool mIsUnflushed;
+
+    bool mIsDeflating;
+    z_stream mZstream;
+    QByteArray mDeflateBuffer;
+};
+
+#endif // MUDLET_TLOGWRITER_H
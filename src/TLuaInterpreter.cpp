@@ -36,6 +36,8 @@
 #include "TEvent.h"
 #include "TForkedProcess.h"
 #include "TMap.h"
+#include "TMatchSubject.h"
+#include "TProtocolDecoder.h"
 #include "TRoom.h"
 #include "TRoomDB.h"
 #include "TTextEdit.h"
@@ -872,7 +874,7 @@ int TLuaInterpreter::selectCaptureGroup(lua_State* L)
 
         int begin = *iti;
         std::string& s = *its;
-        int length = s.size();
+        int length = TMatchSubject::textLength(s);
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::white), QColor(Qt::red)) << "selectCaptureGroup(" << begin << ", " << length << ")\n" >> 0;
         }
@@ -996,6 +998,9 @@ int TLuaInterpreter::updateMap(lua_State* L)
 {
     Host& host = getHostFromLua(L);
     if (host.mpMap) {
+        // Scripts that change the map behind its back use this to get it
+        // redrawn, so anything that the 2D map has kept has to go:
+        host.mpMap->setMapDataChanged();
         if (host.mpMap->mpM) {
             host.mpMap->mpM->update();
         }
@@ -1334,9 +1339,9 @@ int TLuaInterpreter::feedTriggers(lua_State* L)
 int TLuaInterpreter::isPrompt(lua_State* L)
 {
     Host& host = getHostFromLua(L);
-    int userCursorY = host.mpConsole->getLineNumber();
-    if (userCursorY < host.mpConsole->buffer.promptBuffer.size() && userCursorY >= 0) {
-        lua_pushboolean(L, host.mpConsole->buffer.promptBuffer.at(userCursorY));
+    int userCursorY = host.mpConsole->mUserCursor.y();
+    if (userCursorY < host.mpConsole->buffer.size() && userCursorY >= 0) {
+        lua_pushboolean(L, host.mpConsole->buffer.buffer[userCursorY].isPrompt);
         return 1;
     } else {
         if (host.mpConsole->mTriggerEngineMode && host.mpConsole->mIsPromptLine) {
@@ -1768,6 +1773,7 @@ int TLuaInterpreter::setExitStub(lua_State* L)
         return 1;
     }
     pR->setExitStub(dirType, status);
+    host.mpMap->setMapDataChanged();
     return 0;
 }
 
@@ -1842,7 +1848,6 @@ int TLuaInterpreter::connectExitStub(lua_State* L)
         // and it should always be possible to add a stub exit, so provide a true value :
         lua_pushboolean(L, true);
     }
-    host.mpMap->mMapGraphNeedsUpdate = true;
     return 1;
 }
 
@@ -3317,12 +3322,8 @@ int TLuaInterpreter::setTextFormat(lua_State* L)
 
     if (windowName.isEmpty() || !windowName.compare(QStringLiteral("main"), Qt::CaseSensitive)) {
         TConsole* pC = host.mpConsole;
-        pC->mFormatCurrent.bgR = colorComponents.at(0);
-        pC->mFormatCurrent.bgG = colorComponents.at(1);
-        pC->mFormatCurrent.bgB = colorComponents.at(2);
-        pC->mFormatCurrent.fgR = colorComponents.at(3);
-        pC->mFormatCurrent.fgG = colorComponents.at(4);
-        pC->mFormatCurrent.fgB = colorComponents.at(5);
+        pC->mFormatCurrent.setBackground(colorComponents.at(0), colorComponents.at(1), colorComponents.at(2));
+        pC->mFormatCurrent.setForeground(colorComponents.at(3), colorComponents.at(4), colorComponents.at(5));
         int flags = (bold ? TCHAR_BOLD : 0) + (underline ? TCHAR_UNDERLINE : 0) + (italics ? TCHAR_ITALICS : 0) + (strikeout ? TCHAR_STRIKEOUT : 0);
         pC->mFormatCurrent.flags &= ~(TCHAR_BOLD | TCHAR_UNDERLINE | TCHAR_ITALICS | TCHAR_STRIKEOUT);
         pC->mFormatCurrent.flags |= flags;
@@ -3453,6 +3454,7 @@ int TLuaInterpreter::setRoomEnv(lua_State* L)
     TRoom* pR = host.mpMap->mpRoomDB->getRoom(id);
     if (pR) {
         pR->environment = env;
+        host.mpMap->setMapDataChanged();
     }
 
     return 0;
@@ -3488,6 +3490,7 @@ int TLuaInterpreter::setRoomName(lua_State* L)
     TRoom* pR = host.mpMap->mpRoomDB->getRoom(id);
     if (pR) {
         pR->name = name;
+        host.mpMap->mpRoomDB->updateSearchIndex(id);
         lua_pushboolean(L, true); // Might conceivably wish to update the mappers after this...!
         return 1;
     } else {
@@ -3548,7 +3551,6 @@ int TLuaInterpreter::setRoomWeight(lua_State* L)
     TRoom* pR = host.mpMap->mpRoomDB->getRoom(id);
     if (pR) {
         pR->setWeight(w);
-        host.mpMap->mMapGraphNeedsUpdate = true;
     }
 
     return 0;
@@ -3637,7 +3639,7 @@ int TLuaInterpreter::setRoomIDbyHash(lua_State* L)
         hash = lua_tostring(L, 2);
     }
     Host& host = getHostFromLua(L);
-    host.mpMap->mpRoomDB->hashTable[QString(hash.c_str())] = id;
+    host.mpMap->mpRoomDB->setRoomHash(QString(hash.c_str()), id);
     return 0;
 }
 
@@ -3652,14 +3654,7 @@ int TLuaInterpreter::getRoomIDbyHash(lua_State* L)
         hash = lua_tostring(L, 1);
     }
     Host& host = getHostFromLua(L);
-    int retID = -1;
-    QString _hash = hash.c_str();
-    if (host.mpMap->mpRoomDB->hashTable.contains(_hash)) {
-        retID = host.mpMap->mpRoomDB->hashTable[_hash];
-        lua_pushnumber(L, retID);
-    } else {
-        lua_pushnumber(L, -1);
-    }
+    lua_pushnumber(L, host.mpMap->mpRoomDB->getRoomIdByHash(QString(hash.c_str())));
 
     return 1;
 }
@@ -3717,7 +3712,7 @@ int TLuaInterpreter::lockRoom(lua_State* L)
     TRoom* pR = host.mpMap->mpRoomDB->getRoom(id);
     if (pR) {
         pR->isLocked = b;
-        host.mpMap->mMapGraphNeedsUpdate = true;
+        host.mpMap->setRoomNeedsGraphUpdate(id);
         lua_pushboolean(L, true);
     } else {
         lua_pushboolean(L, false);
@@ -3756,7 +3751,6 @@ int TLuaInterpreter::lockExit(lua_State* L)
     TRoom* pR = host.mpMap->mpRoomDB->getRoom(id);
     if (pR) {
         pR->setExitLock(dir, b);
-        host.mpMap->mMapGraphNeedsUpdate = true;
     }
     return 0;
 }
@@ -3802,7 +3796,6 @@ int TLuaInterpreter::lockSpecialExit(lua_State* L)
     if (pR) {
         QString _dir = dir.c_str();
         pR->setSpecialExitLock(to, _dir, b);
-        host.mpMap->mMapGraphNeedsUpdate = true;
     }
     return 0;
 }
@@ -3980,8 +3973,7 @@ int TLuaInterpreter::getAllRoomEntrances(lua_State* L)
             return 2;
         }
         lua_newtable(L);
-        QList<int> entrances = host.mpMap->mpRoomDB->getEntranceHash().values(roomId);
-        // Could use a .toSet().toList() to remove duplicates values
+        QList<int> entrances = host.mpMap->mpRoomDB->getEntrances(roomId).toList();
         if (entrances.count() > 1) {
             std::sort(entrances.begin(), entrances.end());
         }
@@ -4060,27 +4052,13 @@ int TLuaInterpreter::searchRoom(lua_State* L)
             return 1;
         }
     } else {
-        QList<TRoom*> roomList = host.mpMap->mpRoomDB->getRoomPtrList();
         lua_newtable(L);
-        QList<int> roomIdsFound;
-        for (auto pR : roomList) {
-            if (exactMatch) {
-                if (pR->name.compare(room, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive) == 0) {
-                    roomIdsFound.append(pR->getId());
-                }
-            } else {
-                if (pR->name.contains(room, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive)) {
-                    roomIdsFound.append(pR->getId());
-                }
-            }
-        }
-        if (!roomIdsFound.isEmpty()) {
-            for (int i : roomIdsFound) {
-                TRoom* pR = host.mpMap->mpRoomDB->getRoom(i);
-                QString name = pR->name;
-                int roomID = pR->getId();
+        QList<int> roomIdsFound = host.mpMap->mpRoomDB->getSearchIndex().findRoomsByName(room, caseSensitive, exactMatch);
+        for (int roomID : roomIdsFound) {
+            TRoom* pR = host.mpMap->mpRoomDB->getRoom(roomID);
+            if (pR) {
                 lua_pushnumber(L, roomID);
-                lua_pushstring(L, name.toUtf8().constData());
+                lua_pushstring(L, pR->name.toUtf8().constData());
                 lua_settable(L, -3);
             }
         }
@@ -4092,10 +4070,10 @@ int TLuaInterpreter::searchRoom(lua_State* L)
 // searchRoomUserData(key, value)
 //     look through all room ids for a given user data "key" for the "value" and
 //     return a lua "array" of roomids matching those
-//     - linear search time, plus (q)sort(?) of roomIds found
+//     - look up in TRoomDB's search index, plus (q)sort(?) of roomIds found
 // searchRoomUserData(key)
 //     return a sorted lua "array" of the unique "values" found against that "key"
-//     - linear search time, plus (q)sort(?) of values found
+//     - look up in TRoomDB's search index, plus (q)sort(?) of values found
 // searchRoomUserData() - LATER ADDED FEATURE
 //     return a sorted lua "array" of the unique "keys" found in all rooms
 int TLuaInterpreter::searchRoomUserData(lua_State* L)
@@ -4130,22 +4108,10 @@ int TLuaInterpreter::searchRoomUserData(lua_State* L)
         }
     }
 
-    lua_newtable(L);
-
-    QHashIterator<int, TRoom*> itRoom(host.mpMap->mpRoomDB->getRoomMap());
-    // For best performance do the three different types of action in three
-    // different branches each with a loop - rather than choosing a branch
-    // within a loop for each room
-
+    const TRoomSearchIndex& searchIndex = host.mpMap->mpRoomDB->getSearchIndex();
     lua_newtable(L);
     if (key.isNull()) { // Find all keys everywhere
-        QSet<QString> keysSet;
-        while (itRoom.hasNext()) {
-            itRoom.next();
-            keysSet.unite(itRoom.value()->userData.keys().toSet());
-        }
-
-        QStringList keys = keysSet.toList();
+        QStringList keys = searchIndex.getUserDataKeys();
         if (keys.size() > 1) {
             std::sort(keys.begin(), keys.end());
         }
@@ -4156,18 +4122,7 @@ int TLuaInterpreter::searchRoomUserData(lua_State* L)
             lua_settable(L, -3);
         }
     } else if (value.isNull()) { // Find all values for a particular key in every room
-        QSet<QString> valuesSet; // Use a set as it automatically eliminates duplicates
-        while (itRoom.hasNext()) {
-            itRoom.next();
-            QString roomValueForKey = itRoom.value()->userData.value(key, QString());
-            // If the key is NOT present, will return second argument which is a
-            // null QString which is NOT the same as an empty QString.
-            if (!roomValueForKey.isNull()) {
-                valuesSet.insert(roomValueForKey);
-            }
-        }
-
-        QStringList values = valuesSet.toList();
+        QStringList values = searchIndex.getUserDataValues(key);
         if (values.size() > 1) {
             std::sort(values.begin(), values.end());
         }
@@ -4178,17 +4133,7 @@ int TLuaInterpreter::searchRoomUserData(lua_State* L)
             lua_settable(L, -3);
         }
     } else { // Find all rooms where key and value match
-        QSet<int> roomIdsSet;
-        while (itRoom.hasNext()) {
-            itRoom.next();
-
-            QString roomDataValue = itRoom.value()->userData.value(key, QString());
-            if ((!roomDataValue.isNull()) && (!value.compare(roomDataValue, Qt::CaseSensitive))) {
-                roomIdsSet.insert(itRoom.key());
-            }
-        }
-
-        QList<int> roomIds = roomIdsSet.toList();
+        QList<int> roomIds = searchIndex.findRoomsByUserData(key, value);
         if (roomIds.size() > 1) {
             std::sort(roomIds.begin(), roomIds.end());
         }
@@ -4582,6 +4527,127 @@ int TLuaInterpreter::getPath(lua_State* L)
     }
 }
 
+// getPaths(fromRoomId, {targetRoomId, ...}) - one search instead of a getPath()
+// for each of the targets; returns two tables keyed by the id of each target
+// that can be reached, one with the total weight of the best route to it and
+// the other with the command for the first step along that route (an empty
+// string for the starting room itself):
+int TLuaInterpreter::getPaths(lua_State* L)
+{
+    int originRoomId;
+    if (!lua_isnumber(L, 1)) {
+        lua_pushfstring(L, "getPaths: bad argument #1 type (starting room id as number expected, got %s!)", luaL_typename(L, 1));
+        lua_error(L);
+        return 1;
+    } else {
+        originRoomId = lua_tonumber(L, 1);
+    }
+
+    if (!lua_istable(L, 2)) {
+        lua_pushfstring(L, "getPaths: bad argument #2 type (target room ids as table expected, got %s!)", luaL_typename(L, 2));
+        lua_error(L);
+        return 1;
+    }
+    QList<int> targetRoomIds;
+    lua_pushnil(L);
+    while (lua_next(L, 2) != 0) {
+        if (!lua_isnumber(L, -1)) {
+            lua_pushfstring(L, "getPaths: bad argument #2 value (target room ids must be numbers, got %s!)", luaL_typename(L, -1));
+            lua_error(L);
+            return 1;
+        }
+        targetRoomIds.append(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+    }
+
+    Host& host = getHostFromLua(L);
+    if (!host.mpMap || !host.mpMap->mpRoomDB) {
+        lua_pushnil(L);
+        lua_pushstring(L, "getPaths: no map present or loaded!");
+        return 2;
+    } else if (!host.mpMap->mpRoomDB->getRoom(originRoomId)) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "getPaths: bad argument #1 value (number %d is not a valid source room id).", originRoomId);
+        return 2;
+    }
+
+    QHash<int, float> costs;
+    QHash<int, QString> firstMoves;
+    if (!host.mpMap->findPaths(originRoomId, targetRoomIds, costs, firstMoves)) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "getPaths: no paths can be found from room with Id %d!", originRoomId);
+        return 2;
+    }
+    lua_createtable(L, 0, costs.size());
+    QHashIterator<int, float> itCost(costs);
+    while (itCost.hasNext()) {
+        itCost.next();
+        lua_pushnumber(L, itCost.key());
+        lua_pushnumber(L, itCost.value());
+        lua_settable(L, -3);
+    }
+    lua_createtable(L, 0, firstMoves.size());
+    QHashIterator<int, QString> itMove(firstMoves);
+    while (itMove.hasNext()) {
+        itMove.next();
+        lua_pushnumber(L, itMove.key());
+        lua_pushstring(L, itMove.value().toUtf8().constData());
+        lua_settable(L, -3);
+    }
+    return 2;
+}
+
+// getRoomsWithinCost(fromRoomId, maximumCost) - returns a table, keyed by room
+// id, of all the rooms that can be reached with a route of no more than the
+// given total weight, with that weight as the value (0 for the starting room):
+int TLuaInterpreter::getRoomsWithinCost(lua_State* L)
+{
+    int originRoomId;
+    if (!lua_isnumber(L, 1)) {
+        lua_pushfstring(L, "getRoomsWithinCost: bad argument #1 type (starting room id as number expected, got %s!)", luaL_typename(L, 1));
+        lua_error(L);
+        return 1;
+    } else {
+        originRoomId = lua_tonumber(L, 1);
+    }
+
+    float maximumCost;
+    if (!lua_isnumber(L, 2)) {
+        lua_pushfstring(L, "getRoomsWithinCost: bad argument #2 type (maximum cost as number expected, got %s!)", luaL_typename(L, 2));
+        lua_error(L);
+        return 1;
+    } else {
+        maximumCost = lua_tonumber(L, 2);
+    }
+
+    Host& host = getHostFromLua(L);
+    if (!host.mpMap || !host.mpMap->mpRoomDB) {
+        lua_pushnil(L);
+        lua_pushstring(L, "getRoomsWithinCost: no map present or loaded!");
+        return 2;
+    } else if (!host.mpMap->mpRoomDB->getRoom(originRoomId)) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "getRoomsWithinCost: bad argument #1 value (number %d is not a valid source room id).", originRoomId);
+        return 2;
+    }
+
+    QHash<int, float> costs;
+    if (!host.mpMap->findRoomsWithinCost(originRoomId, maximumCost, costs)) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "getRoomsWithinCost: no paths can be found from room with Id %d!", originRoomId);
+        return 2;
+    }
+    lua_createtable(L, 0, costs.size());
+    QHashIterator<int, float> itCost(costs);
+    while (itCost.hasNext()) {
+        itCost.next();
+        lua_pushnumber(L, itCost.key());
+        lua_pushnumber(L, itCost.value());
+        lua_settable(L, -3);
+    }
+    return 1;
+}
+
 int TLuaInterpreter::deselect(lua_State* L)
 {
     Host& host = getHostFromLua(L);
@@ -5258,12 +5324,6 @@ int TLuaInterpreter::sendGMCP(lua_State* L)
     return 0;
 }
 
-#define MSDP_VAR 1
-#define MSDP_VAL 2
-#define MSDP_TABLE_OPEN 3
-#define MSDP_TABLE_CLOSE 4
-#define MSDP_ARRAY_OPEN 5
-#define MSDP_ARRAY_CLOSE 6
 #define IAC 255
 #define SB 250
 #define SE 240
@@ -6429,8 +6489,9 @@ int TLuaInterpreter::getTimestamp(lua_State* L)
     }
     Host& host = getHostFromLua(L);
     if (name == "") {
-        if (luaLine > 0 && luaLine < host.mpConsole->buffer.timeBuffer.size()) {
-            lua_pushstring(L, host.mpConsole->buffer.timeBuffer.at(luaLine).toLatin1().data());
+        luaLine -= host.mpConsole->buffer.mLineOffset;
+        if (luaLine > 0 && luaLine < host.mpConsole->buffer.size()) {
+            lua_pushstring(L, TBuffer::timeStampToString(host.mpConsole->buffer.buffer[luaLine].timeStamp).toLatin1().data());
         } else {
             lua_pushstring(L, "getTimestamp: invalid line number");
         }
@@ -6440,8 +6501,9 @@ int TLuaInterpreter::getTimestamp(lua_State* L)
     QMap<QString, TConsole*>& dockWindowConsoleMap = mudlet::self()->mHostConsoleMap[&host];
     if (dockWindowConsoleMap.contains(_name)) {
         TConsole* pC = dockWindowConsoleMap[_name];
-        if (luaLine > 0 && luaLine < pC->buffer.timeBuffer.size()) {
-            lua_pushstring(L, pC->buffer.timeBuffer.at(luaLine).toLatin1().data());
+        luaLine -= pC->buffer.mLineOffset;
+        if (luaLine > 0 && luaLine < pC->buffer.size()) {
+            lua_pushstring(L, TBuffer::timeStampToString(pC->buffer.buffer[luaLine].timeStamp).toLatin1().data());
         } else {
             lua_pushstring(L, "getTimestamp: invalid line number");
         }
@@ -6450,6 +6512,58 @@ int TLuaInterpreter::getTimestamp(lua_State* L)
     return 0;
 }
 
+// millis = getTimestampMillis([windowName,] lineNumber)
+// When the line was received, in milliseconds on the same (steady) clock as
+// getCurrentMillis(), so that scripts can measure how long the server takes
+// to answer something:
+int TLuaInterpreter::getTimestampMillis(lua_State* L)
+{
+    int n = 1;
+    QString windowName = QStringLiteral("main");
+    if (lua_gettop(L) > 1) {
+        if (!lua_isstring(L, n)) {
+            lua_pushfstring(L, "getTimestampMillis: bad argument #%d type (window name as string is optional, got %s!)", n, luaL_typename(L, n));
+            lua_error(L);
+            return 1;
+        }
+        windowName = QString::fromUtf8(lua_tostring(L, n));
+        ++n;
+    }
+    if (!lua_isnumber(L, n)) {
+        lua_pushfstring(L, "getTimestampMillis: bad argument #%d type (line number as number expected, got %s!)", n, luaL_typename(L, n));
+        lua_error(L);
+        return 1;
+    }
+    const int luaLine = lua_tointeger(L, n);
+
+    Host& host = getHostFromLua(L);
+    TConsole* pC = host.mpConsole;
+    if (windowName != QLatin1String("main")) {
+        pC = mudlet::self()->mHostConsoleMap[&host].value(windowName);
+        if (!pC) {
+            lua_pushnil(L);
+            lua_pushfstring(L, "window \"%s\" not found", windowName.toUtf8().constData());
+            return 2;
+        }
+    }
+
+    const int line = luaLine - pC->buffer.mLineOffset;
+    if (line < 0 || line >= pC->buffer.size() || pC->buffer.buffer[line].steadyTimeStamp < 0) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "line %d does not have a time stamp", luaLine);
+        return 2;
+    }
+    lua_pushnumber(L, pC->buffer.buffer[line].steadyTimeStamp);
+    return 1;
+}
+
+// millis = getCurrentMillis()
+int TLuaInterpreter::getCurrentMillis(lua_State* L)
+{
+    lua_pushnumber(L, TBuffer::currentSteadyTimeStamp());
+    return 1;
+}
+
 int TLuaInterpreter::setBorderColor(lua_State* L)
 {
     int luaRed;
@@ -6581,6 +6695,7 @@ int TLuaInterpreter::setCustomEnvColor(lua_State* L)
 
     Host& host = getHostFromLua(L);
     host.mpMap->customEnvColors[id] = QColor(r, g, b, alpha);
+    host.mpMap->setMapDataChanged();
     return 0;
 }
 
@@ -6915,7 +7030,6 @@ int TLuaInterpreter::setExit(lua_State* L)
 
     Host& host = getHostFromLua(L);
     lua_pushboolean(L, host.mpMap->setExit(from, to, dir));
-    host.mpMap->mMapGraphNeedsUpdate = true;
     return 1;
 }
 
@@ -7004,7 +7118,6 @@ int TLuaInterpreter::addRoom(lua_State* L)
     lua_pushboolean(L, added);
     if (added) {
         host.mpMap->setRoomArea(id, -1, false);
-        host.mpMap->mMapGraphNeedsUpdate = true;
     }
 
     return 1;
@@ -7555,6 +7668,7 @@ int TLuaInterpreter::setDoor(lua_State* L)
 
     bool result = pR->setDoor(exitCmd, doorStatus);
     if (result) {
+        host.mpMap->setMapDataChanged();
         if (host.mpMap->mpMapper && host.mpMap->mpMapper->mp2dMap) {
             host.mpMap->mpMapper->mp2dMap->update();
         }
@@ -7764,6 +7878,7 @@ int TLuaInterpreter::addCustomLine(lua_State* L)
         pR->customLinesArrow[direction] = arrow;
         pR->customLinesStyle[direction] = line_style;
         pR->customLinesColor[direction] = colors;
+        host.mpMap->setMapDataChanged();
     }
     return 0;
 }
@@ -8096,6 +8211,7 @@ int TLuaInterpreter::clearRoomUserData(lua_State* L)
     } else {
         if (!pR->userData.isEmpty()) {
             pR->userData.clear();
+            host.mpMap->mpRoomDB->updateSearchIndex(roomId);
             lua_pushboolean(L, true);
         } else {
             lua_pushboolean(L, false);
@@ -8152,6 +8268,7 @@ int TLuaInterpreter::clearRoomUserDataItem(lua_State* L)
         //        }
         /*      else */ if (pR->userData.contains(key)) {
             pR->userData.remove(key);
+            host.mpMap->mpRoomDB->updateSearchIndex(roomId);
             lua_pushboolean(L, true);
         } else {
             lua_pushboolean(L, false);
@@ -8621,6 +8738,7 @@ int TLuaInterpreter::setRoomUserData(lua_State* L)
         return 2;
     } else {
         pR->userData[key] = value;
+        host.mpMap->mpRoomDB->updateSearchIndex(roomId);
         lua_pushboolean(L, true);
         return 1;
     }
@@ -8970,7 +9088,7 @@ int TLuaInterpreter::setRoomArea(lua_State* L)
         return 1;
     } else {
         id = lua_tointeger(L, 1);
-        if (!host.mpMap->mpRoomDB->getRoomIDList().contains(id)) {
+        if (!host.mpMap->mpRoomDB->getRoom(id)) {
             lua_pushnil(L);
             lua_pushfstring(L, "setRoomArea: bad argument #1 value (number %d is not a valid room id).", id);
             return 2;
@@ -9049,7 +9167,7 @@ int TLuaInterpreter::resetRoomArea(lua_State* L)
         lua_pushnil(L);
         lua_pushstring(L, "resetRoomArea: no map present or loaded!");
         return 2;
-    } else if (!host.mpMap->mpRoomDB->getRoomIDList().contains(id)) {
+    } else if (!host.mpMap->mpRoomDB->getRoom(id)) {
         lua_pushnil(L);
         lua_pushfstring(L, "resetRoomArea: bad argument #1 value (number %d is not a valid room id).", id);
         return 2;
@@ -9098,6 +9216,7 @@ int TLuaInterpreter::setRoomChar(lua_State* L)
     } else {
         if (c.size() >= 1) {
             pR->c = c[0];
+            host.mpMap->setMapDataChanged();
         }
     }
     return 0;
@@ -11328,135 +11447,150 @@ void TLuaInterpreter::setAtcpTable(const QString& var, const QString& arg)
 }
 
 
-void TLuaInterpreter::setGMCPTable(QString& key, const QString& string_data)
+void TLuaInterpreter::setGMCPTable(const QString& key, const QByteArray& data)
 {
     lua_State* L = pGlobalLua;
-    lua_getglobal(L, "gmcp"); //defined in Lua init
-    if (!lua_istable(L, -1)) {
-        lua_newtable(L);
-        lua_setglobal(L, "gmcp");
-        lua_getglobal(L, "gmcp");
-        if (!lua_istable(L, -1)) {
-            qDebug() << "ERROR: gmcp table not defined";
-            return;
+
+    // The JSON is optional, a message can be just the package name:
+    TProtocolDecoder decoder(L, data);
+    if (!decoder.isBlank()) {
+        if (decoder.pushJson()) {
+            setProtocolTable(QStringLiteral("gmcp"), key);
+        } else {
+            string e = "JSON decoder error: ";
+            e += decoder.errorString().toUtf8().constData();
+            QString _n = "JSON decoder error:";
+            QString _f = key;
+            logError(e, _n, _f);
+        }
+    }
+    lua_settop(L, 0);
+
+    raiseProtocolEvents(QStringLiteral("gmcp"), key);
+
+    // auto-detect IRE composer
+    if (key == QLatin1String("IRE.Composer.Edit")) {
+        QRegExp rx(R"lit(\{ "title": "(.*)", "text": "(.*)" \})lit");
+        if (rx.indexIn(QString::fromUtf8(data)) != -1) {
+            QString title = rx.cap(1);
+            QString initialText = rx.cap(2);
+            initialText.replace(QString(R"(\n)"), QString("\n"));
+            Host& host = getHostFromLua(L);
+            if (host.mTelnet.mpComposer) {
+                return;
+            }
+            host.mTelnet.mpComposer = new dlgComposer(&host);
+            host.mTelnet.mpComposer->init(title, initialText);
+            host.mTelnet.mpComposer->raise();
+            host.mTelnet.mpComposer->show();
         }
     }
-    parseJSON(key, string_data, "gmcp");
 }
-void TLuaInterpreter::setMSDPTable(QString& key, const QString& string_data)
+
+void TLuaInterpreter::msdp2Lua(const QByteArray& data)
 {
     lua_State* L = pGlobalLua;
-    lua_getglobal(L, "msdp");
-    if (!lua_istable(L, -1)) {
-        lua_newtable(L);
-        lua_setglobal(L, "msdp");
-        lua_getglobal(L, "msdp");
-        if (!lua_istable(L, -1)) {
-            qDebug() << "ERROR: msdp table not defined";
-            return;
-        }
-    }
 
-    parseJSON(key, string_data, "msdp");
+    // Each variable is stored (and its events raised) as it is decoded, the
+    // same as a series of separate GMCP messages would be:
+    TProtocolDecoder decoder(L, data);
+    QString name;
+    while (decoder.pushNextMsdpVariable(name)) {
+        setProtocolTable(QStringLiteral("msdp"), name);
+        lua_settop(L, 0);
+        raiseProtocolEvents(QStringLiteral("msdp"), name);
+    }
+    if (!decoder.errorString().isEmpty()) {
+        string e = "MSDP decoder error: ";
+        e += decoder.errorString().toUtf8().constData();
+        QString _n = "MSDP decoder error:";
+        QString _f = "msdp";
+        logError(e, _n, _f);
+    }
+    lua_settop(L, 0);
 }
 
-void TLuaInterpreter::parseJSON(QString& key, const QString& string_data, const QString& protocol)
+// Pops the value from the top of the stack and stores it in the protocol's
+// table, with a key in the format of Blah.Blah or Blah.Blah.Bleh giving the
+// path to it - any tables along that path are created as needed. A table
+// value for a key registered in mGMCP_merge_table_keys is merged into any
+// existing table rather than replacing it.
+void TLuaInterpreter::setProtocolTable(const QString& protocol, const QString& key)
 {
-    // key is in format of Blah.Blah or Blah.Blah.Bleh - we want to push & pre-create the tables as appropriate
     lua_State* L = pGlobalLua;
-    QStringList tokenList = key.split(".");
-    if (!lua_checkstack(L, tokenList.size() + 5)) {
+    const int value = lua_gettop(L);
+    const QStringList tokenList = key.split(QLatin1Char('.'));
+    if (!lua_checkstack(L, 6)) {
+        lua_pop(L, 1);
         return;
     }
-    int i = 0;
-    for (; i < tokenList.size() - 1; i++) {
-        lua_getfield(L, -1, tokenList[i].toLatin1().data());
+
+    const QByteArray protocolName = protocol.toUtf8();
+    lua_getglobal(L, protocolName.constData()); //defined in Lua init
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setglobal(L, protocolName.constData());
+    }
+
+    for (int i = 0; i < tokenList.size() - 1; ++i) {
+        const QByteArray token = tokenList.at(i).toUtf8();
+        lua_getfield(L, -1, token.constData());
         if (!lua_istable(L, -1)) {
             lua_pop(L, 1);
-            lua_pushstring(L, tokenList[i].toLatin1().data());
             lua_newtable(L);
-            lua_rawset(L, -3);
-            lua_getfield(L, -1, tokenList[i].toLatin1().data());
+            lua_pushlstring(L, token.constData(), token.size());
+            lua_pushvalue(L, -2);
+            lua_rawset(L, -4);
         }
         lua_remove(L, -2);
     }
-    bool __needMerge = false;
-    lua_getfield(L, -1, tokenList[i].toLatin1().data());
-    if (lua_istable(L, -1)) {
-        // only merge tables (instead of replacing them) if the key has been registered as a need to merge key by the user default is Char.Status only
-        if (mpHost->mGMCP_merge_table_keys.contains(key)) {
-            __needMerge = true;
-        }
-    }
-    lua_pop(L, 1);
-    if (!__needMerge) {
-        lua_pushstring(L, tokenList[i].toLatin1().data());
-    } else {
-        lua_pushstring(L, "__needMerge");
-    }
 
-    lua_getglobal(L, "json_to_value");
+    const int parent = lua_gettop(L);
+    const QByteArray lastToken = tokenList.last().toUtf8();
+    lua_pushlstring(L, lastToken.constData(), lastToken.size());
+    const int name = lua_gettop(L);
 
-    if (!lua_isfunction(L, -1)) {
-        lua_settop(L, 0);
-        qDebug() << "CRITICAL ERROR: json_to_value not defined";
-        return;
-    }
-    lua_pushlstring(L, string_data.toLatin1().data(), string_data.size());
-    int error = lua_pcall(L, 1, 1, 0);
-    if (error == 0) {
-        // Top of stack should now contain the lua representation of json.
-        lua_rawset(L, -3);
-        if (__needMerge) {
-            lua_settop(L, 0);
-            lua_getglobal(L, "__gmcp_merge_gmcp_sub_tables");
-            if (!lua_isfunction(L, -1)) {
-                lua_settop(L, 0);
-                qDebug() << "CRITICAL ERROR: __gmcp_merge_gmcp_sub_tables is not defined in lua_LuaGlobal.lua";
-                return;
-            }
-            lua_getglobal(L, "gmcp");
-            i = 0;
-            for (; i < tokenList.size() - 1; i++) {
-                lua_getfield(L, -1, tokenList[i].toLatin1().data());
-                lua_remove(L, -2);
-            }
-            lua_pushstring(L, tokenList[i].toLatin1().data());
-            lua_pcall(L, 2, 0, 0);
-        }
-    } else {
-        {
-            string e;
-            if (lua_isstring(L, -1)) {
-                e = "Lua error:";
-                e += lua_tostring(L, -1);
+    // only merge tables (instead of replacing them) if the key has been registered as a need to merge key by the user default is Char.Status only
+    if (protocol == QLatin1String("gmcp") && lua_istable(L, value) && mpHost->mGMCP_merge_table_keys.contains(key)) {
+        lua_pushvalue(L, name);
+        lua_rawget(L, parent);
+        if (lua_istable(L, -1)) {
+            const int existing = lua_gettop(L);
+            lua_pushnil(L);
+            while (lua_next(L, value)) {
+                lua_pushvalue(L, -2);
+                lua_insert(L, -2);
+                lua_rawset(L, existing);
             }
-            QString _n = "JSON decoder error:";
-            QString _f = "json_to_value";
-            logError(e, _n, _f);
+            lua_settop(L, value - 1);
+            return;
         }
+        lua_pop(L, 1);
     }
-    lua_settop(L, 0);
 
-    // events: for key "foo.bar.top" we raise: gmcp.foo, gmcp.foo.bar and gmcp.foo.bar.top
-    // with the actual key given as parameter e.g. event=gmcp.foo, param="gmcp.foo.bar"
+    lua_pushvalue(L, value);
+    lua_rawset(L, parent);
+    lua_settop(L, value - 1);
+}
 
+// events: for key "foo.bar.top" we raise: gmcp.foo, gmcp.foo.bar and gmcp.foo.bar.top
+// with the actual key given as parameter e.g. event=gmcp.foo, param="gmcp.foo.bar"
+void TLuaInterpreter::raiseProtocolEvents(const QString& protocol, const QString& key)
+{
+    const QStringList tokenList = key.split(QLatin1Char('.'));
+    const QString fullKey = QStringLiteral("%1.%2").arg(protocol, key);
     QString token = protocol;
-    if (protocol == "msdp") {
-        key.prepend("msdp.");
-    } else {
-        key.prepend("gmcp.");
-    }
-
+    Host& host = getHostFromLua(pGlobalLua);
     for (int k = 0; k < tokenList.size(); k++) {
         TEvent event;
         token.append(".");
-        token.append(tokenList[k]);
+        token.append(tokenList.at(k));
         event.mArgumentList.append(token);
         event.mArgumentTypeList.append(ARGUMENT_TYPE_STRING);
-        event.mArgumentList.append(key);
+        event.mArgumentList.append(fullKey);
         event.mArgumentTypeList.append(ARGUMENT_TYPE_STRING);
-        Host& host = getHostFromLua(L);
         if (mudlet::debugMode) {
             QString msg = QString("\n%1 event <").arg(protocol);
             msg.append(token);
@@ -11465,145 +11599,6 @@ void TLuaInterpreter::parseJSON(QString& key, const QString& string_data, const
         }
         host.raiseEvent(event);
     }
-    // auto-detect IRE composer
-    if (tokenList.size() == 3 && tokenList.at(0) == "IRE" && tokenList.at(1) == "Composer" && tokenList.at(2) == "Edit") {
-        QRegExp rx(R"lit(\{ "title": "(.*)", "text": "(.*)" \})lit");
-        if (rx.indexIn(string_data) != -1) {
-            QString title = rx.cap(1);
-            QString initialText = rx.cap(2);
-            initialText.replace(QString(R"(\n)"), QString("\n"));
-            Host& host = getHostFromLua(L);
-            if (host.mTelnet.mpComposer) {
-                return;
-            }
-            host.mTelnet.mpComposer = new dlgComposer(&host);
-            host.mTelnet.mpComposer->init(title, initialText);
-            host.mTelnet.mpComposer->raise();
-            host.mTelnet.mpComposer->show();
-        }
-    }
-    lua_pop(L, lua_gettop(L));
-}
-
-#define BUFFER_SIZE 20000
-void TLuaInterpreter::msdp2Lua(char* src, int srclen)
-{
-    qDebug() << "<MSDP><" << src << ">";
-    QStringList varList;
-    QString lastVar;
-    int i, nest, last;
-    nest = last = 0;
-    i = 0;
-    QString script; // = "{";
-    // N/U:     bool isSet = false;
-    bool no_array_marker_bug = false;
-    while (i < srclen) {
-        switch (src[i]) {
-            case MSDP_TABLE_OPEN:
-                script.append("{");
-                nest++;
-                last = MSDP_TABLE_OPEN;
-                break;
-            case MSDP_TABLE_CLOSE:
-                if (last == MSDP_VAL || last == MSDP_VAR) {
-                    script.append(R"(")");
-                }
-                if (nest) {
-                    nest--;
-                }
-                script.append("}");
-                last = MSDP_TABLE_CLOSE;
-                break;
-            case MSDP_ARRAY_OPEN:
-                script.append("[");
-                nest++;
-                last = MSDP_ARRAY_OPEN;
-                break;
-            case MSDP_ARRAY_CLOSE:
-                if (last == MSDP_VAL || last == MSDP_VAR) {
-                    script.append(R"(")");
-                }
-                if (nest) {
-                    nest--;
-                }
-                script.append("]");
-                last = MSDP_ARRAY_CLOSE;
-                break;
-            case MSDP_VAR:
-                if (nest) {
-                    if (last == MSDP_VAL || last == MSDP_VAR) {
-                        script.append(R"(")");
-                    }
-                    if (last == MSDP_VAL || last == MSDP_VAR || last == MSDP_TABLE_CLOSE || last == MSDP_ARRAY_CLOSE) {
-                        script.append(",");
-                    }
-                    script.append(R"(")");
-                } else {
-                    script.append(R"(")");
-
-                    if (varList.size()) {
-                        script = script.replace(0, varList.front().size() + 3, "");
-                        QString token = varList.front();
-                        token = token.replace(R"(")", "");
-                        //qDebug()<<"[SET]<Token><"<<token<<"><JSON><"<<script<<">";
-                        setMSDPTable(token, script);
-                        varList.clear();
-                        script.clear();
-                        // N/U:                       isSet = true;
-                    }
-                }
-                last = MSDP_VAR;
-                lastVar.clear();
-                break;
-
-            case MSDP_VAL:
-                if (last == MSDP_VAR) {
-                    script.append(R"(":)");
-                }
-                if (last == MSDP_VAL) {
-                    no_array_marker_bug = true;
-                    script.append(R"(",)");
-                }
-                if (src[i + 1] != MSDP_TABLE_OPEN && src[i + 1] != MSDP_ARRAY_OPEN) {
-                    script.append(R"(")");
-                }
-                varList.append(lastVar);
-                last = MSDP_VAL;
-                break;
-            case '\\':
-                script.append(R"(\\)");
-                break;
-            case '"':
-                script.append(R"(\")");
-                break;
-            default:
-                script.append(src[i]);
-                lastVar.append(src[i]);
-                break;
-        }
-        i++;
-    }
-    if (last != MSDP_ARRAY_CLOSE && last != MSDP_TABLE_CLOSE) {
-        script.append(R"(")");
-        if (!script.startsWith('"')) {
-            script.prepend('"');
-        }
-    }
-    if (varList.size()) {
-        //qDebug()<<"<script>"<<script;
-        // N/U:         int startVal = script.indexOf(":")+1;
-        QString token = varList.front();
-        token = token.replace(R"(")", "");
-        script = script.replace(0, token.size() + 3, "");
-        if (no_array_marker_bug) {
-            if (!script.startsWith('[')) {
-                script.prepend('[');
-                script.append(']');
-            }
-        }
-        //qDebug()<<"[END]<Token>"<<token<<"<JSON>"<<script;
-        setMSDPTable(token, script);
-    }
 }
 
 void TLuaInterpreter::setChannel102Table(int& var, int& arg)
@@ -11741,7 +11736,7 @@ void TLuaInterpreter::logError(std::string& e, const QString& name, const QStrin
     if (mpHost->mEchoLuaErrors) {
         // ensure the Lua error is on a line of it's own and is not prepended to the previous line
         if (mpHost->mpConsole->buffer.size() > 0) {
-            if (!mpHost->mpConsole->buffer.lineBuffer.at(mpHost->mpConsole->buffer.lineBuffer.size() - 1).isEmpty()) {
+            if (!mpHost->mpConsole->buffer.buffer.back().text.isEmpty()) {
                 mpHost->postMessage("\n");
             }
         }
@@ -11848,6 +11843,28 @@ bool TLuaInterpreter::callMulti(const QString& function, const QString& mName)
     }
 }
 
+// Pushes the current value of the event handler function onto the stack, or
+// an error message if it cannot be looked up. The name has to be evaluated
+// every time, as scripts can redefine the function at any time, but it only
+// needs to be parsed and compiled once - after that the chunk that returns it
+// is run from the registry:
+bool TLuaInterpreter::pushEventHandler(const QString& function)
+{
+    lua_State* L = pGlobalLua;
+
+    int ref = mEventHandlerLookups.value(function, LUA_NOREF);
+    if (ref == LUA_NOREF) {
+        if (luaL_loadstring(L, QStringLiteral("return %1").arg(function).toUtf8().constData())) {
+            return false;
+        }
+        ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        mEventHandlerLookups.insert(function, ref);
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    return !lua_pcall(L, 0, 1, 0);
+}
+
 bool TLuaInterpreter::callEventHandler(const QString& function, const TEvent& pE)
 {
     if (function.isEmpty()) {
@@ -11856,15 +11873,15 @@ bool TLuaInterpreter::callEventHandler(const QString& function, const TEvent& pE
 
     lua_State* L = pGlobalLua;
 
-    int error = luaL_dostring(L, QStringLiteral("return %1").arg(function).toUtf8().constData());
-    if (error) {
+    if (!pushEventHandler(function)) {
         string err;
-        if (lua_isstring(L, 1)) {
+        if (lua_isstring(L, -1)) {
             err = "Lua error:";
-            err += lua_tostring(L, 1);
+            err += lua_tostring(L, -1);
         }
         QString name = "event handler function";
         logError(err, name, function);
+        lua_pop(L, lua_gettop(L));
         return false;
     }
 
@@ -11888,7 +11905,7 @@ bool TLuaInterpreter::callEventHandler(const QString& function, const TEvent& pE
         }
     }
 
-    error = lua_pcall(L, pE.mArgumentList.size(), LUA_MULTRET, 0);
+    int error = lua_pcall(L, pE.mArgumentList.size(), LUA_MULTRET, 0);
     if (error) {
         string err = "";
         if (lua_isstring(L, -1)) {
@@ -12060,6 +12077,8 @@ static void storeHostInLua(lua_State* L, Host* h);
 // on initialization of a new session *or* in case of an interpreter reset by the user.
 void TLuaInterpreter::initLuaGlobals()
 {
+    // Any references held are into the registry of the previous state:
+    mEventHandlerLookups.clear();
     pGlobalLua = newstate();
     storeHostInLua(pGlobalLua, mpHost);
 
@@ -12206,6 +12225,8 @@ void TLuaInterpreter::initLuaGlobals()
     lua_register(pGlobalLua, "getTime", TLuaInterpreter::getTime);
     lua_register(pGlobalLua, "invokeFileDialog", TLuaInterpreter::invokeFileDialog);
     lua_register(pGlobalLua, "getTimestamp", TLuaInterpreter::getTimestamp);
+    lua_register(pGlobalLua, "getTimestampMillis", TLuaInterpreter::getTimestampMillis);
+    lua_register(pGlobalLua, "getCurrentMillis", TLuaInterpreter::getCurrentMillis);
     lua_register(pGlobalLua, "setLink", TLuaInterpreter::setLink);
     lua_register(pGlobalLua, "deselect", TLuaInterpreter::deselect);
     lua_register(pGlobalLua, "insertLink", TLuaInterpreter::insertLink);
@@ -12382,6 +12403,12 @@ void TLuaInterpreter::initLuaGlobals()
     lua_register(pGlobalLua, "getServerEncoding", TLuaInterpreter::getServerEncoding);
     lua_register(pGlobalLua, "getServerEncodingsList", TLuaInterpreter::getServerEncodingsList);
     lua_register(pGlobalLua, "alert", TLuaInterpreter::alert);
+    lua_register(pGlobalLua, "setProfilerEnabled", TLuaInterpreter::setProfilerEnabled);
+    lua_register(pGlobalLua, "resetProfiler", TLuaInterpreter::resetProfiler);
+    lua_register(pGlobalLua, "getProfilerStatistics", TLuaInterpreter::getProfilerStatistics);
+    lua_register(pGlobalLua, "getProfilerReport", TLuaInterpreter::getProfilerReport);
+    lua_register(pGlobalLua, "getPaths", TLuaInterpreter::getPaths);
+    lua_register(pGlobalLua, "getRoomsWithinCost", TLuaInterpreter::getRoomsWithinCost);
 
 // PLACEMARKER: End of Lua functions registration
     luaopen_yajl(pGlobalLua);
@@ -12941,6 +12968,112 @@ int TLuaInterpreter::alert(lua_State* L)
     return 0;
 }
 
+// Parses the optional ([sort key], [count]) arguments shared by
+// getProfilerStatistics() and getProfilerReport():
+static bool getProfilerArguments(lua_State* L, const char* function, TProfiler::SortKey& sortKey, int& count)
+{
+    if (lua_gettop(L) > 0 && !lua_isnil(L, 1)) {
+        if (!lua_isstring(L, 1)) {
+            lua_pushfstring(L, "%s: bad argument #1 type (sort key as string is optional, got %s!)", function, luaL_typename(L, 1));
+            return false;
+        }
+        if (!TProfiler::sortKeyFromName(QString::fromUtf8(lua_tostring(L, 1)), sortKey)) {
+            lua_pushfstring(L, R"(%s: bad argument #1 value (sort key must be one of "total", "match", "lua", "hits" or "attempts", got "%s"!))", function, lua_tostring(L, 1));
+            return false;
+        }
+    }
+    if (lua_gettop(L) > 1 && !lua_isnil(L, 2)) {
+        if (!lua_isnumber(L, 2)) {
+            lua_pushfstring(L, "%s: bad argument #2 type (number of items as number is optional, got %s!)", function, luaL_typename(L, 2));
+            return false;
+        }
+        count = qMax(0, static_cast<int>(lua_tointeger(L, 2)));
+    }
+    return true;
+}
+
+int TLuaInterpreter::setProfilerEnabled(lua_State* L)
+{
+    if (!lua_isboolean(L, 1)) {
+        lua_pushfstring(L, "setProfilerEnabled: bad argument #1 type (enabled as boolean expected, got %s!)", luaL_typename(L, 1));
+        return lua_error(L);
+    }
+    Host& host = getHostFromLua(L);
+    host.getProfiler()->setEnabled(lua_toboolean(L, 1));
+    lua_pushboolean(L, true);
+    return 1;
+}
+
+int TLuaInterpreter::resetProfiler(lua_State* L)
+{
+    Host& host = getHostFromLua(L);
+    host.getProfiler()->reset();
+    lua_pushboolean(L, true);
+    return 1;
+}
+
+// Returns an array of tables, one per profiled item, with the most expensive
+// (by default) first - times are in milliseconds:
+int TLuaInterpreter::getProfilerStatistics(lua_State* L)
+{
+    TProfiler::SortKey sortKey = TProfiler::SortByTotalTime;
+    int count = -1;
+    if (!getProfilerArguments(L, "getProfilerStatistics", sortKey, count)) {
+        return lua_error(L);
+    }
+
+    Host& host = getHostFromLua(L);
+    const QList<TProfiler::Record> records = host.getProfiler()->records(sortKey, count);
+    lua_newtable(L);
+    int index = 0;
+    for (auto& record : records) {
+        lua_pushnumber(L, ++index);
+        lua_newtable(L);
+        lua_pushstring(L, "type");
+        lua_pushstring(L, TProfiler::itemTypeName(record.type).toUtf8().constData());
+        lua_settable(L, -3);
+        lua_pushstring(L, "id");
+        lua_pushnumber(L, record.id);
+        lua_settable(L, -3);
+        lua_pushstring(L, "name");
+        lua_pushstring(L, record.name.toUtf8().constData());
+        lua_settable(L, -3);
+        lua_pushstring(L, "attempts");
+        lua_pushnumber(L, record.matchAttempts);
+        lua_settable(L, -3);
+        lua_pushstring(L, "hits");
+        lua_pushnumber(L, record.hits);
+        lua_settable(L, -3);
+        lua_pushstring(L, "executions");
+        lua_pushnumber(L, record.executions);
+        lua_settable(L, -3);
+        lua_pushstring(L, "matchTime");
+        lua_pushnumber(L, record.matchTime / 1.0e6);
+        lua_settable(L, -3);
+        lua_pushstring(L, "luaTime");
+        lua_pushnumber(L, record.luaTime / 1.0e6);
+        lua_settable(L, -3);
+        lua_pushstring(L, "totalTime");
+        lua_pushnumber(L, record.totalTime() / 1.0e6);
+        lua_settable(L, -3);
+        lua_settable(L, -3);
+    }
+    return 1;
+}
+
+int TLuaInterpreter::getProfilerReport(lua_State* L)
+{
+    TProfiler::SortKey sortKey = TProfiler::SortByTotalTime;
+    int count = 20;
+    if (!getProfilerArguments(L, "getProfilerReport", sortKey, count)) {
+        return lua_error(L);
+    }
+
+    Host& host = getHostFromLua(L);
+    lua_pushstring(L, host.getProfiler()->report(sortKey, count).toUtf8().constData());
+    return 1;
+}
+
 static int host_key = 0;
 
 static void storeHostInLua(lua_State* L, Host* h)
@@ -24,6 +24,7 @@
  ***************************************************************************/
 
 #include "pre_guard.h"
+#include <QHash>
 #include <QMutex>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -73,9 +74,7 @@ class TLuaInterpreter : public QThread
 public:
     TLuaInterpreter(Host* mpHost, int id);
     ~TLuaInterpreter();
-    void setMSDPTable(QString& key, const QString& string_data);
-    void parseJSON(QString& key, const QString& string_data, const QString& protocol);
-    void msdp2Lua(char* src, int srclen);
+    void msdp2Lua(const QByteArray&);
     void initLuaGlobals();
     bool call(const QString& function, const QString& mName);
     bool callMulti(const QString& function, const QString& mName);
@@ -85,7 +84,7 @@ public:
     bool compile(const QString& code, QString& error, const QString& name);
     bool compileScript(const QString&);
     void setAtcpTable(const QString&, const QString&);
-    void setGMCPTable(QString&, const QString&);
+    void setGMCPTable(const QString&, const QByteArray&);
     void setChannel102Table(int& var, int& arg);
     bool compileAndExecuteScript(const QString&);
     void loadGlobal();
@@ -364,6 +363,8 @@ public:
     static int getTime(lua_State*);
     static int invokeFileDialog(lua_State*);
     static int getTimestamp(lua_State*);
+    static int getTimestampMillis(lua_State*);
+    static int getCurrentMillis(lua_State*);
     static int setLink(lua_State*);
     static int echoLink(lua_State*);
     static int insertLink(lua_State*);
@@ -410,6 +411,12 @@ public:
     static int getServerEncoding(lua_State *);
     static int getServerEncodingsList(lua_State *);
     static int alert(lua_State* L);
+    static int setProfilerEnabled(lua_State* L);
+    static int resetProfiler(lua_State* L);
+    static int getProfilerStatistics(lua_State* L);
+    static int getProfilerReport(lua_State* L);
+    static int getPaths(lua_State*);
+    static int getRoomsWithinCost(lua_State*);
 #ifdef QT_TTS_LIB
 	static int ttsSpeak(lua_State* L);
 	static int ttsStopSpeech(lua_State* L);
@@ -443,10 +450,16 @@ private:
     std::list<std::list<std::string>> mMultiCaptureGroupList;
     std::list<std::list<int>> mMultiCaptureGroupPosList;
     void logError(std::string& e, const QString&, const QString& function);
+    bool pushEventHandler(const QString& function);
+    void setProtocolTable(const QString& protocol, const QString& key);
+    void raiseProtocolEvents(const QString& protocol, const QString& key);
 
     QMap<QNetworkReply*, QString> downloadMap;
 
     lua_State* pGlobalLua;
+    // Registry references to the compiled "return <function>" chunks that
+    // look up event handlers, keyed by the handler's name:
+    QHash<QString, int> mEventHandlerLookups;
 
     QPointer<Host> mpHost;
     int mHostID;
@@ -47,6 +47,64 @@
 #include "post_guard.h"
 
 
+// Indexed (version 19+) map files have a fixed size header straight after the
+// version number, so that the tables of where the rooms are can be found, and
+// so that it can be filled in once the rest of the file has been written:
+static void writeIndexedMapHeader(QDataStream& ofs, int roomCount, int areaCount, qint64 areaTableOffset, qint64 roomTableOffset)
+{
+    ofs << static_cast<qint32>(roomCount);
+    ofs << static_cast<qint32>(areaCount);
+    ofs << areaTableOffset;
+    ofs << roomTableOffset;
+}
+
+static void readIndexedMapHeader(QDataStream& ifs, int& roomCount, int& areaCount, qint64& areaTableOffset, qint64& roomTableOffset)
+{
+    qint32 value;
+    ifs >> value;
+    roomCount = value;
+    ifs >> value;
+    areaCount = value;
+    ifs >> areaTableOffset;
+    ifs >> roomTableOffset;
+}
+
+static void serializeRoom(QDataStream& ofs, TRoom* pR)
+{
+    ofs << pR->getId();
+    ofs << pR->getArea();
+    ofs << pR->x;
+    ofs << pR->y;
+    ofs << pR->z;
+    ofs << pR->getNorth();
+    ofs << pR->getNortheast();
+    ofs << pR->getEast();
+    ofs << pR->getSoutheast();
+    ofs << pR->getSouth();
+    ofs << pR->getSouthwest();
+    ofs << pR->getWest();
+    ofs << pR->getNorthwest();
+    ofs << pR->getUp();
+    ofs << pR->getDown();
+    ofs << pR->getIn();
+    ofs << pR->getOut();
+    ofs << pR->environment;
+    ofs << pR->getWeight();
+    ofs << pR->name;
+    ofs << pR->isLocked;
+    ofs << pR->getOtherMap();
+    ofs << pR->c;
+    ofs << pR->userData;
+    ofs << pR->customLines;
+    ofs << pR->customLinesArrow;
+    ofs << pR->customLinesColor;
+    ofs << pR->customLinesStyle;
+    ofs << pR->exitLocks;
+    ofs << pR->exitStubs;
+    ofs << pR->getExitWeights();
+    ofs << pR->doors;
+}
+
 TMap::TMap(Host* pH)
 : mpRoomDB(new TRoomDB(this))
 , mpHost(pH)
@@ -64,9 +122,11 @@ TMap::TMap(Host* pH)
 , mDefaultVersion(18)
 // maximum version of the map format that this Mudlet can understand and will
 // allow the user to load
-, mMaxVersion(18)
+, mMaxVersion(19)
 // minimum version this instance of Mudlet will allow the user to save maps in
 , mMinVersion(16)
+, mDeadGraphVertexCount(0)
+, mMapDataRevision(0)
 , mIsFileViewingRecommended(false)
 , mpNetworkAccessManager(Q_NULLPTR)
 , mpProgressDialog(Q_NULLPTR)
@@ -145,6 +205,7 @@ TMap::~TMap()
 void TMap::mapClear()
 {
     mpRoomDB->clearMapDB();
+    setMapDataChanged();
     envColors.clear();
     mRoomIdHash.clear();
     mTargetID = 0;
@@ -236,7 +297,8 @@ bool TMap::setRoomArea(int id, int area, bool isToDeferAreaRelatedRecalculations
 
     bool result = pR->setArea(area, isToDeferAreaRelatedRecalculations);
     if (result) {
-        mMapGraphNeedsUpdate = true;
+        // The route finding heuristic uses the area:
+        setRoomNeedsGraphUpdate(id);
     }
     return result;
 }
@@ -245,7 +307,7 @@ bool TMap::addRoom(int id)
 {
     bool ret = mpRoomDB->addRoom(id);
     if (ret) {
-        mMapGraphNeedsUpdate = true;
+        setRoomNeedsGraphUpdate(id);
     }
     return ret;
 }
@@ -260,6 +322,12 @@ bool TMap::setRoomCoordinates(int id, int x, int y, int z)
     pR->x = x;
     pR->y = y;
     pR->z = z;
+    TArea* pA = mpRoomDB->getArea(pR->getArea());
+    if (pA) {
+        pA->updateRoomPosition(id);
+    }
+    // The route finding heuristic uses the position:
+    setRoomNeedsGraphUpdate(id);
 
     return true;
 }
@@ -424,7 +492,7 @@ bool TMap::setExit(int from, int to, int dir)
         ret = false;
     }
     pR->setExitStub(dir, false);
-    mMapGraphNeedsUpdate = true;
+    setRoomNeedsGraphUpdate(from);
     TArea* pA = mpRoomDB->getArea(pR->getArea());
     if (!pA) {
         return false;
@@ -492,7 +560,15 @@ void TMap::audit()
         }
     }
 
-    mpRoomDB->auditRooms(roomRemapping, areaRemapping);
+    // The rooms in an indexed (version 19+) map file were audited before it was
+    // saved, so they are left in it until they are needed rather than all
+    // being read in here just to be checked again:
+    if (!mpRoomDB->hasUnloadedAreas()) {
+        mpRoomDB->auditRooms(roomRemapping, areaRemapping);
+    }
+    // Rooms may have been renumbered or had their exits fixed up:
+    mMapGraphNeedsUpdate = true;
+    setMapDataChanged();
 
     // The second half of old mpRoomDB->initAreasForOldMaps() - needed to fixup
     // all the (TArea *)->areaExits() that were built wrongly previously,
@@ -501,6 +577,9 @@ void TMap::audit()
     QMapIterator<int, TArea*> itArea(mpRoomDB->getAreaMap());
     while (itArea.hasNext()) {
         itArea.next();
+        if (mpRoomDB->isAreaUnloaded(itArea.key())) {
+            continue; // Keeps the exits and span that were saved for it
+        }
         itArea.value()->determineAreaExits();
         itArea.value()->calcSpan();
         itArea.value()->mIsDirty = false;
@@ -539,28 +618,12 @@ QList<int> TMap::detectRoomCollisions(int id)
     if (!pR) {
         return collList;
     }
-    int area = pR->getArea();
-    int x = pR->x;
-    int y = pR->y;
-    int z = pR->z;
-    TArea* pA = mpRoomDB->getArea(area);
+    TArea* pA = mpRoomDB->getArea(pR->getArea());
     if (!pA) {
         return collList;
     }
 
-    QSetIterator<int> itRoom(pA->getAreaRooms());
-    while (itRoom.hasNext()) {
-        int checkRoomId = itRoom.next();
-        pR = mpRoomDB->getRoom(checkRoomId);
-        if (!pR) {
-            continue;
-        }
-        if (pR->x == x && pR->y == y && pR->z == z) {
-            collList.push_back(checkRoomId);
-        }
-    }
-
-    return collList;
+    return pA->getRoomsByPosition(pR->x, pR->y, pR->z);
 }
 
 // Not used:
@@ -607,19 +670,18 @@ void TMap::initGraph()
     _time.start();
     locations.clear();
     roomidToIndex.clear();
-    g.clear();
-    g = mygraph_t();
+    edgeHash.clear();
+    mRoomsNeedingGraphUpdate.clear();
+    mDeadGraphVertexCount = 0;
     unsigned int roomCount = 0;
     unsigned int edgeCount = 0;
-    QSet<unsigned int> unUsableRoomSet;
-    // Keep track of the unusuable rather than the useable ones because that is
-    // hopefully a MUCH smaller set in normal situations!
+    unsigned int unUsableRoomCount = 0;
     QHashIterator<int, TRoom*> itRoom = mpRoomDB->getRoomMap();
     while (itRoom.hasNext()) {
         itRoom.next();
         TRoom* pR = itRoom.value();
         if (itRoom.key() < 1 || !pR || pR->isLocked) {
-            unUsableRoomSet.insert(itRoom.key());
+            ++unUsableRoomCount;
             continue;
         }
 
@@ -632,240 +694,226 @@ void TMap::initGraph()
         roomidToIndex.insert(itRoom.key(), roomCount++);
     }
 
+    // Give every location a vertex, even those that no edges lead to, so that
+    // vertices added later keep in step with locations:
+    mRouter.clear();
+    for (const location& l : locations) {
+        mRouter.addVertex(l.pR);
+    }
+
     // Now identify the routes between rooms, and pick out the best edges of parallel ones
-    foreach (location l, locations) {
-        unsigned int source = l.id;
-        TRoom* pSourceR = l.pR;
-        QHash<unsigned int, route> bestRoutes;
-        // key is target (destination room),
-        // value is data we will need to store later,
-        QMap<QString, int> exitWeights = pSourceR->getExitWeights();
-
-        int target = pSourceR->getNorth();
-        TRoom* pTargetR;
-        quint8 direction = DIR_NORTH;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            // In above tests the second test is to eliminate self-edges (they
-            // are of no use).  The third test is to eliminate targets that we
-            // have already found to be unreachable because they are invalid or
-            // locked.
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) { // OK got something that is valid
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("n"), pTargetR->getWeight());
-                r.direction = direction;
-                bestRoutes.insert(target, r);
-            }
-        }
+    for (const location& l : locations) {
+        edgeCount += addGraphEdges(l.id, l.pR);
+    }
+    mRouter.compact();
 
-        target = pSourceR->getEast();
-        direction = DIR_EAST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("e"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) { // Ah, this is a better route
-                    r.direction = direction;
-                    bestRoutes.insert(target, r); // If the second part of conditional is the truth this will replace previous best route to this target
-                }
-            }
-        }
+    mMapGraphNeedsUpdate = false;
+    qDebug() << "TMap::initGraph() INFO: built graph with:" << locations.size() << "(" << roomCount << ") locations(roomCount), and discarded" << unUsableRoomCount
+             << "other NOT useable rooms and found:" << edgeCount << "distinct, usable edges in:" << _time.nsecsElapsed() * 1.0e-9 << "seconds.";
+}
 
-        target = pSourceR->getSouth();
-        direction = DIR_SOUTH;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("s"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+void TMap::setRoomNeedsGraphUpdate(const int roomId)
+{
+    setMapDataChanged();
+    // No need to keep track if the whole graph is to be rebuilt anyway:
+    if (!mMapGraphNeedsUpdate) {
+        mRoomsNeedingGraphUpdate.insert(roomId);
+    }
+}
 
-        target = pSourceR->getWest();
-        direction = DIR_WEST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("w"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+// Brings the graph up to date by redoing only the parts of it for the rooms
+// that have changed (and those with exits into them, as the weight of the
+// room an exit leads to is the default cost of it); the whole thing is only
+// rebuilt when asked for or when enough has changed, which also drops the
+// vertices of rooms that have gone from it:
+void TMap::updateGraph()
+{
+    const int locationCount = static_cast<int>(locations.size());
+    if (mMapGraphNeedsUpdate || mDeadGraphVertexCount * 4 > locationCount || mRoomsNeedingGraphUpdate.size() * 4 > locationCount) {
+        initGraph();
+        return;
+    }
 
-        target = pSourceR->getUp();
-        direction = DIR_UP;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("up"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+    if (mRoomsNeedingGraphUpdate.isEmpty()) {
+        return;
+    }
 
-        target = pSourceR->getDown();
-        direction = DIR_DOWN;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("down"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
+    QElapsedTimer _time;
+    _time.start();
+    // First sort out which rooms are in the graph, collecting those that
+    // will need their edges redone:
+    QSet<int> edgeUpdateSet;
+    for (int roomId : mRoomsNeedingGraphUpdate) {
+        TRoom* pR = mpRoomDB->getRoom(roomId);
+        const bool isUsable = roomId > 0 && pR && !pR->isLocked;
+        if (roomidToIndex.contains(roomId)) {
+            edgeUpdateSet.unite(mpRoomDB->getEntrances(roomId));
+            if (!isUsable) {
+                removeGraphVertex(roomId);
+                continue;
             }
+            // In case the room has been replaced by another with the same Id,
+            // or moved:
+            locations[roomidToIndex.value(roomId)].pR = pR;
+            mRouter.setPosition(roomidToIndex.value(roomId), pR);
+        } else if (isUsable) {
+            addGraphVertex(roomId, pR);
+            edgeUpdateSet.unite(mpRoomDB->getEntrances(roomId));
+        } else {
+            continue;
         }
+        edgeUpdateSet.insert(roomId);
+    }
+    mRoomsNeedingGraphUpdate.clear();
 
-        target = pSourceR->getNortheast();
-        direction = DIR_NORTHEAST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("ne"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
+    for (int roomId : edgeUpdateSet) {
+        if (roomidToIndex.contains(roomId)) {
+            updateGraphEdges(roomId);
         }
+    }
+    // The search is quickest with all the edges in the compact arrays but it
+    // is not worth redoing them for every little change:
+    if (mRouter.pendingCount() * 8 > mRouter.vertexCount()) {
+        mRouter.compact();
+    }
 
-        target = pSourceR->getSoutheast();
-        direction = DIR_SOUTHEAST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("se"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+    qDebug() << "TMap::updateGraph() INFO: redid the edges of:" << edgeUpdateSet.size() << "rooms in:" << _time.nsecsElapsed() * 1.0e-9 << "seconds.";
+}
 
-        target = pSourceR->getSouthwest();
-        direction = DIR_SOUTHWEST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("sw"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+void TMap::addGraphVertex(const int roomId, TRoom* pR)
+{
+    location l;
+    l.pR = pR;
+    l.id = roomId;
+    locations.push_back(l);
+    roomidToIndex.insert(roomId, mRouter.addVertex(pR));
+}
 
-        target = pSourceR->getNorthwest();
-        direction = DIR_NORTHWEST;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("nw"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
-        }
+void TMap::removeGraphVertex(const int roomId)
+{
+    const quint32 v = roomidToIndex.take(roomId);
+    // The router's edges into it go when the rooms they come from (which
+    // updateGraph() has lined up) have their edges redone:
+    for (int sourceRoomId : mpRoomDB->getEntrances(roomId)) {
+        edgeHash.remove(qMakePair(static_cast<unsigned int>(sourceRoomId), static_cast<unsigned int>(roomId)));
+    }
+    for (const TMapRouter::Edge& edge : mRouter.edges(v)) {
+        edgeHash.remove(qMakePair(static_cast<unsigned int>(roomId), static_cast<unsigned int>(locations.at(edge.target).id)));
+    }
+    mRouter.setEdges(v, std::vector<TMapRouter::Edge>());
+    // The room may already have been deleted so do not keep a pointer to it:
+    locations[v].id = 0;
+    locations[v].pR = Q_NULLPTR;
+    mRouter.setPosition(v, Q_NULLPTR);
+    ++mDeadGraphVertexCount;
+}
 
-        target = pSourceR->getIn();
-        direction = DIR_IN;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("in"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
+void TMap::updateGraphEdges(const int roomId)
+{
+    const quint32 v = roomidToIndex.value(roomId);
+    // An edge may lead to a room that has since gone from the graph, its
+    // location no longer has an id to look for:
+    for (const TMapRouter::Edge& edge : mRouter.edges(v)) {
+        if (locations.at(edge.target).id) {
+            edgeHash.remove(qMakePair(static_cast<unsigned int>(roomId), static_cast<unsigned int>(locations.at(edge.target).id)));
         }
+    }
+    addGraphEdges(roomId, locations.at(v).pR);
+}
 
-        target = pSourceR->getOut();
-        direction = DIR_OUT;
-        if (target > 0 && source != target && !unUsableRoomSet.contains(target) && !pSourceR->hasExitLock(direction)) {
-            pTargetR = mpRoomDB->getRoom(target);
-            if (pTargetR && !pTargetR->isLocked) {
-                route r;
-                r.cost = exitWeights.value(QStringLiteral("out"), pTargetR->getWeight());
-                if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                    r.direction = direction;
-                    bestRoutes.insert(target, r);
-                }
-            }
+// Adds the edges for the exits out of a room that is in the graph to the
+// other rooms in it, returns how many there were:
+int TMap::addGraphEdges(const int roomId, TRoom* pSourceR)
+{
+    // In this order so that, of two parallel exits with the same cost, the
+    // same one is used as has always been:
+    static const quint8 directions[] = {DIR_NORTH, DIR_EAST, DIR_SOUTH, DIR_WEST, DIR_UP, DIR_DOWN, DIR_NORTHEAST, DIR_SOUTHEAST, DIR_SOUTHWEST, DIR_NORTHWEST, DIR_IN, DIR_OUT};
+    static const QString exitWeightKeys[] = {QStringLiteral("n"),
+                                             QStringLiteral("e"),
+                                             QStringLiteral("s"),
+                                             QStringLiteral("w"),
+                                             QStringLiteral("up"),
+                                             QStringLiteral("down"),
+                                             QStringLiteral("ne"),
+                                             QStringLiteral("se"),
+                                             QStringLiteral("sw"),
+                                             QStringLiteral("nw"),
+                                             QStringLiteral("in"),
+                                             QStringLiteral("out")};
+
+    QHash<unsigned int, route> bestRoutes;
+    // key is target (destination room),
+    // value is data we will need to store later,
+    const QMap<QString, int>& exitWeights = pSourceR->getExitWeights();
+
+    for (int i = 0; i < 12; ++i) {
+        const quint8 direction = directions[i];
+        const int targetRoomId = pSourceR->getExit(direction);
+        // Self-edges are of no use and only rooms that are in the graph can
+        // be reached - which rules out invalid and locked ones:
+        if (targetRoomId < 1 || targetRoomId == roomId || pSourceR->hasExitLock(direction) || !roomidToIndex.contains(targetRoomId)) {
+            continue;
         }
+        TRoom* pTargetR = mpRoomDB->getRoom(targetRoomId);
+        if (!pTargetR) {
+            continue;
+        }
+        route r;
+        r.cost = exitWeights.value(exitWeightKeys[i], pTargetR->getWeight());
+        if (!bestRoutes.contains(targetRoomId) || bestRoutes.value(targetRoomId).cost > r.cost) { // Ah, this is a better route
+            r.direction = direction;
+            bestRoutes.insert(targetRoomId, r); // If the second part of conditional is the truth this will replace previous best route to this target
+        }
+    }
 
-        QMapIterator<int, QString> itSpecialExit(pSourceR->getOtherMap());
-        while (itSpecialExit.hasNext()) {
-            itSpecialExit.next();
-            if ((itSpecialExit.value()).startsWith(QStringLiteral("1"))) {
-                continue; // Is a locked exit so forget it...
-            }
-
-            target = itSpecialExit.key();
-            direction = DIR_OTHER;
-            if (target > 0 && source != target && !unUsableRoomSet.contains(target)) {
-                pTargetR = mpRoomDB->getRoom(target);
-                if (pTargetR && !pTargetR->isLocked) {
-                    route r;
-                    if (Q_LIKELY((itSpecialExit.value()).startsWith(QStringLiteral("0")))) {
-                        r.specialExitName = itSpecialExit.value().mid(1);
-                    } else {
-                        r.specialExitName = itSpecialExit.value();
-                    }
-                    r.cost = exitWeights.value(r.specialExitName, pTargetR->getWeight());
-                    if (!bestRoutes.contains(target) || bestRoutes.value(target).cost > r.cost) {
-                        r.direction = direction;
-                        bestRoutes.insert(target, r);
-                    }
-                }
-            }
-        } // End of while(itSpecialExit.hasNext())
-
-        // Now we have eliminated possibe duplicate and useless edges we can create and
-        // insert the remainder into the BGL graph:
-        QHashIterator<unsigned int, route> itRoute = bestRoutes;
-        while (itRoute.hasNext()) {
-            itRoute.next();
-            edge_descriptor e;
-            bool inserted; // This is always going to be false as it gets set if
-                           // we had tried to insert a parallel edge into a graph
-                           // that does not support them - but we've just been
-                           // and disposed of those already!
-            tie(e, inserted) = add_edge(roomidToIndex.value(source), roomidToIndex.value(itRoute.key()), itRoute.value().cost, g);
-            edgeHash.insert(qMakePair(source, itRoute.key()), itRoute.value());
-            // The key is made from the QPair<edgeSourceRoomId, edgeTargetRoomId>...
-            edgeCount++;
-        }
-    } // End of foreach(location l, locations)
+    QMapIterator<int, QString> itSpecialExit(pSourceR->getOtherMap());
+    while (itSpecialExit.hasNext()) {
+        itSpecialExit.next();
+        if ((itSpecialExit.value()).startsWith(QStringLiteral("1"))) {
+            continue; // Is a locked exit so forget it...
+        }
 
-    mMapGraphNeedsUpdate = false;
-    qDebug() << "TMap::initGraph() INFO: built graph with:" << locations.size() << "(" << roomCount << ") locations(roomCount), and discarded" << unUsableRoomSet.count()
-             << "other NOT useable rooms and found:" << edgeCount << "distinct, usable edges in:" << _time.nsecsElapsed() * 1.0e-9 << "seconds.";
+        const int targetRoomId = itSpecialExit.key();
+        if (targetRoomId < 1 || targetRoomId == roomId || !roomidToIndex.contains(targetRoomId)) {
+            continue;
+        }
+        TRoom* pTargetR = mpRoomDB->getRoom(targetRoomId);
+        if (!pTargetR) {
+            continue;
+        }
+        route r;
+        if (Q_LIKELY((itSpecialExit.value()).startsWith(QStringLiteral("0")))) {
+            r.specialExitName = itSpecialExit.value().mid(1);
+        } else {
+            r.specialExitName = itSpecialExit.value();
+        }
+        r.cost = exitWeights.value(r.specialExitName, pTargetR->getWeight());
+        if (!bestRoutes.contains(targetRoomId) || bestRoutes.value(targetRoomId).cost > r.cost) {
+            r.direction = DIR_OTHER;
+            bestRoutes.insert(targetRoomId, r);
+        }
+    } // End of while(itSpecialExit.hasNext())
+
+    // Now we have eliminated possibe duplicate and useless edges we can create and
+    // insert the remainder into the graph:
+    const quint32 sourceVertex = roomidToIndex.value(roomId);
+    std::vector<TMapRouter::Edge> routerEdges;
+    routerEdges.reserve(bestRoutes.size());
+    QHashIterator<unsigned int, route> itRoute = bestRoutes;
+    while (itRoute.hasNext()) {
+        itRoute.next();
+        const quint32 targetVertex = roomidToIndex.value(itRoute.key());
+        routerEdges.emplace_back(targetVertex, itRoute.value().cost);
+        // The key is made from the QPair<edgeSourceRoomId, edgeTargetRoomId>...
+        edgeHash.insert(qMakePair(static_cast<unsigned int>(roomId), itRoute.key()), itRoute.value());
+    }
+    mRouter.setEdges(sourceVertex, std::move(routerEdges));
+    return bestRoutes.size();
 }
 
 bool TMap::findPath(int from, int to)
 {
-    if (mMapGraphNeedsUpdate) {
-        initGraph();
-    }
+    updateGraph();
 
     QElapsedTimer t;
     t.start();
@@ -945,87 +993,125 @@ bool TMap::findPath(int from, int to)
     if (!roomidToIndex.contains(from)) {
         qDebug() << "TMap::findPath(" << from << "," << to << ") FAIL: start room not in map graph!";
         return false;
-        // The start room is NOT one that has been included in the BGL graph
+        // The start room is NOT one that has been included in the graph
         // probably because it is locked - so no route finding can be done
     }
-    vertex start = roomidToIndex.value(from);
+    quint32 start = roomidToIndex.value(from);
 
     if (!roomidToIndex.contains(to)) {
         qDebug() << "TMap::findPath(" << from << "," << to << ") FAIL: target room not in map graph!";
         return false;
-        // The target room is NOT one that has been included in the BGL graph
+        // The target room is NOT one that has been included in the graph
         // probably because it is locked - so no route finding can be done
     }
-    vertex goal = roomidToIndex.value(to);
-
-    std::vector<vertex> p(num_vertices(g));
-    // Somehow p is an acending, monotonic series of numbers start at 0, it
-    // seems we have a redundent indirection in play there as p[0]=0, p[1]=1,..., p[n]=n ...!
-    std::vector<cost> d(num_vertices(g));
-    try {
-        astar_search(g, start, distance_heuristic<mygraph_t, cost, std::vector<location>>(locations, goal), predecessor_map(&p[0]).distance_map(&d[0]).visitor(astar_goal_visitor<vertex>(goal)));
-    } catch (found_goal) {
-        qDebug() << "TMap::findPath(" << from << "," << to << ") INFO: time elapsed in A*:" << t.nsecsElapsed() * 1.0e-9 << "seconds.";
-        t.restart();
-        if (!roomidToIndex.contains(to)) {
-            qDebug() << "TMap::findPath(" << from << "," << to << ") FAIL: target room not in map graph!";
-            return false;
+    quint32 goal = roomidToIndex.value(to);
+
+    if (!mRouter.findPath(start, goal, mPathVertices)) {
+        qDebug() << "TMap::findPath(" << from << "," << to << ") INFO: did NOT find path in:" << t.nsecsElapsed() * 1.0e-9 << "seconds.";
+        return false;
+    }
+
+    // Step through the found path, each pair of vertices in it being the
+    // SOURCE and TARGET of an edge:
+    for (std::size_t i = 1, total = mPathVertices.size(); i < total; ++i) {
+        unsigned int previousRoomId = (locations.at(mPathVertices[i - 1])).id;
+        unsigned int currentRoomId = (locations.at(mPathVertices[i])).id;
+        QPair<unsigned int, unsigned int> edgeRoomIdPair = qMakePair(previousRoomId, currentRoomId);
+        route r = edgeHash.value(edgeRoomIdPair);
+        Q_ASSERT_X(r.cost > 0, "TMap::findPath()", "broken path {QPair made from source and target roomIds for a path step NOT found in QHash table of all possible steps.}");
+        mPathList.append(currentRoomId);
+        mWeightList.append( r.cost );
+        mDirList.append(getRouteCommand(r));
+        if (r.direction < DIR_NORTH || r.direction > DIR_OTHER) {
+            qWarning() << "TMap::findPath(" << from << "," << to << ") WARN: found route between rooms (from id:" << previousRoomId << ", to id:" << currentRoomId << ") with an invalid DIR_xxxx code:" << r.direction << " - the path will not be valid!" ;
         }
+    }
 
-        vertex currentVertex = roomidToIndex.value(to);
-        unsigned int currentRoomId = (locations.at(currentVertex)).id;
+    // No INFO message on success, scripts may call this in a loop and the
+    // output would cost more than the search...
+    return true;
+}
 
-        // We step through the found path BACKWARDS so advance (well retard)
-        // the "previous" one first, and it will be the SOURCE vertex for the
-        // edge and current will be the TARGET vertex:
-        vertex previousVertex = currentVertex;
-        do {
-            previousVertex = p[currentVertex];
-            if (previousVertex == currentVertex) {
-                qDebug() << "TMap::findPath(" << from << "," << to << ") WARN: unable to build a path in:" << t.nsecsElapsed() * 1.0e-9 << "seconds.";
-                mPathList.clear();
-                mDirList.clear();
-                mWeightList.clear(); // Reset any partial results...
-                return false;
-            }
-            unsigned int previousRoomId = (locations.at(previousVertex)).id;
-            QPair<unsigned int, unsigned int> edgeRoomIdPair = qMakePair(previousRoomId, currentRoomId);
-            route r = edgeHash.value(edgeRoomIdPair);
-            mPathList.prepend(currentRoomId);
-            Q_ASSERT_X(r.cost > 0, "TMap::findPath()", "broken path {QPair made from source and target roomIds for a path step NOT found in QHash table of all possible steps.}");
-            // Above was found to be triggered by the situation described in:
-            // https://bugs.launchpad.net/mudlet/+bug/1263447 on 2015-07-17 but
-            // this is because previousVertex was the same as currentVertex after
-            // the "previousVertex = p[currentVertex]" operation at the start of
-            // the do{} loop - added a test for this so should bail out if it
-            // happens - Slysven
-            mWeightList.prepend( r.cost );
-            switch( r.direction ) {  // TODO: Eventually this can instead drop in I18ned values set by country or user preference!
-            case DIR_NORTH:        mDirList.prepend( tr( "n", "This translation converts the direction that DIR_NORTH codes for to a direction string that the MUD server will accept!" ) );      break;
-            case DIR_NORTHEAST:    mDirList.prepend( tr( "ne", "This translation converts the direction that DIR_NORTHEAST codes for to a direction string that the MUD server will accept!" ) ); break;
-            case DIR_EAST:         mDirList.prepend( tr( "e", "This translation converts the direction that DIR_EAST codes for to a direction string that the MUD server will accept!" ) );       break;
-            case DIR_SOUTHEAST:    mDirList.prepend( tr( "se", "This translation converts the direction that DIR_SOUTHEAST codes for to a direction string that the MUD server will accept!" ) ); break;
-            case DIR_SOUTH:        mDirList.prepend( tr( "s", "This translation converts the direction that DIR_SOUTH codes for to a direction string that the MUD server will accept!" ) );      break;
-            case DIR_SOUTHWEST:    mDirList.prepend( tr( "sw", "This translation converts the direction that DIR_SOUTHWEST codes for to a direction string that the MUD server will accept!" ) ); break;
-            case DIR_WEST:         mDirList.prepend( tr( "w", "This translation converts the direction that DIR_WEST codes for to a direction string that the MUD server will accept!" ) );       break;
-            case DIR_NORTHWEST:    mDirList.prepend( tr( "nw", "This translation converts the direction that DIR_NORTHWEST codes for to a direction string that the MUD server will accept!" ) ); break;
-            case DIR_UP:           mDirList.prepend( tr( "up", "This translation converts the direction that DIR_UP codes for to a direction string that the MUD server will accept!" ) );        break;
-            case DIR_DOWN:         mDirList.prepend( tr( "down", "This translation converts the direction that DIR_DOWN codes for to a direction string that the MUD server will accept!" ) );    break;
-            case DIR_IN:           mDirList.prepend( tr( "in", "This translation converts the direction that DIR_IN codes for to a direction string that the MUD server will accept!" ) );        break;
-            case DIR_OUT:          mDirList.prepend( tr( "out", "This translation converts the direction that DIR_OUT codes for to a direction string that the MUD server will accept!" ) );      break;
-            case DIR_OTHER:        mDirList.prepend( r.specialExitName );  break;
-            default:               qWarning() << "TMap::findPath(" << from << "," << to << ") WARN: found route between rooms (from id:" << previousRoomId << ", to id:" << currentRoomId << ") with an invalid DIR_xxxx code:" << r.direction << " - the path will not be valid!" ;
-            }
-            currentVertex = previousVertex;
-            currentRoomId = previousRoomId;
-        } while (currentVertex != start);
+// The command to send to the game server to take a step along a route:
+QString TMap::getRouteCommand(const route& r) const
+{
+    switch( r.direction ) {  // TODO: Eventually this can instead drop in I18ned values set by country or user preference!
+    case DIR_NORTH:        return tr( "n", "This translation converts the direction that DIR_NORTH codes for to a direction string that the MUD server will accept!" );
+    case DIR_NORTHEAST:    return tr( "ne", "This translation converts the direction that DIR_NORTHEAST codes for to a direction string that the MUD server will accept!" );
+    case DIR_EAST:         return tr( "e", "This translation converts the direction that DIR_EAST codes for to a direction string that the MUD server will accept!" );
+    case DIR_SOUTHEAST:    return tr( "se", "This translation converts the direction that DIR_SOUTHEAST codes for to a direction string that the MUD server will accept!" );
+    case DIR_SOUTH:        return tr( "s", "This translation converts the direction that DIR_SOUTH codes for to a direction string that the MUD server will accept!" );
+    case DIR_SOUTHWEST:    return tr( "sw", "This translation converts the direction that DIR_SOUTHWEST codes for to a direction string that the MUD server will accept!" );
+    case DIR_WEST:         return tr( "w", "This translation converts the direction that DIR_WEST codes for to a direction string that the MUD server will accept!" );
+    case DIR_NORTHWEST:    return tr( "nw", "This translation converts the direction that DIR_NORTHWEST codes for to a direction string that the MUD server will accept!" );
+    case DIR_UP:           return tr( "up", "This translation converts the direction that DIR_UP codes for to a direction string that the MUD server will accept!" );
+    case DIR_DOWN:         return tr( "down", "This translation converts the direction that DIR_DOWN codes for to a direction string that the MUD server will accept!" );
+    case DIR_IN:           return tr( "in", "This translation converts the direction that DIR_IN codes for to a direction string that the MUD server will accept!" );
+    case DIR_OUT:          return tr( "out", "This translation converts the direction that DIR_OUT codes for to a direction string that the MUD server will accept!" );
+    case DIR_OTHER:        return r.specialExitName;
+    default:               return QString();
+    }
+}
 
-        qDebug() << "TMap::findPath(" << from << "," << to << ") INFO: found path in:" << t.nsecsElapsed() * 1.0e-9 << "seconds.";
-        return true;
+// Like findPath() but to many rooms at once, for each of the targets that can
+// be reached gives the total weight of the best route there and the command
+// for the first step of it (none for the start room itself, which may be one
+// of them); returns false if the start room is not one that can be routed
+// from:
+bool TMap::findPaths(int from, const QList<int>& targets, QHash<int, float>& costs, QHash<int, QString>& firstMoves)
+{
+    updateGraph();
+    costs.clear();
+    firstMoves.clear();
+    if (!roomidToIndex.contains(from)) {
+        return false;
+    }
+
+    const quint32 start = roomidToIndex.value(from);
+    std::vector<quint32> targetVertices;
+    targetVertices.reserve(targets.size());
+    for (int target : targets) {
+        if (roomidToIndex.contains(target)) {
+            targetVertices.push_back(roomidToIndex.value(target));
+        }
     }
 
-    qDebug() << "TMap::findPath(" << from << "," << to << ") INFO: did NOT find path in:" << t.nsecsElapsed() * 1.0e-9 << "seconds.";
-    return false;
+    std::vector<quint32> reached;
+    std::vector<float> reachedCosts;
+    std::vector<quint32> firstSteps;
+    mRouter.findCosts(start, targetVertices, reached, reachedCosts, firstSteps);
+    costs.reserve(static_cast<int>(reached.size()));
+    firstMoves.reserve(static_cast<int>(reached.size()));
+    for (std::size_t i = 0, total = reached.size(); i < total; ++i) {
+        const int roomId = locations.at(reached[i]).id;
+        costs.insert(roomId, reachedCosts[i]);
+        if (firstSteps[i] == start) {
+            firstMoves.insert(roomId, QString());
+        } else {
+            firstMoves.insert(roomId, getRouteCommand(edgeHash.value(qMakePair(static_cast<unsigned int>(from), static_cast<unsigned int>(locations.at(firstSteps[i]).id)))));
+        }
+    }
+    return true;
+}
+
+// All the rooms, including the start one, that can be got to from it with a
+// total weight of no more than maxCost:
+bool TMap::findRoomsWithinCost(int from, float maxCost, QHash<int, float>& costs)
+{
+    updateGraph();
+    costs.clear();
+    if (!roomidToIndex.contains(from)) {
+        return false;
+    }
+
+    std::vector<quint32> reached;
+    std::vector<float> reachedCosts;
+    mRouter.findWithinCost(roomidToIndex.value(from), maxCost, reached, reachedCosts);
+    costs.reserve(static_cast<int>(reached.size()));
+    for (std::size_t i = 0, total = reached.size(); i < total; ++i) {
+        costs.insert(locations.at(reached[i]).id, reachedCosts[i]);
+    }
+    return true;
 }
 
 bool TMap::serialize(QDataStream& ofs)
@@ -1056,11 +1142,28 @@ bool TMap::serialize(QDataStream& ofs)
         postMessage(message);
     }
 
+    if (mSaveVersion >= 19 && (!ofs.device() || ofs.device()->isSequential())) {
+        QString message = tr("[ ERROR ] - Unable to save map in format {%1} as it has to be written to a file.").arg(mSaveVersion);
+        appendErrorMsgWithNoLf(message, false);
+        postMessage(message);
+        return false;
+    }
+
+    // Everything has to be read in from the file that it was loaded from first:
+    mpRoomDB->loadAllAreas();
+
     ofs << mSaveVersion;
+    qint64 headerPosition = 0;
+    if (mSaveVersion >= 19) {
+        headerPosition = ofs.device()->pos();
+        writeIndexedMapHeader(ofs, 0, 0, 0, 0);
+        // Kept in the header so the profile dialogue need not read further:
+        ofs << mRoomIdHash;
+    }
     ofs << envColors;
     ofs << mpRoomDB->getAreaNamesMap();
     ofs << customEnvColors;
-    ofs << mpRoomDB->hashTable;
+    ofs << mpRoomDB->getHashTable();
     if (mSaveVersion >= 17) {
         ofs << mUserData;
     }
@@ -1158,7 +1261,9 @@ bool TMap::serialize(QDataStream& ofs)
     }
     // End of TODO
 
-    if (mSaveVersion >= 18) {
+    if (mSaveVersion >= 19) {
+        // Already written in the header
+    } else if (mSaveVersion >= 18) {
         // Revised in version 18 to store mRoomId as a per profile case so that
         // sharing/copying between profiles respects each profile's player
         // location
@@ -1190,6 +1295,11 @@ bool TMap::serialize(QDataStream& ofs)
             ofs << label.showOnTop;
         }
     }
+
+    if (mSaveVersion >= 19) {
+        return serializeIndexedRooms(ofs, headerPosition);
+    }
+
     QHashIterator<int, TRoom*> it(mpRoomDB->getRoomMap());
     while (it.hasNext()) {
         it.next();
@@ -1199,42 +1309,67 @@ bool TMap::serialize(QDataStream& ofs)
             continue;
         }
 
-        ofs << pR->getId();
-        ofs << pR->getArea();
-        ofs << pR->x;
-        ofs << pR->y;
-        ofs << pR->z;
-        ofs << pR->getNorth();
-        ofs << pR->getNortheast();
-        ofs << pR->getEast();
-        ofs << pR->getSoutheast();
-        ofs << pR->getSouth();
-        ofs << pR->getSouthwest();
-        ofs << pR->getWest();
-        ofs << pR->getNorthwest();
-        ofs << pR->getUp();
-        ofs << pR->getDown();
-        ofs << pR->getIn();
-        ofs << pR->getOut();
-        ofs << pR->environment;
-        ofs << pR->getWeight();
-        ofs << pR->name;
-        ofs << pR->isLocked;
-        ofs << pR->getOtherMap();
-        ofs << pR->c;
-        ofs << pR->userData;
-        ofs << pR->customLines;
-        ofs << pR->customLinesArrow;
-        ofs << pR->customLinesColor;
-        ofs << pR->customLinesStyle;
-        ofs << pR->exitLocks;
-        ofs << pR->exitStubs;
-        ofs << pR->getExitWeights();
-        ofs << pR->doors;
+        serializeRoom(ofs, pR);
     }
     return true;
 }
 
+// Writes the rooms in a section for each area, followed by a table of those
+// sections and one of which area each room is in (sorted by room id so that it
+// can be searched where it is in the file) then goes back and fills in where
+// those tables are in the header:
+bool TMap::serializeIndexedRooms(QDataStream& ofs, qint64 headerPosition)
+{
+    QMap<int, QList<TRoom*>> areaRooms;
+    QHashIterator<int, TRoom*> itRoom(mpRoomDB->getRoomMap());
+    while (itRoom.hasNext()) {
+        itRoom.next();
+        TRoom* pR = itRoom.value();
+        if (!pR) {
+            qDebug() << "TMap::serializeIndexedRooms(...) skipping a room with a NULL TRoom pointer:" << itRoom.key();
+            continue;
+        }
+        areaRooms[pR->getArea()].append(pR);
+    }
+
+    QIODevice* pDevice = ofs.device();
+    QList<QPair<int, int>> roomAreas; // first is room id, second is area id
+    QList<QPair<int, QPair<qint64, qint64>>> sections; // first is area id, second is offset and length
+    QMapIterator<int, QList<TRoom*>> itArea(areaRooms);
+    while (itArea.hasNext()) {
+        itArea.next();
+        qint64 offset = pDevice->pos();
+        for (auto pR : itArea.value()) {
+            serializeRoom(ofs, pR);
+            roomAreas.append(qMakePair(pR->getId(), itArea.key()));
+        }
+        sections.append(qMakePair(itArea.key(), qMakePair(offset, pDevice->pos() - offset)));
+    }
+
+    qint64 areaTableOffset = pDevice->pos();
+    ofs << sections.size();
+    for (auto& section : sections) {
+        ofs << section.first;
+        ofs << areaRooms.value(section.first).size();
+        ofs << section.second.first;
+        ofs << section.second.second;
+    }
+
+    qint64 roomTableOffset = pDevice->pos();
+    std::sort(roomAreas.begin(), roomAreas.end());
+    for (auto& roomArea : roomAreas) {
+        ofs << static_cast<qint32>(roomArea.first);
+        ofs << static_cast<qint32>(roomArea.second);
+    }
+
+    qint64 endPosition = pDevice->pos();
+    if (!pDevice->seek(headerPosition)) {
+        return false;
+    }
+    writeIndexedMapHeader(ofs, roomAreas.size(), mpRoomDB->getAreaMap().size(), areaTableOffset, roomTableOffset);
+    return pDevice->seek(endPosition) && ofs.status() == QDataStream::Ok;
+}
+
 bool TMap::restore(QString location, bool downloadIfNotFound)
 {
     qDebug() << "TMap::restore(" << location << ") INFO: restoring map of Profile:" << mpHost->getName() << " URL:" << mpHost->getUrl();
@@ -1264,6 +1399,10 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
 
         QDataStream ifs(&file);
         ifs >> mVersion;
+        int indexedRoomCount = 0;
+        int indexedAreaCount = 0;
+        qint64 indexedAreaTableOffset = 0;
+        qint64 indexedRoomTableOffset = 0;
         if (mVersion > mMaxVersion) {
             QString errMsg = tr("[ ERROR ] - Map file is too new, it's file format (%1) is higher than this version of\n"
                                 "Mudlet can handle (%2)!  The file is:\n\"%3\".")
@@ -1301,6 +1440,11 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
             mSaveVersion = mVersion; // Make the save version the default one - unless the user intervenes
         }
 
+        if (mVersion >= 19) {
+            readIndexedMapHeader(ifs, indexedRoomCount, indexedAreaCount, indexedAreaTableOffset, indexedRoomTableOffset);
+            ifs >> mRoomIdHash;
+        }
+
         // As all but the room reading have version checks the fact that sub-4
         // files will still be parsed despite canRestore being false is probably OK
         if (mVersion >= 4) {
@@ -1311,7 +1455,7 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
             ifs >> customEnvColors;
         }
         if (mVersion >= 7) {
-            ifs >> mpRoomDB->hashTable;
+            mpRoomDB->restoreHashTable(ifs);
         }
         if (mVersion >= 17) {
             ifs >> mUserData;
@@ -1381,7 +1525,9 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
             }
         }
 
-        if (mVersion >= 18) {
+        if (mVersion >= 19) {
+            // Already read from the header
+        } else if (mVersion >= 18) {
             // In version 18 we changed to store the "userRoom" for each profile
             // so that when copied/shared between profiles they do not interfere
             // with each other's saved value
@@ -1432,12 +1578,20 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
             }
         }
 
-        while (!ifs.atEnd()) {
-            int i;
-            ifs >> i;
-            auto pT = new TRoom(mpRoomDB);
-            pT->restore(ifs, i, mVersion);
-            mpRoomDB->restoreSingleRoom(i, pT);
+        if (mVersion >= 19) {
+            // Only the tables of where the rooms are get read now, each area's
+            // rooms are read the first time one of them is wanted:
+            if (!mpRoomDB->restoreIndexedRooms(file.fileName(), ifs.version(), mVersion, indexedAreaTableOffset, indexedRoomTableOffset, indexedRoomCount)) {
+                canRestore = false;
+            }
+        } else {
+            while (!ifs.atEnd()) {
+                int i;
+                ifs >> i;
+                auto pT = new TRoom(mpRoomDB);
+                pT->restore(ifs, i, mVersion);
+                mpRoomDB->restoreSingleRoom(i, pT);
+            }
         }
 
         customEnvColors[257] = mpHost->mRed_2;
@@ -1486,6 +1640,7 @@ bool TMap::restore(QString location, bool downloadIfNotFound)
         }
     }
 
+    setMapDataChanged();
     return canRestore; //FIXME
 }
 
@@ -1566,6 +1721,28 @@ bool TMap::retrieveMapFileStats(QString profile, QString* latestFileName = 0, in
         }
     }
 
+    if (otherProfileVersion >= 19) {
+        // Everything wanted is in the header of indexed map files
+        int headerRoomCount;
+        int headerAreaCount;
+        qint64 areaTableOffset;
+        qint64 roomTableOffset;
+        readIndexedMapHeader(ifs, headerRoomCount, headerAreaCount, areaTableOffset, roomTableOffset);
+        QHash<QString, int> roomIdHash;
+        ifs >> roomIdHash;
+        file.close();
+        if (roomId) {
+            *roomId = roomIdHash.value(profile);
+        }
+        if (areaCount) {
+            *areaCount = headerAreaCount;
+        }
+        if (roomCount) {
+            *roomCount = headerRoomCount;
+        }
+        return true;
+    }
+
     if (otherProfileVersion >= 4) {
         // envColorMap
         QMap<int, int> _dummyQMapIntInt;
@@ -1775,6 +1952,7 @@ int TMap::createMapLabel(int area, QString text, float x, float y, float z, QCol
         }
     }
 
+    setMapDataChanged();
     if (mpMapper) {
         mpMapper->mp2dMap->update();
     }
@@ -1820,6 +1998,7 @@ int TMap::createMapImageLabel(int area, QString imagePath, float x, float y, flo
         }
     }
 
+    setMapDataChanged();
     if (mpMapper) {
         mpMapper->mp2dMap->update();
     }
@@ -1854,6 +2033,7 @@ void TMap::deleteMapLabel(int area, int labelID)
         return;
     }
     mapLabels[area].remove(labelID);
+    setMapDataChanged();
     if (mpMapper) {
         mpMapper->mp2dMap->update();
     }
@@ -24,6 +24,7 @@
 
 
 #include "TAstar.h"
+#include "TMapRouter.h"
 
 #include "pre_guard.h"
 #include <QApplication>
@@ -33,6 +34,7 @@
 #include <QNetworkReply>
 #include <QPixmap>
 #include <QPointer>
+#include <QSet>
 #include <QSizeF>
 #include <QVector3D>
 #include "post_guard.h"
@@ -105,6 +107,8 @@ public:
     void solveRoomCollision(int id, int creationDirection, bool PCheck = true);
     void setRoom(int);
     bool findPath(int from, int to);
+    bool findPaths(int from, const QList<int>& targets, QHash<int, float>& costs, QHash<int, QString>& firstMoves);
+    bool findRoomsWithinCost(int from, float maxCost, QHash<int, float>& costs);
     bool gotoRoom(int);
     bool gotoRoom(int, int);
     void setView(float, float, float, float);
@@ -112,6 +116,16 @@ public:
     bool restore(QString location, bool downloadIfNotFound = true);
     bool retrieveMapFileStats(QString, QString*, int*, int*, int*, int*);
     void initGraph();
+    // Notes that something the route finding graph is built from - the exits,
+    // exit locks and exit weights of the room, or its weight, lock, position
+    // or area - has changed, so that only that part of the graph is redone;
+    // all of those (bar the locks and weights) are drawn by the 2D map too so
+    // it is also noted as a change to the map data:
+    void setRoomNeedsGraphUpdate(int roomId);
+    // Counts the changes to anything that the 2D map draws, so that it knows
+    // when the parts of it that it keeps between paints have to be redone:
+    void setMapDataChanged() { ++mMapDataRevision; }
+    quint64 getMapDataRevision() const { return mMapDataRevision; }
     void connectExitStub(int roomId, int dirType);
     void postMessage(const QString text);
 
@@ -170,14 +184,9 @@ public:
 
     GLWidget* mpM;
     dlgMapper* mpMapper;
-    QMap<int, int> roomidToIndex;
-
-    typedef boost::adjacency_list<boost::listS, boost::vecS, boost::directedS, boost::no_property, boost::property<boost::edge_weight_t, cost>> mygraph_t;
-    typedef boost::property_map<mygraph_t, boost::edge_weight_t>::type WeightMap;
-    typedef mygraph_t::vertex_descriptor vertex;
-    typedef mygraph_t::edge_descriptor edge_descriptor;
-    mygraph_t g;
-    QHash<QPair<unsigned int, unsigned int>, route> edgeHash; // For Mudlet to decode BGL edges
+    QHash<int, int> roomidToIndex;
+
+    QHash<QPair<unsigned int, unsigned int>, route> edgeHash; // For Mudlet to decode the router's edges
     std::vector<location> locations;
     bool mMapGraphNeedsUpdate;
     bool mNewMove;
@@ -220,6 +229,27 @@ public slots:
 
 private:
     const QString createFileHeaderLine(const QString, const QChar);
+    bool serializeIndexedRooms(QDataStream&, qint64 headerPosition);
+
+    void updateGraph();
+    QString getRouteCommand(const route&) const;
+    void addGraphVertex(int roomId, TRoom* pR);
+    void removeGraphVertex(int roomId);
+    void updateGraphEdges(int roomId);
+    int addGraphEdges(int roomId, TRoom* pR);
+
+    // Rooms whose part of the route finding graph is out of date, not used
+    // when mMapGraphNeedsUpdate says the whole of it is:
+    QSet<int> mRoomsNeedingGraphUpdate;
+    // Vertices left behind by rooms that have gone from the graph, they have
+    // no edges but are not removed (which would renumber the others) until
+    // there are enough of them to make a rebuild worthwhile:
+    int mDeadGraphVertexCount;
+    quint64 mMapDataRevision;
+    // Does the searching, on a copy of the graph laid out for it:
+    TMapRouter mRouter;
+    // Kept to save reallocating it for each search:
+    std::vector<quint32> mPathVertices;
 
     QStringList mStoredMessages;
 
@@ -0,0 +1,510 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TMapRouter.h"
+
+
+#include "TRoom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+const int TMapRouter::scAnyArea = std::numeric_limits<int>::min();
+
+TMapRouter::TMapRouter()
+: mGeneration(0)
+, mIsAreaExitsValid(false)
+{
+    mOffsets.push_back(0);
+}
+
+void TMapRouter::clear()
+{
+    mOffsets.clear();
+    mOffsets.push_back(0);
+    mEdges.clear();
+    mPendingEdges.clear();
+    mPositions.clear();
+    mSeenGeneration.clear();
+    mCost.clear();
+    mPredecessor.clear();
+    mFirstStep.clear();
+    mTargetGeneration.clear();
+    mGeneration = 0;
+    mIsAreaExit.clear();
+    mAreaExitCounts.clear();
+    mAreaExitCosts.clear();
+    mChangedAreas.clear();
+    mIsAreaExitsValid = false;
+}
+
+quint32 TMapRouter::addVertex(TRoom* pR)
+{
+    mPositions.push_back(Position());
+    const quint32 vertex = static_cast<quint32>(mPositions.size() - 1);
+    mPositions[vertex].area = -1;
+    setPosition(vertex, pR);
+    return vertex;
+}
+
+void TMapRouter::setPosition(const quint32 vertex, TRoom* pR)
+{
+    // Both the area it was in and (below) the one it is now in:
+    markAreaChanged(vertex);
+    Position& position = mPositions[vertex];
+    if (pR) {
+        position.x = pR->x;
+        position.y = pR->y;
+        position.z = pR->z;
+        position.area = pR->getArea();
+    } else {
+        position.x = position.y = position.z = 0.0f;
+        position.area = -1;
+    }
+    markAreaChanged(vertex);
+}
+
+void TMapRouter::setEdges(const quint32 vertex, std::vector<Edge>&& edges)
+{
+    mPendingEdges[vertex] = std::move(edges);
+    markAreaChanged(vertex);
+}
+
+void TMapRouter::markAreaChanged(const quint32 vertex)
+{
+    if (mIsAreaExitsValid) {
+        mChangedAreas.insert(mPositions[vertex].area);
+    }
+}
+
+void TMapRouter::compact()
+{
+    const quint32 compactedCount = static_cast<quint32>(mOffsets.size() - 1);
+    std::vector<quint32> offsets;
+    offsets.reserve(mPositions.size() + 1);
+    offsets.push_back(0);
+    std::vector<Edge> edges;
+    edges.reserve(mEdges.size());
+    for (quint32 vertex = 0, total = static_cast<quint32>(mPositions.size()); vertex < total; ++vertex) {
+        auto itPending = mPendingEdges.constFind(vertex);
+        if (itPending != mPendingEdges.constEnd()) {
+            edges.insert(edges.end(), itPending.value().cbegin(), itPending.value().cend());
+        } else if (vertex < compactedCount) {
+            edges.insert(edges.end(), mEdges.cbegin() + mOffsets[vertex], mEdges.cbegin() + mOffsets[vertex + 1]);
+        }
+        offsets.push_back(static_cast<quint32>(edges.size()));
+    }
+    mOffsets.swap(offsets);
+    mEdges.swap(edges);
+    mPendingEdges.clear();
+}
+
+template <typename Visitor>
+void TMapRouter::forEachEdge(const quint32 vertex, Visitor visit) const
+{
+    if (!mPendingEdges.isEmpty()) {
+        auto itPending = mPendingEdges.constFind(vertex);
+        if (itPending != mPendingEdges.constEnd()) {
+            for (const Edge& edge : itPending.value()) {
+                visit(edge);
+            }
+            return;
+        }
+    }
+    // Vertices added since the last compact() have no edges here:
+    if (vertex + 1 < mOffsets.size()) {
+        for (quint32 i = mOffsets[vertex], end = mOffsets[vertex + 1]; i < end; ++i) {
+            visit(mEdges[i]);
+        }
+    }
+}
+
+std::vector<TMapRouter::Edge> TMapRouter::edges(const quint32 vertex) const
+{
+    std::vector<Edge> result;
+    forEachEdge(vertex, [&](const Edge& edge) { result.push_back(edge); });
+    return result;
+}
+
+// Was the distance_heuristic used with the Boost A* search, the straight line
+// distance when both rooms are in the same area:
+float TMapRouter::heuristic(const quint32 vertex, const Position& goal) const
+{
+    const Position& position = mPositions[vertex];
+    if (position.area != goal.area) {
+        return 1.0f;
+    }
+    const float dx = goal.x - position.x;
+    const float dy = goal.y - position.y;
+    const float dz = goal.z - position.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void TMapRouter::startSearch()
+{
+    if (mSeenGeneration.size() != mPositions.size()) {
+        mSeenGeneration.resize(mPositions.size(), 0);
+        mCost.resize(mPositions.size());
+        mPredecessor.resize(mPositions.size());
+        mFirstStep.resize(mPositions.size());
+        mTargetGeneration.resize(mPositions.size(), 0);
+    }
+    if (++mGeneration == 0) {
+        // Wrapped around, so old marks could now look current:
+        std::fill(mSeenGeneration.begin(), mSeenGeneration.end(), 0);
+        std::fill(mTargetGeneration.begin(), mTargetGeneration.end(), 0);
+        mGeneration = 1;
+    }
+    mHeap.clear();
+}
+
+bool TMapRouter::findPath(const quint32 start, const quint32 goal, std::vector<quint32>& path)
+{
+    path.clear();
+    if (start >= mPositions.size() || goal >= mPositions.size()) {
+        return false;
+    }
+    if (mPositions[start].area != mPositions[goal].area) {
+        return findPathBetweenAreas(start, goal, path);
+    }
+
+    // Puts the lowest estimate at the front of the heap:
+    const auto heapOrder = [](const HeapEntry& a, const HeapEntry& b) { return a.estimate > b.estimate; };
+
+    startSearch();
+    const Position goalPosition = mPositions[goal];
+    mSeenGeneration[start] = mGeneration;
+    mCost[start] = 0.0f;
+    mPredecessor[start] = start;
+    mHeap.push_back({heuristic(start, goalPosition), 0.0f, start});
+
+    bool isFound = false;
+    while (!mHeap.empty()) {
+        std::pop_heap(mHeap.begin(), mHeap.end(), heapOrder);
+        const HeapEntry current = mHeap.back();
+        mHeap.pop_back();
+        if (current.cost > mCost[current.vertex]) {
+            continue;
+        }
+        if (current.vertex == goal) {
+            isFound = true;
+            break;
+        }
+        forEachEdge(current.vertex, [&](const Edge& edge) {
+            const float cost = current.cost + edge.cost;
+            // As the heuristic is not guaranteed never to overestimate, a
+            // vertex that has already been expanded is gone through again if
+            // a cheaper way to it turns up, as the Boost search did:
+            if (mSeenGeneration[edge.target] != mGeneration || cost < mCost[edge.target]) {
+                mSeenGeneration[edge.target] = mGeneration;
+                mCost[edge.target] = cost;
+                mPredecessor[edge.target] = current.vertex;
+                mHeap.push_back({cost + heuristic(edge.target, goalPosition), cost, edge.target});
+                std::push_heap(mHeap.begin(), mHeap.end(), heapOrder);
+            }
+        });
+    }
+
+    if (!isFound) {
+        return false;
+    }
+
+    for (quint32 vertex = goal; vertex != start; vertex = mPredecessor[vertex]) {
+        path.push_back(vertex);
+    }
+    path.push_back(start);
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+// The cheapest route that does not leave the area, appended to path without
+// the start vertex (which will already be there):
+bool TMapRouter::findPathInArea(const quint32 start, const quint32 goal, const int area, std::vector<quint32>& path)
+{
+    startSearch();
+    bool isFound = false;
+    dijkstra(start, std::numeric_limits<float>::max(), area, [&](const quint32 vertex, float) {
+        isFound = (vertex == goal);
+        return !isFound;
+    });
+    if (!isFound) {
+        return false;
+    }
+
+    const std::size_t end = path.size();
+    for (quint32 vertex = goal; vertex != start; vertex = mPredecessor[vertex]) {
+        path.push_back(vertex);
+    }
+    std::reverse(path.begin() + end, path.end());
+    return true;
+}
+
+// The costs from a vertex to all the area exits in its area that it can get
+// to without leaving it:
+void TMapRouter::findAreaExitCosts(const quint32 start, std::vector<Edge>& costs)
+{
+    costs.clear();
+    const int area = mPositions[start].area;
+    int remaining = mAreaExitCounts.value(area) - (mIsAreaExit[start] ? 1 : 0);
+    if (remaining < 1) {
+        return;
+    }
+    startSearch();
+    dijkstra(start, std::numeric_limits<float>::max(), area, [&](const quint32 vertex, const float cost) {
+        if (vertex != start && mIsAreaExit[vertex]) {
+            costs.emplace_back(vertex, cost);
+            return --remaining > 0;
+        }
+        return true;
+    });
+}
+
+void TMapRouter::updateAreaExits()
+{
+    if (mIsAreaExitsValid && mChangedAreas.isEmpty()) {
+        return;
+    }
+
+    // Which vertices are area exits can only be found by looking at all the
+    // edges, but that is a quick pass over the arrays:
+    mIsAreaExit.assign(mPositions.size(), false);
+    mAreaExitCounts.clear();
+    for (quint32 vertex = 0, total = static_cast<quint32>(mPositions.size()); vertex < total; ++vertex) {
+        const int area = mPositions[vertex].area;
+        forEachEdge(vertex, [&](const Edge& edge) {
+            if (!mIsAreaExit[vertex] && mPositions[edge.target].area != area) {
+                mIsAreaExit[vertex] = true;
+                ++mAreaExitCounts[area];
+            }
+        });
+    }
+
+    // Whereas the routes between them only need redoing where things have
+    // changed:
+    if (!mIsAreaExitsValid) {
+        mAreaExitCosts.clear();
+    } else {
+        auto itCosts = mAreaExitCosts.begin();
+        while (itCosts != mAreaExitCosts.end()) {
+            if (mChangedAreas.contains(mPositions[itCosts.key()].area)) {
+                itCosts = mAreaExitCosts.erase(itCosts);
+            } else {
+                ++itCosts;
+            }
+        }
+    }
+    mChangedAreas.clear();
+    mIsAreaExitsValid = true;
+}
+
+bool TMapRouter::findPathBetweenAreas(const quint32 start, const quint32 goal, std::vector<quint32>& path)
+{
+    updateAreaExits();
+
+    // The top level search is a Dijkstra one over the start, the area exits,
+    // the vertices that they lead to and the goal - its working data is kept
+    // apart from the arrays as they are used to fill in the costs as needed:
+    const quint32 goalNode = std::numeric_limits<quint32>::max();
+    const int goalArea = mPositions[goal].area;
+    const auto heapOrder = [](const HeapEntry& a, const HeapEntry& b) { return a.estimate > b.estimate; };
+    std::vector<HeapEntry> heap;
+    QHash<quint32, float> costs;
+    QHash<quint32, quint32> predecessors;
+    const auto relax = [&](const quint32 vertex, const float cost, const quint32 predecessor) {
+        auto itCost = costs.find(vertex);
+        if (itCost == costs.end() || cost < itCost.value()) {
+            costs.insert(vertex, cost);
+            predecessors.insert(vertex, predecessor);
+            heap.push_back({cost, cost, vertex});
+            std::push_heap(heap.begin(), heap.end(), heapOrder);
+        }
+    };
+
+    relax(start, 0.0f, start);
+    std::vector<Edge> startCosts;
+    bool isFound = false;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heapOrder);
+        const HeapEntry current = heap.back();
+        heap.pop_back();
+        if (current.vertex == goalNode) {
+            isFound = true;
+            break;
+        }
+        if (current.cost > costs.value(current.vertex)) {
+            continue;
+        }
+
+        const int area = mPositions[current.vertex].area;
+        if (area == goalArea) {
+            startSearch();
+            bool isGoalReached = false;
+            dijkstra(current.vertex, std::numeric_limits<float>::max(), area, [&](const quint32 vertex, float) {
+                isGoalReached = (vertex == goal);
+                return !isGoalReached;
+            });
+            if (isGoalReached) {
+                relax(goalNode, current.cost + mCost[goal], current.vertex);
+            }
+        }
+
+        forEachEdge(current.vertex, [&](const Edge& edge) {
+            if (mPositions[edge.target].area != area) {
+                relax(edge.target, current.cost + edge.cost, current.vertex);
+            }
+        });
+
+        // The start vertex need not be an area exit or lead from one, so its
+        // costs are not kept:
+        const std::vector<Edge>* pExitCosts;
+        if (current.vertex == start) {
+            findAreaExitCosts(start, startCosts);
+            pExitCosts = &startCosts;
+        } else {
+            auto itExitCosts = mAreaExitCosts.find(current.vertex);
+            if (itExitCosts == mAreaExitCosts.end()) {
+                itExitCosts = mAreaExitCosts.insert(current.vertex, std::vector<Edge>());
+                findAreaExitCosts(current.vertex, itExitCosts.value());
+            }
+            pExitCosts = &itExitCosts.value();
+        }
+        for (const Edge& exitCost : *pExitCosts) {
+            relax(exitCost.target, current.cost + exitCost.cost, current.vertex);
+        }
+    }
+
+    if (!isFound) {
+        return false;
+    }
+
+    // Now fill in the route, each step of the top level one is either an
+    // edge to another area or a route within one:
+    std::vector<quint32> nodes;
+    nodes.push_back(goal);
+    for (quint32 node = predecessors.value(goalNode); node != start; node = predecessors.value(node)) {
+        nodes.push_back(node);
+    }
+    nodes.push_back(start);
+    std::reverse(nodes.begin(), nodes.end());
+
+    path.push_back(start);
+    for (std::size_t i = 1, total = nodes.size(); i < total; ++i) {
+        const int area = mPositions[nodes[i - 1]].area;
+        if (mPositions[nodes[i]].area != area) {
+            path.push_back(nodes[i]);
+        } else if (!findPathInArea(nodes[i - 1], nodes[i], area, path)) {
+            // Cannot happen unless the graph is broken, as the cost was found
+            // the same way:
+            path.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls settled(vertex, cost) for each vertex, cheapest first, that can be
+// reached for no more than maxCost (and without leaving the area, unless that
+// is scAnyArea) until it returns false:
+template <typename Visitor>
+void TMapRouter::dijkstra(const quint32 start, const float maxCost, const int area, Visitor settled)
+{
+    const auto heapOrder = [](const HeapEntry& a, const HeapEntry& b) { return a.estimate > b.estimate; };
+
+    mSeenGeneration[start] = mGeneration;
+    mCost[start] = 0.0f;
+    mPredecessor[start] = start;
+    mFirstStep[start] = start;
+    mHeap.push_back({0.0f, 0.0f, start});
+
+    while (!mHeap.empty()) {
+        std::pop_heap(mHeap.begin(), mHeap.end(), heapOrder);
+        const HeapEntry current = mHeap.back();
+        mHeap.pop_back();
+        if (current.cost > mCost[current.vertex]) {
+            continue;
+        }
+        if (!settled(current.vertex, current.cost)) {
+            return;
+        }
+        forEachEdge(current.vertex, [&](const Edge& edge) {
+            const float cost = current.cost + edge.cost;
+            if (cost > maxCost || (area != scAnyArea && mPositions[edge.target].area != area)) {
+                return;
+            }
+            if (mSeenGeneration[edge.target] != mGeneration || cost < mCost[edge.target]) {
+                mSeenGeneration[edge.target] = mGeneration;
+                mCost[edge.target] = cost;
+                mPredecessor[edge.target] = current.vertex;
+                mFirstStep[edge.target] = (current.vertex == start) ? edge.target : mFirstStep[current.vertex];
+                mHeap.push_back({cost, cost, edge.target});
+                std::push_heap(mHeap.begin(), mHeap.end(), heapOrder);
+            }
+        });
+    }
+}
+
+void TMapRouter::findCosts(const quint32 start, const std::vector<quint32>& targets, std::vector<quint32>& reached, std::vector<float>& costs, std::vector<quint32>& firstSteps)
+{
+    reached.clear();
+    costs.clear();
+    firstSteps.clear();
+    if (start >= mPositions.size()) {
+        return;
+    }
+
+    startSearch();
+    int remaining = 0;
+    for (quint32 target : targets) {
+        if (target < mPositions.size() && mTargetGeneration[target] != mGeneration) {
+            mTargetGeneration[target] = mGeneration;
+            ++remaining;
+        }
+    }
+    if (!remaining) {
+        return;
+    }
+
+    dijkstra(start, std::numeric_limits<float>::max(), scAnyArea, [&](const quint32 vertex, const float cost) {
+        if (mTargetGeneration[vertex] == mGeneration) {
+            reached.push_back(vertex);
+            costs.push_back(cost);
+            firstSteps.push_back(mFirstStep[vertex]);
+            return --remaining > 0;
+        }
+        return true;
+    });
+}
+
+void TMapRouter::findWithinCost(const quint32 start, const float maxCost, std::vector<quint32>& reached, std::vector<float>& costs)
+{
+    reached.clear();
+    costs.clear();
+    if (start >= mPositions.size() || maxCost < 0.0f) {
+        return;
+    }
+
+    startSearch();
+    dijkstra(start, maxCost, scAnyArea, [&](const quint32 vertex, const float cost) {
+        reached.push_back(vertex);
+        costs.push_back(cost);
+        return true;
+    });
+}
@@ -0,0 +1,152 @@
+#ifndef MUDLET_TMAPROUTER_H
+#define MUDLET_TMAPROUTER_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QHash>
+#include <QSet>
+#include "post_guard.h"
+
+#include <vector>
+
+class TRoom;
+
+
+// The search side of the route finding graph that TMap keeps: the edges are
+// held in compressed sparse row form (one array of all the edges, ordered by
+// the vertex they leave, and one of where each vertex's start) with the room
+// positions that the A* heuristic needs packed alongside, so a search does
+// not have to chase pointers. Vertices are numbered as TMap's locations
+// are. Changes to a vertex's edges are held to one side until compact() is
+// called, so that editing a room does not mean redoing all the arrays.
+//
+// The working arrays for a search are kept from one to the next and marked
+// with a generation number rather than being cleared each time, so the cost
+// of a search depends only on how much of the graph it looks at.
+//
+// A route between two areas is found in two levels, as there is nothing to
+// steer an A* search towards a room in another area: first over just the
+// rooms with exits out of their area, joined by the exits themselves and by
+// the cheapest routes between them within each area (worked out when first
+// needed and then kept until something in that area changes), then the
+// parts of the route inside each area are filled in.
+class TMapRouter
+{
+public:
+    struct Edge
+    {
+        Edge() : target(0), cost(0.0f) {}
+        Edge(quint32 t, float c) : target(t), cost(c) {}
+
+        quint32 target;
+        float cost;
+    };
+
+    TMapRouter();
+
+    void clear();
+    // Returns the index of the new vertex, which has no edges to begin with:
+    quint32 addVertex(TRoom* pR);
+    void setPosition(quint32 vertex, TRoom* pR);
+    void setEdges(quint32 vertex, std::vector<Edge>&& edges);
+    std::vector<Edge> edges(quint32 vertex) const;
+    // Folds the changed edges back into the compressed arrays:
+    void compact();
+
+    int vertexCount() const { return static_cast<int>(mPositions.size()); }
+    int pendingCount() const { return mPendingEdges.size(); }
+
+    // Fills path with the vertices of the cheapest route found from start to
+    // goal, including both of them, returns false if there is none:
+    bool findPath(quint32 start, quint32 goal, std::vector<quint32>& path);
+
+    // One (Dijkstra) search from start that stops once every one of the
+    // targets has been reached; fills reached with those that can be, along
+    // with the cost of getting to each and the first vertex after start on
+    // the way (start itself, if it is one of the targets, has no first step
+    // and that is given as start):
+    void findCosts(quint32 start, const std::vector<quint32>& targets, std::vector<quint32>& reached, std::vector<float>& costs, std::vector<quint32>& firstSteps);
+
+    // Every vertex, start included, that can be reached from start for no
+    // more than maxCost, along with what it costs:
+    void findWithinCost(quint32 start, float maxCost, std::vector<quint32>& reached, std::vector<float>& costs);
+
+private:
+    struct Position
+    {
+        float x;
+        float y;
+        float z;
+        int area;
+    };
+
+    struct HeapEntry
+    {
+        // Estimated total cost through the vertex, and the cost to reach it
+        // when this entry was pushed - if that is no longer the best known one
+        // the entry is stale and is skipped:
+        float estimate;
+        float cost;
+        quint32 vertex;
+    };
+
+    // For searches that may go anywhere rather than staying in one area:
+    static const int scAnyArea;
+
+    void startSearch();
+    template <typename Visitor>
+    void dijkstra(quint32 start, float maxCost, int area, Visitor settled);
+    bool findPathInArea(quint32 start, quint32 goal, int area, std::vector<quint32>& path);
+    bool findPathBetweenAreas(quint32 start, quint32 goal, std::vector<quint32>& path);
+    void updateAreaExits();
+    void findAreaExitCosts(quint32 start, std::vector<Edge>& costs);
+    void markAreaChanged(quint32 vertex);
+    float heuristic(quint32 vertex, const Position& goal) const;
+    template <typename Visitor>
+    void forEachEdge(quint32 vertex, Visitor visit) const;
+
+    std::vector<quint32> mOffsets;
+    std::vector<Edge> mEdges;
+    QHash<quint32, std::vector<Edge>> mPendingEdges;
+    std::vector<Position> mPositions;
+
+    quint32 mGeneration;
+    std::vector<quint32> mSeenGeneration;
+    std::vector<float> mCost;
+    std::vector<quint32> mPredecessor;
+    // For searches from one room to many:
+    std::vector<quint32> mFirstStep;
+    std::vector<quint32> mTargetGeneration;
+
+    // The routing between areas - whether each vertex has an edge to another
+    // area, how many such vertices each area has, and (for those reached so
+    // far) the cheapest routes from each such vertex to the others in its
+    // area. These are brought up to date for the areas that have changed when
+    // next needed:
+    std::vector<bool> mIsAreaExit;
+    QHash<int, int> mAreaExitCounts;
+    QHash<quint32, std::vector<Edge>> mAreaExitCosts;
+    QSet<int> mChangedAreas;
+    bool mIsAreaExitsValid;
+    std::vector<HeapEntry> mHeap;
+};
+
+#endif // MUDLET_TMAPROUTER_H
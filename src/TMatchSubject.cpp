@@ -0,0 +1,61 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TMatchSubject.h"
+
+
+TMatchSubject::TMatchSubject(const QString& text)
+: mText(text)
+, mUtf8(text.toUtf8())
+{
+}
+
+int TMatchSubject::textPosition(const int byteOffset) const
+{
+    if (isAscii() || byteOffset <= 0) {
+        return byteOffset;
+    }
+
+    if (mTextPositions.isEmpty()) {
+        // One entry per byte plus one for the end, a UTF-8 sequence of four
+        // bytes is a surrogate pair and so counts for two QChars:
+        mTextPositions.resize(mUtf8.size() + 1);
+        int position = 0;
+        for (int i = 0; i < mUtf8.size(); ++i) {
+            mTextPositions[i] = position;
+            const uchar byte = static_cast<uchar>(mUtf8.at(i));
+            if ((byte & 0xC0) != 0x80) {
+                position += (byte >= 0xF0) ? 2 : 1;
+            }
+        }
+        mTextPositions[mUtf8.size()] = position;
+    }
+
+    return mTextPositions.at(qMin(byteOffset, mUtf8.size()));
+}
+
+// The byte offset of the character after the one starting at byteOffset
+int TMatchSubject::nextCharacterOffset(const int byteOffset) const
+{
+    int offset = byteOffset + 1;
+    while (offset < mUtf8.size() && (static_cast<uchar>(mUtf8.at(offset)) & 0xC0) == 0x80) {
+        ++offset;
+    }
+    return offset;
+}
@@ -0,0 +1,63 @@
+#ifndef MUDLET_TMATCHSUBJECT_H
+#define MUDLET_TMATCHSUBJECT_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "post_guard.h"
+
+#include <string>
+
+
+// The text that triggers or aliases are matched against, encoded once as
+// UTF-8 (which is what all the perl regexes are compiled for) so that the
+// same buffer can be handed to every pattern in the tree. Positions that pcre
+// reports as byte offsets into it are converted back to QChar positions in
+// the text for capture group positions.
+class TMatchSubject
+{
+public:
+    explicit TMatchSubject(const QString& text);
+
+    const QString& text() const { return mText; }
+    const char* data() const { return mUtf8.constData(); }
+    int length() const { return mUtf8.size(); }
+    bool isAscii() const { return mUtf8.size() == mText.size(); }
+
+    int textPosition(int byteOffset) const;
+    int nextCharacterOffset(int byteOffset) const;
+
+    // Length in QChars of a capture that has been turned into a std::string
+    static int textLength(const std::string& utf8) { return QString::fromStdString(utf8).size(); }
+
+private:
+    TMatchSubject(const TMatchSubject&) = delete;
+    TMatchSubject& operator=(const TMatchSubject&) = delete;
+
+    const QString mText;
+    const QByteArray mUtf8;
+    // Only built if a position is needed in text that is not all ASCII:
+    mutable QVector<int> mTextPositions;
+};
+
+#endif // MUDLET_TMATCHSUBJECT_H
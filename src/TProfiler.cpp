@@ -0,0 +1,179 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TProfiler.h"
+
+
+#include "pre_guard.h"
+#include <QStringList>
+#include "post_guard.h"
+
+#include <algorithm>
+
+
+TProfiler::TProfiler()
+: mIsEnabled(false)
+, mpCurrentScope(nullptr)
+{
+    mClock.start();
+}
+
+void TProfiler::setEnabled(const bool state)
+{
+    mIsEnabled = state;
+}
+
+void TProfiler::reset()
+{
+    mRecords.clear();
+}
+
+QList<TProfiler::Record> TProfiler::records(const SortKey sortKey, const int count) const
+{
+    QList<Record> result = mRecords.values();
+    std::sort(result.begin(), result.end(), [=](const Record& a, const Record& b) {
+        switch (sortKey) {
+        case SortByMatchTime:
+            return a.matchTime > b.matchTime;
+        case SortByLuaTime:
+            return a.luaTime > b.luaTime;
+        case SortByHits:
+            return a.hits > b.hits;
+        case SortByAttempts:
+            return a.matchAttempts > b.matchAttempts;
+        case SortByTotalTime:
+        default:
+            return a.totalTime() > b.totalTime();
+        }
+    });
+    if (count >= 0 && result.size() > count) {
+        result.erase(result.begin() + count, result.end());
+    }
+    return result;
+}
+
+QString TProfiler::report(const SortKey sortKey, const int count) const
+{
+    QList<Record> top = records(sortKey, count);
+    qint64 grandTotal = 0;
+    for (auto& record : mRecords) {
+        grandTotal += record.totalTime();
+    }
+
+    QStringList msg;
+    msg << QStringLiteral("profiled items: %1 (profiling is %2)\n").arg(QString::number(mRecords.size()), mIsEnabled ? QStringLiteral("on") : QStringLiteral("off"));
+    msg << QStringLiteral("%1 %2 %3 %4 %5 %6  %7\n")
+                   .arg(QStringLiteral("type"), -8)
+                   .arg(QStringLiteral("attempts"), 10)
+                   .arg(QStringLiteral("hits"), 8)
+                   .arg(QStringLiteral("match ms"), 10)
+                   .arg(QStringLiteral("lua ms"), 10)
+                   .arg(QStringLiteral("share"), 6)
+                   .arg(QStringLiteral("name (id)"));
+    for (auto& record : top) {
+        const double share = grandTotal ? (100.0 * record.totalTime()) / grandTotal : 0.0;
+        msg << QStringLiteral("%1 %2 %3 %4 %5 %6% %7 (%8)\n")
+                       .arg(itemTypeName(record.type), -8)
+                       .arg(record.matchAttempts, 10)
+                       .arg(record.type == Trigger || record.type == Alias ? record.hits : record.executions, 8)
+                       .arg(record.matchTime / 1.0e6, 10, 'f', 3)
+                       .arg(record.luaTime / 1.0e6, 10, 'f', 3)
+                       .arg(share, 5, 'f', 1)
+                       .arg(record.name, QString::number(record.id));
+    }
+    return msg.join(QString());
+}
+
+QString TProfiler::itemTypeName(const ItemType type)
+{
+    switch (type) {
+    case Trigger:
+        return QStringLiteral("trigger");
+    case Alias:
+        return QStringLiteral("alias");
+    case Timer:
+        return QStringLiteral("timer");
+    case Script:
+        return QStringLiteral("script");
+    }
+    return QString();
+}
+
+bool TProfiler::sortKeyFromName(const QString& name, SortKey& sortKey)
+{
+    static const QHash<QString, SortKey> keys{{QStringLiteral("total"), SortByTotalTime},
+                                              {QStringLiteral("match"), SortByMatchTime},
+                                              {QStringLiteral("lua"), SortByLuaTime},
+                                              {QStringLiteral("hits"), SortByHits},
+                                              {QStringLiteral("attempts"), SortByAttempts}};
+    auto it = keys.constFind(name.toLower());
+    if (it == keys.constEnd()) {
+        return false;
+    }
+    sortKey = it.value();
+    return true;
+}
+
+TProfileScope::TProfileScope(TProfiler& profiler, const TProfiler::ItemType type, const int id, const QString& name, const TProfiler::Phase phase)
+: mProfiler(profiler)
+, mIsActive(profiler.mIsEnabled)
+, mType(type)
+, mId(id)
+, mPhase(phase)
+, mIsHit(false)
+, mStart(0)
+, mChildTime(0)
+, mpParent(nullptr)
+{
+    if (!mIsActive) {
+        return;
+    }
+    mName = name;
+    mpParent = profiler.mpCurrentScope;
+    profiler.mpCurrentScope = this;
+    mStart = profiler.mClock.nsecsElapsed();
+}
+
+TProfileScope::~TProfileScope()
+{
+    if (!mIsActive) {
+        return;
+    }
+    const qint64 elapsed = mProfiler.mClock.nsecsElapsed() - mStart;
+    mProfiler.mpCurrentScope = mpParent;
+    if (mpParent) {
+        mpParent->mChildTime += elapsed;
+    }
+
+    TProfiler::Record& record = mProfiler.mRecords[TProfiler::key(mType, mId)];
+    record.type = mType;
+    record.id = mId;
+    record.name = mName;
+    const qint64 selfTime = qMax(Q_INT64_C(0), elapsed - mChildTime);
+    if (mPhase == TProfiler::Matching) {
+        ++record.matchAttempts;
+        if (mIsHit) {
+            ++record.hits;
+        }
+        record.matchTime += selfTime;
+    } else {
+        ++record.executions;
+        record.luaTime += selfTime;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef MUDLET_TPROFILER_H
+#define MUDLET_TPROFILER_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "post_guard.h"
+
+class TProfileScope;
+
+
+// Per item timing statistics for triggers, aliases, timers and event handler
+// scripts. Profiling is off by default and when it is off the only cost to
+// the instrumented code is a test of a flag. Times are "self" times: the time
+// spent in matching an item does not include the time spent running its Lua
+// script or matching its children, each of those being accounted for
+// separately.
+class TProfiler
+{
+    friend class TProfileScope;
+
+public:
+    enum ItemType { Trigger = 0, Alias, Timer, Script };
+    enum Phase { Matching, Executing };
+    enum SortKey { SortByTotalTime = 0, SortByMatchTime, SortByLuaTime, SortByHits, SortByAttempts };
+
+    struct Record
+    {
+        Record() : type(Trigger), id(0), matchAttempts(0), hits(0), matchTime(0), executions(0), luaTime(0) {}
+
+        ItemType type;
+        int id;
+        QString name;
+        quint64 matchAttempts;
+        quint64 hits;
+        // in nanoseconds:
+        qint64 matchTime;
+        quint64 executions;
+        // in nanoseconds:
+        qint64 luaTime;
+
+        qint64 totalTime() const { return matchTime + luaTime; }
+    };
+
+    TProfiler();
+
+    bool isEnabled() const { return mIsEnabled; }
+    void setEnabled(bool);
+    void reset();
+    QList<Record> records(SortKey sortKey = SortByTotalTime, int count = -1) const;
+    QString report(SortKey sortKey = SortByTotalTime, int count = 20) const;
+
+    static QString itemTypeName(ItemType);
+    static bool sortKeyFromName(const QString&, SortKey&);
+
+private:
+    static quint64 key(const ItemType type, const int id) { return (static_cast<quint64>(type) << 32) | static_cast<quint32>(id); }
+
+    bool mIsEnabled;
+    // Monotonic, started when the profiler is constructed:
+    QElapsedTimer mClock;
+    QHash<quint64, Record> mRecords;
+    // Innermost scope being timed, so that nested scopes can be deducted
+    // from their parents:
+    TProfileScope* mpCurrentScope;
+};
+
+
+// Times one match attempt or one execution of an item for as long as it is
+// in scope - if profiling was enabled when it was created:
+class TProfileScope
+{
+public:
+    TProfileScope(TProfiler&, TProfiler::ItemType, int id, const QString& name, TProfiler::Phase);
+    ~TProfileScope();
+
+    // For a Matching scope: record that the item matched:
+    void setHit() { mIsHit = true; }
+
+private:
+    TProfileScope(const TProfileScope&) = delete;
+    TProfileScope& operator=(const TProfileScope&) = delete;
+
+    TProfiler& mProfiler;
+    const bool mIsActive;
+    TProfiler::ItemType mType;
+    int mId;
+    QString mName;
+    TProfiler::Phase mPhase;
+    bool mIsHit;
+    qint64 mStart;
+    qint64 mChildTime;
+    TProfileScope* mpParent;
+};
+
+#endif // MUDLET_TPROFILER_H
@@ -0,0 +1,490 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TProtocolDecoder.h"
+
+
+#include <cstring>
+
+// Deeper nesting than this is taken to be garbage (or hostile) rather than
+// being allowed to exhaust the C or Lua stacks:
+static const int scMaxDepth = 128;
+
+static bool readHex4(const char*& pos, const char* end, uint& value)
+{
+    if (end - pos < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        const char c = *pos++;
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void appendUtf8(std::string& buffer, const uint codePoint)
+{
+    if (codePoint < 0x80) {
+        buffer += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        buffer += static_cast<char>(0xC0 | (codePoint >> 6));
+        buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        buffer += static_cast<char>(0xE0 | (codePoint >> 12));
+        buffer += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        buffer += static_cast<char>(0xF0 | (codePoint >> 18));
+        buffer += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        buffer += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+TProtocolDecoder::TProtocolDecoder(lua_State* pL, const QByteArray& data)
+: L(pL)
+, mpBegin(data.constData())
+, mpEnd(data.constData() + data.size())
+, mpPos(data.constData())
+{
+}
+
+bool TProtocolDecoder::fail(const char* message)
+{
+    mErrorString = QStringLiteral("%1 at byte %2").arg(QLatin1String(message), QString::number(mpPos - mpBegin));
+    return false;
+}
+
+bool TProtocolDecoder::pushJson()
+{
+    mErrorString.clear();
+    const int top = lua_gettop(L);
+    if (pushJsonValue(0)) {
+        skipJsonWhitespace();
+        if (mpPos == mpEnd) {
+            return true;
+        }
+        fail("unexpected data after the value");
+    }
+    lua_settop(L, top);
+    return false;
+}
+
+bool TProtocolDecoder::isBlank() const
+{
+    for (const char* pos = mpPos; pos < mpEnd; ++pos) {
+        if (*pos != ' ' && *pos != '\t' && *pos != '\n' && *pos != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TProtocolDecoder::skipJsonWhitespace()
+{
+    while (mpPos < mpEnd && (*mpPos == ' ' || *mpPos == '\t' || *mpPos == '\n' || *mpPos == '\r')) {
+        ++mpPos;
+    }
+}
+
+bool TProtocolDecoder::pushJsonValue(const int depth)
+{
+    if (depth > scMaxDepth) {
+        return fail("too deeply nested");
+    }
+    if (!lua_checkstack(L, 4)) {
+        return fail("out of Lua stack space");
+    }
+
+    skipJsonWhitespace();
+    if (mpPos >= mpEnd) {
+        return fail("unexpected end of data");
+    }
+
+    switch (*mpPos) {
+    case '{':
+        return pushJsonObject(depth + 1);
+    case '[':
+        return pushJsonArray(depth + 1);
+    case '"':
+        return pushJsonString();
+    case 't':
+        if (!skipJsonLiteral("true", 4)) {
+            return false;
+        }
+        lua_pushboolean(L, true);
+        return true;
+    case 'f':
+        if (!skipJsonLiteral("false", 5)) {
+            return false;
+        }
+        lua_pushboolean(L, false);
+        return true;
+    case 'n':
+        if (!skipJsonLiteral("null", 4)) {
+            return false;
+        }
+        lua_getfield(L, LUA_REGISTRYINDEX, "yajl.null");
+        return true;
+    default:
+        if (*mpPos == '-' || (*mpPos >= '0' && *mpPos <= '9')) {
+            return pushJsonNumber();
+        }
+        return fail("unexpected character");
+    }
+}
+
+bool TProtocolDecoder::pushJsonObject(const int depth)
+{
+    ++mpPos;
+    lua_newtable(L);
+    skipJsonWhitespace();
+    if (mpPos < mpEnd && *mpPos == '}') {
+        ++mpPos;
+        return true;
+    }
+
+    for (;;) {
+        skipJsonWhitespace();
+        if (mpPos >= mpEnd || *mpPos != '"') {
+            return fail("expected a string for an object key");
+        }
+        if (!pushJsonString()) {
+            return false;
+        }
+        skipJsonWhitespace();
+        if (mpPos >= mpEnd || *mpPos != ':') {
+            return fail("expected ':' after an object key");
+        }
+        ++mpPos;
+        if (!pushJsonValue(depth)) {
+            return false;
+        }
+        lua_rawset(L, -3);
+
+        skipJsonWhitespace();
+        if (mpPos >= mpEnd) {
+            return fail("unterminated object");
+        }
+        if (*mpPos == '}') {
+            ++mpPos;
+            return true;
+        }
+        if (*mpPos != ',') {
+            return fail("expected ',' or '}' in an object");
+        }
+        ++mpPos;
+    }
+}
+
+bool TProtocolDecoder::pushJsonArray(const int depth)
+{
+    ++mpPos;
+    lua_newtable(L);
+    skipJsonWhitespace();
+    if (mpPos < mpEnd && *mpPos == ']') {
+        ++mpPos;
+        return true;
+    }
+
+    for (int index = 1;; ++index) {
+        if (!pushJsonValue(depth)) {
+            return false;
+        }
+        lua_rawseti(L, -2, index);
+
+        skipJsonWhitespace();
+        if (mpPos >= mpEnd) {
+            return fail("unterminated array");
+        }
+        if (*mpPos == ']') {
+            ++mpPos;
+            return true;
+        }
+        if (*mpPos != ',') {
+            return fail("expected ',' or ']' in an array");
+        }
+        ++mpPos;
+    }
+}
+
+bool TProtocolDecoder::pushJsonString()
+{
+    const char* start = ++mpPos;
+
+    // Most strings have no escapes in them and can be pushed straight from
+    // the received data. Raw line endings are dropped from strings, as they
+    // always were before the data was given to the decoder:
+    while (mpPos < mpEnd && *mpPos != '\\' && *mpPos != '\n' && *mpPos != '\r') {
+        if (*mpPos == '"') {
+            lua_pushlstring(L, start, mpPos - start);
+            ++mpPos;
+            return true;
+        }
+        ++mpPos;
+    }
+
+    mBuffer.assign(start, mpPos - start);
+    while (mpPos < mpEnd) {
+        const char c = *mpPos++;
+        switch (c) {
+        case '"':
+            lua_pushlstring(L, mBuffer.data(), mBuffer.size());
+            return true;
+        case '\n':
+        case '\r':
+            break;
+        case '\\':
+            if (mpPos >= mpEnd) {
+                return fail("unterminated string");
+            }
+            switch (*mpPos++) {
+            case '"':
+                mBuffer += '"';
+                break;
+            case '\\':
+                mBuffer += '\\';
+                break;
+            case '/':
+                mBuffer += '/';
+                break;
+            case 'b':
+                mBuffer += '\b';
+                break;
+            case 'f':
+                mBuffer += '\f';
+                break;
+            case 'n':
+                mBuffer += '\n';
+                break;
+            case 'r':
+                mBuffer += '\r';
+                break;
+            case 't':
+                mBuffer += '\t';
+                break;
+            case 'u': {
+                uint codePoint;
+                if (!readHex4(mpPos, mpEnd, codePoint)) {
+                    return fail("invalid \\u escape in string");
+                }
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    // Should be the first half of a surrogate pair:
+                    const char* second = mpPos + 2;
+                    uint lowSurrogate = 0;
+                    if (mpEnd - mpPos >= 6 && mpPos[0] == '\\' && mpPos[1] == 'u' && readHex4(second, mpEnd, lowSurrogate) && lowSurrogate >= 0xDC00 && lowSurrogate < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                        mpPos = second;
+                    } else {
+                        codePoint = 0xFFFD;
+                    }
+                } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                    codePoint = 0xFFFD;
+                }
+                appendUtf8(mBuffer, codePoint);
+                break;
+            }
+            default:
+                return fail("invalid escape in string");
+            }
+            break;
+        default:
+            mBuffer += c;
+        }
+    }
+    return fail("unterminated string");
+}
+
+bool TProtocolDecoder::pushJsonNumber()
+{
+    const char* start = mpPos;
+    auto skipDigits = [&]() {
+        const char* digits = mpPos;
+        while (mpPos < mpEnd && *mpPos >= '0' && *mpPos <= '9') {
+            ++mpPos;
+        }
+        return mpPos != digits;
+    };
+
+    if (*mpPos == '-') {
+        ++mpPos;
+    }
+    if (!skipDigits()) {
+        return fail("invalid number");
+    }
+    if (mpPos < mpEnd && *mpPos == '.') {
+        ++mpPos;
+        if (!skipDigits()) {
+            return fail("invalid number");
+        }
+    }
+    if (mpPos < mpEnd && (*mpPos == 'e' || *mpPos == 'E')) {
+        ++mpPos;
+        if (mpPos < mpEnd && (*mpPos == '+' || *mpPos == '-')) {
+            ++mpPos;
+        }
+        if (!skipDigits()) {
+            return fail("invalid number");
+        }
+    }
+
+    // QByteArray::toDouble() always uses the C locale, unlike strtod():
+    lua_pushnumber(L, QByteArray::fromRawData(start, mpPos - start).toDouble());
+    return true;
+}
+
+bool TProtocolDecoder::skipJsonLiteral(const char* literal, const int length)
+{
+    if (mpEnd - mpPos < length || std::memcmp(mpPos, literal, length)) {
+        return fail("unexpected character");
+    }
+    mpPos += length;
+    return true;
+}
+
+bool TProtocolDecoder::pushNextMsdpVariable(QString& name)
+{
+    mErrorString.clear();
+    if (mpPos >= mpEnd) {
+        return false;
+    }
+    if (*mpPos != MSDP_VAR) {
+        return fail("expected MSDP_VAR");
+    }
+
+    const int top = lua_gettop(L);
+    ++mpPos;
+    const char* nameEnd = msdpTextEnd();
+    name = QString::fromUtf8(mpPos, nameEnd - mpPos);
+    mpPos = nameEnd;
+    if (pushMsdpValues(0)) {
+        return true;
+    }
+    lua_settop(L, top);
+    return false;
+}
+
+// The end of the text (a name or a value) starting at the current position
+const char* TProtocolDecoder::msdpTextEnd() const
+{
+    const char* pos = mpPos;
+    while (pos < mpEnd && (static_cast<uchar>(*pos) < MSDP_VAR || static_cast<uchar>(*pos) > MSDP_ARRAY_CLOSE)) {
+        ++pos;
+    }
+    return pos;
+}
+
+// The value(s) of a variable - more than one value makes an array of them
+bool TProtocolDecoder::pushMsdpValues(const int depth)
+{
+    if (!lua_checkstack(L, 4)) {
+        return fail("out of Lua stack space");
+    }
+
+    if (mpPos >= mpEnd || *mpPos != MSDP_VAL) {
+        lua_pushstring(L, "");
+        return true;
+    }
+    ++mpPos;
+    if (!pushMsdpValue(depth)) {
+        return false;
+    }
+    if (mpPos >= mpEnd || *mpPos != MSDP_VAL) {
+        return true;
+    }
+
+    lua_newtable(L);
+    lua_insert(L, -2);
+    lua_rawseti(L, -2, 1);
+    for (int index = 2; mpPos < mpEnd && *mpPos == MSDP_VAL; ++index) {
+        ++mpPos;
+        if (!pushMsdpValue(depth)) {
+            return false;
+        }
+        lua_rawseti(L, -2, index);
+    }
+    return true;
+}
+
+bool TProtocolDecoder::pushMsdpValue(const int depth)
+{
+    if (depth > scMaxDepth) {
+        return fail("too deeply nested");
+    }
+    if (!lua_checkstack(L, 4)) {
+        return fail("out of Lua stack space");
+    }
+
+    if (mpPos < mpEnd && *mpPos == MSDP_TABLE_OPEN) {
+        ++mpPos;
+        lua_newtable(L);
+        while (mpPos < mpEnd && *mpPos == MSDP_VAR) {
+            ++mpPos;
+            const char* nameEnd = msdpTextEnd();
+            lua_pushlstring(L, mpPos, nameEnd - mpPos);
+            mpPos = nameEnd;
+            if (!pushMsdpValues(depth + 1)) {
+                return false;
+            }
+            lua_rawset(L, -3);
+        }
+        // Tolerate a table that is not closed at the end of the data:
+        if (mpPos < mpEnd) {
+            if (*mpPos != MSDP_TABLE_CLOSE) {
+                return fail("expected MSDP_TABLE_CLOSE");
+            }
+            ++mpPos;
+        }
+        return true;
+    }
+
+    if (mpPos < mpEnd && *mpPos == MSDP_ARRAY_OPEN) {
+        ++mpPos;
+        lua_newtable(L);
+        for (int index = 1; mpPos < mpEnd && *mpPos == MSDP_VAL; ++index) {
+            ++mpPos;
+            if (!pushMsdpValue(depth + 1)) {
+                return false;
+            }
+            lua_rawseti(L, -2, index);
+        }
+        if (mpPos < mpEnd) {
+            if (*mpPos != MSDP_ARRAY_CLOSE) {
+                return fail("expected MSDP_ARRAY_CLOSE");
+            }
+            ++mpPos;
+        }
+        return true;
+    }
+
+    const char* valueEnd = msdpTextEnd();
+    lua_pushlstring(L, mpPos, valueEnd - mpPos);
+    mpPos = valueEnd;
+    return true;
+}
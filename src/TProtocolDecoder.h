@@ -0,0 +1,89 @@
+#ifndef MUDLET_TPROTOCOLDECODER_H
+#define MUDLET_TPROTOCOLDECODER_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QString>
+#include "post_guard.h"
+
+extern "C" {
+#include <lua.h>
+}
+
+#include <string>
+
+#define MSDP_VAR 1
+#define MSDP_VAL 2
+#define MSDP_TABLE_OPEN 3
+#define MSDP_TABLE_CLOSE 4
+#define MSDP_ARRAY_OPEN 5
+#define MSDP_ARRAY_CLOSE 6
+
+
+// Decodes the payload of a GMCP (JSON) or MSDP (binary) sub-negotiation
+// straight onto the Lua stack, working on the bytes as received so that
+// UTF-8 text is passed through to Lua unchanged. JSON null is pushed as the
+// same yajl.null sentinel that the Lua yajl.to_value() function uses.
+class TProtocolDecoder
+{
+public:
+    TProtocolDecoder(lua_State*, const QByteArray& data);
+
+    // GMCP: pushes the one JSON value in the data - on failure nothing is
+    // pushed and errorString() says why:
+    bool pushJson();
+
+    // MSDP: pushes the value of the next top level variable and sets its
+    // name, returns false with nothing pushed when there are no more (or on
+    // an error, when errorString() will not be empty):
+    bool pushNextMsdpVariable(QString& name);
+
+    const QString& errorString() const { return mErrorString; }
+
+    // True if there is nothing but (JSON) white-space left to decode:
+    bool isBlank() const;
+
+private:
+    bool fail(const char* message);
+
+    void skipJsonWhitespace();
+    bool pushJsonValue(int depth);
+    bool pushJsonObject(int depth);
+    bool pushJsonArray(int depth);
+    bool pushJsonString();
+    bool pushJsonNumber();
+    bool skipJsonLiteral(const char* literal, int length);
+
+    bool pushMsdpValues(int depth);
+    bool pushMsdpValue(int depth);
+    const char* msdpTextEnd() const;
+
+    lua_State* L;
+    const char* mpBegin;
+    const char* mpEnd;
+    const char* mpPos;
+    // Scratch space for JSON strings that contain escapes:
+    std::string mBuffer;
+    QString mErrorString;
+};
+
+#endif // MUDLET_TPROTOCOLDECODER_H
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TRegex.h"
+
+
+// pcre 8.20 introduced JIT compilation, and with it a specific function to
+// free study data (which then may hold the JIT code):
+#if defined(PCRE_STUDY_JIT_COMPILE)
+#define MUDLET_PCRE_JIT
+#endif
+
+static void pcre_deleter(pcre* pointer)
+{
+    pcre_free(pointer);
+}
+
+static void pcre_extra_deleter(pcre_extra* pointer)
+{
+#if defined(MUDLET_PCRE_JIT)
+    pcre_free_study(pointer);
+#else
+    pcre_free(pointer);
+#endif
+}
+
+#if defined(MUDLET_PCRE_JIT)
+// The default JIT stack is only 32KB on the machine stack, which complex
+// patterns on long lines can exhaust, so share one bigger one between all
+// patterns - they are only ever run from the main thread:
+static pcre_jit_stack* jitStack()
+{
+    static pcre_jit_stack* pStack = pcre_jit_stack_alloc(32 * 1024, 512 * 1024);
+    return pStack;
+}
+#endif
+
+bool TRegex::jitAvailable()
+{
+#if defined(MUDLET_PCRE_JIT)
+    static int available = -1;
+    if (available < 0) {
+        if (pcre_config(PCRE_CONFIG_JIT, &available) != 0) {
+            available = 0;
+        }
+    }
+    return available == 1;
+#else
+    return false;
+#endif
+}
+
+TRegex TRegex::compile(const QByteArray& pattern, const int options, const char** error, int* errorOffset)
+{
+    TRegex regex;
+    pcre* pCode = pcre_compile(pattern.constData(), options, error, errorOffset, nullptr);
+    if (!pCode) {
+        return regex;
+    }
+    regex.mpCode = QSharedPointer<pcre>(pCode, pcre_deleter);
+
+    int studyOptions = 0;
+#if defined(MUDLET_PCRE_JIT)
+    if (jitAvailable()) {
+        studyOptions |= PCRE_STUDY_JIT_COMPILE;
+    }
+#endif
+    const char* studyError = nullptr;
+    // A null result with no error just means that studying found nothing
+    // that would speed up matching:
+    pcre_extra* pExtra = pcre_study(pCode, studyOptions, &studyError);
+    if (pExtra) {
+        regex.mpExtra = QSharedPointer<pcre_extra>(pExtra, pcre_extra_deleter);
+#if defined(MUDLET_PCRE_JIT)
+        if (regex.isJitCompiled() && jitStack()) {
+            pcre_assign_jit_stack(pExtra, nullptr, jitStack());
+        }
+#endif
+    }
+    return regex;
+}
+
+bool TRegex::isJitCompiled() const
+{
+#if defined(MUDLET_PCRE_JIT)
+    int isJit = 0;
+    return mpExtra && pcre_fullinfo(mpCode.data(), mpExtra.data(), PCRE_INFO_JIT, &isJit) == 0 && isJit;
+#else
+    return false;
+#endif
+}
+
+int TRegex::exec(const char* subject, const int length, const int startOffset, const int options, int* ovector, const int ovecsize) const
+{
+    int rc = pcre_exec(mpCode.data(), mpExtra.data(), subject, length, startOffset, options, ovector, ovecsize);
+#if defined(MUDLET_PCRE_JIT)
+    if (rc == PCRE_ERROR_JIT_STACKLIMIT) {
+        // Even the bigger JIT stack was not enough - the interpreter is not
+        // bound by it so try again with that:
+        pcre_extra interpreted = *mpExtra;
+        interpreted.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+        rc = pcre_exec(mpCode.data(), &interpreted, subject, length, startOffset, options, ovector, ovecsize);
+    }
+#endif
+    return rc;
+}
@@ -0,0 +1,61 @@
+#ifndef MUDLET_TREGEX_H
+#define MUDLET_TREGEX_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QSharedPointer>
+#include "post_guard.h"
+
+#include <pcre.h>
+
+
+// A compiled pcre pattern together with the data from studying it - which
+// includes the JIT compiled machine code when the pcre library was built
+// with JIT support - so that every pcre_exec() on it can use them. Copies
+// share the same compiled pattern.
+class TRegex
+{
+public:
+    TRegex() {}
+
+    // Returns a null TRegex and sets error/errorOffset if the pattern does
+    // not compile; a failure to study or JIT compile it is not an error, the
+    // pattern is then just run by the interpreter:
+    static TRegex compile(const QByteArray& pattern, int options, const char** error, int* errorOffset);
+
+    bool isNull() const { return mpCode.isNull(); }
+    explicit operator bool() const { return !mpCode.isNull(); }
+    pcre* code() const { return mpCode.data(); }
+    pcre_extra* extra() const { return mpExtra.data(); }
+    bool isJitCompiled() const;
+
+    int exec(const char* subject, int length, int startOffset, int options, int* ovector, int ovecsize) const;
+    int fullInfo(int what, void* where) const { return pcre_fullinfo(mpCode.data(), mpExtra.data(), what, where); }
+
+    static bool jitAvailable();
+
+private:
+    QSharedPointer<pcre> mpCode;
+    QSharedPointer<pcre_extra> mpExtra;
+};
+
+#endif // MUDLET_TREGEX_H
@@ -0,0 +1,207 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TReplayBenchmark.h"
+
+
+#include "Host.h"
+#include "HostManager.h"
+#include "mudlet.h"
+
+#include "pre_guard.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include "post_guard.h"
+
+#include <iostream>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+
+TReplayBenchmark::TReplayBenchmark()
+: mByteCount(0)
+, mLineCount(0)
+, mTotalTime(0)
+, mCurrentStage(Telnet)
+, mStageStart(0)
+{
+    for (auto& stageTime : mStageTimes) {
+        stageTime = 0;
+    }
+}
+
+int TReplayBenchmark::run(const QString& profileName, const QString& replayFileName)
+{
+    TReplayBenchmark benchmark;
+    QString errorMessage;
+    if (!benchmark.loadReplay(replayFileName, errorMessage)) {
+        std::cerr << errorMessage.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    if (profileName.isEmpty() || !QDir(QStringLiteral("%1/.config/mudlet/profiles/%2").arg(QDir::homePath(), profileName)).exists()) {
+        std::cerr << QStringLiteral("There is no profile called \"%1\".").arg(profileName).toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    // Loads the profile's triggers, aliases, scripts and packages, just
+    // without connecting to the game server:
+    mudlet::self()->doAutoLogin(profileName, false);
+    Host* pHost = mudlet::self()->getHostManager().getHost(profileName);
+    if (!pHost || !pHost->mpConsole) {
+        std::cerr << QStringLiteral("Unable to load the profile \"%1\".").arg(profileName).toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    pHost->mpReplayBenchmark = &benchmark;
+    benchmark.mClock.start();
+    for (auto& block : benchmark.mBlocks) {
+        pHost->mTelnet.processReplayData(block.constData(), block.size());
+    }
+    benchmark.switchStage(Telnet);
+    benchmark.mTotalTime = benchmark.mClock.nsecsElapsed();
+    pHost->mpReplayBenchmark = nullptr;
+
+    std::cout << benchmark.report(profileName, replayFileName).toLocal8Bit().constData() << std::flush;
+    return 0;
+}
+
+// The same layout as cTelnet::_loadReplay() reads: blocks of a delay (not
+// used here) then the size of the data and the data itself:
+bool TReplayBenchmark::loadReplay(const QString& fileName, QString& errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMessage = QStringLiteral("Unable to open replay file \"%1\": %2.").arg(fileName, file.errorString());
+        return false;
+    }
+
+    QDataStream ifs(&file);
+    while (!ifs.atEnd()) {
+        int offset;
+        int amount;
+        ifs >> offset;
+        ifs >> amount;
+        if (ifs.status() != QDataStream::Ok || amount < 0) {
+            errorMessage = QStringLiteral("Replay file \"%1\" is damaged.").arg(fileName);
+            return false;
+        }
+        QByteArray block(amount, '\0');
+        block.resize(qMax(0, ifs.readRawData(block.data(), amount)));
+        mByteCount += block.size();
+        mBlocks.append(block);
+    }
+    return true;
+}
+
+QString TReplayBenchmark::report(const QString& profileName, const QString& replayFileName) const
+{
+    const double seconds = mTotalTime / 1.0e9;
+    QStringList msg;
+    msg << QStringLiteral("replay: \"%1\" (%2 blocks, %3 bytes)\n").arg(replayFileName, QString::number(mBlocks.size()), QString::number(mByteCount));
+    msg << QStringLiteral("profile: \"%1\"\n").arg(profileName);
+    msg << QStringLiteral("lines: %1 in %2 s, %3 lines/s, %4 bytes/s\n")
+                   .arg(mLineCount)
+                   .arg(seconds, 0, 'f', 3)
+                   .arg(seconds > 0.0 ? mLineCount / seconds : 0.0, 0, 'f', 0)
+                   .arg(seconds > 0.0 ? mByteCount / seconds : 0.0, 0, 'f', 0);
+    msg << QStringLiteral("%1 %2 %3\n").arg(QStringLiteral("stage"), -10).arg(QStringLiteral("ms"), 12).arg(QStringLiteral("share"), 6);
+    for (int i = 0; i < StageCount; ++i) {
+        msg << QStringLiteral("%1 %2 %3%\n")
+                       .arg(stageName(static_cast<Stage>(i)), -10)
+                       .arg(mStageTimes[i] / 1.0e6, 12, 'f', 3)
+                       .arg(mTotalTime ? (100.0 * mStageTimes[i]) / mTotalTime : 0.0, 5, 'f', 1);
+    }
+    const qint64 peakMemory = peakMemoryKiB();
+    if (peakMemory >= 0) {
+        msg << QStringLiteral("peak memory: %1 KiB\n").arg(peakMemory);
+    } else {
+        msg << QStringLiteral("peak memory: not available on this platform\n");
+    }
+    return msg.join(QString());
+}
+
+// Charges the time since the last switch to the current stage and makes the
+// given one current, returning the one that was:
+TReplayBenchmark::Stage TReplayBenchmark::switchStage(const Stage stage)
+{
+    const qint64 now = mClock.nsecsElapsed();
+    mStageTimes[mCurrentStage] += now - mStageStart;
+    mStageStart = now;
+    const Stage previousStage = mCurrentStage;
+    mCurrentStage = stage;
+    return previousStage;
+}
+
+QString TReplayBenchmark::stageName(const Stage stage)
+{
+    switch (stage) {
+    case Telnet:
+        return QStringLiteral("telnet");
+    case Text:
+        return QStringLiteral("text");
+    case Triggers:
+        return QStringLiteral("triggers");
+    case Lua:
+        return QStringLiteral("lua");
+    case Display:
+        return QStringLiteral("display");
+    case StageCount:
+        break;
+    }
+    return QString();
+}
+
+// For the whole process, so it includes loading the profile:
+qint64 TReplayBenchmark::peakMemoryKiB()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss / 1024; // In bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+TBenchmarkStage::TBenchmarkStage(TReplayBenchmark* pBenchmark, const TReplayBenchmark::Stage stage)
+: mpBenchmark(pBenchmark)
+, mPreviousStage(stage)
+{
+    if (mpBenchmark) {
+        mPreviousStage = mpBenchmark->switchStage(stage);
+    }
+}
+
+TBenchmarkStage::~TBenchmarkStage()
+{
+    if (mpBenchmark) {
+        mpBenchmark->switchStage(mPreviousStage);
+    }
+}
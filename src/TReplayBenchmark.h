@@ -0,0 +1,91 @@
+#ifndef MUDLET_TREPLAYBENCHMARK_H
+#define MUDLET_TREPLAYBENCHMARK_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include "post_guard.h"
+
+class TBenchmarkStage;
+
+
+// Feeds a recorded replay through the same processing as data from the game
+// server - telnet, the text buffer, the triggers and their Lua scripts - as
+// fast as it will go and without showing anything, then reports how long was
+// spent in each of those stages. Run from the command line with --benchmark.
+// Times are "self" times, as for TProfiler: the time spent in the triggers
+// is not included in that of the text buffer that runs them, and so on.
+class TReplayBenchmark
+{
+    friend class TBenchmarkStage;
+
+public:
+    enum Stage { Telnet = 0, Text, Triggers, Lua, Display, StageCount };
+
+    TReplayBenchmark();
+
+    // Returns the exit code for the application:
+    static int run(const QString& profileName, const QString& replayFileName);
+
+    void countLine() { ++mLineCount; }
+
+private:
+    bool loadReplay(const QString& fileName, QString& errorMessage);
+    QString report(const QString& profileName, const QString& replayFileName) const;
+    Stage switchStage(Stage);
+
+    static QString stageName(Stage);
+    static qint64 peakMemoryKiB();
+
+    // The whole replay is read in before it is started, so that reading the
+    // file is not part of what is timed:
+    QList<QByteArray> mBlocks;
+    qint64 mByteCount;
+    quint64 mLineCount;
+    QElapsedTimer mClock;
+    // in nanoseconds:
+    qint64 mTotalTime;
+    qint64 mStageTimes[StageCount];
+    Stage mCurrentStage;
+    qint64 mStageStart;
+};
+
+
+// Charges the time that it is in scope to a stage of the benchmark, if one is
+// running, instead of to the stage that was current when it was created:
+class TBenchmarkStage
+{
+public:
+    TBenchmarkStage(TReplayBenchmark*, TReplayBenchmark::Stage);
+    ~TBenchmarkStage();
+
+private:
+    TBenchmarkStage(const TBenchmarkStage&) = delete;
+    TBenchmarkStage& operator=(const TBenchmarkStage&) = delete;
+
+    TReplayBenchmark* mpBenchmark;
+    TReplayBenchmark::Stage mPreviousStage;
+};
+
+#endif // MUDLET_TREPLAYBENCHMARK_H
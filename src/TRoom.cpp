@@ -161,7 +161,13 @@ void TRoom::setWeight(int w)
     if (w < 1) {
         w = 1;
     }
-    weight = w;
+    if (weight != w) {
+        weight = w;
+        // The cost of the exits into this room depends on it:
+        if (mpRoomDB && mpRoomDB->mpMap) {
+            mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
+        }
+    }
 }
 
 // Previous implimentations did not allow for REMOVAL of an exit weight (by
@@ -171,12 +177,12 @@ void TRoom::setExitWeight(const QString& cmd, int w)
     if (w > 0) {
         exitWeights[cmd] = w;
         if (mpRoomDB && mpRoomDB->mpMap) {
-            mpRoomDB->mpMap->mMapGraphNeedsUpdate = true;
+            mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
         }
     } else if (exitWeights.contains(cmd)) {
         exitWeights.remove(cmd);
         if (mpRoomDB && mpRoomDB->mpMap) {
-            mpRoomDB->mpMap->mMapGraphNeedsUpdate = true;
+            mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
         }
     }
 }
@@ -299,6 +305,7 @@ bool TRoom::setExit(int to, int direction)
         return false;
     }
     mpRoomDB->updateEntranceMap(this);
+    mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
     return true;
 }
 
@@ -409,6 +416,7 @@ void TRoom::setExitLock(int exit, bool state)
     } else {
         exitLocks.removeAll(exit);
     }
+    mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
 }
 
 // The need for "to" seems superflous here, cmd is the decisive factor
@@ -437,6 +445,7 @@ void TRoom::setSpecialExitLock(int to, const QString& cmd, bool doLock)
             _cmd.replace(0, 1, '0');
             other.replace(to, _cmd);
         }
+        mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
         return;
     }
 }
@@ -462,6 +471,7 @@ bool TRoom::setSpecialExitLock(const QString& cmd, bool doLock)
                     _cmd.prepend('0');
                 }
                 it.setValue(_cmd); // We can change the value as we are using the Mutable iterator...
+                mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
                 return true;
             }
         } else { // Found it!
@@ -472,6 +482,7 @@ bool TRoom::setSpecialExitLock(const QString& cmd, bool doLock)
                 _cmd.replace(0, 1, '0');
             }
             it.setValue(_cmd);
+            mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
             return true;
         }
     }
@@ -584,14 +595,14 @@ void TRoom::setSpecialExit(int to, const QString& cmd)
         // This updates the (TArea *)->exits map even for exit REMOVALS
     }
     mpRoomDB->updateEntranceMap(this);
-    mpRoomDB->mpMap->mMapGraphNeedsUpdate = true;
+    mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
 }
 
 void TRoom::clearSpecialExits()
 {
     other.clear();
     mpRoomDB->updateEntranceMap(this);
-    mpRoomDB->mpMap->mMapGraphNeedsUpdate = true;
+    mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
 }
 
 void TRoom::removeAllSpecialExitsToRoom(int _id)
@@ -609,7 +620,7 @@ void TRoom::removeAllSpecialExitsToRoom(int _id)
         pA->determineAreaExitsOfRoom(id);
     }
     mpRoomDB->updateEntranceMap(this);
-    mpRoomDB->mpMap->mMapGraphNeedsUpdate = true;
+    mpRoomDB->mpMap->setRoomNeedsGraphUpdate(id);
 }
 
 void TRoom::calcRoomDimensions()
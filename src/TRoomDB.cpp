@@ -33,7 +33,10 @@
 #include <QApplication>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QMultiHash>
 #include <QStringBuilder>
+#include <QtEndian>
 #include "post_guard.h"
 
 
@@ -42,12 +45,24 @@ TRoomDB::TRoomDB( TMap * pMap )
 , mpTempRoomDeletionSet( 0 )
 , mUnnamedAreaName( tr( "Unnamed Area" ) )
 , mDefaultAreaName( tr( "Default Area" ) )
+, mIsSearchIndexValid( false )
+, mpIndexedMapFile( 0 )
+, mIndexedMapStreamVersion( 0 )
+, mIndexedMapFormatVersion( 0 )
+, mIndexedRoomTableOffset( 0 )
+, mIndexedRoomCount( 0 )
+, mUnloadedRoomCount( 0 )
 {
     // Ensure the default area is created, the area/areaName items that get
     // created here will get blown away when a map is loaded but that is expected...
     addArea(-1, mDefaultAreaName);
 }
 
+TRoomDB::~TRoomDB()
+{
+    releaseIndexedMapFile();
+}
+
 TRoom* TRoomDB::getRoom(int id)
 {
     if (id < 0) {
@@ -57,12 +72,154 @@ TRoom* TRoomDB::getRoom(int id)
     if (i != rooms.end() && i.key() == id) {
         return i.value();
     }
-    return 0;
+    loadAreaOfRoom(id);
+    return rooms.value(id);
+}
+
+// If the room is in an area that has not been read from the map file yet,
+// reads it, so that the room is not taken to be missing:
+void TRoomDB::loadAreaOfRoom(int id)
+{
+    int areaId;
+    if (!mUnloadedAreaSections.isEmpty() && findUnloadedRoomArea(id, areaId)) {
+        loadArea(areaId);
+    }
+}
+
+// The room table in an indexed map file is a list of (room id, area id) pairs
+// of big-endian 32-bit values sorted by room id, so it can be searched where
+// it is in the file:
+bool TRoomDB::findUnloadedRoomArea(int id, int& areaId) const
+{
+    const uchar* pTable = reinterpret_cast<const uchar*>(mIndexedMapData.constData()) + mIndexedRoomTableOffset;
+    int low = 0;
+    int high = mIndexedRoomCount - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int middleId = qFromBigEndian<qint32>(pTable + middle * 8);
+        if (middleId < id) {
+            low = middle + 1;
+        } else if (middleId > id) {
+            high = middle - 1;
+        } else {
+            areaId = qFromBigEndian<qint32>(pTable + middle * 8 + 4);
+            // Rooms that have been deleted since the map was loaded are still
+            // in the table, but their area will have been loaded:
+            return mUnloadedAreaSections.contains(areaId);
+        }
+    }
+    return false;
+}
+
+bool TRoomDB::restoreIndexedRooms(const QString& fileName, int streamVersion, int formatVersion, qint64 areaTableOffset, qint64 roomTableOffset, int roomCount)
+{
+    releaseIndexedMapFile();
+    mpIndexedMapFile = new QFile(fileName);
+    if (!mpIndexedMapFile->open(QFile::ReadOnly)) {
+        mpMap->postMessage(tr("[ ERROR ] - Unable to open map file \"%1\" again to read the rooms from it, reason: %2.").arg(fileName, mpIndexedMapFile->errorString()));
+        releaseIndexedMapFile();
+        return false;
+    }
+
+    qint64 fileSize = mpIndexedMapFile->size();
+    uchar* pData = mpIndexedMapFile->map(0, fileSize);
+    if (pData) {
+        mIndexedMapData = QByteArray::fromRawData(reinterpret_cast<const char*>(pData), static_cast<int>(fileSize));
+    } else {
+        // Not everything can be memory mapped, so just read it all in then:
+        mIndexedMapData = mpIndexedMapFile->readAll();
+    }
+
+    bool isValid = roomCount >= 0 && roomTableOffset > 0 && roomTableOffset + roomCount * 8LL <= mIndexedMapData.size() && areaTableOffset > 0 && areaTableOffset < mIndexedMapData.size();
+    if (isValid) {
+        QDataStream ifs(QByteArray::fromRawData(mIndexedMapData.constData() + areaTableOffset, mIndexedMapData.size() - static_cast<int>(areaTableOffset)));
+        ifs.setVersion(streamVersion);
+        int sectionCount = 0;
+        ifs >> sectionCount;
+        for (int i = 0; i < sectionCount && isValid; ++i) {
+            int areaId;
+            AreaSection section;
+            ifs >> areaId;
+            ifs >> section.roomCount;
+            ifs >> section.offset;
+            ifs >> section.length;
+            isValid = ifs.status() == QDataStream::Ok && section.offset > 0 && section.length >= 0 && section.offset + section.length <= mIndexedMapData.size();
+            if (isValid && section.roomCount > 0) {
+                mUnloadedAreaSections.insert(areaId, section);
+                mUnloadedRoomCount += section.roomCount;
+            }
+        }
+    }
+    if (!isValid) {
+        mpMap->postMessage(tr("[ ERROR ] - The room tables in map file \"%1\" are damaged, no rooms could be read from it.").arg(fileName));
+        releaseIndexedMapFile();
+        return false;
+    }
+
+    mIndexedMapStreamVersion = streamVersion;
+    mIndexedMapFormatVersion = formatVersion;
+    mIndexedRoomTableOffset = roomTableOffset;
+    mIndexedRoomCount = roomCount;
+    if (mUnloadedAreaSections.isEmpty()) {
+        releaseIndexedMapFile();
+    }
+    return true;
+}
+
+void TRoomDB::loadArea(int areaId)
+{
+    auto itSection = mUnloadedAreaSections.find(areaId);
+    if (itSection == mUnloadedAreaSections.end()) {
+        return;
+    }
+    // Taken out first, as adding the rooms looks them up again:
+    AreaSection section = itSection.value();
+    mUnloadedAreaSections.erase(itSection);
+    mUnloadedRoomCount -= section.roomCount;
+
+    QDataStream ifs(QByteArray::fromRawData(mIndexedMapData.constData() + section.offset, static_cast<int>(section.length)));
+    ifs.setVersion(mIndexedMapStreamVersion);
+    while (!ifs.atEnd()) {
+        int i;
+        ifs >> i;
+        auto pT = new TRoom(this);
+        pT->restore(ifs, i, mIndexedMapFormatVersion);
+        if (!addRoom(i, pT, true)) {
+            qWarning().nospace().noquote() << "TRoomDB::loadArea(" << areaId << ") WARNING - unable to add room " << i << " from the map file, a room with that id already exists, the one from the file has been discarded!";
+            delete pT;
+        }
+    }
+
+    if (mUnloadedAreaSections.isEmpty()) {
+        releaseIndexedMapFile();
+    }
+}
+
+void TRoomDB::loadAllAreas()
+{
+    while (!mUnloadedAreaSections.isEmpty()) {
+        loadArea(mUnloadedAreaSections.constBegin().key());
+    }
+}
+
+void TRoomDB::releaseIndexedMapFile()
+{
+    mUnloadedAreaSections.clear();
+    mUnloadedRoomCount = 0;
+    mIndexedRoomCount = 0;
+    // This may point into the mapped file so must go before that does:
+    mIndexedMapData.clear();
+    if (mpIndexedMapFile) {
+        mpIndexedMapFile->close(); // Also unmaps it
+        delete mpIndexedMapFile;
+        mpIndexedMapFile = 0;
+    }
 }
 
 bool TRoomDB::addRoom(int id)
 {
     qDebug() << "addRoom(" << id << ")";
+    loadAreaOfRoom(id);
     if (!rooms.contains(id) && id > 0) {
         rooms[id] = new TRoom(this);
         rooms[id]->setId(id);
@@ -79,51 +236,20 @@ bool TRoomDB::addRoom(int id)
 
 bool TRoomDB::addRoom(int id, TRoom* pR, bool isMapLoading)
 {
+    if (!isMapLoading) {
+        loadAreaOfRoom(id);
+    }
     if (!rooms.contains(id) && id > 0 && pR) {
         rooms[id] = pR;
         pR->setId(id);
         updateEntranceMap(pR, isMapLoading);
+        updateSearchIndex(id);
         return true;
     } else {
         return false;
     }
 }
 
-void TRoomDB::deleteValuesFromEntranceMap(int value)
-{
-    QList<int> keyList = entranceMap.keys();
-    QList<int> valueList = entranceMap.values();
-    QList<uint> deleteEntries;
-    int index = valueList.indexOf(value);
-    while (index != -1) {
-        deleteEntries.append(index);
-        index = valueList.indexOf(value, index + 1);
-    }
-    for (int i = deleteEntries.size() - 1; i >= 0; --i) {
-        entranceMap.remove(keyList.at(deleteEntries.at(i)), valueList.at(deleteEntries.at(i)));
-    }
-}
-
-void TRoomDB::deleteValuesFromEntranceMap(QSet<int>& valueSet)
-{
-    QElapsedTimer timer;
-    timer.start();
-    QList<int> keyList = entranceMap.keys();
-    QList<int> valueList = entranceMap.values();
-    QList<uint> deleteEntries;
-    foreach (int roomId, valueSet) {
-        int index = valueList.indexOf(roomId);
-        while (index >= 0) {
-            deleteEntries.append(index);
-            index = valueList.indexOf(roomId, index + 1);
-        }
-    }
-    for (unsigned int entry : deleteEntries) {
-        entranceMap.remove(keyList.at(entry), valueList.at(entry));
-    }
-    qDebug() << "TRoomDB::deleteValuesFromEntranceMap() with a list of:" << valueSet.size() << "items, run time:" << timer.nsecsElapsed() * 1.0e-9 << "sec.";
-}
-
 void TRoomDB::updateEntranceMap(int id)
 {
     TRoom* pR = getRoom(id);
@@ -137,35 +263,40 @@ void TRoomDB::updateEntranceMap(TRoom* pR, bool isMapLoading)
     // entranceMap maps the room to rooms it has a viable exit to. So if room b and c both have
     // an exit to room a, upon deleting room a we want a map that allows us to find
     // room b and c efficiently.
-    // So we create a mapping like: {room_a: room_b, room_a: room_c}. This allows us to delete
+    // So we create a mapping like: {room_a: {room_b, room_c}}. This allows us to delete
     // rooms and know which other rooms are impacted by this change in a single lookup.
+    // exitTargetMap holds the same links the other way round, so that only
+    // the entries for the exits that have changed need to be touched here.
     if (pR) {
         int id = pR->getId();
-        QHash<int, int> exits = pR->getExits();
-        QList<int> toExits = exits.keys();
-        QString values;
-        // to update this we need to iterate the entire entranceMap and remove invalid
-        // connections. I'm not sure if this is efficient for every update, and given
-        // that we check for rooms existance when the map is used, we'll deal with
-        // possible spurious exits for now.
-        // entranceMap.remove(id); // <== not what is wanted
-        // We need to remove all values == id NOT keys == id, so try and do that
-        // now. SlySven
-
-        if (!isMapLoading) {
-            deleteValuesFromEntranceMap(id); // When LOADING a map, will never need to do this
+        QSet<int> toExits = pR->getExits().keys().toSet();
+        QSet<int> oldToExits;
+        if (!isMapLoading) { // When LOADING a map, there will never be any
+            oldToExits = exitTargetMap.value(id);
+            QSetIterator<int> itOldToExit(oldToExits);
+            while (itOldToExit.hasNext()) {
+                int oldToExit = itOldToExit.next();
+                if (!toExits.contains(oldToExit)) {
+                    removeEntrance(oldToExit, id);
+                }
+            }
         }
-        for (int toExit : toExits) {
+        QString values;
+        QSetIterator<int> itToExit(toExits);
+        while (itToExit.hasNext()) {
+            int toExit = itToExit.next();
             if (showDebug) {
                 values.append(QStringLiteral("%1,").arg(toExit));
             }
-            if (!entranceMap.contains(toExit, id)) {
-                // entranceMap is a QMultiHash, so multiple, identical entries is
-                // more than possible - it was actually happening and making
-                // entranceMap get larger than needed...!
-                entranceMap.insert(toExit, id);
+            if (!oldToExits.contains(toExit)) {
+                entranceMap[toExit].insert(id);
             }
         }
+        if (toExits.isEmpty()) {
+            exitTargetMap.remove(id);
+        } else {
+            exitTargetMap.insert(id, toExits);
+        }
         if (showDebug) {
             if (!values.isEmpty()) {
                 values.chop(1);
@@ -179,47 +310,66 @@ void TRoomDB::updateEntranceMap(TRoom* pR, bool isMapLoading)
     }
 }
 
+void TRoomDB::removeEntrance(int toId, int fromId)
+{
+    auto itEntrances = entranceMap.find(toId);
+    if (itEntrances != entranceMap.end()) {
+        itEntrances.value().remove(fromId);
+        if (itEntrances.value().isEmpty()) {
+            entranceMap.erase(itEntrances);
+        }
+    }
+}
+
+// Drops everything about the given room from entranceMap and exitTargetMap,
+// which only involves the rooms that it is linked to:
+void TRoomDB::removeFromEntranceMap(int id)
+{
+    QSetIterator<int> itToExit(exitTargetMap.take(id));
+    while (itToExit.hasNext()) {
+        removeEntrance(itToExit.next(), id);
+    }
+    QSetIterator<int> itFromRoom(entranceMap.take(id));
+    while (itFromRoom.hasNext()) {
+        auto itToExits = exitTargetMap.find(itFromRoom.next());
+        if (itToExits != exitTargetMap.end()) {
+            itToExits.value().remove(id);
+            if (itToExits.value().isEmpty()) {
+                exitTargetMap.erase(itToExits);
+            }
+        }
+    }
+}
+
+void TRoomDB::rebuildEntranceMap()
+{
+    entranceMap.clear();
+    exitTargetMap.clear();
+    QHashIterator<int, TRoom*> itRoom(rooms);
+    while (itRoom.hasNext()) {
+        itRoom.next();
+        updateEntranceMap(itRoom.value(), true);
+    }
+}
+
 // this is call by TRoom destructor only
 bool TRoomDB::__removeRoom(int id)
 {
-    static QMultiHash<int, int> _entranceMap; // Make it persistant - for multiple room deletions
-    static bool isBulkDelete = false;
-    // Gets set / reset by mpTempRoomDeletionSet being non-null, used to setup
-    // _entranceMap the first time around for multi-room deletions
-
     TRoom* pR = getRoom(id);
     // This will FAIL during map deletion as TRoomDB::rooms has already been
     // zapped, so can use to skip everything...
     if (pR) {
-        if (mpTempRoomDeletionSet && mpTempRoomDeletionSet->size() > 1) { // We are deleting multiple rooms
-            if (!isBulkDelete) {
-                _entranceMap = entranceMap;
-                _entranceMap.detach(); // MUST take a deep copy of the data
-                isBulkDelete = true;   // But only do it the first time for a bulk delete
-            }
-        } else {                // We are deleting a single room
-            if (isBulkDelete) { // Last time was a bulk delete but it isn't one now
-                isBulkDelete = false;
-            }
-            _entranceMap.clear();
-            _entranceMap = entranceMap; // Refresh our local copy
-            _entranceMap.detach();      // MUST take a deep copy of the data
-        }
-
         // FIXME: make a proper exit controller so we don't need to do all these if statements
         // Remove the links from the rooms entering this room
-        QMultiHash<int, int>::const_iterator i = _entranceMap.find(id);
-        // The removeAllSpecialExitsToRoom below modifies the entranceMap - and
-        // it is unsafe to modify (use copy operations on) something that an STL
-        // iterator is active on - see "Implicit sharing iterator problem" in
-        // "Container Class | Qt 5.x Core" - this is now avoid by taking a deep
-        // copy and iterating through that instead whilst modifying the original
-        while (i != entranceMap.end() && i.key() == id) {
-            if (i.value() == id || (mpTempRoomDeletionSet && mpTempRoomDeletionSet->size() > 1 && mpTempRoomDeletionSet->contains(i.value()))) {
-                ++i;
+        // The exit changes below modify the entranceMap, so work through a copy
+        // of this room's entry in it:
+        QSetIterator<int> itEntrance(entranceMap.value(id));
+        while (itEntrance.hasNext()) {
+            int fromRoomId = itEntrance.next();
+            if (fromRoomId == id || (mpTempRoomDeletionSet && mpTempRoomDeletionSet->size() > 1 && mpTempRoomDeletionSet->contains(fromRoomId))) {
                 continue; // Bypass rooms we know are also to be deleted
             }
-            TRoom* r = getRoom(i.value());
+            TRoom* r = getRoom(fromRoomId);
             if (r) {
                 if (r->getNorth() == id) {
                     r->setNorth(-1);
@@ -259,30 +409,23 @@ bool TRoomDB::__removeRoom(int id)
                 }
                 r->removeAllSpecialExitsToRoom(id);
             }
-            ++i;
         }
         rooms.remove(id);
-        // FIXME: make hashTable a bimap
-        QList<QString> keyList = hashTable.keys();
-        QList<int> valueList = hashTable.values();
-        for (int i = 0; i < valueList.size(); i++) {
-            if (valueList[i] == id) {
-                hashTable.remove(keyList[i]);
-            }
+        for (const QString& hash : mRoomHashes.values(id)) {
+            hashTable.remove(hash);
         }
+        mRoomHashes.remove(id);
+        updateSearchIndex(id);
         int areaID = pR->getArea();
         TArea* pA = getArea(areaID);
         if (pA) {
-            pA->removeRoom(id);
+            // For multiple rooms the area extents are redone once at the end:
+            pA->removeRoom(id, mpTempRoomDeletionSet && mpTempRoomDeletionSet->size() > 1);
         }
-        if ((!mpTempRoomDeletionSet) || mpTempRoomDeletionSet->size() == 1) { // if NOT deleting multiple rooms
-            entranceMap.remove(id);                                           // Only removes matching keys
-            deleteValuesFromEntranceMap(id);                                  // Needed to remove matching values
-        }
-        // Because we clear the graph in initGraph which will be called
-        // if mMapGraphNeedsUpdate is true -- we don't need to
-        // remove the vertex using clear_vertex and remove_vertex here
-        mpMap->mMapGraphNeedsUpdate = true;
+        removeFromEntranceMap(id);
+        // The room's vertex is cleared out of the route finding graph the next
+        // time that it is used - this room can not be looked at by then:
+        mpMap->setRoomNeedsGraphUpdate(id);
         return true;
     }
     return false;
@@ -290,6 +433,8 @@ bool TRoomDB::__removeRoom(int id)
 
 bool TRoomDB::removeRoom(int id)
 {
+    // The rooms with exits to this one could be anywhere:
+    loadAllAreas();
     if (rooms.contains(id) && id > 0) {
         if (mpMap->mRoomIdHash.value(mpMap->mpHost->getName()) == id) {
             // Now we store mRoomId for each profile, we must remove any where
@@ -313,7 +458,8 @@ void TRoomDB::removeRoom(QSet<int>& ids)
 {
     QElapsedTimer timer;
     timer.start();
-    QSet<int> deletedRoomIds;
+    loadAllAreas();
+    QSet<int> areaIds;
     mpTempRoomDeletionSet = &ids; // Will activate "bulk room deletion" code
                                   // When used by TLuaInterpreter::deleteArea()
                                   // via removeArea(int) the list of rooms to
@@ -326,15 +472,18 @@ void TRoomDB::removeRoom(QSet<int>& ids)
         int deleteRoomId = *(mpTempRoomDeletionSet->constBegin());
         TRoom* pR = getRoom(deleteRoomId);
         if (pR) {
-            deletedRoomIds.insert(deleteRoomId);
+            areaIds.insert(pR->getArea());
             delete pR;
         }
         mpTempRoomDeletionSet->remove(deleteRoomId);
     }
-    foreach (int deleteRoomId, deletedRoomIds) {
-        entranceMap.remove(deleteRoomId); // This has been deferred from __removeRoom()
+    QSetIterator<int> itAreaId(areaIds);
+    while (itAreaId.hasNext()) {
+        TArea* pA = getArea(itAreaId.next());
+        if (pA) {
+            pA->calcSpan();
+        }
     }
-    deleteValuesFromEntranceMap(deletedRoomIds);
     mpTempRoomDeletionSet->clear();
     mpTempRoomDeletionSet = 0;
     qDebug() << "TRoomDB::removeRoom(QList<int>) run time for" << roomcount << "rooms:" << timer.nsecsElapsed() * 1.0e-9 << "sec.";
@@ -343,6 +492,7 @@ void TRoomDB::removeRoom(QSet<int>& ids)
 bool TRoomDB::removeArea(int id)
 {
     if (TArea* pA = areas.value(id)) {
+        loadAllAreas();
         if (!rooms.isEmpty()) {
             // During map deletion rooms will already
             // have been cleared so this would not
@@ -401,6 +551,7 @@ void TRoomDB::buildAreas()
 {
     QElapsedTimer timer;
     timer.start();
+    loadAllAreas();
     QHashIterator<int, TRoom*> it(rooms);
     while (it.hasNext()) {
         it.next();
@@ -430,11 +581,13 @@ void TRoomDB::buildAreas()
 
 const QList<TRoom*> TRoomDB::getRoomPtrList()
 {
+    loadAllAreas();
     return rooms.values();
 }
 
 QList<int> TRoomDB::getRoomIDList()
 {
+    loadAllAreas();
     return rooms.keys();
 }
 
@@ -601,6 +754,7 @@ QList<int> TRoomDB::getAreaIDList()
  */
 void TRoomDB::auditRooms(QHash<int, int>& roomRemapping, QHash<int, int>& areaRemapping)
 {
+    loadAllAreas();
     QSet<int> validUsedRoomIds; // Used good ids (>= 1)
     QSet<int> validUsedAreaIds; // As rooms
 
@@ -1073,20 +1227,35 @@ void TRoomDB::auditRooms(QHash<int, int>& roomRemapping, QHash<int, int>& areaRe
                 pA->mIsDirty = true;
             }
             pA->rooms = foundRooms;
+            // The room set has been worked on directly (and room ids may have
+            // been renumbered) so the area's spatial index must be redone:
+            pA->invalidateSpatialIndex();
         }
     }
     // END OF TASK 8
+
+    // Rooms may have been renumbered and their exits changed behind the back
+    // of updateEntranceMap() so redo the links between them from scratch:
+    rebuildEntranceMap();
+    // ... and the same goes for their user data:
+    mIsSearchIndexValid = false;
 }
 
 void TRoomDB::clearMapDB()
 {
     QElapsedTimer timer;
     timer.start();
+    // The rooms that have not been read in yet can just be forgotten:
+    releaseIndexedMapFile();
     QList<TRoom*> rPtrL = getRoomPtrList();
     rooms.clear(); // Prevents any further use of TRoomDB::getRoom(int) !!!
     entranceMap.clear();
+    exitTargetMap.clear();
     areaNamesMap.clear();
     hashTable.clear();
+    mRoomHashes.clear();
+    mSearchIndex.clear();
+    mIsSearchIndexValid = false;
     for (auto room : rPtrL) {
         delete room; // Uses the internally held value of the room Id
                      // (TRoom::id) to call TRoomDB::__removeRoom(id)
@@ -1103,6 +1272,58 @@ void TRoomDB::clearMapDB()
     qDebug() << "TRoomDB::clearMapDB() run time:" << timer.nsecsElapsed() * 1.0e-9 << "sec.";
 }
 
+const TRoomSearchIndex& TRoomDB::getSearchIndex()
+{
+    if (!mIsSearchIndexValid) {
+        loadAllAreas();
+        mSearchIndex.clear();
+        QHashIterator<int, TRoom*> itRoom(rooms);
+        while (itRoom.hasNext()) {
+            itRoom.next();
+            mSearchIndex.addRoom(itRoom.key(), itRoom.value());
+        }
+        mIsSearchIndexValid = true;
+    }
+    return mSearchIndex;
+}
+
+void TRoomDB::updateSearchIndex(int id)
+{
+    // Until the index is needed there is nothing to keep up to date:
+    if (!mIsSearchIndexValid) {
+        return;
+    }
+
+    TRoom* pR = getRoom(id);
+    if (pR) {
+        mSearchIndex.addRoom(id, pR);
+    } else {
+        mSearchIndex.removeRoom(id);
+    }
+}
+
+void TRoomDB::setRoomHash(const QString& hash, int id)
+{
+    auto itHash = hashTable.find(hash);
+    if (itHash != hashTable.end()) {
+        mRoomHashes.remove(itHash.value(), hash);
+    }
+    hashTable.insert(hash, id);
+    mRoomHashes.insert(id, hash);
+}
+
+void TRoomDB::restoreHashTable(QDataStream& ifs)
+{
+    // Is stored in the same form as the QMap that it used to be:
+    ifs >> hashTable;
+    mRoomHashes.clear();
+    QHashIterator<QString, int> itHash(hashTable);
+    while (itHash.hasNext()) {
+        itHash.next();
+        mRoomHashes.insert(itHash.value(), itHash.key());
+    }
+}
+
 void TRoomDB::restoreAreaMap(QDataStream& ifs)
 {
     QMap<int, QString> areaNamesMapWithPossibleEmptyOrDuplicateItems;
@@ -23,14 +23,20 @@
  ***************************************************************************/
 
 
+#include "TRoomSearchIndex.h"
+
 #include "pre_guard.h"
 #include <QApplication>
+#include <QByteArray>
 #include <QHash>
 #include <QMap>
 #include <QMultiHash>
+#include <QSet>
 #include <QString>
 #include "post_guard.h"
 
+class QFile;
+
 class TArea;
 class TMap;
 class TRoom;
@@ -42,12 +48,13 @@ class TRoomDB
 
 public:
     TRoomDB(TMap*);
+    ~TRoomDB();
 
     TRoom* getRoom(int id);
     TArea* getArea(int id);
     TArea* getRawArea(int, bool*);
     bool addRoom(int id);
-    int size() { return rooms.size(); }
+    int size() { return rooms.size() + mUnloadedRoomCount; }
     bool removeRoom(int);
     void removeRoom(QSet<int>&);
     bool removeArea(int id);
@@ -59,16 +66,23 @@ public:
     bool setAreaName(int areaID, QString name);
     const QList<TRoom*> getRoomPtrList();
     const QList<TArea*> getAreaPtrList();
-    const QHash<int, TRoom*>& getRoomMap() const { return rooms; }
+    const QHash<int, TRoom*>& getRoomMap()
+    {
+        loadAllAreas();
+        return rooms;
+    }
     const QMap<int, TArea*>& getAreaMap() const { return areas; }
     QList<int> getRoomIDList();
     QList<int> getAreaIDList();
     const QMap<int, QString>& getAreaNamesMap() const { return areaNamesMap; }
     void updateEntranceMap(TRoom*, bool isMapLoading = false);
     void updateEntranceMap(int);
-    const QMultiHash<int, int>& getEntranceHash() const { return entranceMap; }
-    void deleteValuesFromEntranceMap(int);
-    void deleteValuesFromEntranceMap(QSet<int>&);
+    // The rooms that have an exit to the given one:
+    QSet<int> getEntrances(int roomId)
+    {
+        loadAllAreas();
+        return entranceMap.value(roomId);
+    }
 
     void buildAreas();
     void clearMapDB();
@@ -78,10 +92,27 @@ public:
     void restoreAreaMap(QDataStream&);
     void restoreSingleArea(int, TArea*);
     void restoreSingleRoom(int, TRoom*);
+    // For maps read from an indexed (version 19+) file only the tables of
+    // where things are in it are read at first, the rooms of each area are
+    // read from the (memory mapped) file the first time that one is needed:
+    bool restoreIndexedRooms(const QString& fileName, int streamVersion, int formatVersion, qint64 areaTableOffset, qint64 roomTableOffset, int roomCount);
+    void loadArea(int areaId);
+    void loadAllAreas();
+    bool hasUnloadedAreas() const { return !mUnloadedAreaSections.isEmpty(); }
+    bool isAreaUnloaded(int areaId) const { return mUnloadedAreaSections.contains(areaId); }
     const QString getDefaultAreaName() { return mDefaultAreaName; }
 
+    // For the room name and user data searches, the index is built the first
+    // time that it is needed after a map is loaded:
+    const TRoomSearchIndex& getSearchIndex();
+    // To be called when a room's name or user data has been changed:
+    void updateSearchIndex(int id);
 
-    QMap<QString, int> hashTable;
+    // The hashes that scripts can use to identify rooms by:
+    void setRoomHash(const QString& hash, int id);
+    int getRoomIdByHash(const QString& hash) const { return hashTable.value(hash, -1); }
+    const QHash<QString, int>& getHashTable() const { return hashTable; }
+    void restoreHashTable(QDataStream&);
 
 
 private:
@@ -89,15 +120,44 @@ private:
     int createNewAreaID();
     bool __removeRoom(int id);
     void setAreaRooms(const int, const QSet<int>&); // Used by XMLImport to fix rooms data after import
+    void removeEntrance(int toId, int fromId);
+    void removeFromEntranceMap(int id);
+    void rebuildEntranceMap();
+    bool findUnloadedRoomArea(int id, int& areaId) const;
+    void loadAreaOfRoom(int id);
+    void releaseIndexedMapFile();
+
+    struct AreaSection
+    {
+        qint64 offset;
+        qint64 length;
+        int roomCount;
+    };
 
     QHash<int, TRoom*> rooms;
-    QMultiHash<int, int> entranceMap; // key is exit target, value is exit source
+    QHash<int, QSet<int>> entranceMap;   // key is exit target, value is exit sources
+    QHash<int, QSet<int>> exitTargetMap; // key is exit source, value is exit targets
     QMap<int, TArea*> areas;
     QMap<int, QString> areaNamesMap;
     TMap* mpMap;
     QSet<int>* mpTempRoomDeletionSet; // Used during bulk room deletion
     QString mUnnamedAreaName;
     QString mDefaultAreaName;
+    QHash<QString, int> hashTable;
+    QMultiHash<int, QString> mRoomHashes; // key is room id, values are its hashes
+    TRoomSearchIndex mSearchIndex;
+    bool mIsSearchIndexValid;
+    // The map file that the rooms not read in yet are in, with its contents
+    // (normally memory mapped rather than copied) and the parts of it that
+    // are needed to find them:
+    QFile* mpIndexedMapFile;
+    QByteArray mIndexedMapData;
+    int mIndexedMapStreamVersion;
+    int mIndexedMapFormatVersion;
+    qint64 mIndexedRoomTableOffset;
+    int mIndexedRoomCount;
+    QHash<int, AreaSection> mUnloadedAreaSections; // key is area id
+    int mUnloadedRoomCount;
 
     friend class TRoom; //friend TRoom::~TRoom();
     //friend class TMap;//bool TMap::restore(QString location);
@@ -0,0 +1,173 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TRoomSearchIndex.h"
+
+
+#include "TRoom.h"
+
+#include <algorithm>
+
+
+// Takes the room out of the set for the given key, and the set out of the
+// hash once it is empty:
+template <typename Key>
+static void removeFromIndex(QHash<Key, QSet<int>>& index, const Key& key, int id)
+{
+    auto itRooms = index.find(key);
+    if (itRooms != index.end()) {
+        itRooms.value().remove(id);
+        if (itRooms.value().isEmpty()) {
+            index.erase(itRooms);
+        }
+    }
+}
+
+void TRoomSearchIndex::clear()
+{
+    mNames.clear();
+    mUserData.clear();
+    mRoomsByName.clear();
+    mRoomsByTrigram.clear();
+    mRoomsByUserData.clear();
+}
+
+quint64 TRoomSearchIndex::trigramAt(const QString& text, int position)
+{
+    return (static_cast<quint64>(text.at(position).unicode()) << 32) | (static_cast<quint64>(text.at(position + 1).unicode()) << 16) | text.at(position + 2).unicode();
+}
+
+void TRoomSearchIndex::addRoom(int id, const TRoom* pR)
+{
+    removeRoom(id);
+    if (!pR) {
+        return;
+    }
+
+    mNames.insert(id, pR->name);
+    const QString foldedName = pR->name.toCaseFolded();
+    mRoomsByName[foldedName].insert(id);
+    for (int i = 0, total = foldedName.size() - 2; i < total; ++i) {
+        mRoomsByTrigram[trigramAt(foldedName, i)].insert(id);
+    }
+
+    if (!pR->userData.isEmpty()) {
+        mUserData.insert(id, pR->userData);
+        QMapIterator<QString, QString> itData(pR->userData);
+        while (itData.hasNext()) {
+            itData.next();
+            mRoomsByUserData[itData.key()][itData.value()].insert(id);
+        }
+    }
+}
+
+void TRoomSearchIndex::removeRoom(int id)
+{
+    auto itName = mNames.find(id);
+    if (itName != mNames.end()) {
+        const QString foldedName = itName.value().toCaseFolded();
+        removeFromIndex(mRoomsByName, foldedName, id);
+        for (int i = 0, total = foldedName.size() - 2; i < total; ++i) {
+            removeFromIndex(mRoomsByTrigram, trigramAt(foldedName, i), id);
+        }
+        mNames.erase(itName);
+    }
+
+    auto itUserData = mUserData.find(id);
+    if (itUserData != mUserData.end()) {
+        QMapIterator<QString, QString> itData(itUserData.value());
+        while (itData.hasNext()) {
+            itData.next();
+            auto itKey = mRoomsByUserData.find(itData.key());
+            if (itKey != mRoomsByUserData.end()) {
+                removeFromIndex(itKey.value(), itData.value(), id);
+                if (itKey.value().isEmpty()) {
+                    mRoomsByUserData.erase(itKey);
+                }
+            }
+        }
+        mUserData.erase(itUserData);
+    }
+}
+
+bool TRoomSearchIndex::isNameMatch(int id, const QString& name, bool isCaseSensitive, bool isExactMatch) const
+{
+    const QString& roomName = mNames.value(id);
+    if (isExactMatch) {
+        return !roomName.compare(name, isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    }
+    return roomName.contains(name, isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+}
+
+QList<int> TRoomSearchIndex::findRoomsByName(const QString& name, bool isCaseSensitive, bool isExactMatch) const
+{
+    QList<int> results;
+    const QString foldedName = name.toCaseFolded();
+    QSet<int> candidates;
+    if (isExactMatch) {
+        candidates = mRoomsByName.value(foldedName);
+    } else if (foldedName.size() < 3) {
+        // Too short to have any runs of three characters to look up, but
+        // checking the indexed names still saves going through the rooms:
+        QHashIterator<int, QString> itName(mNames);
+        while (itName.hasNext()) {
+            itName.next();
+            if (isNameMatch(itName.key(), name, isCaseSensitive, false)) {
+                results.append(itName.key());
+            }
+        }
+        return results;
+    } else {
+        // Start with the least used run of three and then only keep the rooms
+        // that have all the others as well:
+        QList<const QSet<int>*> roomSets;
+        for (int i = 0, total = foldedName.size() - 2; i < total; ++i) {
+            auto itRooms = mRoomsByTrigram.constFind(trigramAt(foldedName, i));
+            if (itRooms == mRoomsByTrigram.constEnd()) {
+                return results;
+            }
+            roomSets.append(&itRooms.value());
+        }
+        std::sort(roomSets.begin(), roomSets.end(), [](const QSet<int>* a, const QSet<int>* b) { return a->size() < b->size(); });
+        candidates = *roomSets.first();
+        for (int i = 1, total = roomSets.size(); i < total && !candidates.isEmpty(); ++i) {
+            candidates.intersect(*roomSets.at(i));
+        }
+    }
+
+    // The runs of three being present does not mean that they are in the
+    // right order, and a case sensitive search has to look at the real name:
+    QSetIterator<int> itCandidate(candidates);
+    while (itCandidate.hasNext()) {
+        int id = itCandidate.next();
+        if (isNameMatch(id, name, isCaseSensitive, isExactMatch)) {
+            results.append(id);
+        }
+    }
+    return results;
+}
+
+QList<int> TRoomSearchIndex::findRoomsByUserData(const QString& key, const QString& value) const
+{
+    auto itKey = mRoomsByUserData.constFind(key);
+    if (itKey == mRoomsByUserData.constEnd()) {
+        return QList<int>();
+    }
+    return itKey.value().value(value).toList();
+}
@@ -0,0 +1,68 @@
+#ifndef MUDLET_TROOMSEARCHINDEX_H
+#define MUDLET_TROOMSEARCHINDEX_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "post_guard.h"
+
+class TRoom;
+
+
+// Inverted indexes of the room names and user data, for the Lua searchRoom()
+// and searchRoomUserData() functions. Names are indexed whole and by each run
+// of three (case folded) characters in them, so that a search for part of a
+// name only has to check the rooms that have all of the runs of three that
+// are in what is being looked for. A copy of what each room was indexed with
+// is kept (cheaply, as Qt shares the data until either copy is changed) so
+// that it can be taken out again when the room changes.
+class TRoomSearchIndex
+{
+public:
+    void clear();
+    void addRoom(int id, const TRoom* pR);
+    void removeRoom(int id);
+
+    QList<int> findRoomsByName(const QString& name, bool isCaseSensitive, bool isExactMatch) const;
+    QList<int> findRoomsByUserData(const QString& key, const QString& value) const;
+    QStringList getUserDataKeys() const { return mRoomsByUserData.keys(); }
+    QStringList getUserDataValues(const QString& key) const { return mRoomsByUserData.value(key).keys(); }
+
+private:
+    static quint64 trigramAt(const QString& text, int position);
+    bool isNameMatch(int id, const QString& name, bool isCaseSensitive, bool isExactMatch) const;
+
+    QHash<int, QString> mNames;
+    QHash<int, QMap<QString, QString>> mUserData;
+    // key = case folded name:
+    QHash<QString, QSet<int>> mRoomsByName;
+    // key = three case folded characters:
+    QHash<quint64, QSet<int>> mRoomsByTrigram;
+    // key = user data key, value = (key = user data value, value = rooms):
+    QHash<QString, QHash<QString, QSet<int>>> mRoomsByUserData;
+};
+
+#endif // MUDLET_TROOMSEARCHINDEX_H
@@ -24,6 +24,7 @@
 
 #include "Host.h"
 #include "TDebug.h"
+#include "TReplayBenchmark.h"
 #include "mudlet.h"
 
 
@@ -98,6 +99,8 @@ void TScript::callEventHandler(const TEvent& pE)
 {
     // Only call this event handler if this script and all its ancestors are active:
     if (isActive() && ancestorsActive()) {
+        TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Script, mID, mName, TProfiler::Executing);
+        TBenchmarkStage benchmarkStage(mpHost->mpReplayBenchmark, TReplayBenchmark::Lua);
         mpHost->mLuaInterpreter.callEventHandler(mName, pE);
     }
 }
@@ -0,0 +1,84 @@
+#ifndef MUDLET_TSPSCQUEUE_H
+#define MUDLET_TSPSCQUEUE_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <atomic>
+#include <utility>
+
+
+// An unbounded, lock free queue for passing items from exactly one producer
+// thread to exactly one consumer thread. It is a linked list with a dummy
+// node at the head: only the producer touches mpTail and only the consumer
+// touches mpHead, the two meeting only through the atomic next pointers.
+template <typename T>
+class TSpscQueue
+{
+public:
+    TSpscQueue() : mpHead(new Node), mpTail(mpHead) {}
+
+    ~TSpscQueue()
+    {
+        while (mpHead) {
+            Node* pNext = mpHead->next.load(std::memory_order_relaxed);
+            delete mpHead;
+            mpHead = pNext;
+        }
+    }
+
+    // Producer thread only:
+    void push(T&& value)
+    {
+        Node* pNode = new Node;
+        pNode->value = std::move(value);
+        mpTail->next.store(pNode, std::memory_order_release);
+        mpTail = pNode;
+    }
+
+    // Consumer thread only, returns false if there is nothing to take:
+    bool pop(T& value)
+    {
+        Node* pNext = mpHead->next.load(std::memory_order_acquire);
+        if (!pNext) {
+            return false;
+        }
+        value = std::move(pNext->value);
+        delete mpHead;
+        mpHead = pNext;
+        return true;
+    }
+
+private:
+    TSpscQueue(const TSpscQueue&) = delete;
+    TSpscQueue& operator=(const TSpscQueue&) = delete;
+
+    struct Node
+    {
+        Node() : next(nullptr) {}
+
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    Node* mpHead;
+    Node* mpTail;
+};
+
+#endif // MUDLET_TSPSCQUEUE_H
@@ -0,0 +1,324 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TTelnetReader.h"
+
+
+#include "ctelnet.h"
+
+#include "pre_guard.h"
+#include <QDebug>
+#include <QMetaObject>
+#include <QTcpSocket>
+#include "post_guard.h"
+
+#include <cstring>
+
+
+TTelnetReader::TTelnetReader(QObject* pReceiver)
+: QObject()
+, mpReceiver(pReceiver)
+, mpSocket(nullptr)
+, mIsNotified(false)
+, mScanState(Text)
+, mIsCompressionAllowed(false)
+, mIsCompressed(false)
+{
+}
+
+TTelnetReader::~TTelnetReader()
+{
+    endCompression();
+}
+
+QTcpSocket* TTelnetReader::socket()
+{
+    if (!mpSocket) {
+        mpSocket = new QTcpSocket(this);
+        connect(mpSocket, SIGNAL(connected()), this, SLOT(slot_connected()));
+        connect(mpSocket, SIGNAL(disconnected()), this, SLOT(slot_disconnected()));
+        connect(mpSocket, SIGNAL(readyRead()), this, SLOT(slot_readyRead()));
+    }
+    return mpSocket;
+}
+
+void TTelnetReader::slot_connectToHost(const QString& hostName, const int port)
+{
+    QTcpSocket* pSocket = socket();
+    if (pSocket->state() != QAbstractSocket::UnconnectedState) {
+        pSocket->abort();
+    }
+    mScanState = Text;
+    mHeldBack.clear();
+    mIsCompressionAllowed = false;
+    endCompression();
+    pSocket->connectToHost(hostName, port);
+}
+
+void TTelnetReader::slot_write(const QByteArray& data)
+{
+    // The socket buffers whatever cannot be sent straight away:
+    if (mpSocket && mpSocket->isWritable()) {
+        mpSocket->write(data);
+    }
+}
+
+void TTelnetReader::slot_disconnectFromHost()
+{
+    if (mpSocket) {
+        mpSocket->disconnectFromHost();
+    }
+}
+
+void TTelnetReader::slot_abort()
+{
+    if (mpSocket) {
+        mpSocket->abort();
+    }
+}
+
+void TTelnetReader::slot_setCompressionAllowed(const bool allowed)
+{
+    mIsCompressionAllowed = allowed;
+}
+
+void TTelnetReader::slot_connected()
+{
+    post(TTelnetChunk(TTelnetChunk::Connected));
+}
+
+void TTelnetReader::slot_disconnected()
+{
+    TTelnetChunk chunk(TTelnetChunk::Disconnected);
+    chunk.errorString = mpSocket->errorString();
+    mScanState = Text;
+    mHeldBack.clear();
+    mIsCompressionAllowed = false;
+    endCompression();
+    post(std::move(chunk));
+}
+
+void TTelnetReader::slot_readyRead()
+{
+    const qint64 available = mpSocket->bytesAvailable();
+    if (available <= 0) {
+        return;
+    }
+    if (mReadBuffer.size() < available) {
+        mReadBuffer.resize(available);
+    }
+    const qint64 amount = mpSocket->read(mReadBuffer.data(), available);
+    if (amount > 0) {
+        scan(mReadBuffer.constData(), static_cast<int>(amount));
+    }
+}
+
+void TTelnetReader::post(TTelnetChunk&& chunk)
+{
+    mChunks.push(std::move(chunk));
+    // Only one notification is outstanding at a time, the main thread takes
+    // everything that has been queued when it gets it:
+    if (!mIsNotified.exchange(true)) {
+        QMetaObject::invokeMethod(mpReceiver, "slot_processNetworkQueue", Qt::QueuedConnection);
+    }
+}
+
+void TTelnetReader::postData(QByteArray&& data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    TTelnetChunk chunk;
+    chunk.data = std::move(data);
+    post(std::move(chunk));
+}
+
+void TTelnetReader::scan(const char* buffer, const int length)
+{
+    int i = 0;
+    while (i < length) {
+        if (mIsCompressed) {
+            i += inflateData(buffer + i, length - i);
+        } else {
+            i += scanText(buffer + i, length - i);
+        }
+    }
+}
+
+// Passes on the (uncompressed) data, returns how much of it was used - which
+// is all of it unless it contains a MCCP start sequence, as whatever follows
+// that is compressed. The start sequence itself is dropped, it may be split
+// over more than one read so the bytes of anything that could be one are held
+// back until it is known which it is.
+int TTelnetReader::scanText(const char* buffer, const int length)
+{
+    QByteArray out;
+    out.reserve(length);
+    int i = 0;
+    while (i < length) {
+        if (mScanState == Text || mScanState == SubNegotiation) {
+            // Nothing changes until the next IAC, so copy up to it in bulk:
+            const char* pIAC = static_cast<const char*>(memchr(buffer + i, TN_IAC, length - i));
+            const int runEnd = pIAC ? static_cast<int>(pIAC - buffer) : length;
+            out.append(buffer + i, runEnd - i);
+            i = runEnd;
+            if (i == length) {
+                break;
+            }
+        }
+        if (scanByte(buffer[i++], out)) {
+            postData(std::move(out));
+            startCompression();
+            // So that cTelnet can drop any telnet command it was part way
+            // through, as it does when it finds the sequence itself:
+            post(TTelnetChunk(TTelnetChunk::CompressionStarted));
+            return i;
+        }
+    }
+    postData(std::move(out));
+    return length;
+}
+
+// Moves the scan on by one byte, in the same way as cTelnet will when it gets
+// it, adding it to out unless it may be part of a MCCP start sequence;
+// returns true when it is the last byte of one:
+bool TTelnetReader::scanByte(const char ch, QByteArray& out)
+{
+    switch (mScanState) {
+    case Text:
+    case SubNegotiation:
+        if (ch == TN_IAC) {
+            mHeldBack.append(ch);
+            mScanState = (mScanState == Text) ? Iac : SubNegotiationIac;
+        } else {
+            out.append(ch);
+        }
+        return false;
+    case Iac:
+    case SubNegotiationIac:
+        // An IAC SB inside a sub-negotiation does not start a new one, but
+        // cTelnet will still take a start sequence that follows it:
+        if (ch == TN_SB && mIsCompressionAllowed) {
+            mHeldBack.append(ch);
+            mScanState = CompressStart;
+            return false;
+        }
+        out.append(mHeldBack);
+        mHeldBack.clear();
+        out.append(ch);
+        if (mScanState == SubNegotiationIac) {
+            mScanState = (ch == TN_SE) ? Text : SubNegotiation;
+        } else if (ch == TN_WILL || ch == TN_WONT || ch == TN_DO || ch == TN_DONT) {
+            mScanState = IacOption;
+        } else {
+            mScanState = (ch == TN_SB) ? SubNegotiation : Text;
+        }
+        return false;
+    case IacOption:
+        out.append(ch);
+        mScanState = Text;
+        return false;
+    case CompressStart:
+        mHeldBack.append(ch);
+        if (mHeldBack.size() == 3 && ch != OPT_COMPRESS && ch != OPT_COMPRESS2) {
+            break;
+        }
+        if (mHeldBack.size() < 5) {
+            return false;
+        }
+        // IAC SB COMPRESS WILL SE for MCCP v1 (unterminated invalid telnet sequence)
+        // IAC SB COMPRESS2 IAC SE for MCCP v2
+        if ((mHeldBack.at(2) == OPT_COMPRESS && mHeldBack.at(3) == TN_WILL && mHeldBack.at(4) == TN_SE)
+            || (mHeldBack.at(2) == OPT_COMPRESS2 && mHeldBack.at(3) == TN_IAC && mHeldBack.at(4) == TN_SE)) {
+            qDebug() << "TTelnetReader: MCCP starting sequence";
+            mHeldBack.clear();
+            mScanState = Text;
+            return true;
+        }
+        break;
+    }
+
+    // Not a start sequence after all, so pass on the IAC SB and go through
+    // the rest again as part of the sub-negotiation that it opened:
+    const QByteArray heldBack = mHeldBack;
+    mHeldBack.clear();
+    out.append(heldBack.left(2));
+    mScanState = SubNegotiation;
+    for (int i = 2; i < heldBack.size(); ++i) {
+        if (scanByte(heldBack.at(i), out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns how much of the input was used - all of it unless the compressed
+// stream ends part way through it.
+int TTelnetReader::inflateData(const char* buffer, const int length)
+{
+    mZstream.avail_in = length;
+    mZstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer));
+
+    int outSize = 0;
+    int zval;
+    do {
+        if (outSize == mInflateBuffer.size()) {
+            mInflateBuffer.resize(qMax(65536, mInflateBuffer.size() * 2));
+        }
+        mZstream.avail_out = mInflateBuffer.size() - outSize;
+        mZstream.next_out = reinterpret_cast<Bytef*>(mInflateBuffer.data()) + outSize;
+        zval = inflate(&mZstream, Z_SYNC_FLUSH);
+        outSize = mInflateBuffer.size() - mZstream.avail_out;
+    } while (zval == Z_OK && mZstream.avail_out == 0);
+
+    const int used = length - static_cast<int>(mZstream.avail_in);
+    postData(QByteArray(mInflateBuffer.constData(), outSize));
+
+    if (zval == Z_STREAM_END) {
+        qDebug() << "TTelnetReader: recv Z_STREAM_END, ending compression";
+        endCompression();
+        post(TTelnetChunk(TTelnetChunk::CompressionEnded));
+        // Any input left over after the end of the stream is not compressed:
+        return used;
+    }
+    if (zval != Z_OK && zval != Z_BUF_ERROR) {
+        // The stream is corrupt, nothing more can be got from this input:
+        qDebug() << "TTelnetReader::inflateData() ERROR: inflate() returned" << zval << "discarding" << length - used << "bytes";
+    }
+    return length;
+}
+
+void TTelnetReader::startCompression()
+{
+    mZstream.zalloc = Z_NULL;
+    mZstream.zfree = Z_NULL;
+    mZstream.opaque = Z_NULL;
+    mZstream.avail_in = 0;
+    mZstream.next_in = Z_NULL;
+    inflateInit(&mZstream);
+    mIsCompressed = true;
+}
+
+void TTelnetReader::endCompression()
+{
+    if (mIsCompressed) {
+        inflateEnd(&mZstream);
+        mIsCompressed = false;
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef MUDLET_TTELNETREADER_H
+#define MUDLET_TTELNETREADER_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TSpscQueue.h"
+
+#include "pre_guard.h"
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include "post_guard.h"
+
+#include <zlib.h>
+
+#include <atomic>
+
+class QTcpSocket;
+
+
+// What the network thread has to tell the main thread, in the order that it
+// happened:
+struct TTelnetChunk
+{
+    enum Type { Data, CompressionStarted, CompressionEnded, Connected, Disconnected };
+
+    TTelnetChunk() : type(Data) {}
+    TTelnetChunk(Type t) : type(t) {}
+
+    Type type;
+    // Data: telnet stream as it was before MCCP was applied:
+    QByteArray data;
+    // Disconnected:
+    QString errorString;
+};
+
+
+// Lives in its own thread and does the socket reading and MCCP inflating for
+// a cTelnet, so that a burst of (compressed) data from the game server is
+// taken off the network without waiting for the main thread. It only looks at
+// the telnet stream enough to spot where compression starts - all other
+// telnet commands, as well as the text, are passed on untouched to be handled
+// by cTelnet in the main thread, which is told that there is something to
+// take with one queued call to slot_processNetworkQueue() however many chunks
+// are queued up before it gets to run.
+//
+// The telnet commands and the splitting of the text into lines are left where
+// they were, rather than this handing over whole lines: the commands are
+// answered from, and change, option state that Host and the Lua interpreter
+// use, and raise events into Lua; the text goes straight into the console's
+// TBuffer as it is decoded - none of which can be touched from another thread.
+class TTelnetReader : public QObject
+{
+    Q_OBJECT
+
+    Q_DISABLE_COPY(TTelnetReader)
+
+    friend class TTelnetReaderTest;
+
+public:
+    explicit TTelnetReader(QObject* pReceiver);
+    ~TTelnetReader();
+
+    // Main thread only - call before taking chunks, any that are queued
+    // after this will then get another notification:
+    void acknowledge() { mIsNotified.store(false); }
+    bool takeChunk(TTelnetChunk& chunk) { return mChunks.pop(chunk); }
+
+public slots:
+    // Invoked by cTelnet through queued calls:
+    void slot_connectToHost(const QString& hostName, int port);
+    void slot_write(const QByteArray& data);
+    void slot_disconnectFromHost();
+    void slot_abort();
+    // Whether MCCP has been negotiated (and not refused by the profile), a
+    // start sequence is left for cTelnet to deal with when it has not:
+    void slot_setCompressionAllowed(bool allowed);
+
+private slots:
+    void slot_connected();
+    void slot_disconnected();
+    void slot_readyRead();
+
+private:
+    // Follows the iac, iac2 and insb flags of cTelnet::processSocketData(),
+    // so that a start sequence is spotted where that would spot it:
+    enum ScanState { Text, Iac, IacOption, SubNegotiation, SubNegotiationIac, CompressStart };
+
+    QTcpSocket* socket();
+    void post(TTelnetChunk&& chunk);
+    void postData(QByteArray&& data);
+    void scan(const char* buffer, int length);
+    int scanText(const char* buffer, int length);
+    bool scanByte(char ch, QByteArray& out);
+    int inflateData(const char* buffer, int length);
+    void startCompression();
+    void endCompression();
+
+    QObject* mpReceiver;
+    // Created on first use, so that it belongs to the network thread:
+    QTcpSocket* mpSocket;
+    TSpscQueue<TTelnetChunk> mChunks;
+    std::atomic<bool> mIsNotified;
+
+    ScanState mScanState;
+    // The bytes of an IAC, or of an IAC SB COMPRESS(2) ... sequence, held
+    // back until it is known whether it is the start of compression:
+    QByteArray mHeldBack;
+
+    bool mIsCompressionAllowed;
+    bool mIsCompressed;
+    z_stream mZstream;
+    QByteArray mReadBuffer;
+    QByteArray mInflateBuffer;
+};
+
+#endif // MUDLET_TTELNETREADER_H
@@ -39,6 +39,8 @@
 #include <QToolTip>
 #include "post_guard.h"
 
+#include <algorithm>
+
 
 TTextEdit::TTextEdit(TConsole* pC, QWidget* pW, TBuffer* pB, Host* pH, bool isDebugConsole, bool isSplitScreen)
 : QWidget(pW)
@@ -62,6 +64,9 @@ TTextEdit::TTextEdit(TConsole* pC, QWidget* pW, TBuffer* pB, Host* pH, bool isDe
 , mpConsole(pC)
 , mpHost(pH)
 , mpScrollBar(0)
+, mScreenMapLetterSpacing(0)
+, mScreenMapIsAntiAliased(false)
+, mScreenMapShowsTimeStamps(false)
 {
     mLastClickTimer.start();
     if (!mIsDebugConsole) {
@@ -446,16 +451,18 @@ void TTextEdit::drawFrame(QPainter& p, const QRect& rect)
             break;
         }
         int timeOffset = 0;
+        QString timeStamp;
         if (mShowTimeStamps) {
-            if (mpBuffer->timeBuffer.size() > i + lineOffset) {
-                timeOffset = mpBuffer->timeBuffer[i + lineOffset].size() - 1;
+            if (static_cast<int>(mpBuffer->buffer.size()) > i + lineOffset) {
+                timeStamp = TBuffer::timeStampToString(mpBuffer->buffer[i + lineOffset].timeStamp);
+                timeOffset = timeStamp.size() - 1;
             }
         }
-        int lineLength = mpBuffer->buffer[i + lineOffset].size() + timeOffset;
+        int lineLength = mpBuffer->buffer[i + lineOffset].format.size() + timeOffset;
         for (int i2 = x1; i2 < lineLength;) {
             QString text;
             if (i2 < timeOffset) {
-                text = mpBuffer->timeBuffer[i + lineOffset];
+                text = timeStamp;
                 bool isBold = false;
                 bool isUnderline = false;
                 bool isItalics = false;
@@ -470,14 +477,14 @@ void TTextEdit::drawFrame(QPainter& p, const QRect& rect)
                 if (i2 >= x2) {
                     break;
                 }
-                text = mpBuffer->lineBuffer[i + lineOffset].at(i2 - timeOffset);
-                TChar& f = mpBuffer->buffer[i + lineOffset][i2 - timeOffset];
+                text = mpBuffer->buffer[i + lineOffset].text.at(i2 - timeOffset);
+                TChar& f = mpBuffer->buffer[i + lineOffset].format[i2 - timeOffset];
                 int delta = 1;
-                auto fgColor = QColor(f.fgR, f.fgG, f.fgB);
-                auto bgColor = QColor(f.bgR, f.bgG, f.bgB);
+                auto fgColor = QColor(f.foreground());
+                auto bgColor = QColor(f.background());
                 while (i2 + delta + timeOffset < lineLength) {
-                    if (mpBuffer->buffer[i + lineOffset][i2 + delta - timeOffset] == f) {
-                        text.append(mpBuffer->lineBuffer[i + lineOffset].at(i2 + delta - timeOffset));
+                    if (mpBuffer->buffer[i + lineOffset].format[i2 + delta - timeOffset] == f) {
+                        text.append(mpBuffer->buffer[i + lineOffset].text.at(i2 + delta - timeOffset));
                         delta++;
                     } else {
                         break;
@@ -526,168 +533,171 @@ void TTextEdit::updateLastLine()
 }
 
 
-void TTextEdit::drawForeground(QPainter& painter, const QRect& r)
+int TTextEdit::currentSearchHitPosition(const int line) const
 {
-    QPixmap screenPixmap;
-    QPixmap pixmap = QPixmap(mScreenWidth * mFontWidth, mScreenHeight * mFontHeight);
-    pixmap.fill(palette().base().color());
+    const TBufferSearchHit& hit = mpConsole->mCurrentSearchHit;
+    return (hit.line == mpBuffer->mLineOffset + line) ? hit.position : -1;
+}
 
-    QPainter p(&pixmap);
-    p.setCompositionMode(QPainter::CompositionMode_Source);
-    if (!mIsDebugConsole && !mIsMiniConsole) {
-        p.setFont(mpHost->mDisplayFont);
-        p.setRenderHint(QPainter::TextAntialiasing, !mpHost->mNoAntiAlias);
-    } else {
-        p.setFont(mDisplayFont);
-        p.setRenderHint(QPainter::TextAntialiasing, false);
+// Whether what was last drawn in the row is what drawLine() would draw there
+// for the line now:
+bool TTextEdit::isScreenRowCurrent(const int row, const int line) const
+{
+    const ScreenRow& drawn = mScreenRows[row];
+    if (!drawn.isDrawn) {
+        return false;
     }
-
-    QPoint P_topLeft = r.topLeft();
-    QPoint P_bottomRight = r.bottomRight();
-    int x_topLeft = 0;
-    int y_topLeft = P_topLeft.y();
-    int x_bottomRight = P_bottomRight.x();
-    int y_bottomRight = P_bottomRight.y();
-
-    if (x_bottomRight > mScreenWidth * mFontWidth) {
-        x_bottomRight = mScreenWidth * mFontWidth;
+    if (line < 0 || line >= mpBuffer->size()) {
+        return !drawn.isLine;
     }
+    const TBufferLine& bufferLine = mpBuffer->buffer[line];
+    return drawn.isLine && drawn.text == bufferLine.text && drawn.format == bufferLine.format && (!mShowTimeStamps || drawn.timeStamp == bufferLine.timeStamp)
+           && drawn.currentHitPosition == currentSearchHitPosition(line) && drawn.hits == mpConsole->getSearchHits(line);
+}
 
-    int x1 = x_topLeft / mFontWidth;
-    int y1 = y_topLeft / mFontHeight;
-    int x2 = x_bottomRight / mFontWidth;
-    int y2 = y_bottomRight / mFontHeight;
+void TTextEdit::keepScreenRow(const int row, const int line)
+{
+    ScreenRow& drawn = mScreenRows[row];
+    drawn.isDrawn = true;
+    drawn.isLine = (line >= 0 && line < mpBuffer->size());
+    if (!drawn.isLine) {
+        drawn.text.clear();
+        drawn.format.clear();
+        drawn.hits.clear();
+        return;
+    }
+    const TBufferLine& bufferLine = mpBuffer->buffer[line];
+    drawn.text = bufferLine.text;
+    drawn.format = bufferLine.format;
+    drawn.timeStamp = bufferLine.timeStamp;
+    drawn.hits = mpConsole->getSearchHits(line);
+    drawn.currentHitPosition = currentSearchHitPosition(line);
+}
 
-    int lineOffset = imageTopLine();
-    int from = 0;
-    if (lineOffset == 0) {
-        mScrollVector = 0;
-    } else {
-        // Was: mScrollVector = lineOffset - mLastRenderBottom;
-        if (mLastRenderBottom) {
-            mScrollVector = lineOffset - mLastRenderBottom;
-        } else {
-            mScrollVector = y2 + lineOffset;
-        }
+void TTextEdit::drawLine(QPainter& p, const int line, const int row)
+{
+    const QRect rowRect(0, row * mFontHeight, mScreenWidth * mFontWidth, mFontHeight);
+    drawBackground(p, rowRect, mBgColor);
+    if (line < 0 || line >= mpBuffer->size()) {
+        return;
     }
+    mpBuffer->buffer[line].isDirty = false;
 
-    bool noScroll = false;
-    bool noCopy = false;
-    if (abs(mScrollVector) > mScreenHeight || mForceUpdate || lineOffset < 10) {
-        mScrollVector = 0;
-        noScroll = true;
-    }
-    if ((r.height() < rect().height()) && (lineOffset > 0)) {
-        p.drawPixmap(0, 0, mScreenMap);
-        if (!mForceUpdate && !mMouseTracking) {
-            from = y1;
-            noScroll = true;
-            noCopy = true;
+    int timeOffset = 0;
+    if (mShowTimeStamps) {
+        timeOffset = 13;
+        QString text = TBuffer::timeStampToString(mpBuffer->buffer[line].timeStamp);
+        QRect textRect = QRect(0, mFontHeight * row, mFontWidth * timeOffset, mFontHeight);
+        auto bgTime = QColor(22, 22, 22);
+        auto fgTime = QColor(200, 150, 0);
+        drawBackground(p, textRect, bgTime);
+        drawCharacters(p, textRect, text, false, false, false, false, fgTime, bgTime);
+    }
+
+    const QString& lineText = mpBuffer->buffer[line].text;
+    const std::vector<TChar>& lineFormat = mpBuffer->buffer[line].format;
+    const int lineLength = static_cast<int>(lineFormat.size());
+    const int visibleLength = qMin(lineLength, mScreenWidth - timeOffset);
+    for (int x = 0; x < visibleLength;) {
+        const TChar& f = lineFormat[x];
+        // The formatting is compared as packed values, so finding the end of
+        // a run of the same format is cheap - the text for it is then taken
+        // in one go:
+        int delta = 1;
+        while (x + delta < lineLength && lineFormat[x + delta] == f) {
+            delta++;
+        }
+        QString text = lineText.mid(x, delta);
+        QColor fgColor;
+        QColor bgColor;
+        if (f.flags & TCHAR_INVERSE) {
+            bgColor = QColor(f.foreground());
+            fgColor = QColor(f.background());
         } else {
-            from = y1;
-            y2 = mScreenHeight;
-            noScroll = true;
-            mScrollVector = 0;
+            fgColor = QColor(f.foreground());
+            bgColor = QColor(f.background());
         }
-    }
-    if( ( ! noScroll ) && ( mScrollVector >= 0 ) && ( mScrollVector <= mScreenHeight ) && ( ! mForceUpdate ) )
-    {
-
-        if( mScrollVector*mFontHeight < mScreenMap.height()
-            && mScreenWidth*mFontWidth <= mScreenMap.width()
-            && (mScreenHeight-mScrollVector)*mFontHeight > 0
-            && (mScreenHeight-mScrollVector)*mFontHeight <= mScreenMap.height() )
-        {
-            screenPixmap = mScreenMap.copy( 0,
-                                            mScrollVector*mFontHeight,
-                                            mScreenWidth*mFontWidth,
-                                            (mScreenHeight-mScrollVector)*mFontHeight );
-            p.drawPixmap( 0, 0, screenPixmap );
-            from = mScreenHeight - mScrollVector - 1;
+        QRect textRect = QRect(mFontWidth * (x + timeOffset), mFontHeight * row, mFontWidth * delta, mFontHeight);
+        if (f.flags & TCHAR_INVERSE || (bgColor != mBgColor)) {
+            drawBackground(p, textRect, bgColor);
         }
+        drawCharacters(p, textRect, text, f.flags & TCHAR_BOLD, f.flags & TCHAR_UNDERLINE, f.flags & TCHAR_ITALICS, f.flags & TCHAR_STRIKEOUT, fgColor, bgColor);
+        x += delta;
     }
-    else if( ( ! noScroll ) && ( mScrollVector < 0 && mScrollVector >= ((-1)*mScreenHeight) ) && ( ! mForceUpdate ) )
-    {
-        if( abs(mScrollVector)*mFontHeight < mScreenMap.height()
-            && mScreenWidth*mFontWidth <= mScreenMap.width()
-            && (mScreenHeight-abs(mScrollVector))*mFontHeight > 0
-            && (mScreenHeight-abs(mScrollVector))*mFontHeight <= mScreenMap.height() )
-        {
-            screenPixmap = mScreenMap.copy( 0,
-                                            0,
-                                            mScreenWidth*mFontWidth,
-                                            (mScreenHeight-abs(mScrollVector))*mFontHeight );
-            p.drawPixmap( 0, abs(mScrollVector)*mFontHeight, screenPixmap );
-            from = 0;
-            y2 = abs(mScrollVector);
+
+    // Search hits are drawn over the top, the one last moved to in a
+    // different color:
+    for (const TBufferSearchHit& hit : mpConsole->getSearchHits(line)) {
+        const int begin = qMin(hit.position, visibleLength);
+        const int end = qMin(hit.position + hit.length, visibleLength);
+        if (begin >= end) {
+            continue;
         }
+        const bool isCurrent = (hit.line == mpConsole->mCurrentSearchHit.line && hit.position == mpConsole->mCurrentSearchHit.position);
+        QColor fgColor = QColor(Qt::black);
+        QColor bgColor = isCurrent ? QColor(255, 128, 0) : QColor(255, 255, 0);
+        QString text = lineText.mid(begin, end - begin);
+        QRect textRect = QRect(mFontWidth * (begin + timeOffset), mFontHeight * row, mFontWidth * (end - begin), mFontHeight);
+        drawBackground(p, textRect, bgColor);
+        drawCharacters(p, textRect, text, false, false, false, false, fgColor, bgColor);
     }
-    QRect deleteRect = QRect(0, from * mFontHeight, x2 * mFontHeight, (y2 + 1) * mFontHeight);
-    drawBackground(p, deleteRect, mBgColor);
-    for (int i = from; i <= y2; i++) {
-        if (static_cast<int>(mpBuffer->buffer.size()) <= i + lineOffset) {
-            break;
+}
+
+// Renders into mScreenMap, which is kept from one paint to the next: when the
+// view has moved by less than a screen the pixmap is scrolled in place and
+// then only the rows whose content differs from what was last drawn in them
+// are redrawn - so that when lines are coming in quickly each paint only has
+// to draw the new ones.
+void TTextEdit::drawForeground(QPainter& painter, const QRect& r)
+{
+    Q_UNUSED(r)
+
+    const bool isMainConsole = !mIsDebugConsole && !mIsMiniConsole;
+    const QFont& font = isMainConsole ? mpHost->mDisplayFont : mDisplayFont;
+    const bool isAntiAliased = isMainConsole && !mpHost->mNoAntiAlias;
+    const QSize mapSize(mScreenWidth * mFontWidth, mScreenHeight * mFontHeight);
+
+    if (mScreenMap.size() != mapSize || static_cast<int>(mScreenRows.size()) != mScreenHeight || mScreenMapFont != font || mScreenMapBgColor != mBgColor || mScreenMapLetterSpacing != mLetterSpacing
+        || mScreenMapIsAntiAliased != isAntiAliased || mScreenMapShowsTimeStamps != mShowTimeStamps) {
+        if (mScreenMap.size() != mapSize) {
+            mScreenMap = QPixmap(mapSize);
         }
-        mpBuffer->dirty[lineOffset + i] = false;
-        int timeOffset = 0;
-        if (mShowTimeStamps) {
-            timeOffset = 13;
+        mScreenRows.assign(mScreenHeight, ScreenRow());
+        mScreenMapFont = font;
+        mScreenMapBgColor = mBgColor;
+        mScreenMapLetterSpacing = mLetterSpacing;
+        mScreenMapIsAntiAliased = isAntiAliased;
+        mScreenMapShowsTimeStamps = mShowTimeStamps;
+    }
+
+    const int lineOffset = imageTopLine();
+    const int scrolledBy = lineOffset - mLastRenderBottom;
+    if (scrolledBy != 0 && abs(scrolledBy) < mScreenHeight) {
+        mScreenMap.scroll(0, -scrolledBy * mFontHeight, mScreenMap.rect());
+        if (scrolledBy > 0) {
+            std::move(mScreenRows.begin() + scrolledBy, mScreenRows.end(), mScreenRows.begin());
+            std::fill(mScreenRows.end() - scrolledBy, mScreenRows.end(), ScreenRow());
+        } else {
+            std::move_backward(mScreenRows.begin(), mScreenRows.end() + scrolledBy, mScreenRows.end());
+            std::fill(mScreenRows.begin(), mScreenRows.begin() - scrolledBy, ScreenRow());
         }
-        int lineLength = mpBuffer->buffer[i + lineOffset].size() + timeOffset;
-        for (int i2 = x1; i2 < lineLength;) {
-            QString text;
-            if (i2 < timeOffset) {
-                text = mpBuffer->timeBuffer[i + lineOffset];
-                bool isBold = false;
-                bool isUnderline = false;
-                bool isItalics = false;
-                bool isStrikeOut = false;
-                QRect textRect = QRect(mFontWidth * i2, mFontHeight * i, mFontWidth * timeOffset, mFontHeight);
-                auto bgTime = QColor(22, 22, 22);
-                auto fgTime = QColor(200, 150, 0);
-                drawBackground(p, textRect, bgTime);
-                drawCharacters(p, textRect, text, isBold, isUnderline, isItalics, isStrikeOut, fgTime, bgTime);
-                i2 += timeOffset;
-            } else {
-                if (i2 >= x2) {
-                    break;
-                }
-                text = mpBuffer->lineBuffer[i + lineOffset].at(i2 - timeOffset);
-                TChar& f = mpBuffer->buffer[i + lineOffset][i2 - timeOffset];
-                int delta = 1;
-                QColor fgColor;
-                QColor bgColor;
-                if (f.flags & TCHAR_INVERSE) {
-                    bgColor = QColor(f.fgR, f.fgG, f.fgB);
-                    fgColor = QColor(f.bgR, f.bgG, f.bgB);
-                } else {
-                    fgColor = QColor(f.fgR, f.fgG, f.fgB);
-                    bgColor = QColor(f.bgR, f.bgG, f.bgB);
-                }
-                while (i2 + delta + timeOffset < lineLength) {
-                    if (mpBuffer->buffer[i + lineOffset][i2 + delta - timeOffset] == f) {
-                        text.append(mpBuffer->lineBuffer[i + lineOffset].at(i2 + delta - timeOffset));
-                        delta++;
-                    } else {
-                        break;
-                    }
-                }
-                QRect textRect;
-                textRect = QRect(mFontWidth * i2, mFontHeight * i, mFontWidth * delta, mFontHeight);
-                if (f.flags & TCHAR_INVERSE || (bgColor != mBgColor)) {
-                    drawBackground(p, textRect, bgColor);
-                }
-                drawCharacters(p, textRect, text, f.flags & TCHAR_BOLD, f.flags & TCHAR_UNDERLINE, f.flags & TCHAR_ITALICS, f.flags & TCHAR_STRIKEOUT, fgColor, bgColor);
-                i2 += delta;
-            }
+    }
+
+    QPainter p(&mScreenMap);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    p.setFont(font);
+    p.setRenderHint(QPainter::TextAntialiasing, isAntiAliased);
+    for (int row = 0; row < mScreenHeight; row++) {
+        const int line = lineOffset + row;
+        if (!isScreenRowCurrent(row, line)) {
+            drawLine(p, line, row);
+            keepScreenRow(row, line);
         }
     }
     p.end();
+
     painter.setCompositionMode(QPainter::CompositionMode_Source);
-    painter.drawPixmap(0, 0, pixmap);
-    if (!noCopy) {
-        mScreenMap = pixmap.copy();
-    }
+    painter.drawPixmap(0, 0, mScreenMap);
     mScrollVector = 0;
     // Only place this value is changed (apart from initialisation to 0):
     mLastRenderBottom = lineOffset;
@@ -770,9 +780,9 @@ void TTextEdit::highlight()
             if ((y == mPB.y()) && (x > mPB.x())) {
                 break;
             }
-            mpBuffer->dirty[y] = true;
-            if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-                mpBuffer->buffer[y][x].flags |= TCHAR_INVERSE;
+            mpBuffer->buffer[y].isDirty = true;
+            if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                mpBuffer->buffer[y].format[x].flags |= TCHAR_INVERSE;
             } else {
                 break;
             }
@@ -801,10 +811,10 @@ void TTextEdit::unHighlight(QRegion& region)
             if (y >= static_cast<int>(mpBuffer->buffer.size())) {
                 break;
             }
-            mpBuffer->dirty[y] = true;
-            if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-                mpBuffer->buffer[y][x].flags &= ~(TCHAR_INVERSE);
-                mpBuffer->dirty[y] = true;
+            mpBuffer->buffer[y].isDirty = true;
+            if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                mpBuffer->buffer[y].format[x].flags &= ~(TCHAR_INVERSE);
+                mpBuffer->buffer[y].isDirty = true;
             } else {
                 break;
             }
@@ -838,10 +848,10 @@ void TTextEdit::mouseMoveEvent(QMouseEvent* event)
         y = 0;
     }
     if (y < static_cast<int>(mpBuffer->buffer.size())) {
-        if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-            if (mpBuffer->buffer[y][x].link > 0) {
+        if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+            if (mpBuffer->buffer[y].format[x].link > 0) {
                 setCursor(Qt::PointingHandCursor);
-                QStringList tooltip = mpBuffer->mHintStore[mpBuffer->buffer[y][x].link];
+                QStringList tooltip = mpBuffer->mHintStore[mpBuffer->buffer[y].format[x].link];
                 QToolTip::showText(event->globalPos(), tooltip.join("\n"));
             } else {
                 setCursor(Qt::IBeamCursor);
@@ -882,21 +892,21 @@ void TTextEdit::mouseMoveEvent(QMouseEvent* event)
 
         if (oldAY < mPA.y()) {
             for (int y = oldAY; y < mPA.y(); y++) {
-                for (auto& x : mpBuffer->buffer[y]) {
+                for (auto& x : mpBuffer->buffer[y].format) {
                     x.flags &= ~(TCHAR_INVERSE);
                 }
             }
         }
         if (oldBY > mPB.y()) {
             for (int y = mPB.y() + 1; y <= oldBY; y++) {
-                for (auto& x : mpBuffer->buffer[y]) {
+                for (auto& x : mpBuffer->buffer[y].format) {
                     x.flags &= ~(TCHAR_INVERSE);
                 }
             }
         }
 
         mPA.setX(0);
-        mPB.setX(static_cast<int>(mpBuffer->buffer[mPB.y()].size()) - 1);
+        mPB.setX(static_cast<int>(mpBuffer->buffer[mPB.y()].format.size()) - 1);
 
         highlight();
         return;
@@ -916,24 +926,24 @@ void TTextEdit::mouseMoveEvent(QMouseEvent* event)
                 if (y >= static_cast<int>(mpBuffer->buffer.size()) || y < 0) {
                     break;
                 }
-                int x = mpBuffer->buffer[y].size() - 1;
+                int x = mpBuffer->buffer[y].format.size() - 1;
                 if (y == y1) {
                     x = PC.x();
-                    if (x >= static_cast<int>(mpBuffer->buffer[y].size())) {
-                        x = static_cast<int>(mpBuffer->buffer[y].size()) - 1;
+                    if (x >= static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                        x = static_cast<int>(mpBuffer->buffer[y].format.size()) - 1;
                     }
                     if (x < 0) {
                         x = 0;
                     }
                 }
-                mpBuffer->dirty[y] = true;
+                mpBuffer->buffer[y].isDirty = true;
                 for (;; x--) {
                     if ((y == mPA.y()) && (x < mPA.x())) {
                         break;
                     }
 
-                    if (x < static_cast<int>(mpBuffer->buffer[y].size()) && x >= 0) {
-                        mpBuffer->buffer[y][x].flags &= ~(TCHAR_INVERSE);
+                    if (x < static_cast<int>(mpBuffer->buffer[y].format.size()) && x >= 0) {
+                        mpBuffer->buffer[y].format[x].flags &= ~(TCHAR_INVERSE);
                     } else {
                         break;
                     }
@@ -955,13 +965,13 @@ void TTextEdit::mouseMoveEvent(QMouseEvent* event)
                 if (y >= static_cast<int>(mpBuffer->buffer.size()) || y < 0) {
                     break;
                 }
-                mpBuffer->dirty[y] = true;
+                mpBuffer->buffer[y].isDirty = true;
                 for (;; x++) {
                     if ((y == mPB.y()) && (x > mPB.x())) {
                         break;
                     }
-                    if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-                        mpBuffer->buffer[y][x].flags &= ~(TCHAR_INVERSE);
+                    if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                        mpBuffer->buffer[y].format[x].flags &= ~(TCHAR_INVERSE);
                     } else {
                         break;
                     }
@@ -1050,9 +1060,9 @@ void TTextEdit::mousePressEvent(QMouseEvent* event)
             y = 0;
         }
         if (y < static_cast<int>(mpBuffer->buffer.size())) {
-            if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-                if (mpBuffer->buffer[y][x].link > 0) {
-                    QStringList command = mpBuffer->mLinkStore[mpBuffer->buffer[y][x].link];
+            if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                if (mpBuffer->buffer[y].format[x].link > 0) {
+                    QStringList command = mpBuffer->mLinkStore[mpBuffer->buffer[y].format[x].link];
                     QString func;
                     if (command.size() > 0) {
                         func = command.at(0);
@@ -1068,14 +1078,14 @@ void TTextEdit::mousePressEvent(QMouseEvent* event)
             int xind = x;
             int yind = y;
 
-            if (yind >= mpBuffer->lineBuffer.size()) {
+            if (yind >= static_cast<int>(mpBuffer->buffer.size())) {
                 return;
             }
-            if (xind >= mpBuffer->lineBuffer[yind].size()) {
+            if (xind >= mpBuffer->buffer[yind].text.size()) {
                 return;
             }
-            while (xind < static_cast<int>(mpBuffer->buffer[yind].size())) {
-                QChar c = mpBuffer->lineBuffer[yind].at(xind);
+            while (xind < static_cast<int>(mpBuffer->buffer[yind].format.size())) {
+                QChar c = mpBuffer->buffer[yind].text.at(xind);
                 if (c == ' ') {
                     break;
                 }
@@ -1083,19 +1093,19 @@ void TTextEdit::mousePressEvent(QMouseEvent* event)
             }
             // For ignoring user specified characters, we first stop at space boundaries, then we
             // proceed to search within these spaces for ignored characters and chop off any we find.
-            while (xind > 0 && mpHost->mDoubleClickIgnore.contains(mpBuffer->lineBuffer[yind].at(xind - 1))) {
+            while (xind > 0 && mpHost->mDoubleClickIgnore.contains(mpBuffer->buffer[yind].text.at(xind - 1))) {
                 xind--;
             }
             mPB.setX(xind - 1);
             mPB.setY(yind);
             for (xind = x - 1; xind > 0; xind--) {
-                QChar c = mpBuffer->lineBuffer[yind].at(xind);
+                QChar c = mpBuffer->buffer[yind].text.at(xind);
                 if (c == ' ') {
                     break;
                 }
             }
-            int lsize = mpBuffer->lineBuffer[yind].size();
-            while (xind + 1 < lsize && mpHost->mDoubleClickIgnore.contains(mpBuffer->lineBuffer[yind].at(xind + 1))) {
+            int lsize = mpBuffer->buffer[yind].text.size();
+            while (xind + 1 < lsize && mpHost->mDoubleClickIgnore.contains(mpBuffer->buffer[yind].text.at(xind + 1))) {
                 xind++;
             }
             if (xind > 0) {
@@ -1116,7 +1126,7 @@ void TTextEdit::mousePressEvent(QMouseEvent* event)
             if (mCtrlSelecting) {
                 mPA.setX(0);
                 mPA.setY(y);
-                mPB.setX(static_cast<int>(mpBuffer->buffer[y].size()) - 1);
+                mPB.setX(static_cast<int>(mpBuffer->buffer[y].format.size()) - 1);
                 mPB.setY(y);
                 mDragStartY = y;
                 highlight();
@@ -1143,10 +1153,10 @@ void TTextEdit::mousePressEvent(QMouseEvent* event)
             y = 0;
         }
         if (y < static_cast<int>(mpBuffer->buffer.size())) {
-            if (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-                if (mpBuffer->buffer[y][x].link > 0) {
-                    QStringList command = mpBuffer->mLinkStore[mpBuffer->buffer[y][x].link];
-                    QStringList hint = mpBuffer->mHintStore[mpBuffer->buffer[y][x].link];
+            if (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+                if (mpBuffer->buffer[y].format[x].link > 0) {
+                    QStringList command = mpBuffer->mLinkStore[mpBuffer->buffer[y].format[x].link];
+                    QStringList hint = mpBuffer->mHintStore[mpBuffer->buffer[y].format[x].link];
                     if (command.size() > 1) {
                         auto popup = new QMenu(this);
                         for (int i = 0; i < command.size(); i++) {
@@ -1227,17 +1237,17 @@ void TTextEdit::copySelectionToClipboard()
             return;
         }
         // add timestamps to clipboard when "Show Time Stamps" is on and it is not one-line selection
-        if (mShowTimeStamps && !mpBuffer->timeBuffer[y].isEmpty() && mPA.y() != mPB.y()) {
-            text.append(mpBuffer->timeBuffer[y].left(13));
+        if (mShowTimeStamps && mpBuffer->buffer[y].timeStamp != cTimeStampNone && mPA.y() != mPB.y()) {
+            text.append(TBuffer::timeStampToString(mpBuffer->buffer[y].timeStamp).left(13));
         }
         int x = 0;
         if (y == mPA.y()) {
             x = mPA.x();
         }
-        while (x < static_cast<int>(mpBuffer->buffer[y].size())) {
-            text.append(mpBuffer->lineBuffer[y].at(x));
+        while (x < static_cast<int>(mpBuffer->buffer[y].format.size())) {
+            text.append(mpBuffer->buffer[y].text.at(x));
             if (y >= mPB.y()) {
-                if ((x == mPB.x()) || (x >= static_cast<int>(mpBuffer->buffer[y].size() - 1))) {
+                if ((x == mPB.x()) || (x >= static_cast<int>(mpBuffer->buffer[y].format.size() - 1))) {
                     QClipboard* clipboard = QApplication::clipboard();
                     clipboard->setText(text);
                     mSelectedRegion = QRegion(0, 0, 0, 0);
@@ -1428,7 +1438,7 @@ int TTextEdit::imageTopLine()
     }
     if (mCursorY > mScreenHeight) {
         if (isTailMode()) {
-            if (mpBuffer->lineBuffer[mpBuffer->getLastLineNumber()] == "") {
+            if (mpBuffer->buffer[mpBuffer->getLastLineNumber()].text == "") {
                 return mCursorY - mScreenHeight - 1;
             } else {
                 return mCursorY - mScreenHeight;
@@ -1486,7 +1496,7 @@ int TTextEdit::bufferScrollDown(int lines)
         return lines;
     } else if (mpBuffer->mCursorY >= (int)(mpBuffer->size() - 1)) {
         mIsTailMode = true;
-        mpBuffer->mCursorY = mpBuffer->lineBuffer.size();
+        mpBuffer->mCursorY = mpBuffer->size();
         forceUpdate();
         return 0;
     } else {
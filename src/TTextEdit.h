@@ -24,17 +24,20 @@
  ***************************************************************************/
 
 
+#include "TBuffer.h"
+
 #include "pre_guard.h"
 #include <QMap>
 #include <QPointer>
 #include <QTime>
+#include <QVector>
 #include <QWidget>
 #include "post_guard.h"
 
 #include <string>
+#include <vector>
 
 class Host;
-class TBuffer;
 class TConsole;
 
 class QScrollBar;
@@ -115,7 +118,30 @@ public slots:
     void slot_copySelectionToClipboardHTML();
 
 private:
+    // A copy of what drawLine() used for a row of mScreenMap: the text, the
+    // format of every character in it (including selection, which is held as
+    // the inverse flag), the time stamp and any search hits on it - so that
+    // it can be told exactly whether the row has to be drawn again:
+    struct ScreenRow
+    {
+        ScreenRow() : isDrawn(false), isLine(false), timeStamp(cTimeStampNone), currentHitPosition(-1) {}
+
+        bool isDrawn;
+        // False for a row past the end of the buffer:
+        bool isLine;
+        QString text;
+        std::vector<TChar> format;
+        qint64 timeStamp;
+        QVector<TBufferSearchHit> hits;
+        // Of the hit that was last moved to, -1 if it is not on the line:
+        int currentHitPosition;
+    };
+
     void initDefaultSettings();
+    bool isScreenRowCurrent(int row, int line) const;
+    void keepScreenRow(int row, int line);
+    int currentSearchHitPosition(int line) const;
+    void drawLine(QPainter&, int line, int row);
 
     QFont mCommandLineFont;
     QFont mCommandSeperator;
@@ -145,7 +171,18 @@ private:
     QPointer<Host> mpHost;
     QScrollBar* mpScrollBar;
     int mScreenHeight;
+    // Kept between paints and scrolled in place, only the rows that now
+    // show something different from what was drawn there are redrawn:
     QPixmap mScreenMap;
+    // One per row in mScreenMap, for what was drawn there:
+    std::vector<ScreenRow> mScreenRows;
+    // The settings that mScreenMap was drawn with, if they change it all has
+    // to be redrawn:
+    QFont mScreenMapFont;
+    QColor mScreenMapBgColor;
+    qreal mScreenMapLetterSpacing;
+    bool mScreenMapIsAntiAliased;
+    bool mScreenMapShowsTimeStamps;
     int mScreenWidth;
     bool mScrollUp;
     int mTopMargin;
@@ -212,6 +212,8 @@ void TTimer::execute()
         return;
     }
 
+    TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Timer, mID, mName, TProfiler::Executing);
+
     if (isTemporary()) {
         if (mScript.isEmpty()) {
             mpHost->mLuaInterpreter.call_luafunction(this);
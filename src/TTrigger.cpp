@@ -28,6 +28,9 @@
 #include "TConsole.h"
 #include "TDebug.h"
 #include "TMatchState.h"
+#include "TMatchSubject.h"
+#include "TReplayBenchmark.h"
+#include "TTriggerIndex.h"
 #include "mudlet.h"
 
 #include "pre_guard.h"
@@ -70,6 +73,8 @@ TTrigger::TTrigger( TTrigger * parent, Host * pHost )
 , mBgColor(QColor(Qt::yellow))
 , mIsColorizerTrigger(false)
 , mModuleMember(false)
+, mIsIndexed(false)
+, mIndexStamp(0)
 , mColorTriggerFgAnsi()
 , mColorTriggerBgAnsi()
 {
@@ -104,6 +109,8 @@ TTrigger::TTrigger(const QString& name, QStringList regexList, QList<int> regexP
 , mBgColor(QColor(Qt::yellow))
 , mIsColorizerTrigger(false)
 , mModuleMember(false)
+, mIsIndexed(false)
+, mIndexStamp(0)
 , mColorTriggerFgAnsi()
 , mColorTriggerBgAnsi()
 {
@@ -128,11 +135,6 @@ void TTrigger::setName(const QString& name)
     mpHost->getTriggerUnit()->mLookupTable.insertMulti(name, this);
 }
 
-static void pcre_deleter(pcre* pointer)
-{
-    pcre_free(pointer);
-}
-
 //FIXME: sperren, wenn code nicht compiliert werden kann *ODER* regex falsch
 bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
 {
@@ -142,7 +144,9 @@ bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
     mRegexCodePropertyList.clear();
     mLuaConditionMap.clear();
     mColorPatternList.clear();
+    mRequiredLiterals.clear();
     mTriggerContainsPerlRegex = false;
+    invalidateIndex();
 
     if (propertyList.size() != regexList.size()) {
         //FIXME: ronny hat das irgendwie geschafft
@@ -156,6 +160,7 @@ bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
     }
 
     bool state = true;
+    bool isIndexable = true;
 
     for (int i = 0; i < regexList.size(); i++) {
         if (regexList[i].size() < 1) {
@@ -165,25 +170,34 @@ bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
         mRegexCodeList.append(regexList[i]);
         mRegexCodePropertyList.append(propertyList[i]);
 
+        if (isIndexable) {
+            QString literal = TTriggerIndex::requiredLiteral(regexList.at(i), propertyList.at(i));
+            if (literal.isEmpty()) {
+                isIndexable = false;
+            } else {
+                mRequiredLiterals.append(literal);
+            }
+        }
+
         if (propertyList[i] == REGEX_PERL) {
             const char* error;
-            const QByteArray& local8Bit = regexList[i].toLocal8Bit();
+            const QByteArray& utf8 = regexList.at(i).toUtf8();
 
             int erroffset;
 
-            QSharedPointer<pcre> re(pcre_compile(local8Bit.constData(), 0, &error, &erroffset, 0), pcre_deleter);
+            TRegex re = TRegex::compile(utf8, PCRE_UTF8, &error, &erroffset);
 
             if (!re) {
                 if (mudlet::debugMode) {
                     TDebug(QColor(Qt::white), QColor(Qt::red)) << "REGEX ERROR: failed to compile, reason:\n" << error << "\n" >> 0;
-                    TDebug(QColor(Qt::red), QColor(Qt::gray)) << R"(in: ")" << local8Bit.constData() << "\"\n" >> 0;
+                    TDebug(QColor(Qt::red), QColor(Qt::gray)) << R"(in: ")" << regexList.at(i) << "\"\n" >> 0;
                 }
                 setError(QStringLiteral("<b><font color='blue'>%1</font></b>")
-                                 .arg(tr(R"(Error: in item %1, perl regex: "%2", it failed to compile, reason: "%3".)").arg(QString::number(i), local8Bit.constData(), error)));
+                                 .arg(tr(R"(Error: in item %1, perl regex: "%2", it failed to compile, reason: "%3".)").arg(QString::number(i), regexList.at(i), error)));
                 state = false;
             } else {
                 if (mudlet::debugMode) {
-                    TDebug(QColor(Qt::white), QColor(Qt::darkGreen)) << "[OK]: REGEX_COMPILE OK\n" >> 0;
+                    TDebug(QColor(Qt::white), QColor(Qt::darkGreen)) << (re.isJitCompiled() ? "[OK]: REGEX_COMPILE OK (JIT)\n" : "[OK]: REGEX_COMPILE OK\n") >> 0;
                 }
             }
             mRegexMap[i] = re;
@@ -230,6 +244,9 @@ bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
             mColorPatternList.push_back(0);
         }
     }
+    if (!isIndexable) {
+        mRequiredLiterals.clear();
+    }
     if (!state) {
         mOK_init = false;
     } else {
@@ -238,11 +255,21 @@ bool TTrigger::setRegexCodeList(QStringList regexList, QList<int> propertyList)
     return state;
 }
 
-bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber, int posOffset)
+// Must be called whenever the patterns change so that a stale entry in the
+// trigger index can not cause this trigger to be skipped:
+void TTrigger::invalidateIndex()
+{
+    mIsIndexed = false;
+    if (mpHost) {
+        mpHost->getTriggerUnit()->invalidateTriggerIndex();
+    }
+}
+
+bool TTrigger::match_perl(const TMatchSubject& matchSubject, int regexNumber, int posOffset)
 {
     assert(mRegexMap.contains(regexNumber));
 
-    QSharedPointer<pcre> re = mRegexMap[regexNumber];
+    const TRegex re = mRegexMap.value(regexNumber);
 
     if (!re) {
         if (mudlet::debugMode) {
@@ -259,13 +286,15 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
     int namecount;
     int name_entry_size;
 
-    int subject_length = strlen(subject);
+    const char* subject = matchSubject.data();
+    int subject_length = matchSubject.length();
     int rc, i;
     std::list<std::string> captureList;
     std::list<int> posList;
     int ovector[300]; // 100 capture groups max (can be increase nbGroups=1/3 ovector
 
-    rc = pcre_exec(re.data(), 0, subject, subject_length, 0, 0, ovector, 100);
+    // The subject was produced by QString::toUtf8() so is known to be valid:
+    rc = re.exec(subject, subject_length, 0, PCRE_NO_UTF8_CHECK, ovector, 100);
 
     if (rc < 0) {
         return false;
@@ -281,7 +310,7 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
     }
 
     for (i = 0; i < rc; i++) {
-        char* substring_start = subject + ovector[2 * i];
+        const char* substring_start = subject + ovector[2 * i];
         int substring_length = ovector[2 * i + 1] - ovector[2 * i];
         std::string match;
         if (substring_length < 1) {
@@ -292,21 +321,21 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
 
         match.append(substring_start, substring_length);
         captureList.push_back(match);
-        posList.push_back(ovector[2 * i] + posOffset);
+        posList.push_back(matchSubject.textPosition(ovector[2 * i]) + posOffset);
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::darkCyan), QColor(Qt::black)) << "capture group #" << (i + 1) << " = " >> 0;
             TDebug(QColor(Qt::darkMagenta), QColor(Qt::black)) << "<" << match.c_str() << ">\n" >> 0;
         }
     }
-    pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMECOUNT, &namecount);
+    re.fullInfo(PCRE_INFO_NAMECOUNT, &namecount);
 
     if (namecount <= 0) {
         ;
     } else {
         unsigned char* tabptr;
-        pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMETABLE, &name_table);
+        re.fullInfo(PCRE_INFO_NAMETABLE, &name_table);
 
-        pcre_fullinfo(re.data(), NULL, PCRE_INFO_NAMEENTRYSIZE, &name_entry_size);
+        re.fullInfo(PCRE_INFO_NAMEENTRYSIZE, &name_entry_size);
 
         tabptr = name_table;
         for (i = 0; i < namecount; i++) {
@@ -328,13 +357,14 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
             options = PCRE_NOTEMPTY | PCRE_ANCHORED;
         }
 
-        rc = pcre_exec(re.data(), NULL, subject, subject_length, start_offset, options, ovector, 30);
+        rc = re.exec(subject, subject_length, start_offset, options | PCRE_NO_UTF8_CHECK, ovector, 30);
 
         if (rc == PCRE_ERROR_NOMATCH) {
             if (options == 0) {
                 break;
             }
-            ovector[1] = start_offset + 1;
+            // Step over a whole character, not into the middle of one:
+            ovector[1] = matchSubject.nextCharacterOffset(start_offset);
             continue;
         }
 
@@ -346,7 +376,7 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
             qDebug() << "CRITICAL ERROR: SHOULD NOT HAPPEN->pcre_info() got wrong num of cap groups ovector only has room for %d captured substrings\n";
         }
         for (i = 0; i < rc; i++) {
-            char* substring_start = subject + ovector[2 * i];
+            const char* substring_start = subject + ovector[2 * i];
             int substring_length = ovector[2 * i + 1] - ovector[2 * i];
 
             std::string match;
@@ -357,7 +387,7 @@ bool TTrigger::match_perl(char* subject, const QString& toMatch, int regexNumber
             }
             match.append(substring_start, substring_length);
             captureList.push_back(match);
-            posList.push_back(ovector[2 * i] + posOffset);
+            posList.push_back(matchSubject.textPosition(ovector[2 * i]) + posOffset);
             if (mudlet::debugMode) {
                 TDebug(QColor(Qt::darkCyan), QColor(Qt::black)) << "<regex mode: match all> capture group #" << (i + 1) << " = " >> 0;
                 TDebug(QColor(Qt::darkMagenta), QColor(Qt::black)) << "<" << match.c_str() << ">\n" >> 0;
@@ -381,7 +411,7 @@ END : {
         for (int i = 1; iti != posList.end(); ++iti, ++its, i++) {
             int begin = *iti;
             std::string& s = *its;
-            int length = s.size();
+            int length = TMatchSubject::textLength(s);
             if (total > 1) {
                 // skip complete match in Perl /g option type of triggers
                 // to enable people to highlight capture groups if there are any
@@ -439,7 +469,7 @@ bool TTrigger::match_begin_of_line_substring(const QString& toMatch, const QStri
     if (toMatch.startsWith(regex)) {
         std::list<std::string> captureList;
         std::list<int> posList;
-        captureList.push_back(regex.toLatin1().data());
+        captureList.push_back(regex.toUtf8().constData());
         posList.push_back(0 + posOffset);
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::darkCyan), QColor(Qt::black)) << "Trigger name=" << mName << "(" << mRegexCodeList.value(regexNumber) << ") matched.\n" >> 0;
@@ -456,7 +486,7 @@ bool TTrigger::match_begin_of_line_substring(const QString& toMatch, const QStri
             for (auto iti = posList.begin(); iti != posList.end(); ++iti, ++its) {
                 int begin = *iti;
                 std::string& s = *its;
-                int length = s.size();
+                int length = TMatchSubject::textLength(s);
                 pC->selectSection(begin, length);
                 pC->setBgColor(r1, g1, b1);
                 pC->setFgColor(r2, g2, b2);
@@ -520,17 +550,10 @@ inline void TTrigger::filter(std::string& capture, int& posOffset)
     if (capture.size() < 1) {
         return;
     }
-    char* filterSubject = (char*)malloc(capture.size() + 2048);
-    if (filterSubject) {
-        strcpy(filterSubject, capture.c_str());
-    } else {
-        return;
-    }
-    QString text = capture.c_str();
+    const TMatchSubject filterSubject(QString::fromStdString(capture));
     for (auto& trigger : *mpMyChildrenList) {
-        trigger->match(filterSubject, text, -1, posOffset);
+        trigger->match(filterSubject, -1, posOffset);
     }
-    free(filterSubject);
 }
 
 bool TTrigger::match_substring(const QString& toMatch, const QString& regex, int regexNumber, int posOffset)
@@ -539,11 +562,11 @@ bool TTrigger::match_substring(const QString& toMatch, const QString& regex, int
     if (where != -1) {
         std::list<std::string> captureList;
         std::list<int> posList;
-        captureList.push_back(regex.toLatin1().data());
+        captureList.push_back(regex.toUtf8().constData());
         posList.push_back(where + posOffset);
         if (mPerlSlashGOption) {
             while ((where = toMatch.indexOf(regex, where + 1)) != -1) {
-                captureList.push_back(regex.toLatin1().data());
+                captureList.push_back(regex.toUtf8().constData());
                 posList.push_back(where + posOffset);
             }
         }
@@ -563,7 +586,7 @@ bool TTrigger::match_substring(const QString& toMatch, const QString& regex, int
             for (auto iti = posList.begin(); iti != posList.end(); ++iti, ++its) {
                 int begin = *iti;
                 std::string& s = *its;
-                int length = s.size();
+                int length = TMatchSubject::textLength(s);
                 pC->selectSection(begin, length);
                 pC->setBgColor(r1, g1, b1);
                 pC->setFgColor(r2, g2, b2);
@@ -605,8 +628,8 @@ bool TTrigger::match_color_pattern(int line, int regexNumber)
     if (line >= static_cast<int>(mpHost->mpConsole->buffer.buffer.size())) {
         return false;
     }
-    std::deque<TChar>& bufferLine = mpHost->mpConsole->buffer.buffer[line];
-    QString& lineBuffer = mpHost->mpConsole->buffer.lineBuffer[line];
+    std::vector<TChar>& bufferLine = mpHost->mpConsole->buffer.buffer[line].format;
+    QString& lineBuffer = mpHost->mpConsole->buffer.buffer[line].text;
     int pos = 0;
     int matchBegin = -1;
     bool matching = false;
@@ -622,7 +645,7 @@ bool TTrigger::match_color_pattern(int line, int regexNumber)
     int mBgG = pCT->bgG;
     int mBgB = pCT->bgB;
     for (auto it = bufferLine.begin(); it != bufferLine.end(); it++, pos++) {
-        if (((*it).fgR == mFgR) && ((*it).fgG == mFgG) && ((*it).fgB == mFgB) && ((*it).bgR == mBgR) && ((*it).bgG == mBgG) && ((*it).bgB == mBgB)) {
+        if (((*it).fgR() == mFgR) && ((*it).fgG() == mFgG) && ((*it).fgB() == mFgB) && ((*it).bgR() == mBgR) && ((*it).bgG() == mBgG) && ((*it).bgB() == mBgB)) {
             if (matchBegin == -1) {
                 matchBegin = pos;
             }
@@ -634,9 +657,9 @@ bool TTrigger::match_color_pattern(int line, int regexNumber)
             if (matchBegin > -1) {
                 std::string got;
                 if (matching) {
-                    got = lineBuffer.mid(matchBegin, pos - matchBegin + 1).toLatin1().data();
+                    got = lineBuffer.mid(matchBegin, pos - matchBegin + 1).toUtf8().constData();
                 } else {
-                    got = lineBuffer.mid(matchBegin, pos - matchBegin).toLatin1().data();
+                    got = lineBuffer.mid(matchBegin, pos - matchBegin).toUtf8().constData();
                 }
                 captureList.push_back(got);
                 posList.push_back(matchBegin);
@@ -663,7 +686,7 @@ bool TTrigger::match_color_pattern(int line, int regexNumber)
                 std::string& s = *its;
                 cout << "CTgot<" << s << "> bis:" << s.size() << endl;
 
-                int length = s.size();
+                int length = TMatchSubject::textLength(s);
                 pC->selectSection(begin, length);
                 pC->setBgColor(r1, g1, b1);
                 pC->setFgColor(r2, g2, b2);
@@ -753,7 +776,7 @@ bool TTrigger::match_exact_match(const QString& toMatch, const QString& line, in
     if (text == line) {
         std::list<std::string> captureList;
         std::list<int> posList;
-        captureList.push_back(line.toLatin1().data());
+        captureList.push_back(line.toUtf8().constData());
         posList.push_back(0 + posOffset);
         if (mudlet::debugMode) {
             TDebug(QColor(Qt::yellow), QColor(Qt::black)) << "Trigger name=" << mName << "(" << mRegexCodeList.value(regexNumber) << ") matched.\n" >> 0;
@@ -770,7 +793,7 @@ bool TTrigger::match_exact_match(const QString& toMatch, const QString& line, in
             for (auto iti = posList.begin(); iti != posList.end(); ++iti, ++its) {
                 int begin = *iti;
                 std::string& s = *its;
-                int length = s.size();
+                int length = TMatchSubject::textLength(s);
                 pC->selectSection(begin, length);
                 pC->setBgColor(r1, g1, b1);
                 pC->setFgColor(r2, g2, b2);
@@ -797,8 +820,9 @@ bool TTrigger::match_exact_match(const QString& toMatch, const QString& line, in
     return false;
 }
 
-bool TTrigger::match(char* subject, const QString& toMatch, int line, int posOffset)
+bool TTrigger::match(const TMatchSubject& subject, int line, int posOffset)
 {
+    const QString& toMatch = subject.text();
     bool ret = false;
     if (isActive()) {
         if (mIsLineTrigger) {
@@ -817,6 +841,14 @@ bool TTrigger::match(char* subject, const QString& toMatch, int line, int posOff
             return false;
         }
 
+        // None of the literals that our patterns need are in this line so
+        // none of them can match:
+        if (mpHost->getTriggerUnit()->isRejectedByIndex(this, toMatch)) {
+            return false;
+        }
+
+        TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Trigger, mID, mName, TProfiler::Matching);
+
         bool conditionMet = false;
 
         int highestCondition = 0;
@@ -842,7 +874,7 @@ bool TTrigger::match(char* subject, const QString& toMatch, int line, int posOff
                 break;
 
             case REGEX_PERL:
-                ret = match_perl(subject, toMatch, i, posOffset);
+                ret = match_perl(subject, i, posOffset);
                 break;
 
             case REGEX_BEGIN_OF_LINE_SUBSTRING:
@@ -947,7 +979,7 @@ bool TTrigger::match(char* subject, const QString& toMatch, int line, int posOff
         if (!mFilterTrigger) {
             if (conditionMet || (mRegexCodeList.size() < 1)) {
                 for (auto trigger : *mpMyChildrenList) {
-                    ret = trigger->match(subject, toMatch, line);
+                    ret = trigger->match(subject, line);
                     if (ret) {
                         conditionMet = true;
                     }
@@ -961,15 +993,19 @@ bool TTrigger::match(char* subject, const QString& toMatch, int line, int posOff
                 execute();
             }
             for (auto trigger : *mpMyChildrenList) {
-                ret = trigger->match(subject, toMatch, line);
+                ret = trigger->match(subject, line);
                 if (ret) {
                     conditionMet = true;
                 }
             }
+            // Still firing counts as a match, as it does for the caller:
+            profileScope.setHit();
             return true;
         }
 
-
+        if (conditionMet) {
+            profileScope.setHit();
+        }
         return conditionMet;
     }
     return false;
@@ -1211,6 +1247,9 @@ bool TTrigger::setupTmpColorTrigger(int ansiFg, int ansiBg)
     mRegexCodeList << code;
     mRegexCodePropertyList << REGEX_COLOR_PATTERN;
     mColorPatternList.push_back(pCT);
+    // A color pattern can not be prefiltered by the trigger index:
+    mRequiredLiterals.clear();
+    invalidateIndex();
     return true;
 }
 
@@ -1288,6 +1327,7 @@ bool TTrigger::compileScript()
 
 void TTrigger::execute()
 {
+    TProfileScope profileScope(*mpHost->getProfiler(), TProfiler::Trigger, mID, mName, TProfiler::Executing);
     if (mSoundTrigger) { /* eventually something should be added to the gui to change sound volumes. 100=full volume */
         mudlet::self()->playSound(mSoundFile, 100);
     }
@@ -1299,6 +1339,7 @@ void TTrigger::execute()
             return;
         }
     }
+    TBenchmarkStage benchmarkStage(mpHost->mpReplayBenchmark, TReplayBenchmark::Lua);
     if (mIsMultiline) {
         mpLua->callMulti(mFuncName, mName);
     } else {
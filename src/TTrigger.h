@@ -23,6 +23,7 @@
  ***************************************************************************/
 
 
+#include "TRegex.h"
 #include "Tree.h"
 
 #include "pre_guard.h"
@@ -41,6 +42,7 @@
 class Host;
 class TLuaInterpreter;
 class TMatchState;
+class TMatchSubject;
 
 
 #define REGEX_SUBSTRING 0
@@ -70,6 +72,7 @@ class TTrigger : public Tree<TTrigger>
     Q_DECLARE_TR_FUNCTIONS(TTrigger) // Needed so we can use tr() even though TTrigger is NOT derived from QObject
     friend class XMLexport;
     friend class XMLimport;
+    friend class TTriggerIndex;
 
 public:
     virtual ~TTrigger();
@@ -95,7 +98,7 @@ public:
     QString getScript() { return mScript; }
     bool setScript(const QString& script);
     bool compileScript();
-    bool match(char*, const QString&, int line, int posOffset = 0);
+    bool match(const TMatchSubject&, int line, int posOffset = 0);
 
     bool isMultiline() { return mIsMultiline; }
     int getTriggerType() { return mTriggerType; }
@@ -109,7 +112,7 @@ public:
     void disableTrigger(const QString&);
     TTrigger* killTrigger(const QString&);
     bool match_substring(const QString&, const QString&, int, int posOffset = 0);
-    bool match_perl(char*, const QString&, int, int posOffset = 0);
+    bool match_perl(const TMatchSubject&, int, int posOffset = 0);
     bool match_wildcard(const QString&, int);
     bool match_exact_match(const QString&, const QString&, int, int posOffset = 0);
     bool match_begin_of_line_substring(const QString& toMatch, const QString& regex, int regexNumber, int posOffset = 0);
@@ -148,10 +151,11 @@ private:
     TTrigger() {}
     void updateMultistates(int regexNumber, std::list<std::string>& captureList, std::list<int>& posList);
     void filter(std::string&, int&);
+    void invalidateIndex();
 
 
     QList<int> mRegexCodePropertyList;
-    QMap<int, QSharedPointer<pcre>> mRegexMap;
+    QMap<int, TRegex> mRegexMap;
 
     QString mScript;
 
@@ -174,6 +178,12 @@ private:
     QColor mBgColor;
     bool mIsColorizerTrigger;
     bool mModuleMember;
+    // One literal per pattern, at least one of which must be present in the
+    // line for this trigger to match - empty if that can not be determined:
+    QStringList mRequiredLiterals;
+    // Maintained by TTriggerIndex:
+    bool mIsIndexed;
+    quint64 mIndexStamp;
 };
 
 #endif // MUDLET_TTRIGGER_H
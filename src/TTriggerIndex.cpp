@@ -0,0 +1,358 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TTriggerIndex.h"
+
+
+#include "TTrigger.h"
+
+#include <algorithm>
+#include <queue>
+
+
+TTriggerIndex::TTriggerIndex(const QMap<int, TTrigger*>& triggerMap)
+: mTriggerMap(triggerMap)
+, mIsDirty(true)
+, mStamp(0)
+, mpScannedLine(nullptr)
+, mIndexedTriggers(0)
+, mIndexedLiterals(0)
+{
+}
+
+void TTriggerIndex::remove(TTrigger* pT)
+{
+    // The automaton holds a pointer to the trigger so it must not be used
+    // again until it has been rebuilt without it:
+    pT->mIsIndexed = false;
+    mIsDirty = true;
+}
+
+int TTriggerIndex::findEdge(const int node, const ushort codeUnit) const
+{
+    const std::vector<std::pair<ushort, int>>& edges = mNodes[node].edges;
+    auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(codeUnit, 0));
+    if (it != edges.end() && it->first == codeUnit) {
+        return it->second;
+    }
+    return -1;
+}
+
+void TTriggerIndex::addLiteral(const QString& literal, TTrigger* pT)
+{
+    int node = 0;
+    for (const QChar& c : literal) {
+        int next = findEdge(node, c.unicode());
+        if (next < 0) {
+            next = static_cast<int>(mNodes.size());
+            mNodes.emplace_back();
+            std::vector<std::pair<ushort, int>>& edges = mNodes[node].edges;
+            edges.insert(std::lower_bound(edges.begin(), edges.end(), std::make_pair(c.unicode(), 0)), std::make_pair(c.unicode(), next));
+        }
+        node = next;
+    }
+    if (std::find(mNodes[node].outputs.begin(), mNodes[node].outputs.end(), pT) == mNodes[node].outputs.end()) {
+        mNodes[node].outputs.push_back(pT);
+    }
+}
+
+void TTriggerIndex::rebuild()
+{
+    mNodes.clear();
+    mNodes.emplace_back();
+    mIndexedTriggers = 0;
+    mIndexedLiterals = 0;
+
+    for (auto pT : mTriggerMap) {
+        pT->mIsIndexed = false;
+        if (pT->mRequiredLiterals.isEmpty()) {
+            continue;
+        }
+        for (auto& literal : pT->mRequiredLiterals) {
+            addLiteral(literal, pT);
+            ++mIndexedLiterals;
+        }
+        pT->mIsIndexed = true;
+        pT->mIndexStamp = 0;
+        ++mIndexedTriggers;
+    }
+
+    // Breadth first pass to set the failure links - each node's failure link
+    // is the longest proper suffix of its path that is also a path from the
+    // root:
+    std::queue<int> pending;
+    for (auto& edge : mNodes[0].edges) {
+        mNodes[edge.second].failure = 0;
+        pending.push(edge.second);
+    }
+    while (!pending.empty()) {
+        const int node = pending.front();
+        pending.pop();
+        for (auto& edge : mNodes[node].edges) {
+            int failure = mNodes[node].failure;
+            int target = findEdge(failure, edge.first);
+            while (target < 0 && failure != 0) {
+                failure = mNodes[failure].failure;
+                target = findEdge(failure, edge.first);
+            }
+            const int child = edge.second;
+            mNodes[child].failure = (target < 0 || target == child) ? 0 : target;
+            const int childFailure = mNodes[child].failure;
+            mNodes[child].outputLink = mNodes[childFailure].outputs.empty() ? mNodes[childFailure].outputLink : childFailure;
+            pending.push(child);
+        }
+    }
+
+    mStamp = 0;
+    mIsDirty = false;
+}
+
+void TTriggerIndex::scan(const QString& line)
+{
+    if (mIsDirty) {
+        rebuild();
+    }
+
+    ++mStamp;
+    mpScannedLine = &line;
+    if (mIndexedTriggers == 0) {
+        return;
+    }
+
+    int state = 0;
+    const QChar* pChar = line.constData();
+    const QChar* pEnd = pChar + line.size();
+    for (; pChar != pEnd; ++pChar) {
+        const ushort codeUnit = pChar->unicode();
+        int next = findEdge(state, codeUnit);
+        while (next < 0 && state != 0) {
+            state = mNodes[state].failure;
+            next = findEdge(state, codeUnit);
+        }
+        state = (next < 0) ? 0 : next;
+
+        // Report this node and every shorter literal that is a suffix of it,
+        // stopping at the first node already reported for this line as all
+        // the ones after it will have been reported with it:
+        int output = mNodes[state].outputs.empty() ? mNodes[state].outputLink : state;
+        while (output > 0 && mNodes[output].stamp != mStamp) {
+            Node& node = mNodes[output];
+            node.stamp = mStamp;
+            for (auto pT : node.outputs) {
+                pT->mIndexStamp = mStamp;
+            }
+            output = node.outputLink;
+        }
+    }
+}
+
+// True if the trigger can be passed over for this line without running any
+// of its patterns - only valid for the line that was scanned (not for the
+// captures handed to filter chains) and only when the trigger has no state
+// that it has to update for every line regardless of whether it matches:
+bool TTriggerIndex::rejects(const TTrigger* pT, const QString& toMatch) const
+{
+    return pT->mIsIndexed && &toMatch == mpScannedLine && pT->mIndexStamp != mStamp && !pT->mIsMultiline && pT->mKeepFiring < 1;
+}
+
+QString TTriggerIndex::requiredLiteral(const QString& pattern, const int patternType)
+{
+    switch (patternType) {
+    case REGEX_SUBSTRING:
+    case REGEX_BEGIN_OF_LINE_SUBSTRING:
+    case REGEX_EXACT_MATCH:
+        return pattern;
+    case REGEX_PERL:
+        return requiredPerlLiteral(pattern);
+    default:
+        return QString();
+    }
+}
+
+// Find the longest run of literal characters at the top level of a perl
+// regex that every match must contain. This is deliberately conservative: if
+// there is anything in the pattern that is not fully understood here (top
+// level alternation, option settings, verbs, quoting or numeric escapes) then
+// nothing is returned and the trigger is always tested.
+QString TTriggerIndex::requiredPerlLiteral(const QString& pattern)
+{
+    QString best;
+    QString run;
+    int depth = 0;
+    const int length = pattern.size();
+
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    // Returns the index of the closing brace if there is a {n}, {n,} or
+    // {n,m} quantifier starting at start, -1 otherwise:
+    auto braceQuantifierEnd = [&](const int start) -> int {
+        int i = start + 1;
+        int digits = 0;
+        while (i < length && pattern.at(i).isDigit()) {
+            ++i;
+            ++digits;
+        }
+        if (!digits) {
+            return -1;
+        }
+        if (i < length && pattern.at(i) == QLatin1Char(',')) {
+            ++i;
+            while (i < length && pattern.at(i).isDigit()) {
+                ++i;
+            }
+        }
+        return (i < length && pattern.at(i) == QLatin1Char('}')) ? i : -1;
+    };
+
+    for (int i = 0; i < length; ++i) {
+        QChar c = pattern.at(i);
+        bool isLiteral = false;
+
+        switch (c.unicode()) {
+        case '\\':
+            if (++i >= length) {
+                return QString();
+            }
+            c = pattern.at(i);
+            if (c.unicode() < 128 && !c.isLetterOrNumber()) {
+                // An escaped punctuation or white-space character is itself
+                isLiteral = true;
+            } else if (!QStringLiteral("dDwWsSbBhHvVRNAzZGK").contains(c)) {
+                // Back references, numeric, property and quoting escapes
+                // span a variable number of characters:
+                return QString();
+            }
+            break;
+
+        case '[': {
+            // Skip over the character class, it is not a literal:
+            ++i;
+            if (i < length && pattern.at(i) == QLatin1Char('^')) {
+                ++i;
+            }
+            if (i < length && pattern.at(i) == QLatin1Char(']')) {
+                ++i;
+            }
+            while (i < length && pattern.at(i) != QLatin1Char(']')) {
+                if (pattern.at(i) == QLatin1Char('[')) {
+                    // POSIX classes in a character class - not worth it
+                    return QString();
+                }
+                if (pattern.at(i) == QLatin1Char('\\')) {
+                    if (i + 1 < length && pattern.at(i + 1) == QLatin1Char('Q')) {
+                        return QString();
+                    }
+                    ++i;
+                }
+                ++i;
+            }
+            if (i >= length) {
+                return QString();
+            }
+            break;
+        }
+
+        case '(':
+            if (i + 1 < length && pattern.at(i + 1) == QLatin1Char('*')) {
+                // A verb like (*UTF8) or (*CRLF)
+                return QString();
+            }
+            if (i + 2 < length && pattern.at(i + 1) == QLatin1Char('?') && !QStringLiteral(":=!<>|P'").contains(pattern.at(i + 2))) {
+                // Inline option settings (e.g. (?i)) or comments
+                return QString();
+            }
+            ++depth;
+            break;
+
+        case ')':
+            if (--depth < 0) {
+                return QString();
+            }
+            break;
+
+        case '|':
+            if (!depth) {
+                // Top level alternation - no single literal is required
+                return QString();
+            }
+            break;
+
+        case '{': {
+            const int end = braceQuantifierEnd(i);
+            if (end < 0) {
+                return QString();
+            }
+            i = end;
+            break;
+        }
+
+        case '.':
+        case '^':
+        case '$':
+        case '?':
+        case '*':
+        case '+':
+            break;
+
+        default:
+            // A quantifier after a surrogate pair applies to both halves, so
+            // they are not worth the trouble of handling:
+            isLiteral = !c.isSurrogate();
+        }
+
+        if (!isLiteral) {
+            if (!depth) {
+                endRun();
+            }
+            continue;
+        }
+        if (depth) {
+            continue;
+        }
+
+        if (i + 1 < length) {
+            const QChar next = pattern.at(i + 1);
+            if (next == QLatin1Char('?') || next == QLatin1Char('*') || next == QLatin1Char('{')) {
+                // This character is optional (or may be repeated) so the run
+                // can not include it:
+                endRun();
+                continue;
+            }
+            if (next == QLatin1Char('+')) {
+                // At least one of this character, but the run can not continue
+                // past it:
+                run.append(c);
+                endRun();
+                continue;
+            }
+        }
+        run.append(c);
+    }
+
+    if (depth) {
+        return QString();
+    }
+    endRun();
+    return best;
+}
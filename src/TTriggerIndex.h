@@ -0,0 +1,88 @@
+#ifndef MUDLET_TTRIGGERINDEX_H
+#define MUDLET_TTRIGGERINDEX_H
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "pre_guard.h"
+#include <QMap>
+#include <QString>
+#include "post_guard.h"
+
+#include <utility>
+#include <vector>
+
+class TTrigger;
+
+
+// Multi-pattern prefilter for the trigger tree: every trigger whose patterns
+// are all substring, begin of line, exact match or perl regex patterns with a
+// literal that any match must contain is entered into a single Aho-Corasick
+// automaton. Each incoming line is scanned once and every trigger for which
+// none of those literals is present can then be passed over by
+// TTrigger::match() without running any of its patterns.
+//
+// The automaton does not depend on whether a trigger is enabled (that is
+// still checked by TTrigger::match() itself) so enabling and disabling
+// triggers is free, only changes to patterns or to the set of registered
+// triggers cause it to be rebuilt - and then only lazily on the next line.
+class TTriggerIndex
+{
+public:
+    explicit TTriggerIndex(const QMap<int, TTrigger*>& triggerMap);
+
+    void invalidate() { mIsDirty = true; }
+    void remove(TTrigger*);
+    void scan(const QString& line);
+    void endScan() { mpScannedLine = nullptr; }
+    bool rejects(const TTrigger*, const QString& toMatch) const;
+    int indexedTriggers() const { return mIndexedTriggers; }
+    int indexedLiterals() const { return mIndexedLiterals; }
+
+    static QString requiredLiteral(const QString& pattern, int patternType);
+
+private:
+    struct Node
+    {
+        Node() : failure(0), outputLink(-1), stamp(0) {}
+
+        // Sorted on the code unit so they can be searched quickly:
+        std::vector<std::pair<ushort, int>> edges;
+        int failure;
+        // Next node along the failure chain that has something in outputs:
+        int outputLink;
+        std::vector<TTrigger*> outputs;
+        quint64 stamp;
+    };
+
+    void rebuild();
+    int findEdge(int node, ushort codeUnit) const;
+    void addLiteral(const QString&, TTrigger*);
+    static QString requiredPerlLiteral(const QString&);
+
+    const QMap<int, TTrigger*>& mTriggerMap;
+    std::vector<Node> mNodes;
+    bool mIsDirty;
+    quint64 mStamp;
+    const QString* mpScannedLine;
+    int mIndexedTriggers;
+    int mIndexedLiterals;
+};
+
+#endif // MUDLET_TTRIGGERINDEX_H
@@ -25,6 +25,7 @@
 #include "Host.h"
 #include "TConsole.h"
 #include "TLuaInterpreter.h"
+#include "TMatchSubject.h"
 #include "TTrigger.h"
 
 #include <iostream>
@@ -107,6 +108,7 @@ void TriggerUnit::addTriggerRootNode(TTrigger* pT, int parentPosition, int child
 
     if (!moveTrigger) {
         mTriggerMap.insert(pT->getID(), pT);
+        mTriggerIndex.invalidate();
     }
 }
 
@@ -145,6 +147,7 @@ void TriggerUnit::removeTriggerRootNode(TTrigger* pT)
         mLookupTable.remove(pT->getName());
     }
     mTriggerMap.remove(pT->getID());
+    mTriggerIndex.remove(pT);
     mTriggerRootNodeList.remove(pT);
 }
 
@@ -208,6 +211,7 @@ void TriggerUnit::addTrigger(TTrigger* pT)
     }
 
     mTriggerMap.insert(pT->getID(), pT);
+    mTriggerIndex.invalidate();
 }
 
 void TriggerUnit::removeTrigger(TTrigger* pT)
@@ -222,6 +226,7 @@ void TriggerUnit::removeTrigger(TTrigger* pT)
     }
 
     mTriggerMap.remove(pT->getID());
+    mTriggerIndex.remove(pT);
 }
 
 // trigger matching order is permantent trigger objects first, temporary objects second
@@ -250,13 +255,16 @@ int TriggerUnit::getNewID()
 void TriggerUnit::processDataStream(const QString& data, int line)
 {
     if (data.size() > 0) {
-        char* subject = (char*)malloc(strlen(data.toLocal8Bit().data()) + 1);
-        strcpy(subject, data.toLocal8Bit().data());
+        // Encoded just once for every trigger in the tree:
+        const TMatchSubject subject(data);
 
+        // Find every trigger that could possibly match this line in a single
+        // pass, TTrigger::match() will pass over the others:
+        mTriggerIndex.scan(subject.text());
         for (auto trigger : mTriggerRootNodeList) {
-            trigger->match(subject, data, line);
+            trigger->match(subject, line);
         }
-        free(subject);
+        mTriggerIndex.endScan();
 
         for (auto& trigger : mCleanupList) {
             delete trigger;
@@ -399,7 +407,8 @@ QString TriggerUnit::assembleReport()
     msg << "triggers current total: " << QString::number(statsTriggerTotal) << "\n"
         << "trigger patterns total: " << QString::number(statsPatterns) << "\n"
         << "tempTriggers current total: " << QString::number(statsTempTriggers) << "\n"
-        << "active triggers: " << QString::number(statsActiveTriggers) << "\n";
+        << "active triggers: " << QString::number(statsActiveTriggers) << "\n"
+        << "prefiltered triggers: " << QString::number(mTriggerIndex.indexedTriggers()) << " (" << QString::number(mTriggerIndex.indexedLiterals()) << " literals)\n";
     return msg.join("");
 }
 
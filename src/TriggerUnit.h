@@ -29,6 +29,8 @@
 #include <QString>
 #include "post_guard.h"
 
+#include "TTriggerIndex.h"
+
 #include <list>
 
 class Host;
@@ -41,7 +43,7 @@ class TriggerUnit
     friend class XMLimport;
 
 public:
-    TriggerUnit(Host* pHost) : mpHost(pHost), mMaxID(0), statsPatterns(), mModuleMember() { initStats(); }
+    TriggerUnit(Host* pHost) : mpHost(pHost), mTriggerIndex(mTriggerMap), mMaxID(0), statsPatterns(), mModuleMember() { initStats(); }
 
     std::list<TTrigger*> getTriggerRootNodeList()
     {
@@ -60,6 +62,8 @@ public:
     void unregisterTrigger(TTrigger* pT);
     void reParentTrigger(int childID, int oldParentID, int newParentID, int parentPosition = -1, int childPosition = -1);
     void processDataStream(const QString&, int);
+    void invalidateTriggerIndex() { mTriggerIndex.invalidate(); }
+    bool isRejectedByIndex(const TTrigger* pT, const QString& toMatch) const { return mTriggerIndex.rejects(pT, toMatch); }
     void compileAll();
     void setTriggerStayOpen(const QString&, int);
     void stopAllTriggers();
@@ -90,7 +94,7 @@ public:
     QList<TTrigger*> uninstallList;
 
 private:
-    TriggerUnit() {}
+    TriggerUnit() : mTriggerIndex(mTriggerMap) {}
     void initStats();
     void _assembleReport(TTrigger*);
     TTrigger* getTriggerPrivate(int id);
@@ -101,6 +105,7 @@ private:
 
     QPointer<Host> mpHost;
     QMap<int, TTrigger*> mTriggerMap;
+    TTriggerIndex mTriggerIndex;
     std::list<TTrigger*> mTriggerRootNodeList;
     int mMaxID;
     bool mModuleMember;
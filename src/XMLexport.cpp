@@ -332,8 +332,14 @@ bool XMLexport::writeHost(Host* pHost)
     // future - phpBB code might be useful if it can be done.
     writeAttribute("mRawStreamDump", pHost->mIsNextLogFileInHtmlFormat ? "yes" : "no");
     writeAttribute("mIsLoggingTimestamps", pHost->mIsLoggingTimestamps ? "yes" : "no");
+    writeAttribute("mIsLogCompressed", pHost->mIsLogCompressed ? "yes" : "no");
+    writeAttribute("mLogFlushInterval", QString::number(pHost->mLogFlushInterval));
+    writeAttribute("mLogFlushSize", QString::number(pHost->mLogFlushSize));
+    writeAttribute("mLogRotateSize", QString::number(pHost->mLogRotateSize));
+    writeAttribute("mLogRotateInterval", QString::number(pHost->mLogRotateInterval));
     writeAttribute("mAlertOnNewData", pHost->mAlertOnNewData ? "yes" : "no");
     writeAttribute("mFORCE_NO_COMPRESSION", pHost->mFORCE_NO_COMPRESSION ? "yes" : "no");
+    writeAttribute("mUseNetworkThread", pHost->mUseNetworkThread ? "yes" : "no");
     writeAttribute("mFORCE_GA_OFF", pHost->mFORCE_GA_OFF ? "yes" : "no");
     writeAttribute("mFORCE_SAVE_ON_EXIT", pHost->mFORCE_SAVE_ON_EXIT ? "yes" : "no");
     writeAttribute("mEnableGMCP", pHost->mEnableGMCP ? "yes" : "no");
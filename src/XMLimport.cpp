@@ -735,8 +735,22 @@ void XMLimport::readHostPackage(Host* pHost)
     pHost->mEchoLuaErrors = (attributes().value("mEchoLuaErrors") == "yes");
     pHost->mIsNextLogFileInHtmlFormat = (attributes().value("mRawStreamDump") == "yes");
     pHost->mIsLoggingTimestamps = (attributes().value("mIsLoggingTimestamps") == "yes");
+    pHost->mIsLogCompressed = (attributes().value("mIsLogCompressed") == "yes");
+    if (attributes().hasAttribute(QLatin1String("mLogFlushInterval"))) {
+        pHost->mLogFlushInterval = qMax(1, attributes().value(QLatin1String("mLogFlushInterval")).toInt());
+    }
+    if (attributes().hasAttribute(QLatin1String("mLogFlushSize"))) {
+        pHost->mLogFlushSize = qMax(1, attributes().value(QLatin1String("mLogFlushSize")).toInt());
+    }
+    if (attributes().hasAttribute(QLatin1String("mLogRotateSize"))) {
+        pHost->mLogRotateSize = qMax(0, attributes().value(QLatin1String("mLogRotateSize")).toInt());
+    }
+    if (attributes().hasAttribute(QLatin1String("mLogRotateInterval"))) {
+        pHost->mLogRotateInterval = qMax(0, attributes().value(QLatin1String("mLogRotateInterval")).toInt());
+    }
     pHost->mAlertOnNewData = (attributes().value("mAlertOnNewData") == "yes");
     pHost->mFORCE_NO_COMPRESSION = (attributes().value("mFORCE_NO_COMPRESSION") == "yes");
+    pHost->mUseNetworkThread = (attributes().value("mUseNetworkThread") == "yes");
     pHost->mFORCE_GA_OFF = (attributes().value("mFORCE_GA_OFF") == "yes");
     pHost->mFORCE_SAVE_ON_EXIT = (attributes().value("mFORCE_SAVE_ON_EXIT") == "yes");
     pHost->mEnableGMCP = (attributes().value("mEnableGMCP") == "yes");
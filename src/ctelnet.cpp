@@ -35,6 +35,7 @@
 #include "TDebug.h"
 #include "TEvent.h"
 #include "TMap.h"
+#include "TTelnetReader.h"
 #include "dlgComposer.h"
 #include "dlgMapper.h"
 #include "glwidget.h"
@@ -47,9 +48,11 @@
 #include <QProgressDialog>
 #include <QStringBuilder>
 #include <QTextCodec>
+#include <QThread>
 #include <QTimer>
 #include "post_guard.h"
 
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -87,6 +90,10 @@ cTelnet::cTelnet(Host* pH)
 , networkLatencyMax()
 , mWaitingForResponse()
 , mZstream()
+, mIsUsingNetworkThread(false)
+, mIsNetworkConnected(false)
+, mpNetworkReader(nullptr)
+, mpNetworkThread(nullptr)
 , recvdGA()
 , lastTimeOffset()
 {
@@ -166,9 +173,41 @@ cTelnet::~cTelnet()
             qWarning("%s\n------------", qPrintable(message));
         }
     }
+    if (mpNetworkThread) {
+        // Drop the connection before the reader goes, it is deleted when its
+        // thread finishes:
+        QMetaObject::invokeMethod(mpNetworkReader, "slot_abort", Qt::BlockingQueuedConnection);
+        mpNetworkThread->quit();
+        mpNetworkThread->wait();
+    }
     socket.deleteLater();
 }
 
+void cTelnet::startNetworkThread()
+{
+    if (mpNetworkThread) {
+        return;
+    }
+    mpNetworkThread = new QThread(this);
+    mpNetworkReader = new TTelnetReader(this);
+    mpNetworkReader->moveToThread(mpNetworkThread);
+    connect(mpNetworkThread, SIGNAL(finished()), mpNetworkReader, SLOT(deleteLater()));
+    mpNetworkThread->start();
+}
+
+void cTelnet::updateReaderCompression()
+{
+    if (mIsUsingNetworkThread && mpNetworkReader) {
+        const bool allowed = !mpHost->mFORCE_NO_COMPRESSION && (mMCCP_version_1 || mMCCP_version_2);
+        QMetaObject::invokeMethod(mpNetworkReader, "slot_setCompressionAllowed", Qt::QueuedConnection, Q_ARG(bool, allowed));
+    }
+}
+
+QString cTelnet::socketErrorString() const
+{
+    return mIsUsingNetworkThread ? mNetworkErrorString : socket.errorString();
+}
+
 
 void cTelnet::encodingChanged(const QString& encoding)
 {
@@ -248,12 +287,24 @@ void cTelnet::connectIt(const QString& address, int port)
         mFORCE_GA_OFF = mpHost->mFORCE_GA_OFF;
     }
 
-    if (socket.state() != QAbstractSocket::UnconnectedState) {
+    if (mIsUsingNetworkThread) {
+        if (mIsNetworkConnected) {
+            QMetaObject::invokeMethod(mpNetworkReader, "slot_abort", Qt::QueuedConnection);
+            mIsNetworkConnected = false;
+        }
+    } else if (socket.state() != QAbstractSocket::UnconnectedState) {
         socket.abort();
         connectIt(address, port);
         return;
     }
 
+    // Only changed between connections, so that one connection is handled
+    // in just the one way:
+    mIsUsingNetworkThread = mpHost && mpHost->mUseNetworkThread;
+    if (mIsUsingNetworkThread) {
+        startNetworkThread();
+    }
+
     hostName = address;
     hostPort = port;
     QString server = "[ INFO ]  - Looking up the IP address of server:" + address + ":" + QString::number(port) + " ...";
@@ -264,12 +315,16 @@ void cTelnet::connectIt(const QString& address, int port)
 
 void cTelnet::disconnect()
 {
-    socket.disconnectFromHost();
+    if (mIsUsingNetworkThread) {
+        QMetaObject::invokeMethod(mpNetworkReader, "slot_disconnectFromHost", Qt::QueuedConnection);
+    } else {
+        socket.disconnectFromHost();
+    }
 }
 
 void cTelnet::handle_socket_signal_error()
 {
-    QString err = "[ ERROR ] - TCP/IP socket ERROR:" % socket.errorString();
+    QString err = "[ ERROR ] - TCP/IP socket ERROR:" % socketErrorString();
     postMessage(err);
 }
 
@@ -317,7 +372,7 @@ void cTelnet::handle_socket_signal_disconnected()
     msg = QString("[ INFO ]  - Connection time: %1\n    ").arg(timeDiff.addMSecs(mConnectionTime.elapsed()).toString("hh:mm:ss.zzz"));
     mNeedDecompression = false;
     reset();
-    QString err = "[ ALERT ] - Socket got disconnected.\nReason: " % socket.errorString();
+    QString err = "[ ALERT ] - Socket got disconnected.\nReason: " % socketErrorString();
     QString spacer = "    ";
     if (!mpHost->mIsGoingDown) {
         postMessage(spacer);
@@ -334,9 +389,17 @@ void cTelnet::handle_socket_signal_hostFound(QHostInfo hostInfo)
         postMessage(msg);
         msg = "[ INFO ]  - Trying to connect to " + mHostAddress.toString() + ":" + QString::number(hostPort) + " ...\n";
         postMessage(msg);
-        socket.connectToHost(mHostAddress, hostPort);
+        if (mIsUsingNetworkThread) {
+            QMetaObject::invokeMethod(mpNetworkReader, "slot_connectToHost", Qt::QueuedConnection, Q_ARG(QString, mHostAddress.toString()), Q_ARG(int, hostPort));
+        } else {
+            socket.connectToHost(mHostAddress, hostPort);
+        }
     } else {
-        socket.connectToHost(hostInfo.hostName(), hostPort);
+        if (mIsUsingNetworkThread) {
+            QMetaObject::invokeMethod(mpNetworkReader, "slot_connectToHost", Qt::QueuedConnection, Q_ARG(QString, hostInfo.hostName()), Q_ARG(int, hostPort));
+        } else {
+            socket.connectToHost(hostInfo.hostName(), hostPort);
+        }
         QString msg = "[ ERROR ] - Host name lookup Failure!\nConnection cannot be established.\nThe server name is not correct, not working properly,\nor your nameservers are not working properly.";
         postMessage(msg);
         return;
@@ -380,21 +443,28 @@ bool cTelnet::sendData(QString& data)
 
 bool cTelnet::socketOutRaw(string& data)
 {
-    if (!socket.isWritable()) {
-        return false;
-    }
-    int dataLength = data.length();
-    int remlen = dataLength;
-
-    do {
-        int written = socket.write(data.data(), remlen);
-
-        if (written == -1) {
+    if (mIsUsingNetworkThread) {
+        if (!mIsNetworkConnected) {
+            return false;
+        }
+        QMetaObject::invokeMethod(mpNetworkReader, "slot_write", Qt::QueuedConnection, Q_ARG(QByteArray, QByteArray(data.data(), static_cast<int>(data.size()))));
+    } else {
+        if (!socket.isWritable()) {
             return false;
         }
-        remlen -= written;
-        dataLength += written;
-    } while (remlen > 0);
+        int dataLength = data.length();
+        int remlen = dataLength;
+
+        do {
+            int written = socket.write(data.data(), remlen);
+
+            if (written == -1) {
+                return false;
+            }
+            remlen -= written;
+            dataLength += written;
+        } while (remlen > 0);
+    }
 
     if (mGA_Driver) {
         mCommands++;
@@ -687,8 +757,6 @@ void cTelnet::processTelnetCommand(const string& command)
                         hisOptionState[idxOption] = false;
                         qDebug() << "Rejecting MCCP v1, because v2 has already been negotiated or FORCE COMPRESSION OFF is set to ON.";
                     } else {
-                        sendTelnetOption(TN_DO, option);
-                        hisOptionState[idxOption] = true;
                         //inform MCCP object about the change
                         if (option == OPT_COMPRESS) {
                             mMCCP_version_1 = true;
@@ -697,6 +765,11 @@ void cTelnet::processTelnetCommand(const string& command)
                             mMCCP_version_2 = true;
                             qDebug() << "MCCP v2 negotiated!";
                         }
+                        // Before the DO is sent, so that the network thread
+                        // knows about it by the time the server can start:
+                        updateReaderCompression();
+                        sendTelnetOption(TN_DO, option);
+                        hisOptionState[idxOption] = true;
                     }
                 } else if (supportedTelnetOptions.contains(option)) {
                     sendTelnetOption(TN_DO, option);
@@ -758,6 +831,9 @@ void cTelnet::processTelnetCommand(const string& command)
                     mMCCP_version_2 = false;
                     qDebug() << "MCCP v2 disabled !";
                 }
+                if (option == OPT_COMPRESS || option == OPT_COMPRESS2) {
+                    updateReaderCompression();
+                }
             }
             heAnnouncedState[idxOption] = true;
         }
@@ -885,12 +961,11 @@ void cTelnet::processTelnetCommand(const string& command)
 
         // MSDP
         if (option == static_cast<char>(69)) {
-            QString _m = command.c_str();
             if (command.size() < 6) {
                 return;
             }
-            _m = _m.mid(3, command.size() - 5);
-            mpHost->mLuaInterpreter.msdp2Lua(_m.toLocal8Bit().data(), _m.length());
+            // Decoded straight from the received bytes, which outlive the call:
+            mpHost->mLuaInterpreter.msdp2Lua(QByteArray::fromRawData(command.data() + 3, command.size() - 5));
             return;
         }
         // ATCP
@@ -967,12 +1042,10 @@ void cTelnet::processTelnetCommand(const string& command)
 
         // GMCP
         if (option == static_cast<char>(201)) {
-            QString _m = command.c_str();
             if (command.size() < 6) {
                 return;
             }
-            _m = _m.mid(3, command.size() - 5);
-            setGMCPVariables(_m);
+            setGMCPVariables(QByteArray::fromRawData(command.data() + 3, command.size() - 5));
             return;
         }
 
@@ -1121,19 +1194,23 @@ void cTelnet::setATCPVariables(const QString& msg)
     }
 }
 
-void cTelnet::setGMCPVariables(const QString& msg)
+void cTelnet::setGMCPVariables(const QByteArray& data)
 {
-    QString var;
-    QString arg;
-    if (msg.indexOf('\n') > -1) {
-        var = msg.section("\n", 0, 0);
-        arg = msg.section("\n", 1);
-    } else {
-        var = msg.section(" ", 0, 0);
-        arg = msg.section(" ", 1);
+    // The package name is separated from the (optional) JSON by white space,
+    // the JSON is handed on as the bytes received so that it can be decoded
+    // straight into Lua:
+    int separator = 0;
+    while (separator < data.size() && data.at(separator) != ' ' && data.at(separator) != '\n') {
+        ++separator;
+    }
+    const QString var = QString::fromUtf8(data.constData(), separator);
+    QByteArray arg;
+    if (separator < data.size()) {
+        arg = QByteArray::fromRawData(data.constData() + separator + 1, data.size() - separator - 1);
     }
 
-    if (msg.startsWith("Client.GUI")) {
+    if (var.startsWith("Client.GUI")) {
+        const QString msg = QString::fromUtf8(data);
         if (!mpHost->mAcceptServerGUI) {
             return;
         }
@@ -1181,9 +1258,6 @@ void cTelnet::setGMCPVariables(const QString& msg)
         mpProgressDialog->show();
         return;
     }
-    arg.remove('\n');
-    // remove \r's from the data, as yajl doesn't like it
-    arg.remove(QChar('\r'));
     mpHost->mLuaInterpreter.setGMCPTable(var, arg);
 }
 
@@ -1490,19 +1564,31 @@ void cTelnet::initStreamDecompressor()
     inflateInit(&mZstream);
 }
 
-int cTelnet::decompressBuffer(char*& in_buffer, int& length, char* out_buffer)
+// Inflates the input, advancing it past what was used, into mInflateBuffer -
+// which is grown as needed so that all the output that is available for the
+// input is taken now instead of being left in the stream until the next read.
+// Returns the amount of output.
+int cTelnet::decompressBuffer(const char*& in_buffer, int& length)
 {
     mZstream.avail_in = length;
-    mZstream.next_in = (Bytef*)in_buffer;
-
-    mZstream.avail_out = 100000;
-    mZstream.next_out = (Bytef*)out_buffer;
+    mZstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in_buffer));
 
-    int zval = inflate(&mZstream, Z_SYNC_FLUSH);
-    int outSize = 100000 - mZstream.avail_out;
+    int outSize = 0;
+    int zval;
+    // Keep going for as long as inflate() fills the buffer, as there may be
+    // more output to come:
+    do {
+        if (outSize == mInflateBuffer.size()) {
+            mInflateBuffer.resize(qMax(65536, mInflateBuffer.size() * 2));
+        }
+        mZstream.avail_out = mInflateBuffer.size() - outSize;
+        mZstream.next_out = reinterpret_cast<Bytef*>(mInflateBuffer.data()) + outSize;
+        zval = inflate(&mZstream, Z_SYNC_FLUSH);
+        outSize = mInflateBuffer.size() - mZstream.avail_out;
+    } while (zval == Z_OK && mZstream.avail_out == 0);
 
     length = mZstream.avail_in;
-    in_buffer = (char*)mZstream.next_in;
+    in_buffer = reinterpret_cast<const char*>(mZstream.next_in);
 
     if (zval == Z_STREAM_END) {
         inflateEnd(&mZstream);
@@ -1515,30 +1601,24 @@ int cTelnet::decompressBuffer(char*& in_buffer, int& length, char* out_buffer)
         // zval should always be NULL on inflateEnd.  No need for an else block. MCCP Rev. 3 -MH //
         initStreamDecompressor();
         qDebug() << "Listening for new compression sequences";
-        return -1;
+        // Any input left over after the end of the stream is not compressed
+    } else if (zval != Z_OK && zval != Z_BUF_ERROR) {
+        // The stream is corrupt, nothing more can be got from this input:
+        qDebug() << "cTelnet::decompressBuffer() ERROR: inflate() returned" << zval << "discarding" << length << "bytes";
+        length = 0;
     }
-    /* TODO: Remove this commented code once it is deemed safe. -MH
-	   else
-	   {
-	    if( zval <= 0 )
-	    {
-	        initStreamDecompressor();
-	        qDebug() << "Listening for new compression sequences";
-	        return -1;
-	    }
-	   }
-	 */
     return outSize;
 }
 
-
 void cTelnet::recordReplay()
 {
     lastTimeOffset = 0;
     timeOffset.start();
 }
 
-char loadBuffer[100001];
+// Sized for each block of the replay as it is loaded, since those recorded
+// after decompression can be of any size:
+QByteArray loadBuffer;
 int loadedBytes;
 QDataStream replayStream;
 QFile replayFile;
@@ -1571,14 +1651,14 @@ void cTelnet::_loadReplay()
         replayStream >> offset;
         replayStream >> amount;
 
-        char* pB = &loadBuffer[0];
-        loadedBytes = replayStream.readRawData(pB, amount);
+        loadBuffer.resize(qMax(0, amount));
+        loadedBytes = qMax(0, replayStream.readRawData(loadBuffer.data(), amount));
         qDebug("_loadReplay(): loaded: %i/%i bytes, wait for %1.3f seconds. (Single shot duration is: %1.3f seconds.)",
                loadedBytes,
                amount,
                offset / 1000.0,
                offset / (1000.0 * mudlet::self()->mReplaySpeed));
-        loadBuffer[loadedBytes] = '\0'; // Previous use of loadedBytes + 1 caused a spurious character at end of string display by a qDebug of the loadBuffer contents
+        loadBuffer.resize(loadedBytes);
         mudlet::self()->mReplayTime = mudlet::self()->mReplayTime.addMSecs(offset);
         QTimer::singleShot(offset / mudlet::self()->mReplaySpeed, this, SLOT(readPipe()));
     } else {
@@ -1593,100 +1673,22 @@ void cTelnet::_loadReplay()
 
 void cTelnet::readPipe()
 {
-    int datalen = loadedBytes;
-    string cleandata = "";
-    recvdGA = false;
-    qDebug(R"(Replay data: "%s")", loadBuffer);
-    for (int i = 0; i < datalen; i++) {
-        char ch = loadBuffer[i];
-        if (iac || iac2 || insb || (ch == TN_IAC)) {
-#ifdef DEBUG
-            qDebug() << " SERVER sends telnet command " << (quint8)ch;
-#endif
-            if (!(iac || iac2 || insb) && (ch == TN_IAC)) {
-                iac = true;
-                command += ch;
-            } else if (iac && (ch == TN_IAC) && (!insb)) {
-                //2. seq. of two IACs
-                iac = false;
-                cleandata += ch;
-                command = "";
-            } else if (iac && (!insb) && ((ch == TN_WILL) || (ch == TN_WONT) || (ch == TN_DO) || (ch == TN_DONT))) {
-                //3. IAC DO/DONT/WILL/WONT
-                iac = false;
-                iac2 = true;
-                command += ch;
-            } else if (iac2) {
-                //4. IAC DO/DONT/WILL/WONT <command code>
-                iac2 = false;
-                command += ch;
-                processTelnetCommand(command);
-                command = "";
-            } else if (iac && (!insb) && (ch == TN_SB)) {
-                //5. IAC SB
-                iac = false;
-                insb = true;
-                command += ch;
-            } else if (iac && (!insb) && (ch == TN_SE)) {
-                //6. IAC SE without IAC SB - error - ignored
-                command = "";
-                iac = false;
-            } else if (insb) {
-                //7. inside IAC SB
-                command += ch;
-                if (iac && (ch == TN_SE)) //IAC SE - end of subcommand
-                {
-                    processTelnetCommand(command);
-                    command = "";
-                    iac = false;
-                    insb = false;
-                }
-                if (iac) {
-                    iac = false;
-                } else if (ch == TN_IAC) {
-                    iac = true;
-                }
-            } else
-            //8. IAC fol. by something else than IAC, SB, SE, DO, DONT, WILL, WONT
-            {
-                iac = false;
-                command += ch;
-                processTelnetCommand(command);
-                //this could have set receivedGA to true; we'll handle that later
-                command = "";
-            }
-        } else {
-            if (ch != '\r') {
-                cleandata += ch;
-            }
-        }
-
-        if (recvdGA) {
-            mGA_Driver = true;
-            if (mCommands > 0) {
-                mCommands--;
-                if (networkLatencyTime.elapsed() > 2000) {
-                    mCommands = 0;
-                }
-            }
-
-            if (mUSE_IRE_DRIVER_BUGFIX || mLF_ON_GA) {
-                cleandata.push_back('\n'); //part of the broken IRE-driver bugfix to make up for broken \n-prepending in unsolicited lines, part #2 see line 628
-            }
-            recvdGA = false;
-            gotPrompt(cleandata);
-            cleandata = "";
-        }
-    } //for
+    processReplayData(loadBuffer.constData(), loadedBytes);
+    if (loadingReplay) {
+        _loadReplay();
+    }
+}
 
+// Recorded data is as it was after any decompression, so it goes through the
+// same processing as data from the server from that point on:
+void cTelnet::processReplayData(const char* data, const int length)
+{
+    string cleandata;
+    processSocketData(data, length, cleandata, true);
     if (cleandata.size() > 0) {
         gotRest(cleandata);
     }
-
     mpHost->mpConsole->finalize();
-    if (loadingReplay) {
-        _loadReplay();
-    }
 }
 
 void cTelnet::handle_socket_signal_readyRead()
@@ -1699,177 +1701,264 @@ void cTelnet::handle_socket_signal_readyRead()
         mWaitingForResponse = false;
     }
 
-    char in_bufferx[100010];
-    char* in_buffer = in_bufferx;
-    char out_buffer[100010];
-
-    int amount = socket.read(in_buffer, 100000);
-    in_buffer[amount + 1] = '\0';
-    if (amount == -1) {
+    // Take everything that has arrived, anything left behind would not be
+    // seen until more data arrives and readyRead() is signalled again:
+    const qint64 available = socket.bytesAvailable();
+    if (available <= 0) {
         return;
     }
-    if (amount == 0) {
+    if (mReadBuffer.size() < available) {
+        mReadBuffer.resize(available);
+    }
+    const qint64 amount = socket.read(mReadBuffer.data(), available);
+    if (amount <= 0) {
         return;
     }
 
-    string cleandata = "";
-    int datalen;
-    do {
-        datalen = amount;
-        char* buffer = in_buffer;
-        if (mNeedDecompression) {
-            datalen = decompressBuffer(in_buffer, amount, out_buffer);
-            buffer = out_buffer;
+    string cleandata;
+    const char* pending = mReadBuffer.constData();
+    int pendingLength = static_cast<int>(amount);
+    while (pendingLength > 0) {
+        const char* buffer = pending;
+        int datalen = pendingLength;
+        const bool isDecompressed = mNeedDecompression;
+        if (isDecompressed) {
+            // This uses up all of the pending data, unless the compressed
+            // stream ends part way through it:
+            datalen = decompressBuffer(pending, pendingLength);
+            buffer = mInflateBuffer.constData();
+        } else {
+            pendingLength = 0;
         }
-        buffer[datalen] = '\0';
+
+        const int used = processSocketData(buffer, datalen, cleandata, isDecompressed);
         if (mpHost->mpConsole->mRecordReplay) {
             mpHost->mpConsole->mReplayStream << timeOffset.elapsed() - lastTimeOffset;
-            mpHost->mpConsole->mReplayStream << datalen;
-            mpHost->mpConsole->mReplayStream.writeRawData(&buffer[0], datalen);
-        }
-
-        recvdGA = false;
-        for (int i = 0; i < datalen; i++) {
-            char ch = buffer[i];
-
-            if (iac || iac2 || insb || (ch == TN_IAC)) {
-                if (!(iac || iac2 || insb) && (ch == TN_IAC)) {
-                    iac = true;
-                    command += ch;
-                } else if (iac && (ch == TN_IAC) && (!insb)) {
-                    //2. seq. of two IACs
-                    iac = false;
-                    cleandata += ch;
-                    command = "";
-                } else if (iac && (!insb) && ((ch == TN_WILL) || (ch == TN_WONT) || (ch == TN_DO) || (ch == TN_DONT))) {
-                    //3. IAC DO/DONT/WILL/WONT
-                    iac = false;
-                    iac2 = true;
-                    command += ch;
-                } else if (iac2) {
-                    //4. IAC DO/DONT/WILL/WONT <command code>
-                    iac2 = false;
-                    command += ch;
-                    processTelnetCommand(command);
-                    command = "";
-                } else if (iac && (!insb) && (ch == TN_SB)) {
-                    //5. IAC SB
-                    iac = false;
-                    insb = true;
-                    command += ch;
-                } else if (iac && (!insb) && (ch == TN_SE)) {
-                    //6. IAC SE without IAC SB - error - ignored
-                    command = "";
-                    iac = false;
-                } else if (insb) {
-                    if (!mNeedDecompression) {
-                        // IAC SB COMPRESS WILL SE for MCCP v1 (unterminated invalid telnet sequence)
-                        // IAC SB COMPRESS2 IAC SE for MCCP v2
-                        if ((mMCCP_version_1 || mMCCP_version_2) && (!mNeedDecompression)) {
-                            char _ch = buffer[i];
-                            if ((_ch == OPT_COMPRESS) || (_ch == OPT_COMPRESS2)) {
-                                bool _compress = false;
-                                if ((i > 1) && (i + 2 < datalen)) {
-                                    qDebug() << "checking mccp start seq...";
-                                    if ((buffer[i - 2] == TN_IAC) && (buffer[i - 1] == TN_SB) && (buffer[i + 1] == TN_WILL) && (buffer[i + 2] == TN_SE)) {
-                                        qDebug() << "MCCP version 1 starting sequence";
-                                        _compress = true;
-                                    }
-                                    if ((buffer[i - 2] == TN_IAC) && (buffer[i - 1] == TN_SB) && (buffer[i + 1] == TN_IAC) && (buffer[i + 2] == TN_SE)) {
-                                        qDebug() << "MCCP version 2 starting sequence";
-                                        _compress = true;
-                                    }
-                                    qDebug() << (int)buffer[i - 2] << "," << (int)buffer[i - 1] << "," << (int)buffer[i] << "," << (int)buffer[i + 1] << "," << (int)buffer[i + 2];
-                                }
-                                if (_compress) {
-                                    mNeedDecompression = true;
-                                    // from this position in stream onwards, data will be compressed by zlib
-                                    gotRest(cleandata);
-                                    cleandata = "";
-                                    initStreamDecompressor();
-                                    buffer += i + 3; //bugfix: BenH
-                                    int restLength = datalen - i - 3;
-                                    if (restLength > 0) {
-                                        datalen = decompressBuffer(buffer, restLength, out_buffer);
-                                        buffer = out_buffer;
-                                        i = -1; // start processing buffer from the beginning.
-                                    } else {
-                                        datalen = 0;
-                                        i = -1; // end the loop, this will make i and datalen the same.
-                                    }
-                                    //bugfix: BenH
-                                    iac = false;
-                                    insb = false;
-                                    command = "";
-                                    ////////////////
-                                    goto MAIN_LOOP_END;
-                                }
-                            }
-                        }
-                    }
-                    //7. inside IAC SB
+            mpHost->mpConsole->mReplayStream << used;
+            mpHost->mpConsole->mReplayStream.writeRawData(buffer, used);
+        }
+        if (used < datalen) {
+            // The server started compression part way through, the rest
+            // is compressed:
+            pending = buffer + used;
+            pendingLength = datalen - used;
+        }
+    }
 
-                    command += ch;
-                    if (iac && (ch == TN_SE)) //IAC SE - end of subcommand
-                    {
-                        processTelnetCommand(command);
-                        command = "";
-                        iac = false;
-                        insb = false;
-                    }
-                    if (iac) {
-                        iac = false;
-                    } else if (ch == TN_IAC) {
-                        iac = true;
-                    }
-                } else
-                //8. IAC fol. by something else than IAC, SB, SE, DO, DONT, WILL, WONT
-                {
-                    iac = false;
-                    command += ch;
-                    processTelnetCommand(command);
-                    //this could have set receivedGA to true; we'll handle that later
-                    command = "";
+    if (cleandata.size() > 0) {
+        gotRest(cleandata);
+    }
+    mpHost->mpConsole->finalize();
+    lastTimeOffset = timeOffset.elapsed();
+}
+
+// Takes what the network thread has queued up since it last notified us, the
+// data having already been read and decompressed there:
+void cTelnet::slot_processNetworkQueue()
+{
+    mpNetworkReader->acknowledge();
+
+    string cleandata;
+    bool isDataSeen = false;
+    TTelnetChunk chunk;
+    while (mpNetworkReader->takeChunk(chunk)) {
+        switch (chunk.type) {
+        case TTelnetChunk::Data: {
+            if (!isDataSeen) {
+                isDataSeen = true;
+                mpHost->mInsertedMissingLF = false;
+                if (mWaitingForResponse) {
+                    double time = networkLatencyTime.elapsed();
+                    networkLatency = time / 1000;
+                    mWaitingForResponse = false;
                 }
-            } else {
-                if (ch == TN_BELL) {
+            }
+            const int datalen = chunk.data.size();
+            processSocketData(chunk.data.constData(), datalen, cleandata, true);
+            if (mpHost->mpConsole->mRecordReplay) {
+                mpHost->mpConsole->mReplayStream << timeOffset.elapsed() - lastTimeOffset;
+                mpHost->mpConsole->mReplayStream << datalen;
+                mpHost->mpConsole->mReplayStream.writeRawData(chunk.data.constData(), datalen);
+            }
+            break;
+        }
+        case TTelnetChunk::CompressionStarted:
+            // The start sequence may have come inside an unfinished
+            // sub-negotiation, which the compressed data is not part of:
+            iac = false;
+            insb = false;
+            command = "";
+            break;
+        case TTelnetChunk::CompressionEnded:
+            hisOptionState[static_cast<int>(OPT_COMPRESS)] = false;
+            hisOptionState[static_cast<int>(OPT_COMPRESS2)] = false;
+            break;
+        case TTelnetChunk::Connected:
+            mIsNetworkConnected = true;
+            handle_socket_signal_connected();
+            break;
+        case TTelnetChunk::Disconnected:
+            if (cleandata.size() > 0) {
+                gotRest(cleandata);
+                cleandata.clear();
+            }
+            mIsNetworkConnected = false;
+            mNetworkErrorString = chunk.errorString;
+            handle_socket_signal_disconnected();
+            break;
+        }
+    }
+
+    if (cleandata.size() > 0) {
+        gotRest(cleandata);
+    }
+    if (isDataSeen) {
+        mpHost->mpConsole->finalize();
+        lastTimeOffset = timeOffset.elapsed();
+    }
+}
+
+// Acts on the telnet commands in the data and puts the rest of it into
+// cleandata, returns how much of the data was used - which is all of it
+// unless the server starts MCCP part way through (and the data is not itself
+// the output of decompression), as the remainder is then compressed.
+int cTelnet::processSocketData(const char* buffer, const int datalen, string& cleandata, const bool isDecompressed)
+{
+    recvdGA = false;
+    for (int i = 0; i < datalen; i++) {
+        char ch = buffer[i];
+
+        if (!(iac || iac2 || insb || (ch == TN_IAC))) {
+            // Copy the text up to the next telnet command in bulk, less any
+            // carriage returns and NULs, rather than a character at a time:
+            const char* pIAC = static_cast<const char*>(memchr(buffer + i, TN_IAC, datalen - i));
+            const int runEnd = pIAC ? static_cast<int>(pIAC - buffer) : datalen;
+            while (i < runEnd) {
+                int j = i;
+                while (j < runEnd && buffer[j] != '\r' && buffer[j] != 0 && buffer[j] != TN_BELL) {
+                    ++j;
+                }
+                cleandata.append(buffer + i, j - i);
+                if (j < runEnd && buffer[j] == TN_BELL) {
                     // flash taskbar for 3 seconds on the telnet bell
                     QApplication::alert(mudlet::self(), 3000);
+                    cleandata += TN_BELL;
                 }
-                if (ch != '\r' && ch != 0) {
-                    cleandata += ch;
-                }
+                i = j + 1;
             }
-        MAIN_LOOP_END:;
-            if (recvdGA) {
-                if (!mFORCE_GA_OFF) //FIXME: wird noch nicht richtig initialisiert
-                {
-                    mGA_Driver = true;
-                    if (mCommands > 0) {
-                        mCommands--;
-                        if (networkLatencyTime.elapsed() > 2000) {
-                            mCommands = 0;
+            // Plain text never sets recvdGA so there is nothing else to do:
+            i = runEnd - 1;
+            continue;
+        }
+
+        if (!(iac || iac2 || insb) && (ch == TN_IAC)) {
+            iac = true;
+            command += ch;
+        } else if (iac && (ch == TN_IAC) && (!insb)) {
+            //2. seq. of two IACs
+            iac = false;
+            cleandata += ch;
+            command = "";
+        } else if (iac && (!insb) && ((ch == TN_WILL) || (ch == TN_WONT) || (ch == TN_DO) || (ch == TN_DONT))) {
+            //3. IAC DO/DONT/WILL/WONT
+            iac = false;
+            iac2 = true;
+            command += ch;
+        } else if (iac2) {
+            //4. IAC DO/DONT/WILL/WONT <command code>
+            iac2 = false;
+            command += ch;
+            processTelnetCommand(command);
+            command = "";
+        } else if (iac && (!insb) && (ch == TN_SB)) {
+            //5. IAC SB
+            iac = false;
+            insb = true;
+            command += ch;
+        } else if (iac && (!insb) && (ch == TN_SE)) {
+            //6. IAC SE without IAC SB - error - ignored
+            command = "";
+            iac = false;
+        } else if (insb) {
+            // IAC SB COMPRESS WILL SE for MCCP v1 (unterminated invalid telnet sequence)
+            // IAC SB COMPRESS2 IAC SE for MCCP v2
+            if ((mMCCP_version_1 || mMCCP_version_2) && !mNeedDecompression && !isDecompressed) {
+                if ((ch == OPT_COMPRESS) || (ch == OPT_COMPRESS2)) {
+                    bool _compress = false;
+                    if ((i > 1) && (i + 2 < datalen)) {
+                        qDebug() << "checking mccp start seq...";
+                        if ((buffer[i - 2] == TN_IAC) && (buffer[i - 1] == TN_SB) && (buffer[i + 1] == TN_WILL) && (buffer[i + 2] == TN_SE)) {
+                            qDebug() << "MCCP version 1 starting sequence";
+                            _compress = true;
+                        }
+                        if ((buffer[i - 2] == TN_IAC) && (buffer[i - 1] == TN_SB) && (buffer[i + 1] == TN_IAC) && (buffer[i + 2] == TN_SE)) {
+                            qDebug() << "MCCP version 2 starting sequence";
+                            _compress = true;
                         }
+                        qDebug() << (int)buffer[i - 2] << "," << (int)buffer[i - 1] << "," << (int)buffer[i] << "," << (int)buffer[i + 1] << "," << (int)buffer[i + 2];
                     }
-                    cleandata.push_back('\xff');
-                    recvdGA = false;
-                    gotPrompt(cleandata);
-                    cleandata = "";
-                } else {
-                    if (mLF_ON_GA) //TODO: reenable option in preferences
-                    {
-                        cleandata.push_back('\n');
+                    if (_compress) {
+                        mNeedDecompression = true;
+                        // from this position in stream onwards, data will be compressed by zlib
+                        gotRest(cleandata);
+                        cleandata = "";
+                        initStreamDecompressor();
+                        //bugfix: BenH
+                        iac = false;
+                        insb = false;
+                        command = "";
+                        return i + 3;
                     }
                 }
             }
-        } //for
-    } while (datalen == 100000);
+            //7. inside IAC SB
 
-    if (cleandata.size() > 0) {
-        gotRest(cleandata);
-    }
-    mpHost->mpConsole->finalize();
-    lastTimeOffset = timeOffset.elapsed();
+            command += ch;
+            if (iac && (ch == TN_SE)) //IAC SE - end of subcommand
+            {
+                processTelnetCommand(command);
+                command = "";
+                iac = false;
+                insb = false;
+            }
+            if (iac) {
+                iac = false;
+            } else if (ch == TN_IAC) {
+                iac = true;
+            }
+        } else
+        //8. IAC fol. by something else than IAC, SB, SE, DO, DONT, WILL, WONT
+        {
+            iac = false;
+            command += ch;
+            processTelnetCommand(command);
+            //this could have set receivedGA to true; we'll handle that later
+            command = "";
+        }
+
+        if (recvdGA) {
+            if (!mFORCE_GA_OFF) //FIXME: wird noch nicht richtig initialisiert
+            {
+                mGA_Driver = true;
+                if (mCommands > 0) {
+                    mCommands--;
+                    if (networkLatencyTime.elapsed() > 2000) {
+                        mCommands = 0;
+                    }
+                }
+                cleandata.push_back('\xff');
+                recvdGA = false;
+                gotPrompt(cleandata);
+                cleandata = "";
+            } else {
+                if (mLF_ON_GA) //TODO: reenable option in preferences
+                {
+                    cleandata.push_back('\n');
+                }
+            }
+        }
+    } //for
+    return datalen;
 }
 
 void cTelnet::raiseProtocolEvent(const QString& name, const QString& protocol)
@@ -46,9 +46,11 @@ class QProgressDialog;
 class QTextCodec;
 class QTextDecoder;
 class QTextEncoder;
+class QThread;
 class QTimer;
 
 class Host;
+class TTelnetReader;
 class dlgComposer;
 
 
@@ -101,7 +103,7 @@ public:
     void disconnect();
     bool sendData(QString& data);
     void setATCPVariables(const QString& _msg);
-    void setGMCPVariables(const QString& _msg);
+    void setGMCPVariables(const QByteArray&);
     void atcpComposerCancel();
     void atcpComposerSave(QString);
     void setDisplayDimensions();
@@ -112,6 +114,7 @@ public:
     void loadReplay(QString&);
     void _loadReplay();
     bool isReplaying() { return loadingReplay; }
+    void processReplayData(const char* data, int length);
     void setChannel102Variables(const QString&);
     bool socketOutRaw(std::string& data);
     const QString & getEncoding() const { return mEncoding; }
@@ -146,13 +149,18 @@ public slots:
     void slot_timerPosting();
     void slot_send_login();
     void slot_send_pass();
+    void slot_processNetworkQueue();
 
 
 private:
     cTelnet() {}
     void initStreamDecompressor();
-    int decompressBuffer(char*& in_buffer, int& length, char* out_buffer);
+    int decompressBuffer(const char*& in_buffer, int& length);
+    int processSocketData(const char* buffer, int datalen, std::string& cleandata, bool isDecompressed);
     void reset();
+    QString socketErrorString() const;
+    void startNetworkThread();
+    void updateReaderCompression();
 
     void processTelnetCommand(const std::string& command);
     void sendTelnetOption(char type, char option);
@@ -176,6 +184,18 @@ private:
     std::queue<int> mCommandQueue;
 
     z_stream mZstream;
+    // Reused for every read rather than being put on the stack, both grow
+    // to fit the largest amount of data seen so far:
+    QByteArray mReadBuffer;
+    QByteArray mInflateBuffer;
+
+    // Only used if the profile has the socket read and MCCP decompression
+    // done in a separate thread, the socket is then owned by the reader:
+    bool mIsUsingNetworkThread;
+    bool mIsNetworkConnected;
+    QString mNetworkErrorString;
+    TTelnetReader* mpNetworkReader;
+    QThread* mpNetworkThread;
 
     bool mNeedDecompression;
     std::string command;
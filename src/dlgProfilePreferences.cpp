@@ -266,9 +266,15 @@ dlgProfilePreferences::dlgProfilePreferences(QWidget* pF, Host* pH) : QDialog(pF
         }
         mIsToLogInHtml->setChecked(pHost->mIsNextLogFileInHtmlFormat);
         mIsLoggingTimestamps->setChecked(pHost->mIsLoggingTimestamps);
+        mIsLogCompressed->setChecked(pHost->mIsLogCompressed);
+        logFlushInterval->setValue(pHost->mLogFlushInterval);
+        logFlushSize->setValue(pHost->mLogFlushSize);
+        logRotateSize->setValue(pHost->mLogRotateSize);
+        logRotateInterval->setValue(pHost->mLogRotateInterval);
         commandLineMinimumHeight->setValue(pHost->commandLineMinimumHeight);
         mNoAntiAlias->setChecked(!pHost->mNoAntiAlias);
         mFORCE_MCCP_OFF->setChecked(pHost->mFORCE_NO_COMPRESSION);
+        checkBox_useNetworkThread->setChecked(pHost->mUseNetworkThread);
         mFORCE_GA_OFF->setChecked(pHost->mFORCE_GA_OFF);
         mAlertOnNewData->setChecked(pHost->mAlertOnNewData);
         //mMXPMode->setCurrentIndex( pHost->mMXPMode );
@@ -1251,6 +1257,7 @@ void dlgProfilePreferences::slot_save_and_exit()
     pHost->mUSE_FORCE_LF_AFTER_PROMPT = checkBox_mUSE_FORCE_LF_AFTER_PROMPT->isChecked();
     pHost->mUSE_UNIX_EOL = USE_UNIX_EOL->isChecked();
     pHost->mFORCE_NO_COMPRESSION = mFORCE_MCCP_OFF->isChecked();
+    pHost->mUseNetworkThread = checkBox_useNetworkThread->isChecked();
     pHost->mFORCE_GA_OFF = mFORCE_GA_OFF->isChecked();
     pHost->mFORCE_SAVE_ON_EXIT = mFORCE_SAVE_ON_EXIT->isChecked();
     pHost->mEnableGMCP = mEnableGMCP->isChecked();
@@ -1297,6 +1304,11 @@ void dlgProfilePreferences::slot_save_and_exit()
     }
     pHost->mIsNextLogFileInHtmlFormat = mIsToLogInHtml->isChecked();
     pHost->mIsLoggingTimestamps = mIsLoggingTimestamps->isChecked();
+    pHost->mIsLogCompressed = mIsLogCompressed->isChecked();
+    pHost->mLogFlushInterval = logFlushInterval->value();
+    pHost->mLogFlushSize = logFlushSize->value();
+    pHost->mLogRotateSize = logRotateSize->value();
+    pHost->mLogRotateInterval = logRotateInterval->value();
     pHost->mNoAntiAlias = !mNoAntiAlias->isChecked();
     pHost->mAlertOnNewData = mAlertOnNewData->isChecked();
     if (mudlet::self()->mConsoleMap.contains(pHost)) {
@@ -251,10 +251,10 @@ void dlgRoomExits::slot_addSpecialExit()
 
 void dlgRoomExits::save()
 {
-    mpHost->mpMap->mMapGraphNeedsUpdate = true;
     if (!pR) {
         return;
     }
+    mpHost->mpMap->setRoomNeedsGraphUpdate(pR->getId());
 
     QMultiMap<int, QString> oldSpecialExits = pR->getOtherMap();
     QMutableMapIterator<int, QString> exitIterator = oldSpecialExits;
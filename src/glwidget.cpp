@@ -34,6 +34,7 @@
 #include <QtEvents>
 #include "post_guard.h"
 
+#include <algorithm>
 #include <math.h>
 
 #ifdef Q_OS_MACOS
@@ -52,6 +53,126 @@ bool mPanMode = false;
 float xpos = 0, ypos = 0, zpos = 0, xrot = 0, yrot = 0, angle = 0.0, mPanXStart = 0, mPanYStart = 0;
 float zmax, zmin;
 
+// The colours of the z levels (taken modulo 26), the rooms and exits on the
+// levels above the centre of the view and those on or below it swap them:
+static const GLfloat ebenenColor2[][4] = {{0.9, 0.5, 0.0, 1.0},
+                                          {165.0 / 255.0, 102.0 / 255.0, 167.0 / 255.0, 1.0},
+                                          {170.0 / 255.0, 10.0 / 255.0, 127.0 / 255.0, 1.0},
+                                          {203.0 / 255.0, 135.0 / 255.0, 101.0 / 255.0, 1.0},
+                                          {154.0 / 255.0, 154.0 / 255.0, 115.0 / 255.0, 1.0},
+                                          {107.0 / 255.0, 154.0 / 255.0, 100.0 / 255.0, 1.0},
+                                          {154.0 / 255.0, 184.0 / 255.0, 111.0 / 255.0, 1.0},
+                                          {67.0 / 255.0, 154.0 / 255.0, 148.0 / 255.0, 1.0},
+                                          {154.0 / 255.0, 118.0 / 255.0, 151.0 / 255.0, 1.0},
+                                          {208.0 / 255.0, 213.0 / 255.0, 164.0 / 255.0, 1.0},
+                                          {213.0 / 255.0, 169.0 / 255.0, 158.0 / 255.0, 1.0},
+                                          {139.0 / 255.0, 209.0 / 255.0, 0, 1.0},
+                                          {163.0 / 255.0, 209.0 / 255.0, 202.0 / 255.0, 1.0},
+                                          {158.0 / 255.0, 156.0 / 255.0, 209.0 / 255.0, 1.0},
+                                          {209.0 / 255.0, 144.0 / 255.0, 162.0 / 255.0, 1.0},
+                                          {209.0 / 255.0, 183.0 / 255.0, 78.0 / 255.0, 1.0},
+                                          {111.0 / 255.0, 209.0 / 255.0, 88.0 / 255.0, 1.0},
+                                          {95.0 / 255.0, 120.0 / 255.0, 209.0 / 255.0, 1.0},
+                                          {31.0 / 255.0, 209.0 / 255.0, 126.0 / 255.0, 1.0},
+                                          {1.0, 170.0 / 255.0, 1.0, 1.0},
+                                          {158.0 / 255.0, 105.0 / 255.0, 158.0 / 255.0, 1.0},
+                                          {68.0 / 255.0, 189.0 / 255.0, 189.0 / 255.0, 1.0},
+                                          {0.1, 0.69, 0.49, 1.0},
+                                          {0.0, 0.15, 1.0, 1.0},
+                                          {0.12, 0.02, 0.20, 1.0},
+                                          {0.0, 0.3, 0.1, 1.0}};
+
+static const GLfloat ebenenColor[][4] = {{0.5, 0.6, 0.5, 0.2},
+                                         {0.233, 0.498, 0.113, 0.2},
+                                         {0.666, 0.333, 0.498, 0.2},
+                                         {0.5, 0.333, 0.666, 0.2},
+                                         {0.69, 0.458, 0.0, 0.2},
+                                         {0.333, 0.0, 0.49, 0.2},
+                                         {133.0 / 255.0, 65.0 / 255.0, 98.0 / 255.0, 0.2},
+                                         {0.3, 0.3, 0.0, 0.2},
+                                         {0.6, 0.2, 0.6, 0.2},
+                                         {0.6, 0.6, 0.2, 0.2},
+                                         {0.4, 0.1, 0.4, 0.2},
+                                         {0.4, 0.4, 0.1, 0.2},
+                                         {0.3, 0.1, 0.3, 0.2},
+                                         {0.3, 0.3, 0.1, 0.2},
+                                         {0.2, 0.1, 0.2, 0.2},
+                                         {0.2, 0.2, 0.1, 0.2},
+                                         {0.24, 0.1, 0.5, 0.2},
+                                         {0.1, 0.1, 0.0, 0.2},
+                                         {0.54, 0.6, 0.2, 0.2},
+                                         {0.2, 0.2, 0.5, 0.2},
+                                         {0.6, 0.6, 0.2, 0.2},
+                                         {0.6, 0.4, 0.6, 0.2},
+                                         {0.4, 0.4, 0.1, 0.2},
+                                         {0.4, 0.2, 0.4, 0.2},
+                                         {0.2, 0.2, 0.0, 0.2},
+                                         {0.2, 0.1, 0.3, 0.2}};
+
+static const GLfloat scCenterRoomColor[] = {1.0, 0.0, 0.0, 1.0};
+static const GLfloat scTargetRoomColor[] = {0.0, 1.0, 0.0, 1.0};
+static const GLfloat scAreaExitColor[] = {85.0 / 255.0, 170.0 / 255.0, 0.0, 1.0};
+
+// The corners of the cubes that rooms are drawn as, in the order of the six
+// faces of four that they have always been drawn with (so that they are
+// culled the same way), each also being the direction of its normal:
+static const GLfloat scCubeCorners[24][3] = {{1, -1, 1}, {-1, -1, 1}, {-1, -1, -1}, {1, -1, -1},
+                                             {1, 1, 1}, {-1, 1, 1}, {-1, -1, 1}, {1, -1, 1},
+                                             {-1, 1, -1}, {1, 1, -1}, {1, -1, -1}, {-1, -1, -1},
+                                             {1, 1, -1}, {1, 1, 1}, {1, -1, 1}, {1, -1, -1},
+                                             {-1, 1, 1}, {-1, 1, -1}, {-1, -1, -1}, {-1, -1, 1},
+                                             {1, 1, -1}, {-1, 1, -1}, {-1, 1, 1}, {1, 1, 1}};
+static const GLfloat scCornerNormal = 0.57735;
+
+// The exits drawn as lines, with where the stub of one leading out of the
+// area ends relative to its room:
+static const struct
+{
+    int direction;
+    float dx;
+    float dy;
+    float dz;
+} scExitDirections[] = {{DIR_NORTH, 0, 1, 0},
+                        {DIR_NORTHEAST, 1, 1, 0},
+                        {DIR_EAST, 1, 0, 0},
+                        {DIR_SOUTHEAST, 1, -1, 0},
+                        {DIR_SOUTH, 0, -1, 0},
+                        {DIR_SOUTHWEST, -1, -1, 0},
+                        {DIR_WEST, -1, 0, 0},
+                        {DIR_NORTHWEST, -1, 1, 0},
+                        {DIR_UP, 0, 0, 1},
+                        {DIR_DOWN, 0, 0, -1}};
+
+// The colour that a room's environment is shown in:
+static QColor roomEnvColor(const TMap* pMap, int env)
+{
+    static const QColor scEnvColors[] = {QColor(128, 0, 0),
+                                         QColor(0, 128, 0),
+                                         QColor(128, 128, 0),
+                                         QColor(0, 0, 128),
+                                         QColor(128, 128, 0),
+                                         QColor(0, 128, 128),
+                                         QColor(128, 128, 128),
+                                         QColor(55, 55, 55),
+                                         QColor(255, 50, 50),
+                                         QColor(50, 255, 50),
+                                         QColor(255, 255, 50),
+                                         QColor(50, 50, 255),
+                                         QColor(255, 50, 255),
+                                         QColor(50, 255, 255),
+                                         QColor(255, 255, 255)};
+
+    if (pMap->envColors.contains(env)) {
+        env = pMap->envColors.value(env);
+    } else if (!pMap->customEnvColors.contains(env)) {
+        env = 1;
+    }
+    if (env >= 1 && env <= 15) {
+        return scEnvColors[env - 1];
+    }
+    return pMap->customEnvColors.value(env, QColor::fromRgbF(0.2, 0.2, 0.6));
+}
+
 GLWidget::GLWidget(QWidget *parent)
     : QGLWidget(QGLFormat(QGL::SampleBuffers), parent)
 , mShowInfo()
@@ -59,6 +180,11 @@ GLWidget::GLWidget(QWidget *parent)
 , rotTri()
 , rotQuad()
 , mTarget()
+, mIsAreaGeometryValid(false)
+, mGeometryAreaId(0)
+, mGeometryMapRevision(0)
+, mIsGeometryGridMode(false)
+, mIsGeometry2DView(false)
 {
     mpMap = 0;
     xDist = 0.0;
@@ -103,6 +229,11 @@ GLWidget::GLWidget(TMap* pM, QWidget* parent)
 , rotQuad()
 , mScale()
 , mTarget()
+, mIsAreaGeometryValid(false)
+, mGeometryAreaId(0)
+, mGeometryMapRevision(0)
+, mIsGeometryGridMode(false)
+, mIsGeometry2DView(false)
 {
     mpHost = 0;
     mpMap = pM;
@@ -358,6 +489,184 @@ void GLWidget::setViewCenter(int areaId, int xPos, int yPos, int zPos)
     updateGL();
 }
 
+void GLWidget::VertexBatch::addVertex(const QVector3D& position)
+{
+    mVertices << position.x() << position.y() << position.z();
+}
+
+void GLWidget::VertexBatch::addCube(const QVector3D& center, const QVector3D& halfSize)
+{
+    for (const auto& corner : scCubeCorners) {
+        mVertices << center.x() + corner[0] * halfSize.x() << center.y() + corner[1] * halfSize.y() << center.z() + corner[2] * halfSize.z();
+        mNormals << corner[0] * scCornerNormal << corner[1] * scCornerNormal << corner[2] * scCornerNormal;
+    }
+}
+
+void GLWidget::VertexBatch::addTriangle(const QVector3D& a, const QVector3D& b, const QVector3D& c)
+{
+    addVertex(a);
+    addVertex(b);
+    addVertex(c);
+    for (int i = 0; i < 3; ++i) {
+        mNormals << scCornerNormal << scCornerNormal << scCornerNormal;
+    }
+}
+
+void GLWidget::VertexBatch::addColor(const QColor& color, const int vertexCount)
+{
+    const GLfloat red = color.redF();
+    const GLfloat green = color.greenF();
+    const GLfloat blue = color.blueF();
+    const GLfloat alpha = color.alphaF();
+    for (int i = 0; i < vertexCount; ++i) {
+        mColors << red << green << blue << alpha;
+    }
+}
+
+void GLWidget::VertexBatch::draw(const GLenum mode, const int first, const int count) const
+{
+    if (count < 1) {
+        return;
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, mVertices.constData());
+    if (!mNormals.isEmpty()) {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, 0, mNormals.constData());
+    }
+    if (!mColors.isEmpty()) {
+        // Each vertex then has its own material, see the glColorMaterial() in
+        // paintGL():
+        glEnable(GL_COLOR_MATERIAL);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(4, GL_FLOAT, 0, mColors.constData());
+    }
+
+    glDrawArrays(mode, first, count);
+
+    if (!mColors.isEmpty()) {
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisable(GL_COLOR_MATERIAL);
+    }
+    if (!mNormals.isEmpty()) {
+        glDisableClientState(GL_NORMAL_ARRAY);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+bool GLWidget::isLevelShown(const int z, const int centerZ) const
+{
+    if (z > centerZ) {
+        return z - centerZ <= mShowTopLevels;
+    }
+    return centerZ - z <= mShowBottomLevels;
+}
+
+// Adds a line for each exit of the room (or only for those to toRoomId, if
+// that is given) to lines, and returns the rooms that the ones leading out of
+// the shown area go to, with where their stubs end:
+QList<QPair<int, QVector3D>> GLWidget::addExitLines(VertexBatch& lines, TRoom* pR, const int toRoomId)
+{
+    QList<QPair<int, QVector3D>> areaExits;
+    const QVector3D position(pR->x, pR->y, pR->z);
+    for (const auto& drawnExit : scExitDirections) {
+        const int exitId = pR->getExit(drawnExit.direction);
+        if (exitId < 1 || (toRoomId && exitId != toRoomId)) {
+            continue;
+        }
+        TRoom* pExit = mpMap->mpRoomDB->getRoom(exitId);
+        if (!pExit) {
+            continue;
+        }
+        if (pExit->getArea() == mAID) {
+            lines.addVertex(QVector3D(pExit->x, pExit->y, pExit->z));
+        } else {
+            const QVector3D stubEnd = position + QVector3D(drawnExit.dx, drawnExit.dy, drawnExit.dz);
+            lines.addVertex(stubEnd);
+            areaExits.append(qMakePair(exitId, stubEnd));
+        }
+        lines.addVertex(position);
+    }
+    return areaExits;
+}
+
+// Builds the vertex arrays for the shown area, they are kept until the area,
+// the map data (which includes the environment colours) or the way that the
+// rooms are drawn changes - so that drawing a frame is only a handful of
+// glDrawArrays() per level however many rooms there are:
+void GLWidget::updateAreaGeometry(TArea* pArea)
+{
+    const quint64 mapRevision = mpMap->getMapDataRevision();
+    if (mIsAreaGeometryValid && mGeometryAreaId == mAID && mGeometryMapRevision == mapRevision && mIsGeometryGridMode == pArea->gridMode && mIsGeometry2DView == is2DView) {
+        return;
+    }
+
+    mAreaGeometry.clear();
+    mIsAreaGeometryValid = true;
+    mGeometryAreaId = mAID;
+    mGeometryMapRevision = mapRevision;
+    mIsGeometryGridMode = pArea->gridMode;
+    mIsGeometry2DView = is2DView;
+
+    const float size = 1.0 / dehnung;
+    // The coloured plates on top of the rooms are a bit smaller than the
+    // rooms, except in grid mode where both are twice as wide:
+    float plateScale = 0.75;
+    if (pArea->gridMode) {
+        plateScale = 2.0;
+    } else if (is2DView) {
+        plateScale = 0.9;
+    }
+    const QVector3D areaExitCubeSize(size, size, size);
+    const QVector3D areaExitPlateSize(0.5 * size, 0.5 * size, 0.2 * size);
+    const QVector3D roomCubeSize = pArea->gridMode ? QVector3D(2.0 * size, 2.0 * size, size) : QVector3D(size, size, size);
+    const QVector3D roomPlateSize(plateScale * size, plateScale * size, 0.2 * size);
+    const float markTip = 0.95 * size * plateScale;
+    const float markBase = 0.25 * size * plateScale;
+
+    QSetIterator<int> itRoom(pArea->getAreaRooms());
+    while (itRoom.hasNext()) {
+        const int id = itRoom.next();
+        TRoom* pR = mpMap->mpRoomDB->getRoom(id);
+        if (!pR) {
+            continue;
+        }
+
+        LevelGeometry& level = mAreaGeometry[pR->z];
+        QListIterator<QPair<int, QVector3D>> itAreaExit(addExitLines(level.mExitLines, pR));
+        while (itAreaExit.hasNext()) {
+            const QPair<int, QVector3D>& areaExit = itAreaExit.next();
+            level.mAreaExitIds.append(areaExit.first);
+            level.mAreaExitCubes.addCube(areaExit.second, areaExitCubeSize);
+            level.mAreaExitPlates.addCube(areaExit.second + QVector3D(0.0, 0.0, 0.25), areaExitPlateSize);
+            QColor exitColor = roomEnvColor(mpMap, mpMap->mpRoomDB->getRoom(areaExit.first)->environment);
+            exitColor.setAlphaF(0.2);
+            level.mAreaExitPlates.addColor(exitColor, 24);
+        }
+
+        level.mRoomIndexes.insert(id, level.mRoomIds.size());
+        level.mRoomIds.append(id);
+        level.mRoomCubes.addCube(QVector3D(pR->x, pR->y, pR->z), roomCubeSize);
+
+        // The alpha only counts on the levels above the centre of the view,
+        // which are the only ones drawn blended:
+        QColor color = roomEnvColor(mpMap, pR->environment);
+        color.setAlphaF(0.2);
+        const QVector3D platePosition(pR->x, pR->y, pR->z + 0.25);
+        level.mRoomPlates.addCube(platePosition, roomPlateSize);
+        level.mRoomPlates.addColor(color, 24);
+        if (pR->getDown() > -1) {
+            level.mUpDownMarks.addTriangle(platePosition + QVector3D(0.0, -markTip, 0.0), platePosition + QVector3D(markTip, -markBase, 0.0), platePosition + QVector3D(-markTip, -markBase, 0.0));
+            level.mUpDownMarks.addColor(color, 3);
+        }
+        if (pR->getUp() > -1) {
+            level.mUpDownMarks.addTriangle(platePosition + QVector3D(0.0, markTip, 0.0), platePosition + QVector3D(-markTip, markBase, 0.0), platePosition + QVector3D(markTip, markBase, 0.0));
+            level.mUpDownMarks.addColor(color, 3);
+        }
+    }
+}
+
 void GLWidget::paintGL()
 {
     if (!mpMap) {
@@ -410,7 +719,6 @@ void GLWidget::paintGL()
     }
     zmax = static_cast<float>(pArea->max_z);
     zmin = static_cast<float>(pArea->min_z);
-    float zEbene;
     glEnable(GL_CULL_FACE);
     glClearDepth(1.0);
     glDepthFunc(GL_LESS);
@@ -448,1604 +756,149 @@ void GLWidget::paintGL()
     glEnable(GL_LIGHT0);
     //glEnable(GL_LIGHT1);
 
-    if (zRot <= 0) {
-        zEbene = zmax;
-    } else {
-        zEbene = zmin;
-    }
-
     glEnable(GL_LINE_SMOOTH);
     glEnable(GL_LINE_STIPPLE);
     glLineWidth(1.0);
-    int quads = 0;
-    int verts = 0;
-    float ebenenColor2[][4] = {{0.9, 0.5, 0.0, 1.0},
-                               {165.0 / 255.0, 102.0 / 255.0, 167.0 / 255.0, 1.0},
-                               {170.0 / 255.0, 10.0 / 255.0, 127.0 / 255.0, 1.0},
-                               {203.0 / 255.0, 135.0 / 255.0, 101.0 / 255.0, 1.0},
-                               {154.0 / 255.0, 154.0 / 255.0, 115.0 / 255.0, 1.0},
-                               {107.0 / 255.0, 154.0 / 255.0, 100.0 / 255.0, 1.0},
-                               {154.0 / 255.0, 184.0 / 255.0, 111.0 / 255.0, 1.0},
-                               {67.0 / 255.0, 154.0 / 255.0, 148.0 / 255.0, 1.0},
-                               {154.0 / 255.0, 118.0 / 255.0, 151.0 / 255.0, 1.0},
-                               {208.0 / 255.0, 213.0 / 255.0, 164.0 / 255.0, 1.0},
-                               {213.0 / 255.0, 169.0 / 255.0, 158.0 / 255.0, 1.0},
-                               {139.0 / 255.0, 209.0 / 255.0, 0, 1.0},
-                               {163.0 / 255.0, 209.0 / 255.0, 202.0 / 255.0, 1.0},
-                               {158.0 / 255.0, 156.0 / 255.0, 209.0 / 255.0, 1.0},
-                               {209.0 / 255.0, 144.0 / 255.0, 162.0 / 255.0, 1.0},
-                               {209.0 / 255.0, 183.0 / 255.0, 78.0 / 255.0, 1.0},
-                               {111.0 / 255.0, 209.0 / 255.0, 88.0 / 255.0, 1.0},
-                               {95.0 / 255.0, 120.0 / 255.0, 209.0 / 255.0, 1.0},
-                               {31.0 / 255.0, 209.0 / 255.0, 126.0 / 255.0, 1.0},
-                               {1.0, 170.0 / 255.0, 1.0, 1.0},
-                               {158.0 / 255.0, 105.0 / 255.0, 158.0 / 255.0, 1.0},
-                               {68.0 / 255.0, 189.0 / 255.0, 189.0 / 255.0, 1.0},
-                               {0.1, 0.69, 0.49, 1.0},
-                               {0.0, 0.15, 1.0, 1.0},
-                               {0.12, 0.02, 0.20, 1.0},
-                               {0.0, 0.3, 0.1, 1.0}};
-
-
-    float ebenenColor[][4] = {{0.5, 0.6, 0.5, 0.2},
-                              {0.233, 0.498, 0.113, 0.2},
-                              {0.666, 0.333, 0.498, 0.2},
-                              {0.5, 0.333, 0.666, 0.2},
-                              {0.69, 0.458, 0.0, 0.2},
-                              {0.333, 0.0, 0.49, 0.2},
-                              {133.0 / 255.0, 65.0 / 255.0, 98.0 / 255.0, 0.2},
-                              {0.3, 0.3, 0.0, 0.2},
-                              {0.6, 0.2, 0.6, 0.2},
-                              {0.6, 0.6, 0.2, 0.2},
-                              {0.4, 0.1, 0.4, 0.2},
-                              {0.4, 0.4, 0.1, 0.2},
-                              {0.3, 0.1, 0.3, 0.2},
-                              {0.3, 0.3, 0.1, 0.2},
-                              {0.2, 0.1, 0.2, 0.2},
-                              {0.2, 0.2, 0.1, 0.2},
-                              {0.24, 0.1, 0.5, 0.2},
-                              {0.1, 0.1, 0.0, 0.2},
-                              {0.54, 0.6, 0.2, 0.2},
-                              {0.2, 0.2, 0.5, 0.2},
-                              {0.6, 0.6, 0.2, 0.2},
-                              {0.6, 0.4, 0.6, 0.2},
-                              {0.4, 0.4, 0.1, 0.2},
-                              {0.4, 0.2, 0.4, 0.2},
-                              {0.2, 0.2, 0.0, 0.2},
-                              {0.2, 0.1, 0.3, 0.2}};
-
-    while (true) {
-        if (zRot <= 0) {
-            if (zEbene < zmin) {
-                break;
-            }
-        } else {
-            if (zEbene > zmax) {
-                break;
-            }
+
+    updateAreaGeometry(pArea);
+
+    glLoadIdentity();
+    gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
+    glScalef(0.1, 0.1, 0.1);
+
+    QList<int> shownLevels;
+    QMapIterator<int, LevelGeometry> itLevel(mAreaGeometry);
+    while (itLevel.hasNext()) {
+        itLevel.next();
+        if (isLevelShown(itLevel.key(), oz)) {
+            shownLevels.append(itLevel.key());
         }
-        QSetIterator<int> itRoom(pArea->getAreaRooms());
-        while (itRoom.hasNext()) {
-            TRoom* pR = mpMap->mpRoomDB->getRoom(itRoom.next());
-            if (!pR) {
-                continue;
-            }
-            float rx = static_cast<float>(pR->x);
-            float ry = static_cast<float>(pR->y);
-            float rz = static_cast<float>(pR->z);
-            if (rz != zEbene) {
-                continue;
-            }
-            if (rz > pz) {
-                if (abs(rz - pz) > mShowTopLevels) {
-                    continue;
-                }
+    }
+
+    if (selectionMode) {
+        // Only the cubes can be picked, each under the id of its room:
+        for (int z : shownLevels) {
+            const LevelGeometry& level = mAreaGeometry.constFind(z).value();
+            for (int i = 0, total = level.mAreaExitIds.size(); i < total; ++i) {
+                glLoadName(level.mAreaExitIds.at(i));
+                level.mAreaExitCubes.draw(GL_QUADS, i * 24, 24);
             }
-            if (rz < pz) {
-                if (abs(rz - pz) > mShowBottomLevels) {
-                    continue;
-                }
-            }
-            QList<int> exitList;
-            exitList.push_back(pR->getNorth());
-            exitList.push_back(pR->getNorthwest());
-            exitList.push_back(pR->getEast());
-            exitList.push_back(pR->getSoutheast());
-            exitList.push_back(pR->getSouth());
-            exitList.push_back(pR->getSouthwest());
-            exitList.push_back(pR->getWest());
-            exitList.push_back(pR->getNorthwest());
-            exitList.push_back(pR->getUp());
-            exitList.push_back(pR->getDown());
-            int e = pR->z;
-            int ef;
-            ef = abs(e % 26);
-            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
-            glMateriali(GL_FRONT, GL_SHININESS, 1);
-            glDisable(GL_DEPTH_TEST);
-            if (rz <= pz) {
-                if ((rz == pz) && (rx == px) && (ry == py)) {
-                    glDisable(GL_BLEND);
-                    glEnable(GL_LIGHTING);
-                    float mc3[] = {1.0f, 0.0f, 0.0f, 1.0f};
-                    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                    glMateriali(GL_FRONT, GL_SHININESS, 1);
-                    glColor4f(1.0, 0.0, 0.0, 1.0);
-                } else {
-                    glDisable(GL_BLEND);
-                    glEnable(GL_LIGHTING);
-                    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
-                    glMateriali(GL_FRONT, GL_SHININESS, 1);
-                    glColor4f(0.3, 0.3, 0.3, 1.0); /*ebenenColor[ef][0],
-                              ebenenColor[ef][1],
-                              ebenenColor[ef][2],
-                              ebenenColor[ef][3]);*/
-                }
-                for (int k : exitList) {
-                    bool areaExit = false;
-                    if (k == -1) {
-                        continue;
-                    }
-                    TRoom* pExit = mpMap->mpRoomDB->getRoom(k);
-                    if (!pExit) {
-                        continue;
-                    }
-                    if (pExit->getArea() != mAID) {
-                        areaExit = true;
-                    } else {
-                        areaExit = false;
-                    }
-                    float ex = static_cast<float>(pExit->x);
-                    float ey = static_cast<float>(pExit->y);
-                    float ez = static_cast<float>(pExit->z);
-                    QVector3D p1(ex, ey, ez);
-                    QVector3D p2(rx, ry, rz);
-                    glLoadIdentity();
-                    gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                    glScalef(0.1, 0.1, 0.1);
-                    if (areaExit) {
-                        glLineWidth(1); //1/mScale+2);
-                    } else {
-                        glLineWidth(1); //1/mScale);
-                    }
-                    if (k == mRID || ((rz == pz) && (rx == px) && (ry == py))) {
-                        glDisable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        float mc3[] = {1.0f, 0.0f, 0.0f, 1.0f};
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1);
-                        glColor4f(1.0, 0.0, 0.0, 1.0);
-                    } else {
-                        glDisable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1);
-                        glColor4f(0.3, 0.3, 0.3, 1.0); //ebenenColor[ef][0],
-                                                       //                                  ebenenColor[ef][1],
-                                                       //                                  ebenenColor[ef][2],
-                                                       //                                  ebenenColor[ef][3]);
-                    }
-                    glBegin(GL_LINES);
-                    if (!areaExit) {
-                        glVertex3f(p1.x(), p1.y(), p1.z());
-                    } else {
-                        if (pR->getNorth() == k) {
-                            glVertex3f(p2.x(), p2.y() + 1, p2.z());
-                        } else if (pR->getSouth() == k) {
-                            glVertex3f(p2.x(), p2.y() - 1, p2.z());
-                        } else if (pR->getWest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y(), p2.z());
-                        } else if (pR->getEast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y(), p2.z());
-                        } else if (pR->getSouthwest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y() - 1, p2.z());
-                        } else if (pR->getSoutheast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y() - 1, p2.z());
-                        } else if (pR->getNortheast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y() + 1, p2.z());
-                        } else if (pR->getNorthwest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y() + 1, p2.z());
-                        } else if (pR->getUp() == k) {
-                            glVertex3f(p2.x(), p2.y(), p2.z() + 1);
-                        } else if (pR->getDown() == k) {
-                            glVertex3f(p2.x(), p2.y(), p2.z() - 1);
-                        }
-                    }
-                    glVertex3f(p2.x(), p2.y(), p2.z());
-                    glEnd();
-                    verts++;
-                    if (areaExit) {
-                        glDisable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        glDisable(GL_LIGHT1);
-                        float mc4[] = {85.0 / 255.0, 170.0 / 255.0, 0.0 / 255.0, 1.0};
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc4);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1);
-                        glColor4f(85.0 / 255.0, 170.0 / 255.0, 0.0 / 255.0, 1.0);
-                        glLoadIdentity();
-                        gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                        glScalef(0.1, 0.1, 0.1);
-                        if (pR->getNorth() == k) {
-                            glTranslatef(p2.x(), p2.y() + 1, p2.z());
-                        } else if (pR->getSouth() == k) {
-                            glTranslatef(p2.x(), p2.y() - 1, p2.z());
-                        } else if (pR->getWest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y(), p2.z());
-                        } else if (pR->getEast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y(), p2.z());
-                        } else if (pR->getSouthwest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y() - 1, p2.z());
-                        } else if (pR->getSoutheast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y() - 1, p2.z());
-                        } else if (pR->getNortheast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y() + 1, p2.z());
-                        } else if (pR->getNorthwest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y() + 1, p2.z());
-                        } else if (pR->getUp() == k) {
-                            glTranslatef(p2.x(), p2.y(), p2.z() + 1);
-                        } else if (pR->getDown() == k) {
-                            glTranslatef(p2.x(), p2.y(), p2.z() - 1);
-                        }
-
-                        float mc6[] = {85.0 / 255.0, 170.0 / 255.0, 0.0 / 255.0, 0.0};
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc6);
-                        glMateriali(GL_FRONT, GL_SHININESS, 96);
-
-                        glLoadName(k);
-                        quads++;
-                        glBegin(GL_QUADS);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glEnd();
-                        //drauf
-                        float mc3[] = {0.2, 0.2, 0.6, 1.0};
-                        int env = pExit->environment;
-                        if (mpMap->envColors.contains(env)) {
-                            env = mpMap->envColors[env];
-                        } else {
-                            if (!mpMap->customEnvColors.contains(env)) {
-                                env = 1;
-                            }
-                        }
-                        switch (env) {
-                        case 1:
-                            glColor4ub(128, 50, 50, 200);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 0.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 2:
-                            glColor4ub(128, 128, 50, 200);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 3:
-                            glColor4ub(50, 128, 50, 200);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 4:
-                            glColor4ub(50, 50, 128, 200);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 0.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 5:
-                            glColor4ub(128, 50, 128, 200);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 6:
-                            glColor4ub(50, 128, 128, 200);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 7:
-                            glColor4ub(52, 38, 78, 200);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 8:
-                            glColor4ub(65, 55, 35, 200);
-                            mc3[0] = 55.0 / 255.0;
-                            mc3[1] = 55.0 / 255.0;
-                            mc3[2] = 55.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 9:
-                            glColor4ub(175, 50, 50, 200);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 10:
-                            glColor4ub(255, 255, 50, 200);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 11:
-                            glColor4ub(50, 175, 175, 200);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 12:
-                            glColor4ub(175, 175, 50, 200);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 13:
-                            glColor4ub(175, 50, 175, 200);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 14:
-                            glColor4ub(50, 175, 50, 200);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 15:
-                            glColor4ub(50, 50, 175, 200);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        default: //user defined room color
-                            if (!mpMap->customEnvColors.contains(env)) {
-                                break;
-                            }
-                            QColor& _c = mpMap->customEnvColors[env];
-                            glColor4ub(_c.red(), _c.green(), _c.blue(), 25);
-                            mc3[0] = _c.redF();
-                            mc3[1] = _c.greenF();
-                            mc3[2] = _c.blueF();
-                            mc3[3] = 0.2;
-                        }
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1);
-                        glDisable(GL_DEPTH_TEST);
-                        glLoadIdentity();
-                        gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                        glScalef(0.05, 0.05, 0.020);
-                        if (pR->getNorth() == k) {
-                            glTranslatef(2 * p2.x(), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSouth() == k) {
-                            glTranslatef(2 * p2.x(), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getWest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * p2.y(), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getEast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * p2.y(), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSouthwest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSoutheast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getNortheast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getNorthwest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getUp() == k) {
-                            glTranslatef(2 * p2.x(), 2 * p2.y(), 5.0 * (p2.z() + 1 + 0.25));
-                        } else if (pR->getDown() == k) {
-                            glTranslatef(2 * p2.x(), 2 * p2.y(), 5.0 * (p2.z() - 1 + 0.25));
-                        }
-
-                        glBegin(GL_QUADS);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glEnd();
-                    }
-                }
-            } else {
-                for (int k : exitList) {
-                    bool areaExit = false;
-                    if (k == -1) {
-                        continue;
-                    }
-                    TRoom* pExit = mpMap->mpRoomDB->getRoom(k);
-                    if (!pExit) {
-                        continue;
-                    }
-                    if (pExit->getArea() != mAID) {
-                        areaExit = true;
-                    } else {
-                        areaExit = false;
-                    }
-
-                    float ex = static_cast<float>(pExit->x);
-                    float ey = static_cast<float>(pExit->y);
-                    float ez = static_cast<float>(pExit->z);
-                    QVector3D p1(ex, ey, ez);
-                    QVector3D p2(rx, ry, rz);
-                    glLoadIdentity();
-                    gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                    glScalef(0.1, 0.1, 0.1);
-                    if (areaExit) {
-                        glLineWidth(1); //1/mScale+2);
-                    } else {
-                        glLineWidth(1); //1/mScale);
-                    }
-                    if (k == mRID || ((rz == pz) && (rx == px) && (ry == py))) {
-                        glDisable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        float mc3[] = {1.0f, 0.0f, 0.0f, 1.0f};
-                        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, mc3);
-                        glMateriali(GL_FRONT_AND_BACK, GL_SHININESS, 1);
-                        glColor4f(1.0, 0.0, 0.0, 1.0);
-                    } else {
-                        glEnable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        glEnable(GL_LIGHT1);
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor2[ef]);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1); //gut:36
-                        glColor4f(0.3, 0.3, 0.3, 1.0); /*ebenenColor2[ef][0],
-                                  ebenenColor2[ef][1],
-                                  ebenenColor2[ef][2],
-                                  ebenenColor2[ef][3])*/
-                        ;
-                    }
-                    glBegin(GL_LINES);
-                    if (!areaExit) {
-                        glVertex3f(p1.x(), p1.y(), p1.z());
-                    } else {
-                        if (pR->getNorth() == k) {
-                            glVertex3f(p2.x(), p2.y() + 1, p2.z());
-                        } else if (pR->getSouth() == k) {
-                            glVertex3f(p2.x(), p2.y() - 1, p2.z());
-                        } else if (pR->getWest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y(), p2.z());
-                        } else if (pR->getEast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y(), p2.z());
-                        } else if (pR->getSouthwest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y() - 1, p2.z());
-                        } else if (pR->getSoutheast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y() - 1, p2.z());
-                        } else if (pR->getNortheast() == k) {
-                            glVertex3f(p2.x() + 1, p2.y() - 1, p2.z());
-                        } else if (pR->getNorthwest() == k) {
-                            glVertex3f(p2.x() - 1, p2.y() + 1, p2.z());
-                        } else if (pR->getUp() == k) {
-                            glVertex3f(p2.x(), p2.y(), p2.z() + 1);
-                        } else if (pR->getDown() == k) {
-                            glVertex3f(p2.x(), p2.y(), p2.z() - 1);
-                        }
-                    }
-                    glVertex3f(p2.x(), p2.y(), p2.z());
-                    glEnd();
-                    verts++;
-                    if (areaExit) {
-                        glDisable(GL_BLEND);
-                        glEnable(GL_LIGHTING);
-                        glDisable(GL_LIGHT1);
-                        float mc4[] = {85.0 / 255.0, 170.0 / 255.0, 0.0 / 255.0, 1.0};
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc4);
-                        glMateriali(GL_FRONT, GL_SHININESS, 1);
-                        glColor4f(85.0 / 255.0, 170.0 / 255.0, 0.0 / 255.0, 1.0);
-                        glLoadIdentity();
-                        gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                        glScalef(0.1, 0.1, 0.1);
-                        if (pR->getNorth() == k) {
-                            glTranslatef(p2.x(), p2.y() + 1, p2.z());
-                        } else if (pR->getSouth() == k) {
-                            glTranslatef(p2.x(), p2.y() - 1, p2.z());
-                        } else if (pR->getWest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y(), p2.z());
-                        } else if (pR->getEast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y(), p2.z());
-                        } else if (pR->getSouthwest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y() - 1, p2.z());
-                        } else if (pR->getSoutheast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y() - 1, p2.z());
-                        } else if (pR->getNortheast() == k) {
-                            glTranslatef(p2.x() + 1, p2.y() + 1, p2.z());
-                        } else if (pR->getNorthwest() == k) {
-                            glTranslatef(p2.x() - 1, p2.y() + 1, p2.z());
-                        } else if (pR->getUp() == k) {
-                            glTranslatef(p2.x(), p2.y(), p2.z() + 1);
-                        } else if (pR->getDown() == k) {
-                            glTranslatef(p2.x(), p2.y(), p2.z() - 1);
-                        }
-
-                        glLoadName(k);
-                        quads++;
-                        glBegin(GL_QUADS);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glEnd();
-
-                        //drauf
-                        float mc3[] = {0.2, 0.2, 0.6, 0.2};
-                        int env = pExit->environment;
-                        if (mpMap->envColors.contains(env)) {
-                            env = mpMap->envColors[env];
-                        } else {
-                            if (!mpMap->customEnvColors.contains(env)) {
-                                env = 1;
-                            }
-                        }
-                        switch (env) {
-                        case 1:
-                            glColor4ub(128, 50, 50, 2);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 0.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 2:
-                            glColor4ub(128, 128, 50, 2);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 3:
-                            glColor4ub(50, 128, 50, 2);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 4:
-                            glColor4ub(50, 50, 128, 2);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 0.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 5:
-                            glColor4ub(128, 50, 128, 2);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 0.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 6:
-                            glColor4ub(50, 128, 128, 2);
-                            mc3[0] = 0.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 7:
-                            glColor4ub(52, 38, 78, 2);
-                            mc3[0] = 128.0 / 255.0;
-                            mc3[1] = 128.0 / 255.0;
-                            mc3[2] = 128.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 8:
-                            glColor4ub(65, 55, 35, 2);
-                            mc3[0] = 55.0 / 255.0;
-                            mc3[1] = 55.0 / 255.0;
-                            mc3[2] = 55.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 9:
-                            glColor4ub(175, 50, 50, 2);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 10:
-                            glColor4ub(255, 255, 50, 2);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 11:
-                            glColor4ub(50, 175, 175, 2);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 50.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 12:
-                            glColor4ub(175, 175, 50, 2);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-
-                        case 13:
-                            glColor4ub(175, 50, 175, 2);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 50.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 14:
-                            glColor4ub(50, 175, 50, 2);
-                            mc3[0] = 50.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        case 15:
-                            glColor4ub(50, 50, 175, 2);
-                            mc3[0] = 255.0 / 255.0;
-                            mc3[1] = 255.0 / 255.0;
-                            mc3[2] = 255.0 / 255.0;
-                            mc3[3] = 0.2;
-                            break;
-                        default: //user defined room color
-                            if (!mpMap->customEnvColors.contains(env)) {
-                                break;
-                            }
-                            QColor& _c = mpMap->customEnvColors[env];
-                            glColor4ub(_c.red(), _c.green(), _c.blue(), 255);
-                            mc3[0] = _c.redF();
-                            mc3[1] = _c.greenF();
-                            mc3[2] = _c.blueF();
-                            mc3[3] = 0.2;
-                        }
-                        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                        glMateriali(GL_FRONT, GL_SHININESS, 36);
-                        glDisable(GL_DEPTH_TEST);
-                        glLoadIdentity();
-                        gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                        glScalef(0.05, 0.05, 0.020);
-                        if (pR->getNorth() == k) {
-                            glTranslatef(2 * p2.x(), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSouth() == k) {
-                            glTranslatef(2 * p2.x(), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getWest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * p2.y(), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getEast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * p2.y(), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSouthwest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getSoutheast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * (p2.y() - 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getNortheast() == k) {
-                            glTranslatef(2 * (p2.x() + 1), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getNorthwest() == k) {
-                            glTranslatef(2 * (p2.x() - 1), 2 * (p2.y() + 1), 5.0 * (p2.z() + 0.25));
-                        } else if (pR->getUp() == k) {
-                            glTranslatef(2 * p2.x(), 2 * p2.y(), 5.0 * (p2.z() + 1 + 0.25));
-                        } else if (pR->getDown() == k) {
-                            glTranslatef(2 * p2.x(), 2 * p2.y(), 5.0 * (p2.z() - 1 + 0.25));
-                        }
-
-                        glBegin(GL_QUADS);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, -0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, -0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                        glNormal3f(0.57735, 0.57735, -0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, -0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                        glNormal3f(-0.57735, 0.57735, 0.57735);
-                        glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glNormal3f(0.57735, 0.57735, 0.57735);
-                        glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                        glEnd();
-                    }
-                }
-                glFlush();
+            for (int i = 0, total = level.mRoomIds.size(); i < total; ++i) {
+                glLoadName(level.mRoomIds.at(i));
+                level.mRoomCubes.draw(GL_QUADS, i * 24, 24);
             }
         }
+        glFlush();
+        return;
+    }
 
-        if (zRot <= 0) {
-            zEbene -= 1.0;
+    int centerRoomId = 0;
+    const QList<int> centerRooms = pArea->getRoomsInRect(ox, ox, oy, oy, oz);
+    if (!centerRooms.isEmpty()) {
+        centerRoomId = centerRooms.first();
+    }
+
+    // The exits are drawn from the top level down when looking from below:
+    QList<int> exitLevels = shownLevels;
+    if (zRot <= 0) {
+        std::reverse(exitLevels.begin(), exitLevels.end());
+    }
+    glEnable(GL_LIGHTING);
+    for (int z : exitLevels) {
+        const LevelGeometry& level = mAreaGeometry.constFind(z).value();
+        const int ef = abs(z % 26);
+        if (z <= oz) {
+            glDisable(GL_BLEND);
+            glDisable(GL_LIGHT1);
+            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
         } else {
-            zEbene += 1.0;
+            glEnable(GL_BLEND);
+            glEnable(GL_LIGHT1);
+            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor2[ef]);
         }
+        // Lines have no normals of their own:
+        glNormal3f(scCornerNormal, scCornerNormal, scCornerNormal);
+        level.mExitLines.draw(GL_LINES);
+
+        glDisable(GL_BLEND);
+        glDisable(GL_LIGHT1);
+        glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, scAreaExitColor);
+        level.mAreaExitCubes.draw(GL_QUADS);
+        level.mAreaExitPlates.draw(GL_QUADS);
     }
 
-    quads = 0;
-    zEbene = zmin;
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glDisable(GL_LIGHT1);
-
-    while (true) {
-        if (zEbene > zmax) {
-            break;
+    // The exits of the room in the centre of the view, and those leading to
+    // the player's room, go over the others in red:
+    VertexBatch redExitLines;
+    TRoom* pCenterRoom = mpMap->mpRoomDB->getRoom(centerRoomId);
+    if (pCenterRoom) {
+        addExitLines(redExitLines, pCenterRoom);
+    }
+    QSetIterator<int> itEntrance(mpMap->mpRoomDB->getEntrances(mRID));
+    while (itEntrance.hasNext()) {
+        TRoom* pR = mpMap->mpRoomDB->getRoom(itEntrance.next());
+        if (pR && pR->getArea() == mAID && isLevelShown(pR->z, oz)) {
+            addExitLines(redExitLines, pR, mRID);
         }
-        QSetIterator<int> itRoom(pArea->getAreaRooms());
-        while (itRoom.hasNext()) {
+    }
+    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, scCenterRoomColor);
+    glNormal3f(scCornerNormal, scCornerNormal, scCornerNormal);
+    redExitLines.draw(GL_LINES);
+
+    for (int z : shownLevels) {
+        const LevelGeometry& level = mAreaGeometry.constFind(z).value();
+        const int ef = abs(z % 26);
+        if (z <= oz) {
+            glDisable(GL_BLEND);
             glDisable(GL_LIGHT1);
-            int currentRoomId = itRoom.next();
-            TRoom* pR = mpMap->mpRoomDB->getRoom(currentRoomId);
-            if (!pR) {
-                continue;
-            }
-            float rx = static_cast<float>(pR->x);
-            float ry = static_cast<float>(pR->y);
-            float rz = static_cast<float>(pR->z);
-            if (rz != zEbene) {
-                continue;
-            }
-
-            if (rz > pz) {
-                if (abs(rz - pz) > mShowTopLevels) {
-                    continue;
-                }
+            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor2[ef]);
+        } else {
+            glEnable(GL_BLEND);
+            glEnable(GL_LIGHT1);
+            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
+        }
+        level.mRoomCubes.draw(GL_QUADS);
+
+        // The target room and the one in the centre of the view are drawn
+        // again, solid, over the others:
+        const int targetIndex = level.mRoomIndexes.value(mTarget, -1);
+        const int centerIndex = level.mRoomIndexes.value(centerRoomId, -1);
+        if (targetIndex >= 0 || centerIndex >= 0) {
+            glDisable(GL_BLEND);
+            glDisable(GL_LIGHT1);
+            if (targetIndex >= 0) {
+                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, scTargetRoomColor);
+                level.mRoomCubes.draw(GL_QUADS, targetIndex * 24, 24);
             }
-            if (rz < pz) {
-                if (abs(rz - pz) > mShowBottomLevels) {
-                    continue;
-                }
+            if (centerIndex >= 0) {
+                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, scCenterRoomColor);
+                level.mRoomCubes.draw(GL_QUADS, centerIndex * 24, 24);
             }
-
-            int e = pR->z;
-            int ef = abs(e % 26);
-            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
-            glMateriali(GL_FRONT, GL_SHININESS, 36); //gut:96
-
-            if ((rz == pz) && (rx == px) && (ry == py)) {
-                glDisable(GL_BLEND);
-                glEnable(GL_LIGHTING);
-                glDisable(GL_LIGHT1);
-                float mc3[] = {1.0f, 0.0f, 0.0f, 1.0f};
-                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                glMateriali(GL_FRONT, GL_SHININESS, 36);
-                glColor4f(1.0, 0.0, 0.0, 1.0);
-            } else if (currentRoomId == mTarget) {
-                glDisable(GL_BLEND);
-                glEnable(GL_LIGHTING);
-                glDisable(GL_LIGHT1);
-                float mc4[] = {0.0, 1.0, 0.0, 1.0};
-                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc4);
-                glMateriali(GL_FRONT, GL_SHININESS, 36); //36
-                glColor4f(0.0, 1.0, 0.0, 1.0);
-            } else if (rz <= pz) {
-                glDisable(GL_BLEND);
-                glEnable(GL_LIGHTING);
-                glDisable(GL_LIGHT1);
-                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor2[ef]);
-                glMateriali(GL_FRONT, GL_SHININESS, 36);
-                glColor4f(ebenenColor[ef][0], ebenenColor[ef][1], ebenenColor[ef][2], ebenenColor[ef][3]);
-            } else {
+            if (z > oz) {
                 glEnable(GL_BLEND);
-                glEnable(GL_LIGHTING);
                 glEnable(GL_LIGHT1);
-                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, ebenenColor[ef]);
-                glMateriali(GL_FRONT, GL_SHININESS, 36); //56);//gut:36
-                glColor4f(ebenenColor2[ef][0], ebenenColor2[ef][1], ebenenColor2[ef][2], ebenenColor2[ef][3]);
-
-                glLoadIdentity();
-                gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-                if (pArea->gridMode) {
-                    glScalef(0.2, 0.2, 0.1);
-                    glTranslatef(0.5 * rx, 0.5 * ry, rz);
-                } else {
-                    glScalef(0.1, 0.1, 0.1);
-                    glTranslatef(rx, ry, rz);
-                }
-
-                glLoadName(currentRoomId);
-                quads++;
-                glBegin(GL_QUADS);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glEnd();
-
-                float mc3[] = {0.2, 0.2, 0.6, 0.2};
-                int env = pR->environment;
-                if (mpMap->envColors.contains(env)) {
-                    env = mpMap->envColors[env];
-                } else {
-                    if (!mpMap->customEnvColors.contains(env)) {
-                        env = 1;
-                    }
-                }
-
-                switch (env) {
-                case 1:
-                    glColor4ub(128, 50, 50, 2);
-                    mc3[0] = 128.0 / 255.0;
-                    mc3[1] = 0.0 / 255.0;
-                    mc3[2] = 0.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 2:
-                    glColor4ub(128, 128, 50, 2);
-                    mc3[0] = 0.0 / 255.0;
-                    mc3[1] = 128.0 / 255.0;
-                    mc3[2] = 0.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 3:
-                    glColor4ub(50, 128, 50, 2);
-                    mc3[0] = 128.0 / 255.0;
-                    mc3[1] = 128.0 / 255.0;
-                    mc3[2] = 0.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 4:
-                    glColor4ub(50, 50, 128, 2);
-                    mc3[0] = 0.0 / 255.0;
-                    mc3[1] = 0.0 / 255.0;
-                    mc3[2] = 128.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 5:
-                    glColor4ub(128, 50, 128, 2);
-                    mc3[0] = 128.0 / 255.0;
-                    mc3[1] = 128.0 / 255.0;
-                    mc3[2] = 0.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 6:
-                    glColor4ub(50, 128, 128, 2);
-                    mc3[0] = 0.0 / 255.0;
-                    mc3[1] = 128.0 / 255.0;
-                    mc3[2] = 128.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 7:
-                    glColor4ub(52, 38, 78, 2);
-                    mc3[0] = 128.0 / 255.0;
-                    mc3[1] = 128.0 / 255.0;
-                    mc3[2] = 128.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 8:
-                    glColor4ub(65, 55, 35, 2);
-                    mc3[0] = 55.0 / 255.0;
-                    mc3[1] = 55.0 / 255.0;
-                    mc3[2] = 55.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 9:
-                    glColor4ub(175, 50, 50, 2);
-                    mc3[0] = 255.0 / 255.0;
-                    mc3[1] = 50.0 / 255.0;
-                    mc3[2] = 50.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 10:
-                    glColor4ub(255, 255, 50, 2);
-                    mc3[0] = 50.0 / 255.0;
-                    mc3[1] = 255.0 / 255.0;
-                    mc3[2] = 50.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 11:
-                    glColor4ub(50, 175, 175, 2);
-                    mc3[0] = 255.0 / 255.0;
-                    mc3[1] = 255.0 / 255.0;
-                    mc3[2] = 50.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 12:
-                    glColor4ub(175, 175, 50, 2);
-                    mc3[0] = 50.0 / 255.0;
-                    mc3[1] = 50.0 / 255.0;
-                    mc3[2] = 255.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-
-                case 13:
-                    glColor4ub(175, 50, 175, 2);
-                    mc3[0] = 255.0 / 255.0;
-                    mc3[1] = 50.0 / 255.0;
-                    mc3[2] = 255.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 14:
-                    glColor4ub(50, 175, 50, 2);
-                    mc3[0] = 50.0 / 255.0;
-                    mc3[1] = 255.0 / 255.0;
-                    mc3[2] = 255.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                case 15:
-                    glColor4ub(50, 50, 175, 2);
-                    mc3[0] = 255.0 / 255.0;
-                    mc3[1] = 255.0 / 255.0;
-                    mc3[2] = 255.0 / 255.0;
-                    mc3[3] = 0.2;
-                    break;
-                default: //user defined room color
-                    if (!mpMap->customEnvColors.contains(env)) {
-                        break;
-                    }
-                    QColor& _c = mpMap->customEnvColors[env];
-                    glColor4ub(_c.red(), _c.green(), _c.blue(), 255);
-                    mc3[0] = _c.redF();
-                    mc3[1] = _c.greenF();
-                    mc3[2] = _c.blueF();
-                    mc3[3] = 0.2;
-                }
-                glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-                glMateriali(GL_FRONT, GL_SHININESS, 96);
-                glDisable(GL_DEPTH_TEST);
-                glLoadIdentity();
-                gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-
-                if (pArea->gridMode) {
-                    if ((rz == pz) && (rx == px) && (ry == py)) {
-                        glScalef(0.1, 0.1, 0.020);
-                        glTranslatef(0.1 * rx, 0.1 * ry, 5.0 * (rz + 0.25));
-                    } else {
-                        glScalef(0.2, 0.2, 0.020);
-                        glTranslatef(0.5 * rx, 0.5 * ry, 5.0 * (rz + 0.25));
-                    }
-                } else {
-                    glScalef(0.075, 0.075, 0.020);
-                    glTranslatef(1.333333333 * rx, 1.333333333 * ry, 5.0 * (rz + 0.25)); //+0.4
-                }
-
-                glBegin(GL_QUADS);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, -0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, -0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-                glNormal3f(0.57735, 0.57735, -0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, -0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-                glNormal3f(-0.57735, 0.57735, 0.57735);
-                glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glNormal3f(0.57735, 0.57735, 0.57735);
-                glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-                glEnd();
-
-                continue;
             }
-
-            float mc3[] = {0.2f, 0.2f, 0.7f, 1.0f};
-            glLoadIdentity();
-            gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-            if (pArea->gridMode) {
-                glScalef(0.2, 0.2, 0.1);
-                glTranslatef(0.5 * rx, 0.5 * ry, rz);
-            } else {
-                glScalef(0.1, 0.1, 0.1);
-                glTranslatef(rx, ry, rz);
-            }
-
-            glLoadName(currentRoomId);
-            quads++;
-            glBegin(GL_QUADS);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-
-            glEnd();
-
-            int env = pR->environment;
-            if (mpMap->envColors.contains(env)) {
-                env = mpMap->envColors[env];
-            } else {
-                if (!mpMap->customEnvColors.contains(env)) {
-                    env = 1;
-                }
-            }
-            switch (env) {
-            case 1:
-                glColor4ub(128, 50, 50, 255);
-                mc3[0] = 128.0 / 255.0;
-                mc3[1] = 0.0 / 255.0;
-                mc3[2] = 0.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 2:
-                glColor4ub(128, 128, 50, 255);
-                mc3[0] = 0.0 / 255.0;
-                mc3[1] = 128.0 / 255.0;
-                mc3[2] = 0.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 3:
-                glColor4ub(50, 128, 50, 255);
-                mc3[0] = 128.0 / 255.0;
-                mc3[1] = 128.0 / 255.0;
-                mc3[2] = 0.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 4:
-                glColor4ub(50, 50, 128, 255);
-                mc3[0] = 0.0 / 255.0;
-                mc3[1] = 0.0 / 255.0;
-                mc3[2] = 128.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 5:
-                glColor4ub(128, 50, 128, 255);
-                mc3[0] = 128.0 / 255.0;
-                mc3[1] = 128.0 / 255.0;
-                mc3[2] = 0.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 6:
-                glColor4ub(50, 128, 128, 255);
-                mc3[0] = 0.0 / 255.0;
-                mc3[1] = 128.0 / 255.0;
-                mc3[2] = 128.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 7:
-                glColor4ub(52, 38, 78, 255);
-                mc3[0] = 128.0 / 255.0;
-                mc3[1] = 128.0 / 255.0;
-                mc3[2] = 128.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 8:
-                glColor4ub(65, 55, 35, 255);
-                mc3[0] = 55.0 / 255.0;
-                mc3[1] = 55.0 / 255.0;
-                mc3[2] = 55.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 9:
-                glColor4ub(175, 50, 50, 255);
-                mc3[0] = 255.0 / 255.0;
-                mc3[1] = 50.0 / 255.0;
-                mc3[2] = 50.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 10:
-                glColor4ub(255, 255, 50, 255);
-                mc3[0] = 50.0 / 255.0;
-                mc3[1] = 255.0 / 255.0;
-                mc3[2] = 50.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 11:
-                glColor4ub(50, 175, 175, 255);
-                mc3[0] = 255.0 / 255.0;
-                mc3[1] = 255.0 / 255.0;
-                mc3[2] = 50.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 12:
-                glColor4ub(175, 175, 50, 255);
-                mc3[0] = 50.0 / 255.0;
-                mc3[1] = 50.0 / 255.0;
-                mc3[2] = 255.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-
-            case 13:
-                glColor4ub(175, 50, 175, 255);
-                mc3[0] = 255.0 / 255.0;
-                mc3[1] = 50.0 / 255.0;
-                mc3[2] = 255.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 14:
-                glColor4ub(50, 175, 50, 255);
-                mc3[0] = 50.0 / 255.0;
-                mc3[1] = 255.0 / 255.0;
-                mc3[2] = 255.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            case 15:
-                glColor4ub(50, 50, 175, 255);
-                mc3[0] = 255.0 / 255.0;
-                mc3[1] = 255.0 / 255.0;
-                mc3[2] = 255.0 / 255.0;
-                mc3[3] = 255.0 / 255.0;
-                break;
-            default: //user defined room color
-                if (!mpMap->customEnvColors.contains(env)) {
-                    break;
-                }
-                QColor& _c = mpMap->customEnvColors[env];
-                glColor4ub(_c.red(), _c.green(), _c.blue(), 255);
-                mc3[0] = _c.redF();
-                mc3[1] = _c.greenF();
-                mc3[2] = _c.blueF();
-                mc3[3] = 1.0;
-            }
-            glDisable(GL_DEPTH_TEST);
-            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mc3);
-            glMateriali(GL_FRONT, GL_SHININESS, 6);
-            glLoadIdentity();
-            gluLookAt(px * 0.1 + xRot, py * 0.1 + yRot, pz * 0.1 + zRot, px * 0.1, py * 0.1, pz * 0.1, 0.0, 1.0, 0.0);
-            if (pArea->gridMode) {
-                if ((rz == pz) && (rx == px) && (ry == py)) {
-                    glScalef(0.1, 0.1, 0.020);
-                    glTranslatef(rx, ry, 5.0 * (rz + 0.25));
-                } else {
-                    glScalef(0.2, 0.2, 0.020);
-                    glTranslatef(0.5 * rx, 0.5 * ry, 5.0 * (rz + 0.25));
-                }
-            } else {
-                if (is2DView) {
-                    glScalef(0.090, 0.090, 0.020);
-                    glTranslatef(1.1111111 * rx, 1.1111111 * ry, 5.0 * (rz + 0.25)); //+0.4
-                } else {
-                    glScalef(0.075, 0.075, 0.020);
-                    glTranslatef(1.333333333 * rx, 1.333333333 * ry, 5.0 * (rz + 0.25)); //+0.4
-                }
-            }
-            glBegin(GL_QUADS);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, -0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, -0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, -1.0 / dehnung, 1.0 / dehnung);
-
-            glNormal3f(0.57735, 0.57735, -0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, -0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, -1.0 / dehnung);
-            glNormal3f(-0.57735, 0.57735, 0.57735);
-            glVertex3f(-1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glNormal3f(0.57735, 0.57735, 0.57735);
-            glVertex3f(1.0 / dehnung, 1.0 / dehnung, 1.0 / dehnung);
-            glEnd();
-
-            glColor4ub(128, 128, 128, 255);
-
-
-            glBegin(GL_TRIANGLES);
-
-            if (pR->getDown() > -1) {
-                glVertex3f(0.0, -0.95 / dehnung, 0.0);
-                glVertex3f(0.95 / dehnung, -0.25 / dehnung, 0.0);
-                glVertex3f(-0.95 / dehnung, -0.25 / dehnung, 0.0);
-            }
-            if (pR->getUp() > -1) {
-                glVertex3f(0.0, 0.95 / dehnung, 0.0);
-                glVertex3f(-0.95 / dehnung, 0.25 / dehnung, 0.0);
-                glVertex3f(0.95 / dehnung, 0.25 / dehnung, 0.0);
-            }
-            glEnd();
-
-//            if( mpMap->rooms[pArea->rooms[i]]->out > -1 )
-//            {
-//                glBegin( GL_LINE_LOOP );
-//                for( int angle=0; angle<360; angle += 1 )
-//                {
-//                    glVertex3f( (0.5 + sin((float)angle) * 0.25)/dehnung, ( cos((float)angle) * 0.25)/dehnung, 0.0);
-//                }
-//                glEnd();
-//            }
-
-
-//            glTranslatef( -0.1, 0.0, 0.0 );
-//            if( mpMap->rooms[pArea->rooms[i]]->in > -1 )
-//            {
-//                glBegin( GL_TRIANGLE_FAN );
-//                glVertex3f( 0.0, 0.0, 0.0);
-//                for( int angle=0; angle<=360; angle += 5 )
-//                {
-//                    glVertex3f( (sin((float)angle)*0.25)/dehnung, (cos((float)angle)*0.25)/dehnung, 0.0);
-//                }
-//                glEnd();
-//            }
         }
 
-
-        zEbene += 1.0;
+        if (pArea->gridMode && centerIndex >= 0) {
+            // In grid mode the plate would cover the whole of the red room
+            // in the centre of the view, so it gets a smaller one:
+            const int afterCenter = (centerIndex + 1) * 24;
+            level.mRoomPlates.draw(GL_QUADS, 0, centerIndex * 24);
+            level.mRoomPlates.draw(GL_QUADS, afterCenter, level.mRoomPlates.vertexCount() - afterCenter);
+            glPushMatrix();
+            glTranslatef(px, py, 0.0);
+            glScalef(0.5, 0.5, 1.0);
+            glTranslatef(-px, -py, 0.0);
+            level.mRoomPlates.draw(GL_QUADS, centerIndex * 24, 24);
+            glPopMatrix();
+        } else {
+            level.mRoomPlates.draw(GL_QUADS);
+        }
+        if (z <= oz) {
+            level.mUpDownMarks.draw(GL_TRIANGLES);
+        }
     }
-    //   qDebug()<<"FINAL: mQuads.size()="<<mQuads.size()<<"area.size()="<<pArea->rooms.size()<<" quads="<<quads<<" verts="<<verts;
-    //    qDebug()<<"mScale="<<mScale<<" 1/mScale="<<1/mScale<<" env="<<env;
-    //    cout<<"dif r="<<diffuseLight[0]<<" g="<<diffuseLight[1]<<" b="<<diffuseLight[2]<<endl;
-    //    cout << "xRot:"<<xRot<<" yRot:"<<yRot<<" zRot:"<<zRot<<endl;
     glFlush();
 }
 
@@ -25,11 +25,19 @@
 
 #include "pre_guard.h"
 #include <QtOpenGL/qgl.h> //problem with git
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
 #include <QPointer>
+#include <QVector>
+#include <QVector3D>
 #include "post_guard.h"
 
 class Host;
+class TArea;
 class TMap;
+class TRoom;
 
 
 class GLWidget : public QGLWidget
@@ -94,6 +102,45 @@ public:
     TMap* mpMap;
 
 private:
+    // Vertex (and normal and colour, where they are used) arrays for one kind
+    // of thing drawn on a level, so that all of it is sent to OpenGL with one
+    // glDrawArrays() instead of a vertex at a time:
+    struct VertexBatch
+    {
+        void addVertex(const QVector3D& position);
+        void addCube(const QVector3D& center, const QVector3D& halfSize);
+        void addTriangle(const QVector3D& a, const QVector3D& b, const QVector3D& c);
+        void addColor(const QColor& color, int vertexCount);
+        void draw(GLenum mode) const { draw(mode, 0, vertexCount()); }
+        void draw(GLenum mode, int first, int count) const;
+        int vertexCount() const { return mVertices.size() / 3; }
+
+        QVector<GLfloat> mVertices;
+        QVector<GLfloat> mNormals;
+        QVector<GLfloat> mColors;
+    };
+
+    // Everything on one z level of the shown area that does not depend on
+    // where the view is centred, the cubes are 24 vertices each and in the
+    // same order as the ids that go with them:
+    struct LevelGeometry
+    {
+        VertexBatch mExitLines;
+        VertexBatch mAreaExitCubes;
+        VertexBatch mAreaExitPlates;
+        VertexBatch mRoomCubes;
+        VertexBatch mRoomPlates;
+        VertexBatch mUpDownMarks;
+        QVector<int> mAreaExitIds;
+        QVector<int> mRoomIds;
+        // key = room id, value = index in mRoomIds:
+        QHash<int, int> mRoomIndexes;
+    };
+
+    void updateAreaGeometry(TArea* pArea);
+    QList<QPair<int, QVector3D>> addExitLines(VertexBatch& lines, TRoom* pR, int toRoomId = 0);
+    bool isLevelShown(int z, int centerZ) const;
+
     bool is2DView;
 
     int mRID;
@@ -122,6 +169,15 @@ private:
     int mTarget;
     QPointer<Host> mpHost;
     QMap<int, int> mQuads;
+
+    // The geometry of the shown area, rebuilt when the area, the map data or
+    // the way the rooms are drawn changes - key = z level:
+    QMap<int, LevelGeometry> mAreaGeometry;
+    bool mIsAreaGeometryValid;
+    int mGeometryAreaId;
+    quint64 mGeometryMapRevision;
+    bool mIsGeometryGridMode;
+    bool mIsGeometry2DView;
 };
 
 #endif // MUDLET_GLWIDGET_H
@@ -23,6 +23,7 @@
 
 #include "FontManager.h"
 #include "HostManager.h"
+#include "TReplayBenchmark.h"
 #include "mudlet.h"
 
 #include "pre_guard.h"
@@ -33,6 +34,7 @@
 #include <QPainter>
 #include <QSplashScreen>
 #include <QStringBuilder>
+#include <QStringList>
 #include <QTextLayout>
 #include "post_guard.h"
 
@@ -67,7 +69,7 @@ static void pcre_free_dbg(void* ptr)
 
 #endif // _DEBUG && _MSC_VER
 
-QCoreApplication* createApplication(int& argc, char* argv[], unsigned int& action)
+QCoreApplication* createApplication(int& argc, char* argv[], unsigned int& action, QStringList& benchmarkArguments)
 {
     action = 0;
 
@@ -118,6 +120,17 @@ QCoreApplication* createApplication(int& argc, char* argv[], unsigned int& actio
             if (tolower(argument) == 'q') {
                 action |= 4;
             }
+
+            if (tolower(argument) == 'b') {
+                // Followed by the profile and the replay file to run with it
+                if (i + 2 >= argc) {
+                    action = 1; // Show how it should be used instead
+                    break;
+                }
+                action |= 8;
+                benchmarkArguments << QString::fromLocal8Bit(argv[i + 1]) << QString::fromLocal8Bit(argv[i + 2]);
+                i += 2;
+            }
         }
     }
 
@@ -176,7 +189,8 @@ int main(int argc, char* argv[])
 
     Q_INIT_RESOURCE(mudlet);
 
-    QScopedPointer<QCoreApplication> initApp(createApplication(argc, argv, startupAction));
+    QStringList benchmarkArguments;
+    QScopedPointer<QCoreApplication> initApp(createApplication(argc, argv, startupAction, benchmarkArguments));
 
     QApplication* app = qobject_cast<QApplication*>(initApp.data());
 
@@ -199,11 +213,23 @@ int main(int argc, char* argv[])
             std::cout << "   /h, /help           displays this message." << std::endl;
             std::cout << "   /v, /version        displays version information." << std::endl;
             std::cout << "   /q, /quiet          no splash screen on startup." << std::endl;
+            std::cout << "   /b, /benchmark PROFILE REPLAY" << std::endl;
+            std::cout << "                       runs the REPLAY file through the triggers and scripts" << std::endl;
+            std::cout << "                       of PROFILE as fast as possible, without showing" << std::endl;
+            std::cout << "                       anything or connecting to the game, then reports" << std::endl;
+            std::cout << "                       how long that took and exits. Adding" << std::endl;
+            std::cout << "                       /platform offscreen lets it run without a display." << std::endl;
 #define OPT_PREFIX '/'
 #else
             std::cout << "   -h, --help          displays this message." << std::endl;
             std::cout << "   -v, --version       displays version information." << std::endl;
             std::cout << "   -q, --quiet         no splash screen on startup." << std::endl;
+            std::cout << "   -b, --benchmark PROFILE REPLAY" << std::endl;
+            std::cout << "                       runs the REPLAY file through the triggers and scripts" << std::endl;
+            std::cout << "                       of PROFILE as fast as possible, without showing" << std::endl;
+            std::cout << "                       anything or connecting to the game, then reports" << std::endl;
+            std::cout << "                       how long that took and exits. Adding" << std::endl;
+            std::cout << "                       -platform offscreen lets it run without a display." << std::endl;
 #define OPT_PREFIX '-'
 #endif
             std::cout << "There are other inherited options that arise from the Qt Libraries which" << std::endl;
@@ -265,7 +291,7 @@ int main(int argc, char* argv[])
     app->setApplicationName("Mudlet");
     app->setApplicationVersion(APP_VERSION);
 
-    bool show_splash = !(startupAction & 4); // Not --quiet.
+    bool show_splash = !(startupAction & (4 | 8)); // Not --quiet or --benchmark.
 
     QImage splashImage(":/Mudlet_splashscreen_main.png");
     if (show_splash) {
@@ -419,6 +445,12 @@ int main(int argc, char* argv[])
     QFile::link(home, homeLink);
     mudlet::start();
 
+    if (startupAction & 8) {
+        // The main window is never shown, so nothing gets painted:
+        app->restoreOverrideCursor();
+        return TReplayBenchmark::run(benchmarkArguments.at(0), benchmarkArguments.at(1));
+    }
+
     if (first_launch) {
         // give Mudlet window decent size - most of the screen on non-HiDPI displays
         auto desktop = qApp->desktop();
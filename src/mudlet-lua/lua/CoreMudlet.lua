@@ -676,6 +676,34 @@ function getTimestamp(console_name, lineNumber) end
 
 
 
+--- Returns when a line was received, in milliseconds on the same clock as getCurrentMillis(), or nil and an
+--- error message if the line does not have a time stamp.
+---
+--- @usage Measure how long the server took to answer, in a trigger on the answer.
+---   <pre>
+---   echo( getTimestampMillis(getLineCount()) - sentAt .. "ms" )
+---   </pre>
+---
+--- @param console_name optional parameter
+--- @see getCurrentMillis
+function getTimestampMillis(console_name, lineNumber) end
+
+
+
+--- Returns the number of milliseconds since Mudlet started keeping time stamps - from a clock that is not
+--- affected by changes to the time of day, and that does not move on while the computer is asleep.
+---
+--- @usage Note when a command was sent.
+---   <pre>
+---   sentAt = getCurrentMillis()
+---   send("look")
+---   </pre>
+---
+--- @see getTimestampMillis
+function getCurrentMillis() end
+
+
+
 --- <b><u>TODO</u></b>  hasFocus - TLuaInterpreter::hasFocus
 function hasFocus() end
 
@@ -14,14 +14,6 @@ if package.loaded["lfs"] then lfs = require "lfs" end
 json_to_value = yajl.to_value
 gmcp = {}
 
-function __gmcp_merge_gmcp_sub_tables( a, key )
-	local _m = a.__needMerge;
-	for k,v in pairs(_m) do
-		a[key][k] = v;
-	end
-	a.__needMerge = nil
-end
-
 
 function unzip( what, dest )
 	-- cecho("\n<blue>unpacking package:<"..what.."< to <"..dest..">\n")
@@ -1347,12 +1347,8 @@ bool mudlet::setTextFormat(Host* pHost, const QString& name, int r1, int g1, int
     QMap<QString, TConsole*>& dockWindowConsoleMap = mHostConsoleMap[pHost];
     if (dockWindowConsoleMap.contains(name)) {
         TConsole* pC = dockWindowConsoleMap[name];
-        pC->mFormatCurrent.bgR = r1;
-        pC->mFormatCurrent.bgG = g1;
-        pC->mFormatCurrent.bgB = b1;
-        pC->mFormatCurrent.fgR = r2;
-        pC->mFormatCurrent.fgG = g2;
-        pC->mFormatCurrent.fgB = b2;
+        pC->mFormatCurrent.setBackground(r1, g1, b1);
+        pC->mFormatCurrent.setForeground(r2, g2, b2);
         if (bold) {
             pC->mFormatCurrent.flags |= TCHAR_BOLD;
         } else {
@@ -2221,7 +2217,7 @@ void mudlet::createMapper(bool loadDefaultMap)
     pHost->mpMap->mpM = pHost->mpMap->mpMapper->glWidget;
     pHost->mpDockableMapWidget->setWidget(pHost->mpMap->mpMapper);
 
-    if (loadDefaultMap && pHost->mpMap->mpRoomDB->getRoomIDList().isEmpty()) {
+    if (loadDefaultMap && !pHost->mpMap->mpRoomDB->size()) {
         qDebug() << "mudlet::slot_mapper() - restore map case 3.";
         pHost->mpMap->pushErrorMessagesToFile(tr("Pre-Map loading(3) report"), true);
         QDateTime now(QDateTime::currentDateTime());
@@ -2423,7 +2419,7 @@ void mudlet::startAutoLogin()
     }
 }
 
-void mudlet::doAutoLogin(const QString& profile_name)
+void mudlet::doAutoLogin(const QString& profile_name, const bool isToConnect)
 {
     if (profile_name.size() < 1) {
         return;
@@ -2463,7 +2459,11 @@ void mudlet::doAutoLogin(const QString& profile_name)
     QString pass = "password";
     QString val2 = readProfileData(profile_name, pass);
     pHost->setPass(val2);
-    slot_connection_dlg_finished(profile_name, 0);
+    if (isToConnect) {
+        slot_connection_dlg_finished(profile_name, 0);
+    } else {
+        startProfile(pHost);
+    }
     enableToolbarButtons();
 }
 
@@ -2511,6 +2511,21 @@ void mudlet::slot_connection_dlg_finished(const QString& profile, int historyVer
     if (!pHost) {
         return;
     }
+    startProfile(pHost);
+
+    //NOTE: this is a potential problem if users connect by hand quickly
+    //      and one host has a slower response time as the other one, but
+    //      the worst that can happen is that they have to login manually.
+
+    tempHostQueue.enqueue(pHost);
+    tempHostQueue.enqueue(pHost);
+    pHost->connectToServer();
+}
+
+// Everything needed to get a loaded profile going, short of connecting it to
+// the game server:
+void mudlet::startProfile(Host* pHost)
+{
     pHost->mIsProfileLoadingSequence = true;
     addConsoleForNewHost(pHost);
     pHost->mBlockScriptCompile = false;
@@ -2553,14 +2568,6 @@ void mudlet::slot_connection_dlg_finished(const QString& profile, int historyVer
     event.mArgumentList.append(QLatin1String("sysLoadEvent"));
     event.mArgumentTypeList.append(ARGUMENT_TYPE_STRING);
     pHost->raiseEvent(event);
-
-    //NOTE: this is a potential problem if users connect by hand quickly
-    //      and one host has a slower response time as the other one, but
-    //      the worst that can happen is that they have to login manually.
-
-    tempHostQueue.enqueue(pHost);
-    tempHostQueue.enqueue(pHost);
-    pHost->connectToServer();
 }
 
 void mudlet::slot_multi_view()
@@ -167,7 +167,7 @@ public:
     bool resetFormat(Host*, QString& name);
     bool moduleTableVisible();
     bool mWindowMinimized;
-    void doAutoLogin(const QString&);
+    void doAutoLogin(const QString&, bool isToConnect = true);
     bool deselect(Host* pHost, const QString& name);
     void stopSounds();
     void playSound(QString s, int);
@@ -280,6 +280,7 @@ private slots:
 
 private:
     void initEdbee();
+    void startProfile(Host*);
 
     void goingDown() { mIsGoingDown = true; }
     QMap<QString, TConsole*> mTabMap;
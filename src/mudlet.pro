@@ -226,6 +226,7 @@ SOURCES += \
     TAlias.cpp \
     TArea.cpp \
     TBuffer.cpp \
+    TBufferSearchIndex.cpp \
     TCommandLine.cpp \
     TConsole.cpp \
     TDebug.cpp \
@@ -237,19 +238,29 @@ SOURCES += \
     TimerUnit.cpp \
     TKey.cpp \
     TLabel.cpp \
+    TLogWriter.cpp \
     TLuaInterpreter.cpp \
     TMap.cpp \
+    TMapRouter.cpp \
+    TMatchSubject.cpp \
+    TProfiler.cpp \
+    TProtocolDecoder.cpp \
+    TRegex.cpp \
+    TReplayBenchmark.cpp \
     TriggerUnit.cpp \
     TRoom.cpp \
     TRoomDB.cpp \
+    TRoomSearchIndex.cpp \
     TScript.cpp \
     TSplitter.cpp \
     TSplitterHandle.cpp \
+    TTelnetReader.cpp \
     TTextEdit.cpp \
     TTimer.cpp \
     TToolBar.cpp \
     TTreeWidget.cpp \
     TTrigger.cpp \
+    TTriggerIndex.cpp \
     TVar.cpp \
     VarUnit.cpp \
     XMLexport.cpp \
@@ -299,6 +310,7 @@ HEADERS += \
     TArea.h \
     TAstar.h \
     TBuffer.h \
+    TBufferSearchIndex.h \
     TCommandLine.h \
     TConsole.h \
     TDebug.h \
@@ -312,21 +324,32 @@ HEADERS += \
     TimerUnit.h \
     TKey.h \
     TLabel.h \
+    TLogWriter.h \
     TLuaInterpreter.h \
     TMap.h \
+    TMapRouter.h \
     TMatchState.h \
+    TMatchSubject.h \
+    TProfiler.h \
+    TProtocolDecoder.h \
     Tree.h \
+    TRegex.h \
+    TReplayBenchmark.h \
     TriggerUnit.h \
     TRoom.h \
     TRoomDB.h \
+    TRoomSearchIndex.h \
     TScript.h \
     TSplitter.h \
     TSplitterHandle.h \
+    TSpscQueue.h \
+    TTelnetReader.h \
     TTextEdit.h \
     TTimer.h \
     TToolBar.h \
     TTreeWidget.h \
     TTrigger.h \
+    TTriggerIndex.h \
     TVar.h \
     VarUnit.h \
     XMLexport.h \
@@ -0,0 +1,147 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "TTelnetReader.h"
+
+
+#include "ctelnet.h"
+
+#include "pre_guard.h"
+#include <QtTest/QtTest>
+#include "post_guard.h"
+
+#include <zlib.h>
+
+
+// Checks that the network thread's reader finds the MCCP start sequences
+// that cTelnet::processSocketData() would, however the data is split up
+// between reads, and passes everything else on as it was:
+class TTelnetReaderTest : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    // Where the reader says there are chunks to take, the tests take them
+    // directly instead:
+    void slot_processNetworkQueue() {}
+
+private slots:
+    void testV2StartSplitAnywhere();
+    void testV1StartSplitAnywhere();
+    void testStartNotAllowed();
+    void testStartAfterUnacceptedV1();
+    void testIacEndsFailedStart();
+
+private:
+    static QByteArray compressed(const QByteArray& data);
+    QByteArray feed(TTelnetReader& reader, const QByteArray& input, int split);
+    void checkEverySplit(const QByteArray& input, const QByteArray& expected);
+
+    const QByteArray mV1Start = QByteArray() + TN_IAC + TN_SB + OPT_COMPRESS + TN_WILL + TN_SE;
+    const QByteArray mV2Start = QByteArray() + TN_IAC + TN_SB + OPT_COMPRESS2 + TN_IAC + TN_SE;
+};
+
+QByteArray TTelnetReaderTest::compressed(const QByteArray& data)
+{
+    uLongf size = compressBound(static_cast<uLong>(data.size()));
+    QByteArray result(static_cast<int>(size), '\0');
+    compress(reinterpret_cast<Bytef*>(result.data()), &size, reinterpret_cast<const Bytef*>(data.constData()), static_cast<uLong>(data.size()));
+    result.resize(static_cast<int>(size));
+    return result;
+}
+
+// Gives the input to the reader in two reads, split at the given point, and
+// returns what it passes on with the start and end of compression marked:
+QByteArray TTelnetReaderTest::feed(TTelnetReader& reader, const QByteArray& input, const int split)
+{
+    reader.scan(input.constData(), split);
+    reader.scan(input.constData() + split, input.size() - split);
+
+    QByteArray result;
+    TTelnetChunk chunk;
+    while (reader.takeChunk(chunk)) {
+        switch (chunk.type) {
+        case TTelnetChunk::Data:
+            result.append(chunk.data);
+            break;
+        case TTelnetChunk::CompressionStarted:
+            result.append("<start>");
+            break;
+        case TTelnetChunk::CompressionEnded:
+            result.append("<end>");
+            break;
+        default:
+            break;
+        }
+    }
+    return result;
+}
+
+void TTelnetReaderTest::checkEverySplit(const QByteArray& input, const QByteArray& expected)
+{
+    for (int split = 0; split <= input.size(); ++split) {
+        TTelnetReader reader(this);
+        reader.slot_setCompressionAllowed(true);
+        QCOMPARE(feed(reader, input, split), expected);
+    }
+}
+
+void TTelnetReaderTest::testV2StartSplitAnywhere()
+{
+    checkEverySplit(QByteArray("before") + mV2Start + compressed("inside") + "after", QByteArray("before<start>inside<end>after"));
+}
+
+void TTelnetReaderTest::testV1StartSplitAnywhere()
+{
+    checkEverySplit(QByteArray("before") + mV1Start + compressed("inside") + "after", QByteArray("before<start>inside<end>after"));
+}
+
+void TTelnetReaderTest::testStartNotAllowed()
+{
+    const QByteArray input = QByteArray("before") + mV2Start + "after";
+    for (int split = 0; split <= input.size(); ++split) {
+        TTelnetReader reader(this);
+        QCOMPARE(feed(reader, input, split), input);
+    }
+}
+
+// cTelnet treats an unaccepted v1 start as a sub-negotiation that has not
+// ended, but still takes a start sequence that comes inside it:
+void TTelnetReaderTest::testStartAfterUnacceptedV1()
+{
+    const QByteArray input = mV2Start + compressed("inside") + "after";
+    for (int split = 0; split <= input.size(); ++split) {
+        TTelnetReader reader(this);
+        QCOMPARE(feed(reader, QByteArray("before") + mV1Start, 0), QByteArray("before") + mV1Start);
+        reader.slot_setCompressionAllowed(true);
+        QCOMPARE(feed(reader, input, split), QByteArray("<start>inside<end>after"));
+    }
+}
+
+// An IAC as the last byte of what might have been a start sequence begins an
+// IAC SE that ends the sub-negotiation, so a start sequence after that is
+// still found:
+void TTelnetReaderTest::testIacEndsFailedStart()
+{
+    const QByteArray subNegotiation = QByteArray() + TN_IAC + TN_SB + OPT_COMPRESS2 + 'x' + TN_IAC + TN_SE;
+    checkEverySplit(subNegotiation + "between" + mV2Start + compressed("inside"), subNegotiation + "between<start>inside<end>");
+}
+
+QTEST_GUILESS_MAIN(TTelnetReaderTest)
+#include "TTelnetReaderTest.moc"